@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_audio.c
+ * @brief Block rendering, the SPSC ring and the pre-render stream.
+ * @details The sample-to-frame map is monotonic (for a fixed multiplier), so
+ * the samples of a block that fall inside one hold are contiguous. A hold's
+ * last sample is estimated from the frame where the hold ends, then
+ * corrected against fpsr_audio_frame_at() itself, so rounding in the
+ * estimate can never move a sample across a hold boundary.
+ *
+ * The ring keeps two free-running counters, head (samples written) and tail
+ * (samples read), each on its own cache line and each stored by one side
+ * only. The producer publishes samples by storing head with release order
+ * after writing them; the consumer acquires head before copying and
+ * releases tail after, which hands the space back.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fpsr_audio.h"
+
+#include <errno.h> // For errno
+#include <limits.h> // For INT_MIN and INT_MAX
+#include <math.h> // For floor() and ceil()
+#include <pthread.h> // For the stream's worker
+#include <stdatomic.h> // For the ring counters
+#include <stdlib.h> // For aligned_alloc() and free()
+#include <string.h> // For memcpy() and memset()
+#include <time.h> // For nanosleep()
+
+#include "fpsr_segments.h"
+
+#define FPSR_AUDIO_DEFAULT_CAPACITY 8192
+#define FPSR_AUDIO_DEFAULT_POLL_NS 250000L
+
+
+/******************************************************************************/
+/* Voices                                                                     */
+/******************************************************************************/
+
+static void fpsr_audio_voice_init(fpsr_audio_voice* v, fpsr_bake_algorithm algorithm, double startFrame, double frameMultiplier) {
+    memset(v, 0, sizeof *v);
+    v->algorithm = algorithm;
+    v->origin = startFrame;
+    v->frameMultiplier = frameMultiplier;
+    v->sample = 0;
+}
+
+void fpsr_audio_voice_sm(fpsr_audio_voice* v, const fpsr_sm_params* p, double startFrame, double frameMultiplier) {
+    fpsr_audio_voice_init(v, FPSR_BAKE_SM, startFrame, frameMultiplier);
+    v->sm = *p;
+}
+
+void fpsr_audio_voice_tm(fpsr_audio_voice* v, const fpsr_tm_params* p, double startFrame, double frameMultiplier) {
+    fpsr_audio_voice_init(v, FPSR_BAKE_TM, startFrame, frameMultiplier);
+    v->tm = *p;
+}
+
+void fpsr_audio_voice_qs(fpsr_audio_voice* v, const fpsr_qs_params* p, double startFrame, double frameMultiplier) {
+    fpsr_audio_voice_init(v, FPSR_BAKE_QS, startFrame, frameMultiplier);
+    v->qs = *p;
+}
+
+double fpsr_audio_voice_position(const fpsr_audio_voice* v) {
+    return v->origin + (double)v->sample * v->frameMultiplier;
+}
+
+void fpsr_audio_voice_set_multiplier(fpsr_audio_voice* v, double frameMultiplier) {
+    v->origin = fpsr_audio_voice_position(v);
+    v->sample = 0;
+    v->frameMultiplier = frameMultiplier;
+}
+
+int fpsr_audio_frame_at(const fpsr_audio_voice* v, int64_t offset) {
+    const double frame = floor(v->origin + (double)(v->sample + offset) * v->frameMultiplier);
+    if (!(frame > (double)INT_MIN)) { return INT_MIN; } // also catches NaN
+    if (frame >= (double)INT_MAX) { return INT_MAX; }
+    return (int)frame;
+}
+
+static float fpsr_audio_eval(const fpsr_audio_voice* v, int frame) {
+    switch (v->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_eval(&v->sm, frame);
+    case FPSR_BAKE_TM: return fpsr_tm_eval(&v->tm, frame);
+    case FPSR_BAKE_QS: return fpsr_qs_eval(&v->qs, frame);
+    }
+    return 0.0f;
+}
+
+float fpsr_audio_value_at(const fpsr_audio_voice* v, int64_t offset) {
+    return fpsr_audio_eval(v, fpsr_audio_frame_at(v, offset));
+}
+
+static int fpsr_audio_next_change(const fpsr_audio_voice* v, int frame, int lastFrame, int* changeFrame) {
+    switch (v->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_next_change(&v->sm, frame, lastFrame, changeFrame);
+    case FPSR_BAKE_TM: return fpsr_tm_next_change(&v->tm, frame, lastFrame, changeFrame);
+    case FPSR_BAKE_QS: return fpsr_qs_next_change(&v->qs, frame, lastFrame, changeFrame);
+    }
+    return 0;
+}
+
+static int fpsr_audio_last_change(const fpsr_audio_voice* v, int frame, int firstFrame, int* changeFrame) {
+    switch (v->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_last_change(&v->sm, frame, firstFrame, changeFrame);
+    case FPSR_BAKE_TM: return fpsr_tm_last_change(&v->tm, frame, firstFrame, changeFrame);
+    case FPSR_BAKE_QS: return fpsr_qs_last_change(&v->qs, frame, firstFrame, changeFrame);
+    }
+    return 0;
+}
+
+/** @brief Whether sample j reads a frame past bound: >= bound going forward, < bound going back. */
+static inline int fpsr_audio_outside(const fpsr_audio_voice* v, size_t j, int bound, int forward) {
+    const int frame = fpsr_audio_frame_at(v, (int64_t)j);
+    return forward ? frame >= bound : frame < bound;
+}
+
+/**
+ * @brief First sample in (i, n) that reads a frame past bound, given that
+ * sample n - 1 does.
+ */
+static size_t fpsr_audio_span_end(const fpsr_audio_voice* v, size_t i, size_t n, int bound, int forward) {
+    const double m = v->frameMultiplier;
+    const double at = ((double)bound - v->origin) / m - (double)v->sample;
+    const double guess = forward ? ceil(at) : floor(at) + 1.0;
+    size_t j = n - 1;
+    if (guess < (double)(n - 1)) { j = guess > (double)(i + 1) ? (size_t)guess : i + 1; }
+    while (j > i + 1 && fpsr_audio_outside(v, j - 1, bound, forward)) { j--; }
+    while (!fpsr_audio_outside(v, j, bound, forward)) { j++; }
+    return j;
+}
+
+void fpsr_audio_process(fpsr_audio_voice* v, float* block, size_t nframes) {
+    if (nframes == 0) { return; }
+    const int lastFrame = fpsr_audio_frame_at(v, (int64_t)nframes - 1);
+    size_t i = 0;
+    while (i < nframes) {
+        const int frame = fpsr_audio_frame_at(v, (int64_t)i);
+        const float value = fpsr_audio_eval(v, frame);
+        size_t end = nframes;
+        int bound;
+        if (lastFrame > frame && fpsr_audio_next_change(v, frame, lastFrame, &bound)) {
+            end = fpsr_audio_span_end(v, i, nframes, bound, 1);
+        } else if (lastFrame < frame && fpsr_audio_last_change(v, frame, lastFrame, &bound)) {
+            end = fpsr_audio_span_end(v, i, nframes, bound, 0);
+        }
+        for (size_t k = i; k < end; k++) { block[k] = value; }
+        i = end;
+    }
+    v->sample += (int64_t)nframes;
+}
+
+
+/******************************************************************************/
+/* Ring buffer                                                                */
+/******************************************************************************/
+
+struct fpsr_audio_ring {
+    _Alignas(64) _Atomic size_t head; // stored by the producer
+    _Alignas(64) _Atomic size_t tail; // stored by the consumer
+    _Alignas(64) float* data;
+    size_t mask;
+};
+
+fpsr_audio_ring* fpsr_audio_ring_create(size_t capacity) {
+    size_t size = 64;
+    while (size < capacity && size < SIZE_MAX / 2 / sizeof(float)) { size *= 2; }
+
+    fpsr_audio_ring* ring = (fpsr_audio_ring*)aligned_alloc(64, sizeof(fpsr_audio_ring));
+    float* data = (float*)aligned_alloc(64, size * sizeof(float));
+    if (!ring || !data) {
+        free(ring);
+        free(data);
+        errno = ENOMEM;
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->data = data;
+    ring->mask = size - 1;
+    return ring;
+}
+
+void fpsr_audio_ring_destroy(fpsr_audio_ring* ring) {
+    if (!ring) { return; }
+    free(ring->data);
+    free(ring);
+}
+
+size_t fpsr_audio_ring_capacity(const fpsr_audio_ring* ring) {
+    return ring->mask + 1;
+}
+
+size_t fpsr_audio_ring_readable(const fpsr_audio_ring* ring) {
+    fpsr_audio_ring* r = (fpsr_audio_ring*)ring;
+    return atomic_load_explicit(&r->head, memory_order_acquire) - atomic_load_explicit(&r->tail, memory_order_relaxed);
+}
+
+size_t fpsr_audio_ring_writable(const fpsr_audio_ring* ring) {
+    fpsr_audio_ring* r = (fpsr_audio_ring*)ring;
+    const size_t used = atomic_load_explicit(&r->head, memory_order_relaxed) - atomic_load_explicit(&r->tail, memory_order_acquire);
+    return r->mask + 1 - used;
+}
+
+size_t fpsr_audio_ring_render(fpsr_audio_ring* ring, fpsr_audio_voice* v, size_t nframes) {
+    const size_t space = fpsr_audio_ring_writable(ring);
+    const size_t n = nframes < space ? nframes : space;
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const size_t at = head & ring->mask;
+    const size_t first = n < ring->mask + 1 - at ? n : ring->mask + 1 - at;
+    fpsr_audio_process(v, ring->data + at, first);
+    fpsr_audio_process(v, ring->data, n - first);
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    return n;
+}
+
+size_t fpsr_audio_ring_read(fpsr_audio_ring* ring, float* out, size_t nframes) {
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const size_t ready = atomic_load_explicit(&ring->head, memory_order_acquire) - tail;
+    const size_t n = nframes < ready ? nframes : ready;
+    const size_t at = tail & ring->mask;
+    const size_t first = n < ring->mask + 1 - at ? n : ring->mask + 1 - at;
+    memcpy(out, ring->data + at, first * sizeof(float));
+    memcpy(out + first, ring->data, (n - first) * sizeof(float));
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    return n;
+}
+
+
+/******************************************************************************/
+/* Streams                                                                    */
+/******************************************************************************/
+
+struct fpsr_audio_stream {
+    fpsr_audio_ring* ring;
+    fpsr_audio_voice voice; // the worker's
+    size_t chunk;
+    struct timespec poll;
+    _Atomic int stop;
+    _Atomic int pending; // a new multiplier is waiting in multiplier
+    _Atomic uint64_t multiplier; // double bits
+    _Alignas(64) _Atomic uint64_t xruns; // stored by the consumer
+    pthread_t thread;
+};
+
+static void* fpsr_audio_stream_work(void* arg) {
+    fpsr_audio_stream* s = (fpsr_audio_stream*)arg;
+    while (!atomic_load_explicit(&s->stop, memory_order_acquire)) {
+        if (atomic_exchange_explicit(&s->pending, 0, memory_order_acquire)) {
+            const uint64_t bits = atomic_load_explicit(&s->multiplier, memory_order_relaxed);
+            double m;
+            memcpy(&m, &bits, sizeof m);
+            fpsr_audio_voice_set_multiplier(&s->voice, m);
+        }
+        if (fpsr_audio_ring_writable(s->ring) >= s->chunk) {
+            fpsr_audio_ring_render(s->ring, &s->voice, s->chunk);
+        } else {
+            nanosleep(&s->poll, NULL);
+        }
+    }
+    return NULL;
+}
+
+fpsr_audio_stream* fpsr_audio_stream_start(const fpsr_audio_voice* voice, const fpsr_audio_stream_options* options) {
+    const fpsr_audio_stream_options none = { 0, 0, 0 };
+    if (!options) { options = &none; }
+
+    fpsr_audio_stream* s = (fpsr_audio_stream*)aligned_alloc(64, sizeof(fpsr_audio_stream));
+    fpsr_audio_ring* ring = fpsr_audio_ring_create(options->capacity ? options->capacity : FPSR_AUDIO_DEFAULT_CAPACITY);
+    if (!s || !ring) {
+        free(s);
+        fpsr_audio_ring_destroy(ring);
+        errno = ENOMEM;
+        return NULL;
+    }
+    const size_t capacity = fpsr_audio_ring_capacity(ring);
+    const long pollNs = options->pollNs > 0 ? options->pollNs : FPSR_AUDIO_DEFAULT_POLL_NS;
+    s->ring = ring;
+    s->voice = *voice;
+    s->chunk = options->chunk && options->chunk <= capacity ? options->chunk : capacity / 4;
+    s->poll.tv_sec = pollNs / 1000000000L;
+    s->poll.tv_nsec = pollNs % 1000000000L;
+    atomic_init(&s->stop, 0);
+    atomic_init(&s->pending, 0);
+    atomic_init(&s->multiplier, 0);
+    atomic_init(&s->xruns, 0);
+
+    // Start full, so the consumer has the whole ring of headroom from its first read
+    fpsr_audio_ring_render(ring, &s->voice, capacity);
+
+    const int error = pthread_create(&s->thread, NULL, fpsr_audio_stream_work, s);
+    if (error != 0) {
+        fpsr_audio_ring_destroy(ring);
+        free(s);
+        errno = error;
+        return NULL;
+    }
+    return s;
+}
+
+void fpsr_audio_stream_stop(fpsr_audio_stream* stream) {
+    if (!stream) { return; }
+    atomic_store_explicit(&stream->stop, 1, memory_order_release);
+    pthread_join(stream->thread, NULL);
+    fpsr_audio_ring_destroy(stream->ring);
+    free(stream);
+}
+
+size_t fpsr_audio_stream_read(fpsr_audio_stream* stream, float* out, size_t nframes) {
+    const size_t n = fpsr_audio_ring_read(stream->ring, out, nframes);
+    if (n < nframes) { atomic_fetch_add_explicit(&stream->xruns, 1, memory_order_relaxed); }
+    return n;
+}
+
+void fpsr_audio_stream_set_multiplier(fpsr_audio_stream* stream, double frameMultiplier) {
+    uint64_t bits;
+    memcpy(&bits, &frameMultiplier, sizeof bits);
+    atomic_store_explicit(&stream->multiplier, bits, memory_order_relaxed);
+    atomic_store_explicit(&stream->pending, 1, memory_order_release);
+}
+
+uint64_t fpsr_audio_stream_xruns(const fpsr_audio_stream* stream) {
+    return atomic_load_explicit(&((fpsr_audio_stream*)stream)->xruns, memory_order_relaxed);
+}
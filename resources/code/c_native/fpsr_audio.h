@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_audio.h
+ * @brief Block rendering of FPS-R at audio rate, with a lock-free hand-off to a real-time thread.
+ * @details A voice plays one preset on a sample clock. Sample n of the voice
+ * reads FPS-R frame
+ *     floor(origin + n * frameMultiplier)
+ * so frameMultiplier is FPS-R frames per sample: 24.0 / 48000 plays a 24 fps
+ * pattern under a 48 kHz stream, 1.0 gives a new frame every sample, 0
+ * freezes the voice and a negative value plays it backwards. Changing it
+ * with fpsr_audio_voice_set_multiplier() re-anchors the voice at its current
+ * position, so tempo changes never jump.
+ *
+ * fpsr_audio_process() fills a block by holds rather than by samples: it
+ * evaluates the value once at the start of a hold, finds where the hold ends
+ * with fpsr_segments.h, works out how many samples of the block fall inside
+ * it, and writes that span in one fill. Per-sample cost is a store; the
+ * FPS-R arithmetic is paid once per hold. The output is bit-identical to
+ * fpsr_audio_value_at() sample by sample.
+ *
+ * For real-time use, a stream renders a voice ahead of the consumer from
+ * its own thread into a single-producer, single-consumer ring buffer.
+ * fpsr_audio_stream_read(), called from the audio callback, only copies out
+ * of the ring and publishes its position with one atomic store: it never
+ * allocates, locks or waits. A read that finds too few samples (an xrun)
+ * returns what there is and is counted. The ring is usable on its own for
+ * callers that run their own producer.
+ *
+ * Frames outside the int range are clamped to INT_MIN / INT_MAX.
+ *
+ * POSIX only (pthreads, for the stream's worker).
+ */
+
+#ifndef FPSR_AUDIO_H
+#define FPSR_AUDIO_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For int64_t and uint64_t
+
+#include "fpsr_bake.h" // For fpsr_bake_algorithm
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Voices                                                                     */
+/******************************************************************************/
+
+/**
+ * @brief One preset on a sample clock. The preset is copied in, so a voice
+ * can be handed to another thread without the caller's storage.
+ */
+typedef struct fpsr_audio_voice {
+    fpsr_bake_algorithm algorithm;
+    fpsr_sm_params sm;
+    fpsr_tm_params tm;
+    fpsr_qs_params qs;
+    double origin; // FPS-R frame (fractional) at the anchor
+    double frameMultiplier; // FPS-R frames per sample
+    int64_t sample; // samples rendered since the anchor
+} fpsr_audio_voice;
+
+/** @brief Sets up a voice at FPS-R frame startFrame. */
+void fpsr_audio_voice_sm(fpsr_audio_voice* v, const fpsr_sm_params* p, double startFrame, double frameMultiplier);
+void fpsr_audio_voice_tm(fpsr_audio_voice* v, const fpsr_tm_params* p, double startFrame, double frameMultiplier);
+void fpsr_audio_voice_qs(fpsr_audio_voice* v, const fpsr_qs_params* p, double startFrame, double frameMultiplier);
+
+/** @brief The fractional FPS-R frame the next sample reads. */
+double fpsr_audio_voice_position(const fpsr_audio_voice* v);
+
+/** @brief Changes the time scale from the next sample on. */
+void fpsr_audio_voice_set_multiplier(fpsr_audio_voice* v, double frameMultiplier);
+
+/** @brief The FPS-R frame of sample offset (relative to the next sample). */
+int fpsr_audio_frame_at(const fpsr_audio_voice* v, int64_t offset);
+
+/** @brief The value of sample offset, evaluated directly. The reference fpsr_audio_process() matches. */
+float fpsr_audio_value_at(const fpsr_audio_voice* v, int64_t offset);
+
+/** @brief Renders the next nframes samples into block and advances the voice. */
+void fpsr_audio_process(fpsr_audio_voice* v, float* block, size_t nframes);
+
+
+/******************************************************************************/
+/* Ring buffer                                                                */
+/******************************************************************************/
+
+/** @brief A single-producer, single-consumer ring of samples. */
+typedef struct fpsr_audio_ring fpsr_audio_ring;
+
+/**
+ * @brief Creates a ring holding at least capacity samples (rounded up to a
+ * power of two, minimum 64).
+ * @return NULL with errno set if out of memory.
+ */
+fpsr_audio_ring* fpsr_audio_ring_create(size_t capacity);
+void fpsr_audio_ring_destroy(fpsr_audio_ring* ring);
+
+size_t fpsr_audio_ring_capacity(const fpsr_audio_ring* ring);
+
+/** @brief Samples the consumer can read. Consumer side. */
+size_t fpsr_audio_ring_readable(const fpsr_audio_ring* ring);
+
+/** @brief Free space the producer can fill. Producer side. */
+size_t fpsr_audio_ring_writable(const fpsr_audio_ring* ring);
+
+/** @brief Renders up to nframes samples of v into the ring. Producer side. @return Samples written. */
+size_t fpsr_audio_ring_render(fpsr_audio_ring* ring, fpsr_audio_voice* v, size_t nframes);
+
+/** @brief Copies up to nframes samples out. Consumer side, real-time safe. @return Samples read. */
+size_t fpsr_audio_ring_read(fpsr_audio_ring* ring, float* out, size_t nframes);
+
+
+/******************************************************************************/
+/* Streams                                                                    */
+/******************************************************************************/
+
+/** @brief A voice pre-rendered by a worker thread into a ring. */
+typedef struct fpsr_audio_stream fpsr_audio_stream;
+
+/**
+ * @brief Buffering knobs. Zero fields pick the defaults.
+ */
+typedef struct fpsr_audio_stream_options {
+    size_t capacity; // ring size in samples; default: 8192
+    size_t chunk; // samples the worker renders at a time; default: capacity / 4
+    long pollNs; // how long the worker sleeps when the ring is full; default: 250000
+} fpsr_audio_stream_options;
+
+/**
+ * @brief Fills a ring from voice (copied) and starts its worker.
+ * @return NULL with errno set if out of memory or the thread cannot start.
+ */
+fpsr_audio_stream* fpsr_audio_stream_start(const fpsr_audio_voice* voice, const fpsr_audio_stream_options* options);
+
+/** @brief Stops the worker and frees the stream. */
+void fpsr_audio_stream_stop(fpsr_audio_stream* stream);
+
+/**
+ * @brief Copies the next nframes samples into out. Real-time safe.
+ * @return Samples read; fewer than nframes is an xrun, and is counted.
+ */
+size_t fpsr_audio_stream_read(fpsr_audio_stream* stream, float* out, size_t nframes);
+
+/**
+ * @brief Changes the voice's time scale. It takes effect at the next chunk
+ * the worker renders, i.e. after the samples already in the ring.
+ */
+void fpsr_audio_stream_set_multiplier(fpsr_audio_stream* stream, double frameMultiplier);
+
+/** @brief Reads that came up short so far. */
+uint64_t fpsr_audio_stream_xruns(const fpsr_audio_stream* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_AUDIO_H
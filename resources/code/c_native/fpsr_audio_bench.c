@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_audio_bench.c
+ * @brief Render cost, callback latency and xrun benchmark for fpsr_audio.h.
+ * @details Two parts:
+ *     - Render: ns per sample of fpsr_audio_process() in blocks, against
+ *       calling fpsr_*_eval() for every sample, for SM, TM and QS at a 24 fps
+ *       pattern under the stream (24 / rate frames per sample) and at one
+ *       frame per sample. Also prints how many voices fit in one callback.
+ *     - Stream: starts --streams QS streams and runs a simulated audio
+ *       callback on a timer for --seconds, reading one block from each
+ *       stream per period. Prints callback duration percentiles, how late
+ *       the callback woke, and the xrun count.
+ *
+ * Options: --rate HZ (48000), --block N (256), --streams N (4),
+ *          --seconds S (2), --capacity N (ring size, 8192)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 -pthread fpsr_audio_bench.c fpsr_audio.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol(), qsort() and malloc()
+#include <string.h> // For strcmp()
+#include <time.h> // For clock_gettime() and clock_nanosleep()
+
+#include "fpsr_audio.h"
+
+#define FPSR_AUDIO_BENCH_MAX_STREAMS 64
+#define FPSR_AUDIO_BENCH_MAX_BLOCK 8192
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static volatile float fpsr_audio_bench_sink;
+
+static double fpsr_audio_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static void fpsr_audio_bench_voice(fpsr_audio_voice* v, int algorithm, double frameMultiplier) {
+    switch (algorithm) {
+    case 0: fpsr_audio_voice_sm(v, &SM, 0.0, frameMultiplier); break;
+    case 1: fpsr_audio_voice_tm(v, &TM, 0.0, frameMultiplier); break;
+    default: fpsr_audio_voice_qs(v, &QS, 0.0, frameMultiplier); break;
+    }
+}
+
+
+/******************************************************************************/
+/* Render cost                                                                */
+/******************************************************************************/
+
+static void fpsr_audio_bench_render(int rate, int block) {
+    static const char* NAMES[3] = { "sm", "tm", "qs" };
+    static float out[FPSR_AUDIO_BENCH_MAX_BLOCK];
+    const long samples = 4L * rate;
+    const double budget = (double)block / rate * 1e9; // ns per callback
+    const double multipliers[2] = { 24.0 / rate, 1.0 };
+
+    printf("render, %d-sample blocks (%.0f us callback budget):\n", block, budget * 1e-3);
+    printf("%-4s %-12s %12s %12s %9s %14s\n", "alg", "frames/smp", "process ns", "per-smp ns", "speedup", "voices/block");
+    for (int a = 0; a < 3; a++) {
+        for (int m = 0; m < 2; m++) {
+            fpsr_audio_voice v;
+            fpsr_audio_bench_voice(&v, a, multipliers[m]);
+            double t0 = fpsr_audio_bench_now();
+            for (long done = 0; done < samples; done += block) { fpsr_audio_process(&v, out, (size_t)block); }
+            const double blockNs = (fpsr_audio_bench_now() - t0) * 1e9 / ((double)samples / block);
+            fpsr_audio_bench_sink = out[block - 1];
+
+            fpsr_audio_bench_voice(&v, a, multipliers[m]);
+            const long direct = samples / 8; // per-sample evaluation is slow; time fewer samples
+            float sum = 0.0f;
+            t0 = fpsr_audio_bench_now();
+            for (long i = 0; i < direct; i++) { sum += fpsr_audio_value_at(&v, i); }
+            const double directNs = (fpsr_audio_bench_now() - t0) * 1e9 / (double)direct;
+            fpsr_audio_bench_sink = sum;
+
+            const double processNs = blockNs / block;
+            printf("%-4s %-12.6g %12.2f %12.2f %8.1fx %14.0f\n", NAMES[a], multipliers[m], processNs, directNs,
+                   directNs / processNs, budget / blockNs);
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* Stream latency and xruns                                                   */
+/******************************************************************************/
+
+static int fpsr_audio_bench_compare(const void* a, const void* b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int fpsr_audio_bench_stream(int rate, int block, int streams, double seconds, size_t capacity) {
+    fpsr_audio_stream* stream[FPSR_AUDIO_BENCH_MAX_STREAMS];
+    static float out[FPSR_AUDIO_BENCH_MAX_BLOCK];
+    const fpsr_audio_stream_options options = { capacity, 0, 0 };
+    for (int s = 0; s < streams; s++) {
+        fpsr_audio_voice v;
+        fpsr_audio_voice_qs(&v, &QS, 1000.0 * s, 24.0 / rate);
+        stream[s] = fpsr_audio_stream_start(&v, &options);
+        if (!stream[s]) {
+            perror("fpsr_audio_stream_start");
+            while (s--) { fpsr_audio_stream_stop(stream[s]); }
+            return 1;
+        }
+    }
+
+    const long periodNs = (long)((double)block / rate * 1e9);
+    const long callbacks = (long)(seconds * rate / block);
+    double* duration = (double*)malloc(sizeof(double) * (size_t)callbacks);
+    double* lateness = (double*)malloc(sizeof(double) * (size_t)callbacks);
+    if (!duration || !lateness) {
+        free(duration);
+        free(lateness);
+        for (int s = 0; s < streams; s++) { fpsr_audio_stream_stop(stream[s]); }
+        return 1;
+    }
+
+    struct timespec due;
+    clock_gettime(CLOCK_MONOTONIC, &due);
+    for (long c = 0; c < callbacks; c++) {
+        due.tv_nsec += periodNs;
+        while (due.tv_nsec >= 1000000000L) {
+            due.tv_nsec -= 1000000000L;
+            due.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+        const double woke = fpsr_audio_bench_now();
+        for (int s = 0; s < streams; s++) { fpsr_audio_stream_read(stream[s], out, (size_t)block); }
+        duration[c] = (fpsr_audio_bench_now() - woke) * 1e9;
+        lateness[c] = (woke - ((double)due.tv_sec + (double)due.tv_nsec * 1e-9)) * 1e9;
+    }
+
+    uint64_t xruns = 0;
+    for (int s = 0; s < streams; s++) {
+        xruns += fpsr_audio_stream_xruns(stream[s]);
+        fpsr_audio_stream_stop(stream[s]);
+    }
+    qsort(duration, (size_t)callbacks, sizeof(double), fpsr_audio_bench_compare);
+    qsort(lateness, (size_t)callbacks, sizeof(double), fpsr_audio_bench_compare);
+    printf("\nstream: %d QS streams, %ld callbacks of %d samples every %.0f us, ring %zu samples\n", streams, callbacks,
+           block, periodNs * 1e-3, capacity);
+    printf("callback ns: p50 %.0f  p99 %.0f  max %.0f\n", duration[callbacks / 2], duration[callbacks * 99 / 100],
+           duration[callbacks - 1]);
+    printf("wake-up late us: p50 %.1f  p99 %.1f  max %.1f\n", lateness[callbacks / 2] * 1e-3,
+           lateness[callbacks * 99 / 100] * 1e-3, lateness[callbacks - 1] * 1e-3);
+    printf("xruns: %llu\n", (unsigned long long)xruns);
+    free(duration);
+    free(lateness);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int rate = 48000, block = 256, streams = 4;
+    double seconds = 2.0;
+    size_t capacity = 8192;
+    for (int i = 1; i < argc; i++) {
+        const int hasValue = i + 1 < argc;
+        if (hasValue && strcmp(argv[i], "--rate") == 0) { rate = (int)strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--block") == 0) { block = (int)strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--streams") == 0) { streams = (int)strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--seconds") == 0) { seconds = strtod(argv[++i], NULL); }
+        else if (hasValue && strcmp(argv[i], "--capacity") == 0) { capacity = (size_t)strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--rate HZ] [--block N] [--streams N] [--seconds S] [--capacity N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rate < 1 || block < 1 || block > FPSR_AUDIO_BENCH_MAX_BLOCK || streams < 1 ||
+        streams > FPSR_AUDIO_BENCH_MAX_STREAMS || seconds * rate < block) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+    fpsr_audio_bench_render(rate, block);
+    return fpsr_audio_bench_stream(rate, block, streams, seconds, capacity);
+}
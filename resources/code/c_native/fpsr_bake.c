@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_bake.c
+ * @brief Tiled bake engine on a work-stealing thread pool.
+ * @details The tiles of a bake are numbered entity block by entity block, so a
+ * run of consecutive tiles covers consecutive rows of the output. Every
+ * thread owns a queue that is nothing but a [begin, end) run of tile numbers
+ * packed into one atomic 64-bit word. The owner takes tiles from the front;
+ * a thief takes the back half. Both do it with a single compare-and-swap on
+ * the same word, so they can never hand out a tile twice, and a run only
+ * ever shrinks, so an old value cannot reappear (no ABA).
+ *
+ * Threads that cannot be started are not an error: their runs stay in the
+ * pool and are stolen by the others.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fpsr_bake.h"
+
+#include <errno.h> // For errno
+#include <fcntl.h> // For open()
+#include <pthread.h> // For the worker threads
+#include <stdatomic.h> // For the tile queues
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset() and memcpy()
+#include <sys/mman.h> // For mmap()
+#include <unistd.h> // For ftruncate(), close(), unlink() and sysconf()
+
+#define FPSR_BAKE_TILE_ENTITIES 16
+#define FPSR_BAKE_TILE_FRAMES 2048
+#define FPSR_BAKE_DATA_OFFSET 64
+
+_Static_assert(sizeof(fpsr_bake_header) == FPSR_BAKE_DATA_OFFSET, "fpsr_bake_header must be 64 bytes");
+
+
+/******************************************************************************/
+/* Tile queues                                                                */
+/******************************************************************************/
+
+/** @brief One thread's run of tiles: begin in the low 32 bits, end in the high 32. */
+typedef struct fpsr_bake_queue {
+    _Alignas(64) _Atomic uint64_t span;
+} fpsr_bake_queue;
+
+static inline uint64_t fpsr_bake_span(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+/** @brief Takes the first tile of the owner's run. */
+static int fpsr_bake_pop(fpsr_bake_queue* q, uint32_t* tile) {
+    uint64_t span = atomic_load_explicit(&q->span, memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)span;
+        uint32_t end = (uint32_t)(span >> 32);
+        if (begin >= end) {
+            return 0;
+        }
+        if (atomic_compare_exchange_weak(&q->span, &span, fpsr_bake_span(begin + 1, end))) {
+            *tile = begin;
+            return 1;
+        }
+    }
+}
+
+/** @brief Moves the back half of victim's run into own (which must be empty). */
+static int fpsr_bake_steal(fpsr_bake_queue* victim, fpsr_bake_queue* own) {
+    uint64_t span = atomic_load_explicit(&victim->span, memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)span;
+        uint32_t end = (uint32_t)(span >> 32);
+        if (begin >= end) {
+            return 0;
+        }
+        uint32_t take = (end - begin + 1) / 2;
+        if (atomic_compare_exchange_weak(&victim->span, &span, fpsr_bake_span(begin, end - take))) {
+            atomic_store(&own->span, fpsr_bake_span(end - take, end));
+            return 1;
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* Pool                                                                       */
+/******************************************************************************/
+
+typedef struct fpsr_bake_pool {
+    const fpsr_bake_job* job;
+    float* out;
+    size_t tileEntities;
+    int tileFrames;
+    uint32_t frameTiles; // tiles per entity block
+    int threads;
+    fpsr_bake_queue* queues;
+} fpsr_bake_pool;
+
+typedef struct fpsr_bake_worker {
+    fpsr_bake_pool* pool;
+    int index;
+    int started;
+    pthread_t thread;
+} fpsr_bake_worker;
+
+/** @brief Evaluates one tile into the output rows. */
+static void fpsr_bake_tile(const fpsr_bake_pool* pool, uint32_t tile) {
+    const fpsr_bake_job* job = pool->job;
+    size_t e0 = (size_t)(tile / pool->frameTiles) * pool->tileEntities;
+    size_t e1 = e0 + pool->tileEntities < job->entityCount ? e0 + pool->tileEntities : job->entityCount;
+    int f0 = (int)(tile % pool->frameTiles) * pool->tileFrames;
+    int frames = job->frameCount - f0 < pool->tileFrames ? job->frameCount - f0 : pool->tileFrames;
+    int frame = job->firstFrame + f0;
+
+    for (size_t e = e0; e < e1; e++) {
+        float* row = pool->out + e * (size_t)job->frameCount + f0;
+        switch (job->algorithm) {
+        case FPSR_BAKE_SM: {
+            fpsr_sm_params p = *job->sm;
+            if (job->seedInner) { p.seedInner = job->seedInner[e]; }
+            if (job->seedOuter) { p.seedOuter = job->seedOuter[e]; }
+            fpsr_sm_batch_frames(&p, frame, row, (size_t)frames);
+            break;
+        }
+        case FPSR_BAKE_TM: {
+            fpsr_tm_params p = *job->tm;
+            if (job->seedInner) { p.seedInner = job->seedInner[e]; }
+            if (job->seedOuter) { p.seedOuter = job->seedOuter[e]; }
+            fpsr_tm_batch_frames(&p, frame, row, (size_t)frames);
+            break;
+        }
+        case FPSR_BAKE_QS: {
+            fpsr_qs_params p = *job->qs;
+            for (int s = 0; s < 2; s++) {
+                if (job->qsSeeds.streamsOffset[s]) { p.streamsOffset[s] = job->qsSeeds.streamsOffset[s][e]; }
+                if (job->qsSeeds.quantOffsets[s]) { p.quantOffsets[s] = job->qsSeeds.quantOffsets[s][e]; }
+            }
+            fpsr_qs_batch_frames(&p, frame, row, (size_t)frames);
+            break;
+        }
+        }
+    }
+}
+
+/** @brief Drains the worker's own run, then steals until every run is empty. */
+static void* fpsr_bake_work(void* arg) {
+    fpsr_bake_worker* worker = (fpsr_bake_worker*)arg;
+    fpsr_bake_pool* pool = worker->pool;
+    fpsr_bake_queue* own = &pool->queues[worker->index];
+
+    for (;;) {
+        uint32_t tile;
+        while (fpsr_bake_pop(own, &tile)) {
+            fpsr_bake_tile(pool, tile);
+        }
+        int stolen = 0;
+        for (int i = 1; i < pool->threads && !stolen; i++) {
+            stolen = fpsr_bake_steal(&pool->queues[(worker->index + i) % pool->threads], own);
+        }
+        if (!stolen) {
+            return NULL;
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* Entry points                                                               */
+/******************************************************************************/
+
+/**
+ * @brief Checks a job before anything is allocated or created, and fills in
+ * the tiling of the pool.
+ * @return 0 if the job can be baked, -1 with errno EINVAL or EOVERFLOW if not.
+ */
+static int fpsr_bake_check(const fpsr_bake_job* job, const fpsr_bake_options* options, fpsr_bake_pool* pool,
+                           uint64_t* tiles) {
+    const void* preset = job->algorithm == FPSR_BAKE_SM ? (const void*)job->sm
+                       : job->algorithm == FPSR_BAKE_TM ? (const void*)job->tm
+                       : job->algorithm == FPSR_BAKE_QS ? (const void*)job->qs : NULL;
+    if (!preset || job->frameCount < 0 ||
+        (int64_t)job->firstFrame + job->frameCount - 1 > INT_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pool->tileEntities = options->tileEntities > 0 ? (size_t)options->tileEntities : FPSR_BAKE_TILE_ENTITIES;
+    pool->tileFrames = options->tileFrames > 0 ? options->tileFrames : FPSR_BAKE_TILE_FRAMES;
+    pool->frameTiles = job->frameCount > 0 ? (uint32_t)((job->frameCount - 1) / pool->tileFrames + 1) : 0;
+
+    uint64_t entityTiles = job->entityCount > 0 ? (job->entityCount - 1) / pool->tileEntities + 1 : 0;
+    *tiles = entityTiles * pool->frameTiles;
+    if (*tiles > UINT32_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    return 0;
+}
+
+int fpsr_bake(const fpsr_bake_job* job, const fpsr_bake_options* options, float* out) {
+    const fpsr_bake_options none = { 0, 0, 0 };
+    if (!options) { options = &none; }
+
+    fpsr_bake_pool pool;
+    uint64_t tiles;
+    if (fpsr_bake_check(job, options, &pool, &tiles) != 0) {
+        return -1;
+    }
+    if (tiles == 0) {
+        return 0;
+    }
+    pool.job = job;
+    pool.out = out;
+
+    pool.threads = options->threads;
+    if (pool.threads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        pool.threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if ((uint64_t)pool.threads > tiles) { pool.threads = (int)tiles; }
+
+    pool.queues = (fpsr_bake_queue*)aligned_alloc(64, sizeof(fpsr_bake_queue) * (size_t)pool.threads);
+    fpsr_bake_worker* workers = (fpsr_bake_worker*)malloc(sizeof(fpsr_bake_worker) * (size_t)pool.threads);
+    if (!pool.queues || !workers) {
+        free(pool.queues);
+        free(workers);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // Even contiguous runs, one per thread.
+    for (int i = 0; i < pool.threads; i++) {
+        uint32_t begin = (uint32_t)(tiles * (uint64_t)i / (uint64_t)pool.threads);
+        uint32_t end = (uint32_t)(tiles * (uint64_t)(i + 1) / (uint64_t)pool.threads);
+        atomic_init(&pool.queues[i].span, fpsr_bake_span(begin, end));
+        workers[i].pool = &pool;
+        workers[i].index = i;
+    }
+
+    // The calling thread is worker 0.
+    for (int i = 1; i < pool.threads; i++) {
+        workers[i].started = pthread_create(&workers[i].thread, NULL, fpsr_bake_work, &workers[i]) == 0;
+    }
+    fpsr_bake_work(&workers[0]);
+    for (int i = 1; i < pool.threads; i++) {
+        if (workers[i].started) { pthread_join(workers[i].thread, NULL); }
+    }
+
+    free(pool.queues);
+    free(workers);
+    return 0;
+}
+
+/** @brief Closes and removes a bake file that could not be completed, keeping errno. */
+static int fpsr_bake_discard(int fd, const char* path) {
+    int err = errno;
+    close(fd);
+    unlink(path);
+    errno = err;
+    return -1;
+}
+
+int fpsr_bake_to_file(const fpsr_bake_job* job, const fpsr_bake_options* options, const char* path) {
+    // Everything that can be checked is checked before the file is touched.
+    const fpsr_bake_options none = { 0, 0, 0 };
+    fpsr_bake_pool pool;
+    uint64_t tiles;
+    if (fpsr_bake_check(job, options ? options : &none, &pool, &tiles) != 0) {
+        return -1;
+    }
+    if (job->entityCount > (SIZE_MAX - FPSR_BAKE_DATA_OFFSET) / sizeof(float) / ((size_t)job->frameCount + 1)) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    size_t bytes = FPSR_BAKE_DATA_OFFSET + job->entityCount * (size_t)job->frameCount * sizeof(float);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        return fpsr_bake_discard(fd, path);
+    }
+    unsigned char* base = (unsigned char*)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return fpsr_bake_discard(fd, path);
+    }
+
+    fpsr_bake_header header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, "FPSRBAKE", 8);
+    header.version = FPSR_BAKE_VERSION;
+    header.algorithm = (uint32_t)job->algorithm;
+    header.entityCount = job->entityCount;
+    header.firstFrame = job->firstFrame;
+    header.frameCount = job->frameCount;
+    header.dataOffset = FPSR_BAKE_DATA_OFFSET;
+    memcpy(base, &header, sizeof header);
+
+    int result = fpsr_bake(job, options, (float*)(base + FPSR_BAKE_DATA_OFFSET));
+    int err = errno;
+    if (munmap(base, bytes) != 0 && result == 0) {
+        err = errno;
+        result = -1;
+    }
+    if (close(fd) != 0 && result == 0) {
+        err = errno;
+        result = -1;
+    }
+    if (result != 0) {
+        unlink(path);
+    }
+    errno = err;
+    return result;
+}
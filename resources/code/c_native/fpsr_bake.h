@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_bake.h
+ * @brief Multi-threaded bulk baking of FPS-R channels into a memory-mapped file.
+ * @details A bake evaluates one preset for many entities (each with its own
+ * seeds) over a frame range. The (entity, frame) space is cut into tiles of
+ * tileEntities x tileFrames samples, small enough to stay in cache, and the
+ * tiles are spread over a pool of threads:
+ *     - every thread starts with a contiguous run of tiles, so in the common
+ *       case it writes one contiguous region of the file;
+ *     - a thread that runs dry steals the back half of another thread's run,
+ *       which keeps all threads busy when tiles cost different amounts
+ *       (QS vs SM, sparse vs dense entities, busy machines).
+ * Each tile is evaluated with the SIMD kernels of fpsr_batch.h straight into
+ * the mapped output, so no channel is ever buffered in RAM. The engine's own
+ * memory is a few cache lines per thread; the written pages belong to the page
+ * cache and are flushed by the kernel as it sees fit.
+ *
+ * File layout (host byte order, float32 samples):
+ *     fpsr_bake_header (64 bytes)
+ *     entityCount rows of frameCount samples; row e is entity e
+ *
+ * POSIX only (pthreads, mmap).
+ */
+
+#ifndef FPSR_BAKE_H
+#define FPSR_BAKE_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint32_t and uint64_t
+
+#include "fpsr_batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Which algorithm a bake evaluates. */
+typedef enum fpsr_bake_algorithm {
+    FPSR_BAKE_SM = 0,
+    FPSR_BAKE_TM = 1,
+    FPSR_BAKE_QS = 2
+} fpsr_bake_algorithm;
+
+/**
+ * @brief What to bake. Set the preset matching algorithm; the others are ignored.
+ * @details Per-entity seed arrays hold entityCount values each and may be NULL
+ * to use the preset's seed for every entity, as in fpsr_batch.h.
+ */
+typedef struct fpsr_bake_job {
+    fpsr_bake_algorithm algorithm;
+    const fpsr_sm_params* sm;
+    const fpsr_tm_params* tm;
+    const fpsr_qs_params* qs;
+    const int* seedInner; // SM and TM
+    const int* seedOuter; // SM and TM
+    fpsr_qs_seeds qsSeeds; // QS
+    size_t entityCount;
+    int firstFrame;
+    int frameCount;
+} fpsr_bake_job;
+
+/**
+ * @brief Scheduling knobs. Zero fields pick the defaults.
+ */
+typedef struct fpsr_bake_options {
+    int threads; // default: online CPUs
+    int tileEntities; // default: 16
+    int tileFrames; // default: 2048 (16 x 2048 floats = 128 KiB per tile)
+} fpsr_bake_options;
+
+/** @brief Header at the start of a bake file. */
+typedef struct fpsr_bake_header {
+    char magic[8]; // "FPSRBAKE"
+    uint32_t version; // FPSR_BAKE_VERSION
+    uint32_t algorithm; // fpsr_bake_algorithm
+    uint64_t entityCount;
+    int32_t firstFrame;
+    int32_t frameCount;
+    uint64_t dataOffset; // byte offset of row 0
+    uint8_t reserved[24];
+} fpsr_bake_header;
+
+#define FPSR_BAKE_VERSION 1
+
+/**
+ * @brief Bakes a job into caller-owned memory: out[e * frameCount + f].
+ * @details Threads that cannot be started are not an error; their tiles are
+ * baked by the threads that did start (at worst by the calling thread alone).
+ * @return 0 on success, -1 with errno EINVAL (unknown algorithm, missing
+ * preset, negative frameCount or a range past INT_MAX), EOVERFLOW (more than
+ * 2^32 tiles) or ENOMEM.
+ */
+int fpsr_bake(const fpsr_bake_job* job, const fpsr_bake_options* options, float* out);
+
+/**
+ * @brief Bakes a job into a new file at path (replaced if it exists).
+ * @details The job is checked as in fpsr_bake() before path is opened, so an
+ * invalid job leaves any existing file alone. A failure after the file was
+ * created removes it.
+ * @return 0 on success, -1 on failure with errno set by the failing call.
+ */
+int fpsr_bake_to_file(const fpsr_bake_job* job, const fpsr_bake_options* options, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_BAKE_H
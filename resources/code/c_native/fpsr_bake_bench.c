@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_bake_bench.c
+ * @brief Checks of fpsr_bake.h and its throughput against the thread count.
+ * @details With the sample presets of SM, TM and QS and per-entity seeds:
+ *     - Checks (the program exits 1 if one fails):
+ *         - fpsr_bake() into memory, at every thread count timed, gives the
+ *           bits of fpsr_*_eval() for every sample;
+ *         - fpsr_bake_to_file() writes the header and the same samples;
+ *         - an invalid job (unknown algorithm, missing preset, negative
+ *           frameCount, a range past INT_MAX) fails with EINVAL and leaves an
+ *           existing file at the path untouched;
+ *         - a failure after the file was created (ftruncate() past a small
+ *           RLIMIT_FSIZE) removes the file.
+ *     - Throughput: Msamples/s of fpsr_bake() into memory with 1, 2, 4, ...
+ *       threads up to --threads, best of 3. Counts above the online CPUs
+ *       show only the cost of the pool and of stealing.
+ *
+ * Options: --entities N (4096), --frames N (4096), --threads N (max threads, 8)
+ *
+ * Build (POSIX; the flags are the ones fpsr_batch.c expects):
+ *     cc -std=c11 -O3 -fno-trapping-math -pthread fpsr_bake_bench.c fpsr_bake.c fpsr_batch.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h> // For errno
+#include <limits.h> // For INT_MAX
+#include <signal.h> // For signal()
+#include <stdio.h> // For printf() and the file read-back
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <sys/resource.h> // For setrlimit()
+#include <time.h> // For clock_gettime()
+#include <unistd.h> // For access(), unlink() and getpid()
+
+#include "fpsr_bake.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static const char* const NAMES[3] = { "sm", "tm", "qs" };
+
+#define FPSR_BAKE_BENCH_FIRST -1000 // first frame of every bake
+#define FPSR_BAKE_BENCH_SEED -500000 // first per-entity seed
+
+static volatile float fpsr_bake_bench_sink;
+
+static double fpsr_bake_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static fpsr_bake_job fpsr_bake_bench_job(int algorithm, const int* seeds, size_t entities, int frames) {
+    fpsr_bake_job job;
+    memset(&job, 0, sizeof job);
+    job.algorithm = (fpsr_bake_algorithm)algorithm;
+    job.sm = &SM;
+    job.tm = &TM;
+    job.qs = &QS;
+    job.seedOuter = seeds;
+    job.qsSeeds.streamsOffset[0] = seeds;
+    job.qsSeeds.quantOffsets[1] = seeds;
+    job.entityCount = entities;
+    job.firstFrame = FPSR_BAKE_BENCH_FIRST;
+    job.frameCount = frames;
+    return job;
+}
+
+// The reference value of entity e at a frame, one preset per entity.
+static float fpsr_bake_bench_reference(int algorithm, int seed, int frame) {
+    if (algorithm == FPSR_BAKE_SM) {
+        fpsr_sm_params p = SM;
+        p.seedOuter = seed;
+        return fpsr_sm_eval(&p, frame);
+    }
+    if (algorithm == FPSR_BAKE_TM) {
+        fpsr_tm_params p = TM;
+        p.seedOuter = seed;
+        return fpsr_tm_eval(&p, frame);
+    }
+    fpsr_qs_params p = QS;
+    p.streamsOffset[0] = seed;
+    p.quantOffsets[1] = seed;
+    return fpsr_qs_eval(&p, frame);
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static long fpsr_bake_bench_compare(int algorithm, const int* seeds, size_t entities, int frames, const float* out) {
+    long mismatches = 0;
+    for (size_t e = 0; e < entities; e++) {
+        for (int f = 0; f < frames; f++) {
+            const float ref = fpsr_bake_bench_reference(algorithm, seeds[e], FPSR_BAKE_BENCH_FIRST + f);
+            mismatches += memcmp(&ref, &out[e * (size_t)frames + (size_t)f], sizeof ref) != 0;
+        }
+    }
+    return mismatches;
+}
+
+static int fpsr_bake_bench_report(const char* what, long mismatches) {
+    printf("check %-34s %s", what, mismatches ? "DIFFER" : "same");
+    if (mismatches > 0) { printf(" (%ld samples)", mismatches); }
+    printf("\n");
+    return mismatches != 0;
+}
+
+static int fpsr_bake_bench_expect(const char* what, int ok) {
+    printf("check %-34s %s\n", what, ok ? "ok" : "FAILED");
+    return !ok;
+}
+
+// fpsr_bake_to_file() against the in-memory bake in expected.
+static long fpsr_bake_bench_file(const fpsr_bake_job* job, const char* path, const float* expected) {
+    if (fpsr_bake_to_file(job, NULL, path) != 0) { return -1; }
+    FILE* f = fopen(path, "rb");
+    if (!f) { return -1; }
+    fpsr_bake_header header;
+    const size_t samples = job->entityCount * (size_t)job->frameCount;
+    float* data = malloc(samples * sizeof *data);
+    long mismatches = -1;
+    if (data && fread(&header, sizeof header, 1, f) == 1 && fread(data, sizeof *data, samples, f) == samples) {
+        mismatches = memcmp(header.magic, "FPSRBAKE", 8) != 0 || header.version != FPSR_BAKE_VERSION ||
+                     header.algorithm != (uint32_t)job->algorithm || header.entityCount != job->entityCount ||
+                     header.firstFrame != job->firstFrame || header.frameCount != job->frameCount ||
+                     header.dataOffset != sizeof header;
+        for (size_t i = 0; i < samples; i++) { mismatches += memcmp(&data[i], &expected[i], sizeof *data) != 0; }
+    }
+    free(data);
+    fclose(f);
+    unlink(path);
+    return mismatches;
+}
+
+// Invalid jobs fail with EINVAL before the file at path is touched.
+static int fpsr_bake_bench_invalid(const int* seeds, const char* path) {
+    fpsr_bake_job jobs[4];
+    for (int i = 0; i < 4; i++) { jobs[i] = fpsr_bake_bench_job(FPSR_BAKE_SM, seeds, 4, 16); }
+    jobs[0].algorithm = (fpsr_bake_algorithm)7;
+    jobs[1].sm = NULL;
+    jobs[2].frameCount = -1;
+    jobs[3].firstFrame = INT_MAX - 4;
+
+    int failed = 0;
+    for (int i = 0; i < 4; i++) {
+        FILE* f = fopen(path, "wb");
+        if (!f || fputs("keep", f) < 0 || fclose(f) != 0) { return 1; }
+        errno = 0;
+        const int result = fpsr_bake_to_file(&jobs[i], NULL, path);
+        const int err = errno;
+        char kept[8] = { 0 };
+        f = fopen(path, "rb");
+        const int untouched = f && fread(kept, 1, sizeof kept, f) == 4 && memcmp(kept, "keep", 4) == 0;
+        if (f) { fclose(f); }
+        failed |= result != -1 || err != EINVAL || !untouched;
+    }
+    unlink(path);
+    return fpsr_bake_bench_expect("invalid jobs leave the file", !failed);
+}
+
+// A failure after open() removes the file. Runs last: it lowers RLIMIT_FSIZE.
+static int fpsr_bake_bench_cleanup(const int* seeds, const char* path) {
+    signal(SIGXFSZ, SIG_IGN);
+    struct rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    limit.rlim_cur = 4096;
+    if (setrlimit(RLIMIT_FSIZE, &limit) != 0) {
+        printf("check %-34s skipped (setrlimit failed)\n", "failed bake removes the file");
+        return 0;
+    }
+    const fpsr_bake_job job = fpsr_bake_bench_job(FPSR_BAKE_SM, seeds, 4, 4096);
+    unlink(path);
+    const int result = fpsr_bake_to_file(&job, NULL, path);
+    const int gone = access(path, F_OK) != 0;
+    unlink(path);
+    return fpsr_bake_bench_expect("failed bake removes the file", result == -1 && gone);
+}
+
+
+/******************************************************************************/
+/* Throughput                                                                 */
+/******************************************************************************/
+
+// Best of three runs, Msamples/s; *bad counts runs that failed.
+static double fpsr_bake_bench_time(const fpsr_bake_job* job, int threads, float* out, int* bad) {
+    const fpsr_bake_options options = { threads, 0, 0 };
+    const double samples = (double)job->entityCount * (double)job->frameCount;
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        const double t0 = fpsr_bake_bench_now();
+        *bad |= fpsr_bake(job, &options, out) != 0;
+        const double rate = samples / ((fpsr_bake_bench_now() - t0) / 1e3);
+        if (rate > best) { best = rate; }
+        fpsr_bake_bench_sink = out[job->entityCount * (size_t)job->frameCount - 1];
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long entities = 4096, frames = 4096, maxThreads = 8;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--entities") == 0) { entities = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) { frames = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) { maxThreads = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--entities N] [--frames N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (entities < 1 || entities > 1000000 || frames < 1 || frames > 1000000 ||
+        entities * frames > 100000000L || maxThreads < 1 || maxThreads > 1024) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    const size_t n = (size_t)entities;
+    const size_t samples = n * (size_t)frames;
+    int* seeds = malloc(n * sizeof *seeds);
+    float* out = malloc(samples * sizeof *out);
+    if (!seeds || !out) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 2;
+    }
+    for (size_t e = 0; e < n; e++) { seeds[e] = FPSR_BAKE_BENCH_SEED + (int)e; }
+    char path[64];
+    snprintf(path, sizeof path, "fpsr_bake_bench_%ld.bin", (long)getpid());
+
+    int failed = 0;
+    double rates[3][11];
+    int counts = 0;
+    for (int alg = 0; alg < 3; alg++) {
+        const fpsr_bake_job job = fpsr_bake_bench_job(alg, seeds, n, (int)frames);
+        char what[64];
+        counts = 0;
+        for (long threads = 1; threads <= maxThreads && counts < 11; threads *= 2, counts++) {
+            int bad = 0;
+            memset(out, 0, samples * sizeof *out);
+            rates[alg][counts] = fpsr_bake_bench_time(&job, (int)threads, out, &bad);
+            snprintf(what, sizeof what, "%s fpsr_bake() %ld threads", NAMES[alg], threads);
+            failed |= fpsr_bake_bench_report(what, bad ? -1 : fpsr_bake_bench_compare(alg, seeds, n, (int)frames, out));
+        }
+        snprintf(what, sizeof what, "%s fpsr_bake_to_file()", NAMES[alg]);
+        failed |= fpsr_bake_bench_report(what, fpsr_bake_bench_file(&job, path, out));
+    }
+    failed |= fpsr_bake_bench_invalid(seeds, path);
+    failed |= fpsr_bake_bench_cleanup(seeds, path);
+
+    printf("\n%-8s %12s %12s %12s\n", "threads", "sm Ms/s", "tm Ms/s", "qs Ms/s");
+    for (int c = 0; c < counts; c++) {
+        printf("%-8ld %12.1f %12.1f %12.1f\n", 1L << c, rates[0][c], rates[1][c], rates[2][c]);
+    }
+    printf("(%ld entities x %ld frames, %ld online CPUs, best of 3)\n", entities, frames, sysconf(_SC_NPROCESSORS_ONLN));
+
+    free(seeds);
+    free(out);
+    return failed;
+}
@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_batch.c
+ * @brief SIMD batch evaluators for FPS-R SM, TM and QS with runtime dispatch.
+ * @details Inputs are cut into blocks of FPSR_BATCH_BLOCK lanes. Each block is
+ * handed to a kernel from fpsr_batch_kernels.inc, compiled once per SIMD
+ * instruction set; the scalar level loops over the scalar core of
+ * fpsr_native.h instead. Inside the SIMD kernels every step of the reference
+ * is kept, in the same precision and order, with three lane-friendly
+ * substitutions:
+ *     - integer % is computed through a double division, which is exact for
+ *       32-bit operands;
+ *     - fmod(val, TWO_PI) is computed exactly with a split quotient;
+ *     - sin() is a Cody-Waite reduction plus the fdlibm kernels.
+ * The last one is not bit-exact by itself, so every place where the sine
+ * result gets rounded (to float in portable_rand(), through floor() in the
+ * QS quantiser) checks that a perturbation far larger than the sine error
+ * would round the same way. Lanes that fail the check (about 1 in 30000) are
+ * recomputed with the scalar core, which makes the output bit-identical.
+ *
+ * Build with -O3 -fno-trapping-math. The kernels are written branch-free,
+ * but GCC only if-converts the conversions and selects in them when it may
+ * assume FP exceptions do not trap. Neither flag changes a result; without
+ * them the kernels are correct but slower. See fpsr_batch_bench.c.
+ */
+
+#include "fpsr_batch.h"
+
+#include <stdatomic.h> // For the dispatch level
+#include <stdint.h> // For int64_t
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FPSR_BATCH_X86 1
+#else
+#define FPSR_BATCH_X86 0
+#endif
+
+#define FPSR_BATCH_BLOCK 256
+
+
+/******************************************************************************/
+/* Lane helpers                                                               */
+/******************************************************************************/
+
+// Arguments beyond this use the libm sin(); the reduction below is exact up to
+// 2^20 multiples of pi/2 and this keeps well inside that.
+#define FPSR_LANE_SIN_LIMIT 1.0e6
+
+// Relative and absolute margins of the rounding checks. The lane sine agrees
+// with libm to a few parts in 1e16, far inside either margin.
+#define FPSR_LANE_REL_MARGIN 0x1p-40
+#define FPSR_LANE_ABS_MARGIN 1.0e-9
+
+// pi/2 split in three 33-bit parts (fdlibm's pio2_1, pio2_2, pio2_3).
+static const double FPSR_PIO2_1 = 1.57079632673412561417e+00;
+static const double FPSR_PIO2_2 = 6.07710050630396597660e-11;
+static const double FPSR_PIO2_3 = 2.02226624871116645580e-21;
+static const double FPSR_TWO_OVER_PI = 6.36619772367581382433e-01;
+
+/**
+ * @brief a % b for b >= 1, through an exact double division.
+ */
+static inline int fpsr_lane_mod(int a, int b) {
+    int q = (int)((double)a / (double)b);
+    return a - q * b;
+}
+
+/**
+ * @brief fpsr_state_seed() written without a data-dependent branch.
+ */
+static inline int fpsr_lane_state_seed(int held_integer_state) {
+    double scaled = held_integer_state * 100000.0;
+    int in_range = (scaled >= -2147483648.0) & (scaled < 2147483648.0);
+    int seed = (int)(in_range ? scaled : 0.0);
+    return in_range ? seed : INT_MIN;
+}
+
+/**
+ * @brief sin(x) for |x| <= FPSR_LANE_SIN_LIMIT, accurate to about one ulp.
+ */
+static inline double fpsr_lane_sin(double x) {
+    double k = floor(x * FPSR_TWO_OVER_PI + 0.5);
+    double t = ((x - k * FPSR_PIO2_1) - k * FPSR_PIO2_2) - k * FPSR_PIO2_3;
+    int quadrant = (int)k;
+    double z = t * t;
+
+    // fdlibm __kernel_sin / __kernel_cos, tail argument dropped.
+    double sr = 8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04
+              + z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08
+              + z * 1.58969099521155010221e-10)));
+    double s = t + z * t * (-1.66666666666666324348e-01 + z * sr);
+
+    double cr = z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03
+              + z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07
+              + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+    double hz = 0.5 * z;
+    double w = 1.0 - hz;
+    double c = w + (((1.0 - w) - hz) + z * cr);
+
+    double v = (quadrant & 1) ? c : s;
+    return (quadrant & 2) ? -v : v;
+}
+
+/**
+ * @brief portable_rand() for one lane; sets *flag when the result may differ
+ * from the reference.
+ */
+static inline float fpsr_lane_rand(int seed, unsigned char* flag) {
+    float val = (float)seed * 12.9898;
+
+    // Exact fmod(val, TWO_PI): the quotient is split so both partial products
+    // are exact, then corrected if the rounded division was one off.
+    const double two_pi = (double)6.28318530718f;
+    double x = fabs((double)val);
+    double n = trunc(x / two_pi);
+    double n_hi = trunc(n * (1.0 / 65536.0)) * 65536.0;
+    double rem = (x - n_hi * two_pi) - (n - n_hi) * two_pi;
+    rem = (rem < 0.0) ? rem + two_pi : rem;
+    rem = (rem >= two_pi) ? rem - two_pi : rem;
+    val = (float)copysign(rem, (double)val);
+
+    double scaled = fpsr_lane_sin(val) * 43758.5453f;
+    double margin = fabs(scaled) * FPSR_LANE_REL_MARGIN;
+    float result = (float)scaled;
+    *flag |= ((float)(scaled - margin) != (float)(scaled + margin));
+
+    return result - floor(result);
+}
+
+/**
+ * @brief One QS stream: floor((sin(arg) / 2 + 0.5) * level) / level.
+ */
+static inline float fpsr_lane_quantise(double arg, int quant_level, unsigned char* flag) {
+    double level_pos = (fpsr_lane_sin(arg) / 2.0 + 0.5) * quant_level;
+    double step = floor(level_pos);
+    *flag |= (fabs(arg) > FPSR_LANE_SIN_LIMIT)
+           | (floor(level_pos - FPSR_LANE_ABS_MARGIN) != floor(level_pos + FPSR_LANE_ABS_MARGIN));
+    return step / (float)quant_level;
+}
+
+
+/******************************************************************************/
+/* Kernels                                                                    */
+/******************************************************************************/
+
+typedef void (*fpsr_sm_block_fn)(const fpsr_sm_params*, const int*, const int*, const int*, float*, int);
+typedef void (*fpsr_tm_block_fn)(const fpsr_tm_params*, const int*, const int*, const int*, float*, int);
+typedef void (*fpsr_qs_block_fn)(const fpsr_qs_params*, const int*,
+                                 const int*, const int*, const int*, const int*, float*, int);
+
+typedef void (*fpsr_quantise_block_fn)(const double*, const int*, float*, int);
+
+typedef struct fpsr_batch_kernels {
+    fpsr_sm_block_fn sm;
+    fpsr_tm_block_fn tm;
+    fpsr_qs_block_fn qs;
+    fpsr_quantise_block_fn quantise;
+} fpsr_batch_kernels;
+
+/*
+ * The scalar level is a plain loop over the scalar core. The lane kernels
+ * only pay once the compiler vectorises them: one lane at a time, their
+ * branch-free steps (both QS streams, the double-division modulo, the
+ * rounding checks) cost more than the branches of the reference they
+ * replace.
+ */
+static void fpsr_sm_block_scalar(
+    const fpsr_sm_params* p, const int* frame, const int* seedInner, const int* seedOuter, float* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] = fpsr_sm_scalar(frame[i], p->minHold, p->maxHold, p->reseedInterval,
+                                seedInner[i], seedOuter[i], p->finalRandSwitch);
+    }
+}
+
+static void fpsr_tm_block_scalar(
+    const fpsr_tm_params* p, const int* frame, const int* seedInner, const int* seedOuter, float* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] = fpsr_tm_scalar(frame[i], p->periodA, p->periodB, p->periodSwitch,
+                                seedInner[i], seedOuter[i], p->finalRandSwitch);
+    }
+}
+
+static void fpsr_qs_block_scalar(
+    const fpsr_qs_params* p, const int* frame, const int* streamsOffset0, const int* streamsOffset1,
+    const int* quantOffsets0, const int* quantOffsets1, float* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        const int streamsOffset[2] = { streamsOffset0[i], streamsOffset1[i] };
+        const int quantOffsets[2] = { quantOffsets0[i], quantOffsets1[i] };
+        out[i] = fpsr_qs_scalar(frame[i], p->baseWaveFreq, p->stream2FreqMult,
+                                p->quantLevelsMinMax, streamsOffset, quantOffsets,
+                                p->streamSwitchDur, p->stream1QuantDur, p->stream2QuantDur,
+                                p->finalRandSwitch);
+    }
+}
+
+static void fpsr_quantise_block_scalar(const double* arg, const int* quant_level, float* out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = fpsr_qs_step_value(fpsr_qs_sin_step(sin(arg[i]), quant_level[i]), quant_level[i]);
+    }
+}
+
+#if FPSR_BATCH_X86
+#define FPSR_KERNEL(name) name##_sse41
+#define FPSR_KERNEL_TARGET __attribute__((target("sse4.1")))
+#include "fpsr_batch_kernels.inc"
+#undef FPSR_KERNEL
+#undef FPSR_KERNEL_TARGET
+
+#define FPSR_KERNEL(name) name##_avx2
+#define FPSR_KERNEL_TARGET __attribute__((target("avx2")))
+#include "fpsr_batch_kernels.inc"
+#undef FPSR_KERNEL
+#undef FPSR_KERNEL_TARGET
+
+#define FPSR_KERNEL(name) name##_avx512
+#define FPSR_KERNEL_TARGET __attribute__((target("avx512f,avx512dq,avx512vl,prefer-vector-width=512")))
+#include "fpsr_batch_kernels.inc"
+#undef FPSR_KERNEL
+#undef FPSR_KERNEL_TARGET
+#endif
+
+static const fpsr_batch_kernels FPSR_KERNELS[] = {
+    { fpsr_sm_block_scalar, fpsr_tm_block_scalar, fpsr_qs_block_scalar, fpsr_quantise_block_scalar },
+#if FPSR_BATCH_X86
+    { fpsr_sm_block_sse41, fpsr_tm_block_sse41, fpsr_qs_block_sse41, fpsr_quantise_block_sse41 },
+    { fpsr_sm_block_avx2, fpsr_tm_block_avx2, fpsr_qs_block_avx2, fpsr_quantise_block_avx2 },
+    { fpsr_sm_block_avx512, fpsr_tm_block_avx512, fpsr_qs_block_avx512, fpsr_quantise_block_avx512 },
+#endif
+};
+
+
+/******************************************************************************/
+/* Dispatch                                                                   */
+/******************************************************************************/
+
+static atomic_int fpsr_simd_level_active = -1;
+
+fpsr_simd_level fpsr_simd_detect(void) {
+#if FPSR_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vl")) {
+        return FPSR_SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) { return FPSR_SIMD_AVX2; }
+    if (__builtin_cpu_supports("sse4.1")) { return FPSR_SIMD_SSE41; }
+#endif
+    return FPSR_SIMD_SCALAR;
+}
+
+fpsr_simd_level fpsr_simd_active(void) {
+    int level = atomic_load_explicit(&fpsr_simd_level_active, memory_order_relaxed);
+    if (level < 0) {
+        level = (int)fpsr_simd_detect();
+        atomic_store_explicit(&fpsr_simd_level_active, level, memory_order_relaxed);
+    }
+    return (fpsr_simd_level)level;
+}
+
+fpsr_simd_level fpsr_simd_select(fpsr_simd_level level) {
+    fpsr_simd_level supported = fpsr_simd_detect();
+    if (level > supported) { level = supported; }
+    if (level < FPSR_SIMD_SCALAR) { level = FPSR_SIMD_SCALAR; }
+    atomic_store_explicit(&fpsr_simd_level_active, (int)level, memory_order_relaxed);
+    return level;
+}
+
+static const fpsr_batch_kernels* fpsr_batch_kernels_active(void) {
+    return &FPSR_KERNELS[fpsr_simd_active()];
+}
+
+
+/******************************************************************************/
+/* Block drivers                                                              */
+/******************************************************************************/
+
+// Lane inputs of one block. A NULL source array (or a single frame) is
+// broadcast, so the kernels only ever see dense per-lane arrays.
+static void fpsr_fill_lanes(int* lanes, const int* source, int fallback, size_t offset, int n) {
+    if (source) {
+        for (int i = 0; i < n; i++) { lanes[i] = source[offset + i]; }
+    } else {
+        for (int i = 0; i < n; i++) { lanes[i] = fallback; }
+    }
+}
+
+// firstFrame + k * step in 64 bits: k * step alone can pass INT_MAX on a
+// long run that starts far below 0 and still ends inside the int range.
+static void fpsr_fill_frames(int* lanes, const int* frames, int firstFrame, int step, size_t offset, int n) {
+    if (frames) {
+        for (int i = 0; i < n; i++) { lanes[i] = frames[offset + i]; }
+    } else {
+        for (int i = 0; i < n; i++) { lanes[i] = (int)(firstFrame + (int64_t)(offset + (size_t)i) * step); }
+    }
+}
+
+static void fpsr_sm_run(
+    const fpsr_sm_params* preset, const int* frames, int firstFrame, int step,
+    const int* seedInner, const int* seedOuter, float* out, size_t count)
+{
+    const fpsr_batch_kernels* k = fpsr_batch_kernels_active();
+    int frame[FPSR_BATCH_BLOCK], inner[FPSR_BATCH_BLOCK], outer[FPSR_BATCH_BLOCK];
+
+    for (size_t offset = 0; offset < count; offset += FPSR_BATCH_BLOCK) {
+        int n = (count - offset < FPSR_BATCH_BLOCK) ? (int)(count - offset) : FPSR_BATCH_BLOCK;
+        fpsr_fill_frames(frame, frames, firstFrame, step, offset, n);
+        fpsr_fill_lanes(inner, seedInner, preset->seedInner, offset, n);
+        fpsr_fill_lanes(outer, seedOuter, preset->seedOuter, offset, n);
+        k->sm(preset, frame, inner, outer, out + offset, n);
+    }
+}
+
+static void fpsr_tm_run(
+    const fpsr_tm_params* preset, const int* frames, int firstFrame, int step,
+    const int* seedInner, const int* seedOuter, float* out, size_t count)
+{
+    const fpsr_batch_kernels* k = fpsr_batch_kernels_active();
+    int frame[FPSR_BATCH_BLOCK], inner[FPSR_BATCH_BLOCK], outer[FPSR_BATCH_BLOCK];
+
+    for (size_t offset = 0; offset < count; offset += FPSR_BATCH_BLOCK) {
+        int n = (count - offset < FPSR_BATCH_BLOCK) ? (int)(count - offset) : FPSR_BATCH_BLOCK;
+        fpsr_fill_frames(frame, frames, firstFrame, step, offset, n);
+        fpsr_fill_lanes(inner, seedInner, preset->seedInner, offset, n);
+        fpsr_fill_lanes(outer, seedOuter, preset->seedOuter, offset, n);
+        k->tm(preset, frame, inner, outer, out + offset, n);
+    }
+}
+
+static void fpsr_qs_run(
+    const fpsr_qs_params* preset, const int* frames, int firstFrame, int step,
+    const fpsr_qs_seeds* seeds, float* out, size_t count)
+{
+    static const fpsr_qs_seeds no_seeds = { { NULL, NULL }, { NULL, NULL } };
+    const fpsr_batch_kernels* k = fpsr_batch_kernels_active();
+    int frame[FPSR_BATCH_BLOCK];
+    int so0[FPSR_BATCH_BLOCK], so1[FPSR_BATCH_BLOCK], qo0[FPSR_BATCH_BLOCK], qo1[FPSR_BATCH_BLOCK];
+
+    if (!seeds) { seeds = &no_seeds; }
+    for (size_t offset = 0; offset < count; offset += FPSR_BATCH_BLOCK) {
+        int n = (count - offset < FPSR_BATCH_BLOCK) ? (int)(count - offset) : FPSR_BATCH_BLOCK;
+        fpsr_fill_frames(frame, frames, firstFrame, step, offset, n);
+        fpsr_fill_lanes(so0, seeds->streamsOffset[0], preset->streamsOffset[0], offset, n);
+        fpsr_fill_lanes(so1, seeds->streamsOffset[1], preset->streamsOffset[1], offset, n);
+        fpsr_fill_lanes(qo0, seeds->quantOffsets[0], preset->quantOffsets[0], offset, n);
+        fpsr_fill_lanes(qo1, seeds->quantOffsets[1], preset->quantOffsets[1], offset, n);
+        k->qs(preset, frame, so0, so1, qo0, qo1, out + offset, n);
+    }
+}
+
+
+/******************************************************************************/
+/* Public API                                                                 */
+/******************************************************************************/
+
+void fpsr_sm_batch(
+    const fpsr_sm_params* preset, const int* frames,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count)
+{
+    fpsr_sm_run(preset, frames, 0, 0, seedInner, seedOuter, out, count);
+}
+
+void fpsr_tm_batch(
+    const fpsr_tm_params* preset, const int* frames,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count)
+{
+    fpsr_tm_run(preset, frames, 0, 0, seedInner, seedOuter, out, count);
+}
+
+void fpsr_qs_batch(
+    const fpsr_qs_params* preset, const int* frames,
+    const fpsr_qs_seeds* seeds,
+    float* out, size_t count)
+{
+    fpsr_qs_run(preset, frames, 0, 0, seeds, out, count);
+}
+
+void fpsr_sm_batch_entities(
+    const fpsr_sm_params* preset, int frame,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count)
+{
+    fpsr_sm_run(preset, NULL, frame, 0, seedInner, seedOuter, out, count);
+}
+
+void fpsr_tm_batch_entities(
+    const fpsr_tm_params* preset, int frame,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count)
+{
+    fpsr_tm_run(preset, NULL, frame, 0, seedInner, seedOuter, out, count);
+}
+
+void fpsr_qs_batch_entities(
+    const fpsr_qs_params* preset, int frame,
+    const fpsr_qs_seeds* seeds,
+    float* out, size_t count)
+{
+    fpsr_qs_run(preset, NULL, frame, 0, seeds, out, count);
+}
+
+void fpsr_sm_batch_frames(const fpsr_sm_params* params, int firstFrame, float* out, size_t count) {
+    fpsr_sm_run(params, NULL, firstFrame, 1, NULL, NULL, out, count);
+}
+
+void fpsr_tm_batch_frames(const fpsr_tm_params* params, int firstFrame, float* out, size_t count) {
+    fpsr_tm_run(params, NULL, firstFrame, 1, NULL, NULL, out, count);
+}
+
+void fpsr_qs_batch_frames(const fpsr_qs_params* params, int firstFrame, float* out, size_t count) {
+    fpsr_qs_run(params, NULL, firstFrame, 1, NULL, out, count);
+}
+
+void fpsr_qs_quantise_batch(const double* arg, const int* quantLevel, float* out, size_t count) {
+    const fpsr_batch_kernels* k = fpsr_batch_kernels_active();
+    for (size_t offset = 0; offset < count; offset += FPSR_BATCH_BLOCK) {
+        int n = (count - offset < FPSR_BATCH_BLOCK) ? (int)(count - offset) : FPSR_BATCH_BLOCK;
+        k->quantise(arg + offset, quantLevel + offset, out + offset, n);
+    }
+}
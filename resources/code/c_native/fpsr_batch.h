@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_batch.h
+ * @brief SIMD batch evaluators for FPS-R SM, TM and QS.
+ * @details Evaluates many (frame, seed) tuples per call, in structure-of-arrays
+ * form: N entities at one frame, one entity over a frame range, or fully
+ * per-lane frames and seeds. The kernels are compiled for SSE4.1, AVX2 and
+ * AVX-512 and the widest one the CPU supports is picked at runtime.
+ *
+ * Output is bit-identical to the scalar reference. The SIMD lanes compute
+ * sin() with their own polynomial and carry a rounding check; any lane whose
+ * float result could differ from the libm path is recomputed with the scalar
+ * core from fpsr_native.h.
+ *
+ * Seed arrays may be NULL, in which case the seed stored in the preset is
+ * used for every lane.
+ */
+
+#ifndef FPSR_BATCH_H
+#define FPSR_BATCH_H
+
+#include <stddef.h> // For size_t
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Instruction set levels the batch kernels are compiled for.
+ */
+typedef enum fpsr_simd_level {
+    FPSR_SIMD_SCALAR = 0,
+    FPSR_SIMD_SSE41 = 1,
+    FPSR_SIMD_AVX2 = 2,
+    FPSR_SIMD_AVX512 = 3
+} fpsr_simd_level;
+
+/**
+ * @brief QS per-entity seeds. Any pointer may be NULL to use the preset's value.
+ */
+typedef struct fpsr_qs_seeds {
+    const int* streamsOffset[2];
+    const int* quantOffsets[2];
+} fpsr_qs_seeds;
+
+/** @brief The widest level this CPU (and this build) supports. */
+fpsr_simd_level fpsr_simd_detect(void);
+
+/** @brief The level the batch functions currently dispatch to. */
+fpsr_simd_level fpsr_simd_active(void);
+
+/**
+ * @brief Forces a dispatch level, e.g. to compare kernels against each other.
+ * @return The level actually selected; requests above fpsr_simd_detect() are clamped.
+ */
+fpsr_simd_level fpsr_simd_select(fpsr_simd_level level);
+
+/**
+ * @brief Fully per-lane evaluation: lane i uses frames[i] and the i-th seeds.
+ */
+void fpsr_sm_batch(
+    const fpsr_sm_params* preset, const int* frames,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count);
+void fpsr_tm_batch(
+    const fpsr_tm_params* preset, const int* frames,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count);
+void fpsr_qs_batch(
+    const fpsr_qs_params* preset, const int* frames,
+    const fpsr_qs_seeds* seeds,
+    float* out, size_t count);
+
+/**
+ * @brief N entities at one frame: out[i] is entity i's value at frame.
+ */
+void fpsr_sm_batch_entities(
+    const fpsr_sm_params* preset, int frame,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count);
+void fpsr_tm_batch_entities(
+    const fpsr_tm_params* preset, int frame,
+    const int* seedInner, const int* seedOuter,
+    float* out, size_t count);
+void fpsr_qs_batch_entities(
+    const fpsr_qs_params* preset, int frame,
+    const fpsr_qs_seeds* seeds,
+    float* out, size_t count);
+
+/**
+ * @brief One entity over a frame range: out[i] is the value at firstFrame + i.
+ */
+void fpsr_sm_batch_frames(const fpsr_sm_params* params, int firstFrame, float* out, size_t count);
+void fpsr_tm_batch_frames(const fpsr_tm_params* params, int firstFrame, float* out, size_t count);
+void fpsr_qs_batch_frames(const fpsr_qs_params* params, int firstFrame, float* out, size_t count);
+
+/**
+ * @brief QS step 3 over precomputed sine arguments: out[i] is
+ * floor((sin(arg[i]) / 2 + 0.5) * quantLevel[i]) / quantLevel[i].
+ * @details For callers that carry the arguments themselves, such as the
+ * 64-bit timelines of fpsr_time64.c, whose wide phases are already reduced
+ * into (-2 pi, 2 pi). Arguments beyond the lane sine's range take libm sin().
+ */
+void fpsr_qs_quantise_batch(const double* arg, const int* quantLevel, float* out, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_BATCH_H
@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_batch_bench.c
+ * @brief Checks and ns per sample of the fpsr_batch.h kernels at every level.
+ * @details For every dispatch level this CPU supports (scalar, SSE4.1, AVX2,
+ * AVX-512), with the sample presets of SM, TM and QS:
+ *     - Checks (the program exits 1 if one fails): fpsr_*_batch_frames()
+ *       over --count frames centred on 0 and ending just inside INT_MAX, and
+ *       fpsr_*_batch_entities() over --count per-entity seeds at one frame,
+ *       give the bits of fpsr_*_eval() called on every sample;
+ *     - Throughput: ns per sample of the scalar loop calling fpsr_*_eval()
+ *       against each level, for a frame range and for entities at a frame.
+ *       Most SM and TM states here are past +-21474, where
+ *       fpsr_state_seed() saturates to INT_MIN. With the preset a constant,
+ *       the compiler folds that portable_rand() call in the inlined eval()
+ *       loop, so its SM and TM rows show little more than the integer
+ *       steps. The scalar level runs the same loop on a runtime preset and
+ *       cannot fold it, which is all that separates the two; over frames
+ *       whose states fit, the scalar level matches eval().
+ *
+ * Options: --count N (samples per run, 1000000)
+ *
+ * Build (POSIX; the flags are the ones fpsr_batch.c expects):
+ *     cc -std=c11 -O3 -fno-trapping-math fpsr_batch_bench.c fpsr_batch.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h> // For INT_MAX
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_batch.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static const char* const LEVELS[4] = { "scalar", "sse4.1", "avx2", "avx512" };
+
+// Frame of the entity runs, and the first of the per-entity seeds.
+#define FPSR_BATCH_BENCH_FRAME 1234
+#define FPSR_BATCH_BENCH_SEED -500000
+
+static volatile float fpsr_batch_bench_sink;
+
+static double fpsr_batch_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static int fpsr_batch_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+
+/******************************************************************************/
+/* Per-algorithm runs                                                         */
+/******************************************************************************/
+
+// mode 0: the scalar loop, 1: batch over frames, 2: batch over entities.
+// Entity e has seed seeds[e] in seedOuter (SM, TM) or in streamsOffset[0]
+// and quantOffsets[1] (QS).
+static void fpsr_batch_bench_sm(int mode, int first, const int* seeds, float* out, size_t count) {
+    if (mode == 1) { fpsr_sm_batch_frames(&SM, first, out, count); return; }
+    if (mode == 2) { fpsr_sm_batch_entities(&SM, FPSR_BATCH_BENCH_FRAME, NULL, seeds, out, count); return; }
+    for (size_t i = 0; i < count; i++) { out[i] = fpsr_sm_eval(&SM, first + (int)i); }
+}
+
+static void fpsr_batch_bench_tm(int mode, int first, const int* seeds, float* out, size_t count) {
+    if (mode == 1) { fpsr_tm_batch_frames(&TM, first, out, count); return; }
+    if (mode == 2) { fpsr_tm_batch_entities(&TM, FPSR_BATCH_BENCH_FRAME, NULL, seeds, out, count); return; }
+    for (size_t i = 0; i < count; i++) { out[i] = fpsr_tm_eval(&TM, first + (int)i); }
+}
+
+static void fpsr_batch_bench_qs(int mode, int first, const int* seeds, float* out, size_t count) {
+    const fpsr_qs_seeds qsSeeds = { { seeds, NULL }, { NULL, seeds } };
+    if (mode == 1) { fpsr_qs_batch_frames(&QS, first, out, count); return; }
+    if (mode == 2) { fpsr_qs_batch_entities(&QS, FPSR_BATCH_BENCH_FRAME, &qsSeeds, out, count); return; }
+    for (size_t i = 0; i < count; i++) { out[i] = fpsr_qs_eval(&QS, first + (int)i); }
+}
+
+// The reference value of entity e, one preset per entity.
+static float fpsr_batch_bench_entity(int algorithm, int seed) {
+    if (algorithm == 0) {
+        fpsr_sm_params p = SM;
+        p.seedOuter = seed;
+        return fpsr_sm_eval(&p, FPSR_BATCH_BENCH_FRAME);
+    }
+    if (algorithm == 1) {
+        fpsr_tm_params p = TM;
+        p.seedOuter = seed;
+        return fpsr_tm_eval(&p, FPSR_BATCH_BENCH_FRAME);
+    }
+    fpsr_qs_params p = QS;
+    p.streamsOffset[0] = seed;
+    p.quantOffsets[1] = seed;
+    return fpsr_qs_eval(&p, FPSR_BATCH_BENCH_FRAME);
+}
+
+typedef void (*fpsr_batch_bench_fn)(int mode, int first, const int* seeds, float* out, size_t count);
+
+static const fpsr_batch_bench_fn RUNS[3] = { fpsr_batch_bench_sm, fpsr_batch_bench_tm, fpsr_batch_bench_qs };
+static const char* const NAMES[3] = { "sm", "tm", "qs" };
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static int fpsr_batch_bench_checks(int level, const int* seeds, float* a, float* b, size_t count) {
+    // Clocks reach first + count + the largest seed (81); keep them inside INT_MAX.
+    const int firsts[2] = { -(int)(count / 2), INT_MAX - (int)count - 100 };
+    int failed = 0;
+    for (int alg = 0; alg < 3; alg++) {
+        long mismatches = 0;
+        for (int w = 0; w < 2; w++) {
+            RUNS[alg](0, firsts[w], seeds, a, count);
+            RUNS[alg](1, firsts[w], seeds, b, count);
+            for (size_t i = 0; i < count; i++) { mismatches += !fpsr_batch_bench_same(a[i], b[i]); }
+        }
+        RUNS[alg](2, 0, seeds, b, count);
+        for (size_t i = 0; i < count; i++) {
+            mismatches += !fpsr_batch_bench_same(b[i], fpsr_batch_bench_entity(alg, seeds[i]));
+        }
+        printf("check %-6s %s: %s", LEVELS[level], NAMES[alg], mismatches ? "DIFFER" : "same");
+        if (mismatches) { printf(" (%ld samples)", mismatches); }
+        printf("\n");
+        failed |= mismatches != 0;
+    }
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Throughput                                                                 */
+/******************************************************************************/
+
+// Best of three runs, ns per sample.
+static double fpsr_batch_bench_time(int alg, int mode, const int* seeds, float* out, size_t count) {
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        const double t0 = fpsr_batch_bench_now();
+        RUNS[alg](mode, 0, seeds, out, count);
+        const double ns = (fpsr_batch_bench_now() - t0) / (double)count;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_batch_bench_sink = out[count - 1];
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long count = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1 || count > 100000000) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    const size_t n = (size_t)count;
+    int* seeds = malloc(n * sizeof *seeds);
+    float* a = malloc(n * sizeof *a);
+    float* b = malloc(n * sizeof *b);
+    if (!seeds || !a || !b) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 2;
+    }
+    for (size_t i = 0; i < n; i++) { seeds[i] = FPSR_BATCH_BENCH_SEED + (int)i; }
+
+    const fpsr_simd_level top = fpsr_simd_detect();
+    int failed = 0;
+    for (int level = FPSR_SIMD_SCALAR; level <= (int)top; level++) {
+        fpsr_simd_select((fpsr_simd_level)level);
+        failed |= fpsr_batch_bench_checks(level, seeds, a, b, n);
+    }
+
+    printf("\n%-4s %-8s %-9s %12s %9s\n", "alg", "level", "input", "ns/sample", "speedup");
+    for (int alg = 0; alg < 3; alg++) {
+        const double scalarNs = fpsr_batch_bench_time(alg, 0, seeds, a, n);
+        printf("%-4s %-8s %-9s %12.2f\n", NAMES[alg], "eval()", "frames", scalarNs);
+        for (int level = FPSR_SIMD_SCALAR; level <= (int)top; level++) {
+            fpsr_simd_select((fpsr_simd_level)level);
+            for (int mode = 1; mode <= 2; mode++) {
+                const double ns = fpsr_batch_bench_time(alg, mode, seeds, a, n);
+                printf("%-4s %-8s %-9s %12.2f %8.1fx\n", NAMES[alg], LEVELS[level],
+                       mode == 1 ? "frames" : "entities", ns, scalarNs / ns);
+            }
+        }
+    }
+    printf("(%ld samples per run, best of 3)\n", count);
+
+    free(seeds);
+    free(a);
+    free(b);
+    return failed;
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_compiled.c
+ * @brief Builds the compiled (reciprocal-carrying) presets of fpsr_compiled.h.
+ */
+
+#include "fpsr_compiled.h"
+
+fpsr_sm_compiled fpsr_sm_compile(const fpsr_sm_params* p) {
+    fpsr_sm_compiled c;
+    c.params = *p;
+    c.reseedInterval = fpsr_divisor_make(p->reseedInterval < 1 ? 1 : p->reseedInterval);
+
+    // floor(minHold + r * (maxHold - minHold)) with r in [0, 1) lies between
+    // the two bounds; both are included since the float product can round up.
+    int lo = p->minHold < p->maxHold ? p->minHold : p->maxHold;
+    int hi = p->minHold < p->maxHold ? p->maxHold : p->minHold;
+    if (lo < 1) { lo = 1; }
+    if (hi < 1) { hi = 1; }
+
+    c.holdFirst = lo;
+    c.holdCount = 0;
+    if ((int64_t)hi - lo < FPSR_COMPILED_HOLD_TABLE) {
+        c.holdCount = hi - lo + 1;
+        for (int i = 0; i < c.holdCount; i++) {
+            c.holdDivisors[i] = fpsr_divisor_make(lo + i);
+        }
+    }
+    return c;
+}
+
+fpsr_tm_compiled fpsr_tm_compile(const fpsr_tm_params* p) {
+    fpsr_tm_compiled c;
+    c.params = *p;
+    int periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    c.periodSwitch = fpsr_divisor_make(periodSwitch);
+    // For an integer m, m < periodSwitch / 2.0 is m < ceil(periodSwitch / 2.0).
+    c.switchHalf = periodSwitch / 2 + (periodSwitch & 1);
+    c.holdA = fpsr_divisor_make(p->periodA < 1 ? 1 : p->periodA);
+    c.holdB = fpsr_divisor_make(p->periodB < 1 ? 1 : p->periodB);
+    return c;
+}
+
+fpsr_qs_compiled fpsr_qs_compile(const fpsr_qs_params* p) {
+    fpsr_qs_compiled c;
+    c.params = fpsr_qs_resolve(*p);
+    c.streamSwitchDur = fpsr_divisor_make(c.params.streamSwitchDur);
+    c.stream1QuantDur = fpsr_divisor_make(c.params.stream1QuantDur);
+    c.stream2QuantDur = fpsr_divisor_make(c.params.stream2QuantDur);
+    return c;
+}
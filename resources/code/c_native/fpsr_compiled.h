@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_compiled.h
+ * @brief FPS-R with the integer divisions strength-reduced, for presets that
+ * are fixed at compile time or for the life of a run.
+ * @details Outside sin(), the cost of SM, TM and QS is mostly integer %, and
+ * every divisor comes from the preset: reseedInterval, periodSwitch,
+ * periodA / periodB, streamSwitchDur and the QS quant durations. Two ways to
+ * stop paying for a hardware divide on each call:
+ *     - Fixed presets: FPSR_SM_FIXED() and friends define a function with the
+ *       divisors baked in as constants, so the compiler turns each % into a
+ *       multiply and shifts.
+ *     - Runtime presets: fpsr_*_compile() precomputes a multiply-based
+ *       reciprocal (fpsr_divisor) for each divisor once, and
+ *       fpsr_*_compiled_eval() uses those instead of %.
+ *
+ * Both give the same result as the reference for every int frame and seed,
+ * including negative clocks: % truncates toward zero in C, and so does
+ * fpsr_divisor_mod().
+ *
+ * Measured (fpsr_compiled_bench.c, x86-64), the reciprocals do not pay here.
+ * fpsr_divisor_mod() runs at the speed of a hardware % (1.6 to 3.0 ns against
+ * 2.5 to 2.7 in a loop of random operands), and with finalRandSwitch on,
+ * portable_rand() is nearly all of an SM or TM call, so SM and TM compiled
+ * presets land within noise of fpsr_*_eval(). Compiled QS is 1.1x to 1.6x
+ * faster, but that comes from evaluating only the selected stream, not from
+ * its reciprocals. The one case where dividing by constants shows is TM with
+ * finalRandSwitch off, which is nothing but integer steps: FPSR_TM_FIXED()
+ * has no divide left and runs about 1.35x faster than fpsr_tm_eval(). Keep
+ * fpsr_*_compile() for the single-stream QS; prefer the fixed macros where
+ * the timing really is a constant.
+ */
+
+#ifndef FPSR_COMPILED_H
+#define FPSR_COMPILED_H
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Divisors                                                                   */
+/******************************************************************************/
+
+/**
+ * @brief A positive int divisor with its precomputed reciprocal.
+ * @details magic is ceil(2^64 / d), wrapped to 0 for d == 1. With it,
+ * n mod d for any 32-bit unsigned n is the high half of (magic * n mod 2^64) * d
+ * (Lemire, Kaser and Kurz, "Faster Remainder by Direct Computation", 2019),
+ * exact for every n, with no correction step.
+ */
+typedef struct fpsr_divisor {
+    uint64_t magic;
+    int d;
+} fpsr_divisor;
+
+/** @brief Precomputes the reciprocal of d. @p d must be >= 1. */
+static inline fpsr_divisor fpsr_divisor_make(int d) {
+    fpsr_divisor v;
+    v.magic = UINT64_MAX / (uint32_t)d + 1;
+    v.d = d;
+    return v;
+}
+
+/** @brief The high 64 bits of a * b, as an unsigned 32-bit value (b < 2^32). */
+static inline uint32_t fpsr_mulhi_u64_u32(uint64_t a, uint32_t b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 fpsr_u128; // keeps -Wpedantic quiet
+    return (uint32_t)(((fpsr_u128)a * b) >> 64);
+#else
+    uint64_t lo = (a & 0xFFFFFFFFu) * b;
+    uint64_t hi = (a >> 32) * b;
+    return (uint32_t)((hi + (lo >> 32)) >> 32);
+#endif
+}
+
+/**
+ * @brief n % v->d with C semantics: the result takes the sign of n.
+ * @details |INT_MIN| fits a uint32_t, so every int n is covered.
+ */
+static inline int fpsr_divisor_mod(const fpsr_divisor* v, int n) {
+    uint32_t sign = 0u - ((uint32_t)n >> 31); // all ones for negative n; no branch
+    uint32_t u = ((uint32_t)n ^ sign) - sign;
+    uint32_t r = fpsr_mulhi_u64_u32(v->magic * u, (uint32_t)v->d);
+    return (int)((r ^ sign) - sign);
+}
+
+
+/******************************************************************************/
+/* Fixed presets                                                              */
+/******************************************************************************/
+
+// Each macro defines a static function with the durations of a preset baked
+// in; the arguments must be integer constant expressions for the divisions to
+// be reduced. The seeds and finalRandSwitch stay per call, so one definition
+// serves every entity that shares the timing:
+//
+//     FPSR_TM_FIXED(flicker_tm, 12, 5, 60)
+//     float v = flicker_tm(frame, seedInner, seedOuter, 1);
+//
+// SM's second division is by the hold duration it draws at run time, so only
+// reseedInterval can be baked in there.
+
+#define FPSR_SM_FIXED(name, minHold, maxHold, reseedInterval) \
+    static inline float name(int frame, int seedInner, int seedOuter, int finalRandSwitch) { \
+        return fpsr_sm_scalar(frame, (minHold), (maxHold), (reseedInterval), \
+                              seedInner, seedOuter, finalRandSwitch); \
+    }
+
+// TM picks periodA or periodB per frame; each branch divides by its own
+// constant, where fpsr_tm_scalar() would pick the divisor and then divide.
+#define FPSR_TM_FIXED(name, periodA, periodB, periodSwitch) \
+    static inline float name(int frame, int seedInner, int seedOuter, int finalRandSwitch) { \
+        const int fixedSwitch = (periodSwitch) < 1 ? 1 : (periodSwitch); \
+        const int outer_clock_frame = seedOuter + frame; \
+        const int held_integer_state = (((seedInner + frame) % fixedSwitch) < (fixedSwitch * 0.5)) \
+            ? outer_clock_frame - outer_clock_frame % ((periodA) < 1 ? 1 : (periodA)) \
+            : outer_clock_frame - outer_clock_frame % ((periodB) < 1 ? 1 : (periodB)); \
+        return fpsr_held_output(held_integer_state, finalRandSwitch); \
+    }
+
+// The QS durations must already be >= 1 here (no defaults from baseWaveFreq).
+#define FPSR_QS_FIXED(name, streamSwitchDur, stream1QuantDur, stream2QuantDur) \
+    static inline float name(int frame, float baseWaveFreq, float stream2FreqMult, \
+                             const int quantLevelsMinMax[2], const int streamsOffset[2], \
+                             const int quantOffsets[2], int finalRandSwitch) { \
+        return fpsr_qs_scalar(frame, baseWaveFreq, stream2FreqMult, \
+                              quantLevelsMinMax, streamsOffset, quantOffsets, \
+                              (streamSwitchDur), (stream1QuantDur), (stream2QuantDur), \
+                              finalRandSwitch); \
+    }
+
+
+/******************************************************************************/
+/* Compiled presets                                                           */
+/******************************************************************************/
+
+/** @brief Widest minHold..maxHold range whose divisors fpsr_sm_compile() tabulates. */
+#define FPSR_COMPILED_HOLD_TABLE 64
+
+/**
+ * @brief An SM preset with its divisors precomputed.
+ * @details The hold duration is drawn per reseed block, so a reciprocal is kept
+ * for every duration the preset can draw. Presets with a wider hold range
+ * than FPSR_COMPILED_HOLD_TABLE fall back to % for that division.
+ */
+typedef struct fpsr_sm_compiled {
+    fpsr_sm_params params;
+    fpsr_divisor reseedInterval;
+    int holdFirst; // holdDivisors[i] divides by holdFirst + i
+    int holdCount;
+    fpsr_divisor holdDivisors[FPSR_COMPILED_HOLD_TABLE];
+} fpsr_sm_compiled;
+
+/** @brief A TM preset with its divisors precomputed. */
+typedef struct fpsr_tm_compiled {
+    fpsr_tm_params params;
+    fpsr_divisor periodSwitch;
+    int switchHalf; // m < periodSwitch * 0.5 exactly when m < switchHalf
+    fpsr_divisor holdA;
+    fpsr_divisor holdB;
+} fpsr_tm_compiled;
+
+/** @brief A QS preset, resolved, with its divisors precomputed. */
+typedef struct fpsr_qs_compiled {
+    fpsr_qs_params params; // after fpsr_qs_resolve()
+    fpsr_divisor streamSwitchDur;
+    fpsr_divisor stream1QuantDur;
+    fpsr_divisor stream2QuantDur;
+} fpsr_qs_compiled;
+
+/** @brief Precomputes the divisors of a preset. Cheap, but not per frame. */
+fpsr_sm_compiled fpsr_sm_compile(const fpsr_sm_params* p);
+fpsr_tm_compiled fpsr_tm_compile(const fpsr_tm_params* p);
+fpsr_qs_compiled fpsr_qs_compile(const fpsr_qs_params* p);
+
+/** @brief fpsr_sm_eval() on a compiled preset. */
+static inline float fpsr_sm_compiled_eval(const fpsr_sm_compiled* c, int frame) {
+    const fpsr_sm_params* p = &c->params;
+    float rand_for_duration = fpsr_portable_rand(p->seedInner + frame - fpsr_divisor_mod(&c->reseedInterval, frame));
+    int holdDuration = (int)floor(p->minHold + rand_for_duration * (p->maxHold - p->minHold));
+    if (holdDuration < 1) { holdDuration = 1; }
+
+    int outer_clock_frame = p->seedOuter + frame;
+    unsigned slot = (unsigned)holdDuration - (unsigned)c->holdFirst;
+    int held_integer_state = outer_clock_frame - (slot < (unsigned)c->holdCount
+        ? fpsr_divisor_mod(&c->holdDivisors[slot], outer_clock_frame)
+        : outer_clock_frame % holdDuration);
+    return fpsr_held_output(held_integer_state, p->finalRandSwitch);
+}
+
+/** @brief fpsr_tm_eval() on a compiled preset. */
+static inline float fpsr_tm_compiled_eval(const fpsr_tm_compiled* c, int frame) {
+    const fpsr_tm_params* p = &c->params;
+    const fpsr_divisor* hold = (fpsr_divisor_mod(&c->periodSwitch, p->seedInner + frame) < c->switchHalf)
+        ? &c->holdA : &c->holdB;
+
+    int outer_clock_frame = p->seedOuter + frame;
+    int held_integer_state = outer_clock_frame - fpsr_divisor_mod(hold, outer_clock_frame);
+    return fpsr_held_output(held_integer_state, p->finalRandSwitch);
+}
+
+/**
+ * @brief fpsr_qs_eval() on a compiled preset.
+ * @details The reference computes both streams and then keeps one; only the
+ * selected stream's level and sine are computed here, which gives the same value.
+ */
+static inline float fpsr_qs_compiled_eval(const fpsr_qs_compiled* c, int frame) {
+    const fpsr_qs_params* r = &c->params;
+    int stream = (fpsr_divisor_mod(&c->streamSwitchDur, frame) < r->streamSwitchDur / 2) ? 0 : 1;
+    const fpsr_divisor* quantDur = stream ? &c->stream2QuantDur : &c->stream1QuantDur;
+
+    int quant_range = r->quantLevelsMinMax[1] - r->quantLevelsMinMax[0] + 1;
+    int quant_clock = r->quantOffsets[stream] + frame;
+    int quant_seed = quant_clock - fpsr_divisor_mod(quantDur, quant_clock);
+    int quant_level = r->quantLevelsMinMax[0] + (int)floor(fpsr_portable_rand(quant_seed) * quant_range);
+    if (quant_level < 1) { quant_level = 1; }
+
+    return fpsr_qs_output(fpsr_qs_stream_value(r, stream, frame, quant_level), r->finalRandSwitch);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_COMPILED_H
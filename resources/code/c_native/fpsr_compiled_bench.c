@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_compiled_bench.c
+ * @brief Equality checks and speed of fpsr_compiled.h against plain %.
+ * @details Two parts:
+ *     - Checks (the program exits 1 if one fails):
+ *         - fpsr_divisor_mod() against % for divisors 1, 2, 3, 7, 24, 1000,
+ *           65537, INT_MAX - 1 and INT_MAX, on INT_MIN, INT_MAX, 0, +-1,
+ *           multiples of the divisor and their neighbours, every n in
+ *           [-2^20, 2^20] and --count pseudo-random ints;
+ *         - fpsr_*_compiled_eval() and FPSR_*_FIXED() functions against
+ *           fpsr_*_eval() over frames -2^20 to 2^20, for the sample presets
+ *           with negative seeds, and for presets whose durations are 1 and
+ *           INT_MAX.
+ *     - Speed, ns per call (best of 3) with the preset hidden from the
+ *       optimiser (so % is a real divide): % against fpsr_divisor_mod() and
+ *       % by a constant, then fpsr_*_eval() against FPSR_*_FIXED() and
+ *       fpsr_*_compiled_eval(), with finalRandSwitch on and off. With it on,
+ *       portable_rand() is most of the cost.
+ *
+ * Options: --count N (calls per timing and random mod checks, 2000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_compiled_bench.c fpsr_compiled.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_compiled.h"
+
+#define FPSR_COMPILED_BENCH_SPAN (1 << 20) // frames and n on each side of 0
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+// The same timings baked in; FPSR_*_FIXED() takes them as constants.
+FPSR_SM_FIXED(fpsr_compiled_bench_sm_fixed, 16, 24, 9)
+FPSR_TM_FIXED(fpsr_compiled_bench_tm_fixed, 10, 25, 30)
+FPSR_QS_FIXED(fpsr_compiled_bench_qs_fixed, 24, 16, 20)
+
+// Durations of 1 and INT_MAX.
+FPSR_SM_FIXED(fpsr_compiled_bench_sm_edge_fixed, 1, 1, INT_MAX)
+FPSR_TM_FIXED(fpsr_compiled_bench_tm_edge_fixed, 1, INT_MAX, 1)
+FPSR_QS_FIXED(fpsr_compiled_bench_qs_edge_fixed, INT_MAX, 1, INT_MAX)
+
+static const fpsr_sm_params SM_EDGE = { 1, 1, INT_MAX, -7, 3, 0 };
+static const fpsr_tm_params TM_EDGE = { 1, INT_MAX, 1, -5, 9, 0 };
+static const fpsr_qs_params QS_EDGE = { 0.05f, 2.0f, { 2, 9 }, { -3, 11 }, { 5, -8 }, INT_MAX, 1, INT_MAX, 0 };
+
+static const int DIVISORS[9] = { 1, 2, 3, 7, 24, 1000, 65537, INT_MAX - 1, INT_MAX };
+
+// Read at startup so the timed presets are not compile-time constants.
+static volatile int fpsr_compiled_bench_zero = 0;
+static volatile float fpsr_compiled_bench_sink;
+
+static double fpsr_compiled_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static int fpsr_compiled_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+static uint32_t fpsr_compiled_bench_xorshift(uint32_t* s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static long fpsr_compiled_bench_mod_one(const fpsr_divisor* v, int n) {
+    return fpsr_divisor_mod(v, n) != n % v->d;
+}
+
+static int fpsr_compiled_bench_check_mod(long count) {
+    long errors = 0;
+    uint32_t state = 0x9E3779B9u;
+    for (int k = 0; k < 9; k++) {
+        const int d = DIVISORS[k];
+        const fpsr_divisor v = fpsr_divisor_make(d);
+        const int edges[5] = { INT_MIN, INT_MIN + 1, INT_MAX, INT_MAX - 1, 0 };
+        for (int i = 0; i < 5; i++) { errors += fpsr_compiled_bench_mod_one(&v, edges[i]); }
+        for (int64_t m = -3; m <= 3; m++) {
+            for (int delta = -1; delta <= 1; delta++) {
+                const int64_t n = m * d + delta;
+                if (n >= INT_MIN && n <= INT_MAX) { errors += fpsr_compiled_bench_mod_one(&v, (int)n); }
+            }
+        }
+        for (int n = -FPSR_COMPILED_BENCH_SPAN; n <= FPSR_COMPILED_BENCH_SPAN; n++) {
+            errors += fpsr_compiled_bench_mod_one(&v, n);
+        }
+        for (long i = 0; i < count; i++) {
+            errors += fpsr_compiled_bench_mod_one(&v, (int)fpsr_compiled_bench_xorshift(&state));
+        }
+    }
+    printf("check fpsr_divisor_mod: %s", errors ? "DIFFER" : "same");
+    if (errors) { printf(" (%ld values)", errors); }
+    printf("\n");
+    return errors != 0;
+}
+
+// One preset: compiled and fixed against the reference over the frame span.
+static int fpsr_compiled_bench_check_presets(
+    const char* name, const fpsr_sm_params* sm, float (*smFixed)(int, int, int, int),
+    const fpsr_tm_params* tm, float (*tmFixed)(int, int, int, int),
+    const fpsr_qs_params* qs,
+    float (*qsFixed)(int, float, float, const int[2], const int[2], const int[2], int))
+{
+    const fpsr_sm_compiled smc = fpsr_sm_compile(sm);
+    const fpsr_tm_compiled tmc = fpsr_tm_compile(tm);
+    const fpsr_qs_compiled qsc = fpsr_qs_compile(qs);
+    long errors[3] = { 0, 0, 0 };
+    for (int f = -FPSR_COMPILED_BENCH_SPAN; f <= FPSR_COMPILED_BENCH_SPAN; f++) {
+        const float s = fpsr_sm_eval(sm, f);
+        errors[0] += !fpsr_compiled_bench_same(s, fpsr_sm_compiled_eval(&smc, f))
+                   + !fpsr_compiled_bench_same(s, smFixed(f, sm->seedInner, sm->seedOuter, sm->finalRandSwitch));
+        const float t = fpsr_tm_eval(tm, f);
+        errors[1] += !fpsr_compiled_bench_same(t, fpsr_tm_compiled_eval(&tmc, f))
+                   + !fpsr_compiled_bench_same(t, tmFixed(f, tm->seedInner, tm->seedOuter, tm->finalRandSwitch));
+        const float q = fpsr_qs_eval(qs, f);
+        errors[2] += !fpsr_compiled_bench_same(q, fpsr_qs_compiled_eval(&qsc, f))
+                   + !fpsr_compiled_bench_same(q, qsFixed(f, qs->baseWaveFreq, qs->stream2FreqMult,
+                                                           qs->quantLevelsMinMax, qs->streamsOffset,
+                                                           qs->quantOffsets, qs->finalRandSwitch));
+    }
+    static const char* const ALGS[3] = { "sm", "tm", "qs" };
+    int failed = 0;
+    for (int a = 0; a < 3; a++) {
+        printf("check %-6s %s: %s", name, ALGS[a], errors[a] ? "DIFFER" : "same");
+        if (errors[a]) { printf(" (%ld frames)", errors[a]); }
+        printf("\n");
+        failed |= errors[a] != 0;
+    }
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Speed                                                                      */
+/******************************************************************************/
+
+static double fpsr_compiled_bench_mod_once(int method, const fpsr_divisor* v, const int* n, long count) {
+    const int d = v->d;
+    int acc = 0;
+    const double t0 = fpsr_compiled_bench_now();
+    for (long i = 0; i < count; i++) {
+        const int x = n[i & (FPSR_COMPILED_BENCH_SPAN - 1)];
+        acc += method == 0 ? x % d : method == 1 ? fpsr_divisor_mod(v, x) : x % 24;
+    }
+    fpsr_compiled_bench_sink = (float)acc;
+    return (fpsr_compiled_bench_now() - t0) / (double)count;
+}
+
+// method 0: fpsr_*_eval(), 1: FPSR_*_FIXED(), 2: fpsr_*_compiled_eval().
+static double fpsr_compiled_bench_eval_once(
+    int alg, int method, const fpsr_sm_params* sm, const fpsr_tm_params* tm, const fpsr_qs_params* qs, long count)
+{
+    const fpsr_sm_compiled smc = fpsr_sm_compile(sm);
+    const fpsr_tm_compiled tmc = fpsr_tm_compile(tm);
+    const fpsr_qs_compiled qsc = fpsr_qs_compile(qs);
+    float acc = 0.0f;
+    const double t0 = fpsr_compiled_bench_now();
+    for (long i = 0; i < count; i++) {
+        const int f = (int)i - (int)(count / 2);
+        if (alg == 0) {
+            acc += method == 0 ? fpsr_sm_eval(sm, f)
+                 : method == 1 ? fpsr_compiled_bench_sm_fixed(f, sm->seedInner, sm->seedOuter, sm->finalRandSwitch)
+                               : fpsr_sm_compiled_eval(&smc, f);
+        } else if (alg == 1) {
+            acc += method == 0 ? fpsr_tm_eval(tm, f)
+                 : method == 1 ? fpsr_compiled_bench_tm_fixed(f, tm->seedInner, tm->seedOuter, tm->finalRandSwitch)
+                               : fpsr_tm_compiled_eval(&tmc, f);
+        } else {
+            acc += method == 0 ? fpsr_qs_eval(qs, f)
+                 : method == 1 ? fpsr_compiled_bench_qs_fixed(f, qs->baseWaveFreq, qs->stream2FreqMult,
+                                                              qs->quantLevelsMinMax, qs->streamsOffset,
+                                                              qs->quantOffsets, qs->finalRandSwitch)
+                               : fpsr_qs_compiled_eval(&qsc, f);
+        }
+    }
+    fpsr_compiled_bench_sink = acc;
+    return (fpsr_compiled_bench_now() - t0) / (double)count;
+}
+
+// Best of three runs; this machine's timings are noisy.
+static double fpsr_compiled_bench_mod_time(int method, const fpsr_divisor* v, const int* n, long count) {
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        const double t = fpsr_compiled_bench_mod_once(method, v, n, count);
+        if (run == 0 || t < best) { best = t; }
+    }
+    return best;
+}
+
+static double fpsr_compiled_bench_eval_time(
+    int alg, int method, const fpsr_sm_params* sm, const fpsr_tm_params* tm, const fpsr_qs_params* qs, long count)
+{
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        const double t = fpsr_compiled_bench_eval_once(alg, method, sm, tm, qs, count);
+        if (run == 0 || t < best) { best = t; }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long count = 2000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1 || count > 2000000000) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    fpsr_sm_params sm = SM;
+    fpsr_tm_params tm = TM;
+    fpsr_qs_params qs = QS;
+    sm.seedInner = -sm.seedInner * 1000 + fpsr_compiled_bench_zero; // negative clocks for most frames
+    sm.seedOuter = -sm.seedOuter * 1000;
+    tm.seedInner = -tm.seedInner * 1000;
+    qs.streamsOffset[1] = -qs.streamsOffset[1] * 1000;
+    qs.quantOffsets[0] = -qs.quantOffsets[0] * 1000;
+
+    int failed = fpsr_compiled_bench_check_mod(count);
+    failed |= fpsr_compiled_bench_check_presets("sample", &sm, fpsr_compiled_bench_sm_fixed,
+                                                &tm, fpsr_compiled_bench_tm_fixed, &qs, fpsr_compiled_bench_qs_fixed);
+    failed |= fpsr_compiled_bench_check_presets("edge", &SM_EDGE, fpsr_compiled_bench_sm_edge_fixed,
+                                                &TM_EDGE, fpsr_compiled_bench_tm_edge_fixed,
+                                                &QS_EDGE, fpsr_compiled_bench_qs_edge_fixed);
+
+    int* n = malloc(FPSR_COMPILED_BENCH_SPAN * sizeof *n);
+    if (!n) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 2;
+    }
+    uint32_t state = 12345u;
+    for (int i = 0; i < FPSR_COMPILED_BENCH_SPAN; i++) { n[i] = (int)fpsr_compiled_bench_xorshift(&state); }
+    const fpsr_divisor d24 = fpsr_divisor_make(24 + fpsr_compiled_bench_zero);
+    printf("\n%-22s %10s\n", "mod by 24", "ns/call");
+    printf("%-22s %10.2f\n", "% (runtime divisor)", fpsr_compiled_bench_mod_time(0, &d24, n, count));
+    printf("%-22s %10.2f\n", "fpsr_divisor_mod()", fpsr_compiled_bench_mod_time(1, &d24, n, count));
+    printf("%-22s %10.2f\n", "% 24 (constant)", fpsr_compiled_bench_mod_time(2, &d24, n, count));
+    free(n);
+
+    static const char* const ALGS[3] = { "sm", "tm", "qs" };
+    printf("\n%-4s %-6s %10s %10s %10s %9s %9s\n", "alg", "final", "eval ns", "fixed ns", "compiled", "fixed", "compiled");
+    for (int final = 1; final >= 0; final--) {
+        sm.finalRandSwitch = tm.finalRandSwitch = qs.finalRandSwitch = final;
+        for (int alg = 0; alg < 3; alg++) {
+            const double t[3] = {
+                fpsr_compiled_bench_eval_time(alg, 0, &sm, &tm, &qs, count),
+                fpsr_compiled_bench_eval_time(alg, 1, &sm, &tm, &qs, count),
+                fpsr_compiled_bench_eval_time(alg, 2, &sm, &tm, &qs, count),
+            };
+            printf("%-4s %-6s %10.2f %10.2f %10.2f %8.2fx %8.2fx\n", ALGS[alg], final ? "on" : "off",
+                   t[0], t[1], t[2], t[0] / t[1], t[0] / t[2]);
+        }
+    }
+    printf("(%ld calls per timing)\n", count);
+    return failed;
+}
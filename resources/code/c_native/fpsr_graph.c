@@ -0,0 +1,743 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_graph.c
+ * @brief Nested modulation graph compiler and block interpreter.
+ * @details Every step of the program is one of the fpsr_op_code operations
+ * below and writes one register: a block of FPSR_GRAPH_BLOCK lanes of either
+ * int or float. Steps only read registers written by earlier steps, so the
+ * step list is its own topological order.
+ */
+
+#include "fpsr_graph.h"
+
+#include <errno.h> // For errno
+#include <stdlib.h> // For malloc(), realloc() and free()
+#include <string.h> // For memset() and memcmp()
+
+
+/******************************************************************************/
+/* Graph                                                                      */
+/******************************************************************************/
+
+typedef enum fpsr_node_kind {
+    FPSR_NODE_FRAME,
+    FPSR_NODE_ENTITY,
+    FPSR_NODE_CONST,
+    FPSR_NODE_SM,
+    FPSR_NODE_TM,
+    FPSR_NODE_QS,
+    FPSR_NODE_ADD,
+    FPSR_NODE_MUL,
+    FPSR_NODE_REMAP
+} fpsr_node_kind;
+
+typedef struct fpsr_graph_node {
+    fpsr_node_kind kind;
+    fpsr_sm_params sm;
+    fpsr_tm_params tm;
+    fpsr_qs_params qs;
+    float value; // CONST
+    double remap[4]; // REMAP: inMin, inMax, outMin, outMax
+    int args[2]; // ADD, MUL, REMAP
+    int drive[FPSR_SLOT_COUNT]; // driving node per slot, or -1
+} fpsr_graph_node;
+
+struct fpsr_graph {
+    fpsr_graph_node* nodes;
+    size_t count;
+    size_t capacity;
+};
+
+fpsr_graph* fpsr_graph_create(void) {
+    fpsr_graph* g = (fpsr_graph*)calloc(1, sizeof(fpsr_graph));
+    if (!g) { errno = ENOMEM; }
+    return g;
+}
+
+void fpsr_graph_destroy(fpsr_graph* g) {
+    if (g) {
+        free(g->nodes);
+        free(g);
+    }
+}
+
+static int fpsr_graph_valid(const fpsr_graph* g, int node) {
+    return node >= 0 && (size_t)node < g->count;
+}
+
+/** @brief Appends a node of the given kind; the caller fills in the rest. */
+static int fpsr_graph_push(fpsr_graph* g, fpsr_node_kind kind, fpsr_graph_node** node) {
+    if (g->count == g->capacity) {
+        size_t capacity = g->capacity ? g->capacity * 2 : 16;
+        fpsr_graph_node* nodes = (fpsr_graph_node*)realloc(g->nodes, capacity * sizeof(fpsr_graph_node));
+        if (!nodes) {
+            errno = ENOMEM;
+            return -1;
+        }
+        g->nodes = nodes;
+        g->capacity = capacity;
+    }
+    fpsr_graph_node* n = &g->nodes[g->count];
+    memset(n, 0, sizeof *n);
+    n->kind = kind;
+    n->args[0] = n->args[1] = -1;
+    for (int s = 0; s < FPSR_SLOT_COUNT; s++) { n->drive[s] = -1; }
+    *node = n;
+    return (int)g->count++;
+}
+
+int fpsr_graph_frame(fpsr_graph* g) {
+    fpsr_graph_node* n;
+    return fpsr_graph_push(g, FPSR_NODE_FRAME, &n);
+}
+
+int fpsr_graph_entity(fpsr_graph* g) {
+    fpsr_graph_node* n;
+    return fpsr_graph_push(g, FPSR_NODE_ENTITY, &n);
+}
+
+int fpsr_graph_const(fpsr_graph* g, float value) {
+    fpsr_graph_node* n;
+    int id = fpsr_graph_push(g, FPSR_NODE_CONST, &n);
+    if (id >= 0) { n->value = value; }
+    return id;
+}
+
+int fpsr_graph_sm(fpsr_graph* g, const fpsr_sm_params* preset) {
+    fpsr_graph_node* n;
+    int id = fpsr_graph_push(g, FPSR_NODE_SM, &n);
+    if (id >= 0) { n->sm = *preset; }
+    return id;
+}
+
+int fpsr_graph_tm(fpsr_graph* g, const fpsr_tm_params* preset) {
+    fpsr_graph_node* n;
+    int id = fpsr_graph_push(g, FPSR_NODE_TM, &n);
+    if (id >= 0) { n->tm = *preset; }
+    return id;
+}
+
+int fpsr_graph_qs(fpsr_graph* g, const fpsr_qs_params* preset) {
+    fpsr_graph_node* n;
+    int id = fpsr_graph_push(g, FPSR_NODE_QS, &n);
+    if (id >= 0) { n->qs = *preset; }
+    return id;
+}
+
+static int fpsr_graph_binary(fpsr_graph* g, fpsr_node_kind kind, int a, int b) {
+    if (!fpsr_graph_valid(g, a) || !fpsr_graph_valid(g, b)) {
+        errno = EINVAL;
+        return -1;
+    }
+    fpsr_graph_node* n;
+    int id = fpsr_graph_push(g, kind, &n);
+    if (id >= 0) {
+        n->args[0] = a;
+        n->args[1] = b;
+    }
+    return id;
+}
+
+int fpsr_graph_add(fpsr_graph* g, int a, int b) { return fpsr_graph_binary(g, FPSR_NODE_ADD, a, b); }
+int fpsr_graph_mul(fpsr_graph* g, int a, int b) { return fpsr_graph_binary(g, FPSR_NODE_MUL, a, b); }
+
+int fpsr_graph_remap(fpsr_graph* g, int x, double inMin, double inMax, double outMin, double outMax) {
+    if (!fpsr_graph_valid(g, x)) {
+        errno = EINVAL;
+        return -1;
+    }
+    fpsr_graph_node* n;
+    int id = fpsr_graph_push(g, FPSR_NODE_REMAP, &n);
+    if (id >= 0) {
+        n->args[0] = x;
+        n->remap[0] = inMin;
+        n->remap[1] = inMax;
+        n->remap[2] = outMin;
+        n->remap[3] = outMax;
+    }
+    return id;
+}
+
+/** @brief Whether an FPS-R node of this kind has the slot. */
+static int fpsr_graph_has_slot(fpsr_node_kind kind, fpsr_graph_slot slot) {
+    switch (kind) {
+    case FPSR_NODE_SM:
+        return slot == FPSR_SLOT_FRAME || slot == FPSR_SLOT_SEED_INNER || slot == FPSR_SLOT_SEED_OUTER ||
+               slot == FPSR_SLOT_MIN_HOLD || slot == FPSR_SLOT_MAX_HOLD || slot == FPSR_SLOT_RESEED_INTERVAL;
+    case FPSR_NODE_TM:
+        return slot == FPSR_SLOT_FRAME || slot == FPSR_SLOT_SEED_INNER || slot == FPSR_SLOT_SEED_OUTER ||
+               slot == FPSR_SLOT_PERIOD_A || slot == FPSR_SLOT_PERIOD_B || slot == FPSR_SLOT_PERIOD_SWITCH;
+    case FPSR_NODE_QS:
+        return slot == FPSR_SLOT_FRAME || slot == FPSR_SLOT_STREAM1_OFFSET || slot == FPSR_SLOT_STREAM2_OFFSET ||
+               slot == FPSR_SLOT_QUANT1_OFFSET || slot == FPSR_SLOT_QUANT2_OFFSET;
+    default:
+        return 0;
+    }
+}
+
+int fpsr_graph_drive(fpsr_graph* g, int node, fpsr_graph_slot slot, int source) {
+    if (!fpsr_graph_valid(g, node) || !fpsr_graph_valid(g, source) ||
+        (int)slot < 0 || slot >= FPSR_SLOT_COUNT || !fpsr_graph_has_slot(g->nodes[node].kind, slot)) {
+        errno = EINVAL;
+        return -1;
+    }
+    g->nodes[node].drive[slot] = source;
+    return 0;
+}
+
+
+/******************************************************************************/
+/* Steps                                                                      */
+/******************************************************************************/
+
+typedef enum fpsr_op_code {
+    // int results
+    FPSR_OP_FRAME,
+    FPSR_OP_ENTITY,
+    FPSR_OP_CONST_I, // imm[0]
+    FPSR_OP_ADD_I, // a + b
+    FPSR_OP_HELD, // x - (x % d)
+    FPSR_OP_CLAMP1, // a < 1 ? 1 : a
+    FPSR_OP_STATE_SEED, // fpsr_state_seed(state)
+    FPSR_OP_F2I, // (int)f, INT_MIN out of range
+    FPSR_OP_SM_HOLD, // (minHold, maxHold, rand) -> holdDuration
+    FPSR_OP_TM_HOLD, // (inner clock, periodSwitch, periodA, periodB) -> holdDuration
+    FPSR_OP_QS_LEVEL, // rand -> quant level; imm: quant_min, quant_range
+    FPSR_OP_QS_ACTIVE, // frame -> stream index; imm: streamSwitchDur
+    FPSR_OP_QS_SEED, // (int)(val * 100000.0)
+    // float results
+    FPSR_OP_CONST_F, // imm[0]
+    FPSR_OP_RAND, // fpsr_portable_rand(seed)
+    FPSR_OP_I2F, // (float)i
+    FPSR_OP_QS_WAVE, // (offset + frame, level) -> stream value; imm: freq, mult, use mult
+    FPSR_OP_SELECT, // c == 0 ? a : b
+    FPSR_OP_QS_LINEAR, // 0.5 * val + 0.5
+    FPSR_OP_ADD_F,
+    FPSR_OP_MUL_F,
+    FPSR_OP_REMAP // imm: inMin, scale, outMin
+} fpsr_op_code;
+
+typedef union fpsr_lane {
+    int32_t i;
+    float f;
+} fpsr_lane;
+
+typedef struct fpsr_op {
+    int code;
+    int arg[4];
+    double imm[4];
+} fpsr_op;
+
+static const int FPSR_OP_ARITY[] = {
+    0, 0, 0, 2, 2, 1, 1, 1, 3, 4, 1, 1, 1,
+    0, 1, 1, 2, 3, 1, 2, 2, 1
+};
+
+static int fpsr_op_is_int(int code) { return code < FPSR_OP_CONST_F; }
+static int fpsr_op_is_const(int code) { return code == FPSR_OP_CONST_I || code == FPSR_OP_CONST_F; }
+
+/**
+ * @brief (int)f as the reference gets it on x86 (cvttss2si): truncation
+ * toward zero, and INT_MIN for NaN and values outside the int range, where
+ * C leaves the conversion undefined. The convention of fpsr_state_seed().
+ */
+static int32_t fpsr_convert_int(float f) {
+    if (f >= -2147483648.0f && f < 2147483648.0f) { return (int32_t)f; }
+    return INT32_MIN;
+}
+
+/** @brief Runs one step over n lanes. in[k] is the register of arg[k]. */
+static void fpsr_op_run(const fpsr_op* op, const fpsr_lane* const* in, fpsr_lane* out, size_t n) {
+    const fpsr_lane* a = in[0];
+    const fpsr_lane* b = in[1];
+    const fpsr_lane* c = in[2];
+    const fpsr_lane* d = in[3];
+
+    switch ((fpsr_op_code)op->code) {
+    case FPSR_OP_FRAME:
+    case FPSR_OP_ENTITY:
+        break; // filled by the caller
+    case FPSR_OP_CONST_I:
+        for (size_t k = 0; k < n; k++) { out[k].i = (int32_t)op->imm[0]; }
+        break;
+    case FPSR_OP_CONST_F:
+        for (size_t k = 0; k < n; k++) { out[k].f = (float)op->imm[0]; }
+        break;
+    case FPSR_OP_ADD_I:
+        for (size_t k = 0; k < n; k++) { out[k].i = (int32_t)((uint32_t)a[k].i + (uint32_t)b[k].i); }
+        break;
+    case FPSR_OP_HELD:
+        for (size_t k = 0; k < n; k++) { out[k].i = a[k].i - (a[k].i % b[k].i); }
+        break;
+    case FPSR_OP_CLAMP1:
+        for (size_t k = 0; k < n; k++) { out[k].i = a[k].i < 1 ? 1 : a[k].i; }
+        break;
+    case FPSR_OP_STATE_SEED:
+        for (size_t k = 0; k < n; k++) { out[k].i = fpsr_state_seed(a[k].i); }
+        break;
+    case FPSR_OP_F2I:
+        for (size_t k = 0; k < n; k++) { out[k].i = fpsr_convert_int(a[k].f); }
+        break;
+    case FPSR_OP_SM_HOLD:
+        for (size_t k = 0; k < n; k++) {
+            int minHold = a[k].i, maxHold = b[k].i;
+            float rand_for_duration = c[k].f;
+            int holdDuration = (int)floor(minHold + rand_for_duration * (maxHold - minHold));
+            out[k].i = holdDuration < 1 ? 1 : holdDuration;
+        }
+        break;
+    case FPSR_OP_TM_HOLD:
+        for (size_t k = 0; k < n; k++) {
+            int periodSwitch = b[k].i;
+            int holdDuration = ((a[k].i % periodSwitch) < (periodSwitch * 0.5)) ? c[k].i : d[k].i;
+            out[k].i = holdDuration < 1 ? 1 : holdDuration;
+        }
+        break;
+    case FPSR_OP_QS_LEVEL: {
+        const int quant_min = (int)op->imm[0], quant_range = (int)op->imm[1];
+        for (size_t k = 0; k < n; k++) {
+            int quant_level = quant_min + (int)floor(a[k].f * quant_range);
+            out[k].i = quant_level < 1 ? 1 : quant_level;
+        }
+        break;
+    }
+    case FPSR_OP_QS_ACTIVE: {
+        const int streamSwitchDur = (int)op->imm[0];
+        for (size_t k = 0; k < n; k++) { out[k].i = ((a[k].i % streamSwitchDur) < streamSwitchDur / 2) ? 0 : 1; }
+        break;
+    }
+    case FPSR_OP_QS_SEED:
+        for (size_t k = 0; k < n; k++) { out[k].i = (int)(a[k].f * 100000.0); }
+        break;
+    case FPSR_OP_RAND:
+        // Seeds are mostly held values, repeated over runs of lanes: hash each run once.
+        for (size_t k = 0; k < n; k++) {
+            out[k].f = (k > 0 && a[k].i == a[k - 1].i) ? out[k - 1].f : fpsr_portable_rand(a[k].i);
+        }
+        break;
+    case FPSR_OP_I2F:
+        for (size_t k = 0; k < n; k++) { out[k].f = (float)a[k].i; }
+        break;
+    case FPSR_OP_QS_WAVE: {
+        const float freq = (float)op->imm[0], mult = (float)op->imm[1];
+        const int useMult = op->imm[2] != 0.0;
+        for (size_t k = 0; k < n; k++) {
+            float arg = useMult ? (float)a[k].i * freq * mult : (float)a[k].i * freq;
+            int quant_level = b[k].i;
+            out[k].f = floor((sin(arg) / 2.0 + 0.5) * quant_level) / (float)quant_level;
+        }
+        break;
+    }
+    case FPSR_OP_SELECT:
+        for (size_t k = 0; k < n; k++) { out[k].f = a[k].i == 0 ? b[k].f : c[k].f; }
+        break;
+    case FPSR_OP_QS_LINEAR:
+        for (size_t k = 0; k < n; k++) { out[k].f = 0.5 * a[k].f + 0.5; }
+        break;
+    case FPSR_OP_ADD_F:
+        for (size_t k = 0; k < n; k++) { out[k].f = a[k].f + b[k].f; }
+        break;
+    case FPSR_OP_MUL_F:
+        for (size_t k = 0; k < n; k++) { out[k].f = a[k].f * b[k].f; }
+        break;
+    case FPSR_OP_REMAP: {
+        const double inMin = op->imm[0], scale = op->imm[1], outMin = op->imm[2];
+        for (size_t k = 0; k < n; k++) { out[k].f = (float)(outMin + ((double)a[k].f - inMin) * scale); }
+        break;
+    }
+    }
+}
+
+
+/******************************************************************************/
+/* Compiler                                                                   */
+/******************************************************************************/
+
+struct fpsr_program {
+    fpsr_op* ops;
+    size_t count;
+    int* outputs; // register of each output
+    size_t outputCount;
+};
+
+typedef struct fpsr_compiler {
+    const fpsr_graph* g;
+    fpsr_op* ops;
+    size_t count;
+    size_t capacity;
+    int* nodeReg; // register of each lowered node, or -1
+    unsigned char* visiting; // cycle detection
+} fpsr_compiler;
+
+static fpsr_op fpsr_op_make(int code, int a, int b, int c, int d) {
+    fpsr_op op;
+    memset(&op, 0, sizeof op); // unused args and immediates are 0, so equal steps compare equal
+    op.code = code;
+    op.arg[0] = a;
+    op.arg[1] = b;
+    op.arg[2] = c;
+    op.arg[3] = d;
+    return op;
+}
+
+/**
+ * @brief Whether two steps are identical: code, arguments and immediates.
+ * @details Immediates are compared by their bits, so the constants 0.0 and
+ * -0.0 stay apart (x * 0.0 and x * -0.0 differ).
+ */
+static int fpsr_op_same(const fpsr_op* x, const fpsr_op* y) {
+    if (x->code != y->code) { return 0; }
+    for (int k = 0; k < 4; k++) {
+        if (x->arg[k] != y->arg[k] || memcmp(&x->imm[k], &y->imm[k], sizeof x->imm[k]) != 0) { return 0; }
+    }
+    return 1;
+}
+
+/**
+ * @brief Adds a step, or returns the register of an identical one.
+ * @details Steps on constants only are evaluated here and become constants.
+ * Unused arg slots must be 0. @return The register, or -1 when out of memory.
+ */
+static int fpsr_emit(fpsr_compiler* c, fpsr_op op) {
+    const int arity = FPSR_OP_ARITY[op.code];
+
+    // Canonical operand order for commutative steps.
+    if ((op.code == FPSR_OP_ADD_I || op.code == FPSR_OP_ADD_F || op.code == FPSR_OP_MUL_F) && op.arg[0] > op.arg[1]) {
+        int t = op.arg[0];
+        op.arg[0] = op.arg[1];
+        op.arg[1] = t;
+    }
+
+    int folds = arity > 0;
+    for (int k = 0; k < arity; k++) { folds = folds && fpsr_op_is_const(c->ops[op.arg[k]].code); }
+    if (folds) {
+        fpsr_lane values[4], result;
+        const fpsr_lane* in[4] = { &values[0], &values[1], &values[2], &values[3] };
+        for (int k = 0; k < arity; k++) {
+            fpsr_op_run(&c->ops[op.arg[k]], in, &values[k], 1);
+        }
+        fpsr_op_run(&op, in, &result, 1);
+        int isInt = fpsr_op_is_int(op.code);
+        op = fpsr_op_make(isInt ? FPSR_OP_CONST_I : FPSR_OP_CONST_F, 0, 0, 0, 0);
+        op.imm[0] = isInt ? (double)result.i : (double)result.f;
+    }
+
+    for (size_t i = 0; i < c->count; i++) {
+        if (fpsr_op_same(&c->ops[i], &op)) { return (int)i; }
+    }
+
+    if (c->count == c->capacity) {
+        size_t capacity = c->capacity ? c->capacity * 2 : 64;
+        fpsr_op* ops = (fpsr_op*)realloc(c->ops, capacity * sizeof(fpsr_op));
+        if (!ops) {
+            errno = ENOMEM;
+            return -1;
+        }
+        c->ops = ops;
+        c->capacity = capacity;
+    }
+    c->ops[c->count] = op;
+    return (int)c->count++;
+}
+
+static int fpsr_emit1(fpsr_compiler* c, int code, int a) { return a < 0 ? -1 : fpsr_emit(c, fpsr_op_make(code, a, 0, 0, 0)); }
+static int fpsr_emit2(fpsr_compiler* c, int code, int a, int b) { return (a < 0 || b < 0) ? -1 : fpsr_emit(c, fpsr_op_make(code, a, b, 0, 0)); }
+
+static int fpsr_emit_const_i(fpsr_compiler* c, int value) {
+    fpsr_op op = fpsr_op_make(FPSR_OP_CONST_I, 0, 0, 0, 0);
+    op.imm[0] = value;
+    return fpsr_emit(c, op);
+}
+
+static int fpsr_lower(fpsr_compiler* c, int node);
+
+/** @brief The node's register as a float. */
+static int fpsr_lower_float(fpsr_compiler* c, int node) {
+    int r = fpsr_lower(c, node);
+    if (r >= 0 && fpsr_op_is_int(c->ops[r].code)) { r = fpsr_emit1(c, FPSR_OP_I2F, r); }
+    return r;
+}
+
+/** @brief An integer parameter: the driving node (converted to int) or the preset value. */
+static int fpsr_lower_slot(fpsr_compiler* c, const fpsr_graph_node* n, fpsr_graph_slot slot, int preset) {
+    if (n->drive[slot] < 0) {
+        return slot == FPSR_SLOT_FRAME ? fpsr_emit(c, fpsr_op_make(FPSR_OP_FRAME, 0, 0, 0, 0))
+                                       : fpsr_emit_const_i(c, preset);
+    }
+    int r = fpsr_lower(c, n->drive[slot]);
+    if (r >= 0 && !fpsr_op_is_int(c->ops[r].code)) { r = fpsr_emit1(c, FPSR_OP_F2I, r); }
+    return r;
+}
+
+/** @brief Step 3 of SM and TM. */
+static int fpsr_lower_held_output(fpsr_compiler* c, int state, int finalRandSwitch) {
+    return finalRandSwitch ? fpsr_emit1(c, FPSR_OP_RAND, fpsr_emit1(c, FPSR_OP_STATE_SEED, state))
+                           : fpsr_emit1(c, FPSR_OP_I2F, state);
+}
+
+static int fpsr_lower_sm(fpsr_compiler* c, const fpsr_graph_node* n) {
+    const fpsr_sm_params* p = &n->sm;
+    int frame = fpsr_lower_slot(c, n, FPSR_SLOT_FRAME, 0);
+    int seedInner = fpsr_lower_slot(c, n, FPSR_SLOT_SEED_INNER, p->seedInner);
+    int seedOuter = fpsr_lower_slot(c, n, FPSR_SLOT_SEED_OUTER, p->seedOuter);
+    int minHold = fpsr_lower_slot(c, n, FPSR_SLOT_MIN_HOLD, p->minHold);
+    int maxHold = fpsr_lower_slot(c, n, FPSR_SLOT_MAX_HOLD, p->maxHold);
+    int reseedInterval = fpsr_emit1(c, FPSR_OP_CLAMP1, fpsr_lower_slot(c, n, FPSR_SLOT_RESEED_INTERVAL, p->reseedInterval));
+
+    // seedInner + frame - (frame % reseedInterval)
+    int seed = fpsr_emit2(c, FPSR_OP_ADD_I, seedInner, fpsr_emit2(c, FPSR_OP_HELD, frame, reseedInterval));
+    int rand_for_duration = fpsr_emit1(c, FPSR_OP_RAND, seed);
+    if (minHold < 0 || maxHold < 0 || rand_for_duration < 0) { return -1; }
+    int holdDuration = fpsr_emit(c, fpsr_op_make(FPSR_OP_SM_HOLD, minHold, maxHold, rand_for_duration, 0));
+
+    int state = fpsr_emit2(c, FPSR_OP_HELD, fpsr_emit2(c, FPSR_OP_ADD_I, seedOuter, frame), holdDuration);
+    return fpsr_lower_held_output(c, state, p->finalRandSwitch);
+}
+
+static int fpsr_lower_tm(fpsr_compiler* c, const fpsr_graph_node* n) {
+    const fpsr_tm_params* p = &n->tm;
+    int frame = fpsr_lower_slot(c, n, FPSR_SLOT_FRAME, 0);
+    int seedInner = fpsr_lower_slot(c, n, FPSR_SLOT_SEED_INNER, p->seedInner);
+    int seedOuter = fpsr_lower_slot(c, n, FPSR_SLOT_SEED_OUTER, p->seedOuter);
+    int periodA = fpsr_lower_slot(c, n, FPSR_SLOT_PERIOD_A, p->periodA);
+    int periodB = fpsr_lower_slot(c, n, FPSR_SLOT_PERIOD_B, p->periodB);
+    int periodSwitch = fpsr_emit1(c, FPSR_OP_CLAMP1, fpsr_lower_slot(c, n, FPSR_SLOT_PERIOD_SWITCH, p->periodSwitch));
+
+    int inner_clock_frame = fpsr_emit2(c, FPSR_OP_ADD_I, seedInner, frame);
+    if (inner_clock_frame < 0 || periodSwitch < 0 || periodA < 0 || periodB < 0) { return -1; }
+    int holdDuration = fpsr_emit(c, fpsr_op_make(FPSR_OP_TM_HOLD, inner_clock_frame, periodSwitch, periodA, periodB));
+
+    int state = fpsr_emit2(c, FPSR_OP_HELD, fpsr_emit2(c, FPSR_OP_ADD_I, seedOuter, frame), holdDuration);
+    return fpsr_lower_held_output(c, state, p->finalRandSwitch);
+}
+
+static int fpsr_lower_qs(fpsr_compiler* c, const fpsr_graph_node* n) {
+    // The durations cannot be driven, so their defaults resolve here.
+    const fpsr_qs_params r = fpsr_qs_resolve(n->qs);
+    const int quantDur[2] = { r.stream1QuantDur, r.stream2QuantDur };
+    const fpsr_graph_slot streamSlot[2] = { FPSR_SLOT_STREAM1_OFFSET, FPSR_SLOT_STREAM2_OFFSET };
+    const fpsr_graph_slot quantSlot[2] = { FPSR_SLOT_QUANT1_OFFSET, FPSR_SLOT_QUANT2_OFFSET };
+    int frame = fpsr_lower_slot(c, n, FPSR_SLOT_FRAME, 0);
+    int stream[2];
+
+    for (int s = 0; s < 2; s++) {
+        int quantX = fpsr_emit2(c, FPSR_OP_ADD_I, fpsr_lower_slot(c, n, quantSlot[s], r.quantOffsets[s]), frame);
+        int quant_seed = fpsr_emit2(c, FPSR_OP_HELD, quantX, fpsr_emit_const_i(c, quantDur[s]));
+        int rand_for_quant = fpsr_emit1(c, FPSR_OP_RAND, quant_seed);
+        if (rand_for_quant < 0) { return -1; }
+        fpsr_op level = fpsr_op_make(FPSR_OP_QS_LEVEL, rand_for_quant, 0, 0, 0);
+        level.imm[0] = r.quantLevelsMinMax[0];
+        level.imm[1] = r.quantLevelsMinMax[1] - r.quantLevelsMinMax[0] + 1;
+        int quant_level = fpsr_emit(c, level);
+
+        int waveX = fpsr_emit2(c, FPSR_OP_ADD_I, fpsr_lower_slot(c, n, streamSlot[s], r.streamsOffset[s]), frame);
+        if (waveX < 0 || quant_level < 0) { return -1; }
+        fpsr_op wave = fpsr_op_make(FPSR_OP_QS_WAVE, waveX, quant_level, 0, 0);
+        wave.imm[0] = r.baseWaveFreq;
+        wave.imm[1] = s ? r.stream2FreqMult : 0.0f;
+        wave.imm[2] = s;
+        stream[s] = fpsr_emit(c, wave);
+    }
+
+    if (frame < 0 || stream[0] < 0 || stream[1] < 0) { return -1; }
+    fpsr_op active = fpsr_op_make(FPSR_OP_QS_ACTIVE, frame, 0, 0, 0);
+    active.imm[0] = r.streamSwitchDur;
+    int active_stream = fpsr_emit(c, active);
+    if (active_stream < 0) { return -1; }
+    int active_stream_val = fpsr_emit(c, fpsr_op_make(FPSR_OP_SELECT, active_stream, stream[0], stream[1], 0));
+
+    return (r.finalRandSwitch == 1) ? fpsr_emit1(c, FPSR_OP_RAND, fpsr_emit1(c, FPSR_OP_QS_SEED, active_stream_val))
+                                    : fpsr_emit1(c, FPSR_OP_QS_LINEAR, active_stream_val);
+}
+
+/** @brief Lowers a node and everything it depends on. @return Its register, or -1. */
+static int fpsr_lower(fpsr_compiler* c, int node) {
+    if (c->nodeReg[node] >= 0) { return c->nodeReg[node]; }
+    if (c->visiting[node]) {
+        errno = ELOOP;
+        return -1;
+    }
+    c->visiting[node] = 1;
+
+    const fpsr_graph_node* n = &c->g->nodes[node];
+    int r = -1;
+    switch (n->kind) {
+    case FPSR_NODE_FRAME: r = fpsr_emit(c, fpsr_op_make(FPSR_OP_FRAME, 0, 0, 0, 0)); break;
+    case FPSR_NODE_ENTITY: r = fpsr_emit(c, fpsr_op_make(FPSR_OP_ENTITY, 0, 0, 0, 0)); break;
+    case FPSR_NODE_CONST: {
+        fpsr_op op = fpsr_op_make(FPSR_OP_CONST_F, 0, 0, 0, 0);
+        op.imm[0] = n->value;
+        r = fpsr_emit(c, op);
+        break;
+    }
+    case FPSR_NODE_SM: r = fpsr_lower_sm(c, n); break;
+    case FPSR_NODE_TM: r = fpsr_lower_tm(c, n); break;
+    case FPSR_NODE_QS: r = fpsr_lower_qs(c, n); break;
+    case FPSR_NODE_ADD:
+    case FPSR_NODE_MUL: {
+        int a = fpsr_lower_float(c, n->args[0]);
+        int b = a < 0 ? -1 : fpsr_lower_float(c, n->args[1]);
+        r = fpsr_emit2(c, n->kind == FPSR_NODE_ADD ? FPSR_OP_ADD_F : FPSR_OP_MUL_F, a, b);
+        break;
+    }
+    case FPSR_NODE_REMAP: {
+        int x = fpsr_lower_float(c, n->args[0]);
+        if (x < 0) { break; }
+        fpsr_op op = fpsr_op_make(FPSR_OP_REMAP, x, 0, 0, 0);
+        op.imm[0] = n->remap[0];
+        op.imm[1] = (n->remap[1] != n->remap[0]) ? (n->remap[3] - n->remap[2]) / (n->remap[1] - n->remap[0]) : 0.0;
+        op.imm[2] = n->remap[2];
+        r = fpsr_emit(c, op);
+        break;
+    }
+    }
+
+    c->visiting[node] = 0;
+    c->nodeReg[node] = r;
+    return r;
+}
+
+fpsr_program* fpsr_graph_compile(const fpsr_graph* g, const int* outputs, size_t outputCount) {
+    for (size_t o = 0; o < outputCount; o++) {
+        if (!fpsr_graph_valid(g, outputs[o])) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    fpsr_compiler c;
+    memset(&c, 0, sizeof c);
+    c.g = g;
+    c.nodeReg = (int*)malloc((g->count ? g->count : 1) * sizeof(int));
+    c.visiting = (unsigned char*)calloc(g->count ? g->count : 1, 1);
+    fpsr_program* prog = (fpsr_program*)calloc(1, sizeof(fpsr_program));
+    int* regs = (int*)malloc((outputCount ? outputCount : 1) * sizeof(int));
+    int ok = c.nodeReg && c.visiting && prog && regs;
+    if (!ok) { errno = ENOMEM; }
+    for (size_t i = 0; ok && i < g->count; i++) { c.nodeReg[i] = -1; }
+
+    for (size_t o = 0; ok && o < outputCount; o++) {
+        regs[o] = fpsr_lower_float(&c, outputs[o]);
+        ok = regs[o] >= 0;
+    }
+
+    // Drop the steps no output reads, e.g. constants that were folded away.
+    unsigned char* live = ok ? (unsigned char*)calloc(c.count ? c.count : 1, 1) : NULL;
+    int* renumber = ok ? (int*)malloc((c.count ? c.count : 1) * sizeof(int)) : NULL;
+    if (ok && (!live || !renumber)) {
+        errno = ENOMEM;
+        ok = 0;
+    }
+    if (ok) {
+        for (size_t o = 0; o < outputCount; o++) { live[regs[o]] = 1; }
+        for (size_t i = c.count; i-- > 0;) {
+            for (int k = 0; live[i] && k < FPSR_OP_ARITY[c.ops[i].code]; k++) { live[c.ops[i].arg[k]] = 1; }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < c.count; i++) {
+            if (!live[i]) { continue; }
+            fpsr_op op = c.ops[i];
+            for (int k = 0; k < FPSR_OP_ARITY[op.code]; k++) { op.arg[k] = renumber[op.arg[k]]; }
+            renumber[i] = (int)kept;
+            c.ops[kept++] = op;
+        }
+        for (size_t o = 0; o < outputCount; o++) { regs[o] = renumber[regs[o]]; }
+        c.count = kept;
+    }
+
+    free(live);
+    free(renumber);
+    free(c.nodeReg);
+    free(c.visiting);
+    if (!ok) {
+        free(c.ops);
+        free(prog);
+        free(regs);
+        return NULL;
+    }
+    prog->ops = c.ops;
+    prog->count = c.count;
+    prog->outputs = regs;
+    prog->outputCount = outputCount;
+    return prog;
+}
+
+void fpsr_program_destroy(fpsr_program* prog) {
+    if (prog) {
+        free(prog->ops);
+        free(prog->outputs);
+        free(prog);
+    }
+}
+
+size_t fpsr_program_steps(const fpsr_program* prog) {
+    return prog->count;
+}
+
+
+/******************************************************************************/
+/* Evaluation                                                                 */
+/******************************************************************************/
+
+/**
+ * @brief Runs the program over count lanes. Lane i sees frame
+ * firstFrame + i * frameStep and entity entities[i] (or entity).
+ */
+static int fpsr_program_run(const fpsr_program* prog, int firstFrame, int frameStep,
+                            int entity, const int* entities, float* out, size_t count)
+{
+    if (count == 0) { return 0; }
+    fpsr_lane* regs = (fpsr_lane*)malloc((prog->count ? prog->count : 1) * FPSR_GRAPH_BLOCK * sizeof(fpsr_lane));
+    if (!regs) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // Constants never change, so they are filled once.
+    for (size_t i = 0; i < prog->count; i++) {
+        if (fpsr_op_is_const(prog->ops[i].code)) {
+            const fpsr_lane* none[4] = { NULL, NULL, NULL, NULL };
+            fpsr_op_run(&prog->ops[i], none, regs + i * FPSR_GRAPH_BLOCK, FPSR_GRAPH_BLOCK);
+        }
+    }
+
+    for (size_t start = 0; start < count; start += FPSR_GRAPH_BLOCK) {
+        size_t n = count - start < FPSR_GRAPH_BLOCK ? count - start : FPSR_GRAPH_BLOCK;
+        for (size_t i = 0; i < prog->count; i++) {
+            const fpsr_op* op = &prog->ops[i];
+            fpsr_lane* dst = regs + i * FPSR_GRAPH_BLOCK;
+            if (op->code == FPSR_OP_FRAME) {
+                for (size_t k = 0; k < n; k++) { dst[k].i = (int32_t)(firstFrame + (int64_t)frameStep * (int64_t)(start + k)); }
+            } else if (op->code == FPSR_OP_ENTITY) {
+                for (size_t k = 0; k < n; k++) { dst[k].i = entities ? entities[start + k] : entity; }
+            } else if (!fpsr_op_is_const(op->code)) {
+                const fpsr_lane* in[4];
+                for (int k = 0; k < 4; k++) { in[k] = regs + (size_t)op->arg[k] * FPSR_GRAPH_BLOCK; }
+                fpsr_op_run(op, in, dst, n);
+            }
+        }
+        for (size_t o = 0; o < prog->outputCount; o++) {
+            const fpsr_lane* src = regs + (size_t)prog->outputs[o] * FPSR_GRAPH_BLOCK;
+            for (size_t k = 0; k < n; k++) { out[o * count + start + k] = src[k].f; }
+        }
+    }
+
+    free(regs);
+    return 0;
+}
+
+int fpsr_program_eval_frames(const fpsr_program* prog, int firstFrame, int entity,
+                             float* out, size_t count)
+{
+    return fpsr_program_run(prog, firstFrame, 1, entity, NULL, out, count);
+}
+
+int fpsr_program_eval_entities(const fpsr_program* prog, int frame, const int* entities,
+                               float* out, size_t count)
+{
+    return fpsr_program_run(prog, frame, 0, 0, entities, out, count);
+}
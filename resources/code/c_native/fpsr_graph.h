@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_graph.h
+ * @brief Nested modulation graphs: FPS-R driving FPS-R, compiled into one flat program.
+ * @details A graph is built from nodes:
+ *     - inputs: the frame, a per-entity integer, constants;
+ *     - FPS-R channels (SM, TM, QS), created from a preset. Any integer
+ *       parameter listed in fpsr_graph_slot can instead be driven by
+ *       another node, and so can the frame the channel sees;
+ *     - arithmetic on outputs: add, multiply, and a linear remap.
+ * A driven integer parameter receives the driving value converted as C
+ * converts a float argument to an int parameter (truncation toward zero).
+ * Where C leaves that undefined (NaN, or a value outside the int range) it
+ * gets INT_MIN, which is what x86 yields and the convention of
+ * fpsr_state_seed(); int additions wrap, as they do on x86. Everything else
+ * is computed with the reference expressions, so a graph gives bit for bit
+ * what the same calls chained by hand give on x86, and on any platform
+ * while the driving values stay in the int range.
+ *
+ * fpsr_graph_compile() lowers the nodes to the individual steps of each
+ * algorithm (e.g. seedInner + frame - (frame % reseedInterval), its
+ * portable_rand(), holdDuration, the held state) and builds a flat,
+ * topologically ordered program from them:
+ *     - identical steps are emitted once (common subexpression elimination),
+ *       so channels sharing a clock share its hash and its modulo;
+ *     - steps whose inputs are all constants are evaluated at compile time;
+ *     - steps no output depends on are dropped.
+ * The program runs in blocks of FPSR_GRAPH_BLOCK lanes (frames, or
+ * entities), one step at a time over the whole block, so each step is a
+ * tight loop and the dispatch cost is paid once per block. A portable_rand()
+ * step hashes each run of equal seeds in the block once; over consecutive
+ * frames, seeds are held values and mostly repeat.
+ *
+ * A program is immutable once compiled and may be evaluated from several
+ * threads at once.
+ */
+
+#ifndef FPSR_GRAPH_H
+#define FPSR_GRAPH_H
+
+#include <stddef.h> // For size_t
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Lanes per evaluation block. */
+#define FPSR_GRAPH_BLOCK 256
+
+/**
+ * @brief The parameters a node can be driven on (fpsr_graph_drive()).
+ */
+typedef enum fpsr_graph_slot {
+    FPSR_SLOT_FRAME = 0, // SM, TM, QS: the frame the channel sees
+    FPSR_SLOT_SEED_INNER = 1, // SM, TM
+    FPSR_SLOT_SEED_OUTER = 2, // SM, TM
+    FPSR_SLOT_MIN_HOLD = 3, // SM
+    FPSR_SLOT_MAX_HOLD = 4, // SM
+    FPSR_SLOT_RESEED_INTERVAL = 5, // SM
+    FPSR_SLOT_PERIOD_A = 6, // TM
+    FPSR_SLOT_PERIOD_B = 7, // TM
+    FPSR_SLOT_PERIOD_SWITCH = 8, // TM
+    FPSR_SLOT_STREAM1_OFFSET = 9, // QS streamsOffset[0]
+    FPSR_SLOT_STREAM2_OFFSET = 10, // QS streamsOffset[1]
+    FPSR_SLOT_QUANT1_OFFSET = 11, // QS quantOffsets[0]
+    FPSR_SLOT_QUANT2_OFFSET = 12, // QS quantOffsets[1]
+    FPSR_SLOT_COUNT = 13
+} fpsr_graph_slot;
+
+/** @brief A graph under construction. */
+typedef struct fpsr_graph fpsr_graph;
+
+/** @brief A compiled graph. */
+typedef struct fpsr_program fpsr_program;
+
+/**
+ * @brief Creates an empty graph.
+ * @return NULL with errno set if out of memory.
+ */
+fpsr_graph* fpsr_graph_create(void);
+void fpsr_graph_destroy(fpsr_graph* g);
+
+// Node constructors. Each returns the new node's id (>= 0), or -1 with
+// errno set (EINVAL for an unknown operand, ENOMEM).
+
+/** @brief The frame being evaluated. */
+int fpsr_graph_frame(fpsr_graph* g);
+/** @brief The per-entity integer (see fpsr_program_eval_entities()). */
+int fpsr_graph_entity(fpsr_graph* g);
+int fpsr_graph_const(fpsr_graph* g, float value);
+
+int fpsr_graph_sm(fpsr_graph* g, const fpsr_sm_params* preset);
+int fpsr_graph_tm(fpsr_graph* g, const fpsr_tm_params* preset);
+int fpsr_graph_qs(fpsr_graph* g, const fpsr_qs_params* preset);
+
+/** @brief a + b, in float. */
+int fpsr_graph_add(fpsr_graph* g, int a, int b);
+/** @brief a * b, in float. */
+int fpsr_graph_mul(fpsr_graph* g, int a, int b);
+/** @brief Maps x linearly from [inMin, inMax] to [outMin, outMax], in double, rounded to float. */
+int fpsr_graph_remap(fpsr_graph* g, int x, double inMin, double inMax, double outMin, double outMax);
+
+/**
+ * @brief Drives a parameter of an FPS-R node with the output of source.
+ * @return 0 on success, -1 with errno EINVAL if node does not have slot.
+ */
+int fpsr_graph_drive(fpsr_graph* g, int node, fpsr_graph_slot slot, int source);
+
+/**
+ * @brief Compiles the part of g that the given output nodes depend on.
+ * @return NULL with errno set on failure (ELOOP for a cycle, EINVAL, ENOMEM).
+ */
+fpsr_program* fpsr_graph_compile(const fpsr_graph* g, const int* outputs, size_t outputCount);
+void fpsr_program_destroy(fpsr_program* prog);
+
+/** @brief Number of steps in the compiled program. */
+size_t fpsr_program_steps(const fpsr_program* prog);
+
+/**
+ * @brief Evaluates frames firstFrame .. firstFrame + count - 1 for one entity.
+ * @details out[o * count + i] is output o at frame firstFrame + i.
+ * @return 0 on success, -1 with errno ENOMEM.
+ */
+int fpsr_program_eval_frames(const fpsr_program* prog, int firstFrame, int entity,
+                             float* out, size_t count);
+
+/**
+ * @brief Evaluates one frame for count entities.
+ * @details out[o * count + i] is output o for entities[i].
+ * @return 0 on success, -1 with errno ENOMEM.
+ */
+int fpsr_program_eval_entities(const fpsr_program* prog, int frame, const int* entities,
+                               float* out, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_GRAPH_H
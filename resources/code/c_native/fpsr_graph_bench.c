@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_graph_bench.c
+ * @brief Checks and benchmark of fpsr_graph.h programs against chained calls.
+ * @details Three graphs, each also written by hand as chained fpsr_*_eval()
+ * calls with C's conversions:
+ *     - shared: two SM channels on the same inner clock plus a TM channel,
+ *       added, so the compiler can share the duration hash and modulo;
+ *     - nested: TM, remapped to 0..1000, drives SM's seedOuter, and QS,
+ *       remapped to 0..500 and added to the frame, drives SM's frame;
+ *     - overflow: TM * 10^12 drives SM's seedInner, so nearly every driving
+ *       value is outside the int range and converts to INT_MIN. Chained by
+ *       hand that conversion is undefined in C, so this graph is only
+ *       checked on x86, where it yields INT_MIN.
+ * Parts:
+ *     - Checks (the program exits 1 if one fails): every graph against its
+ *       chain at 2 * 10^5 frames, bit for bit; and a graph with outputs
+ *       x * 0.0 and x * -0.0, whose constants must not be merged.
+ *     - Cost: steps in each program (and, for shared, in the three channels
+ *       compiled separately), and ns per frame of the chain against
+ *       fpsr_program_eval_frames() over --count frames, best of 3.
+ *
+ * Options: --count N (frames per timing, 1000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_graph_bench.c fpsr_graph.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h> // For uint32_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_graph.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_sm_params SM_B = { 16, 24, 9, -41, 77, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FPSR_GRAPH_BENCH_X86 1
+#else
+#define FPSR_GRAPH_BENCH_X86 0
+#endif
+
+#define FPSR_GRAPH_BENCH_GRAPHS 3
+#define FPSR_GRAPH_BENCH_CHUNK 4096
+
+static const char* const NAMES[FPSR_GRAPH_BENCH_GRAPHS] = { "shared", "nested", "overflow" };
+// First frame checked and timed; overflow stays >= 0 so INT_MIN + frame does not overflow.
+static const int FIRST[FPSR_GRAPH_BENCH_GRAPHS] = { -100000, -100000, 0 };
+
+static volatile float fpsr_graph_bench_sink;
+
+static double fpsr_graph_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static int fpsr_graph_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+
+/******************************************************************************/
+/* Graphs and their chains                                                    */
+/******************************************************************************/
+
+// The graph's remap node: in double, rounded to float.
+static float fpsr_graph_bench_remap(float x, double inMin, double inMax, double outMin, double outMax) {
+    return (float)(outMin + ((double)x - inMin) * ((outMax - outMin) / (inMax - inMin)));
+}
+
+static float fpsr_graph_bench_chain(int graph, int frame) {
+    fpsr_sm_params p = SM;
+    switch (graph) {
+    case 0:
+        return (fpsr_sm_eval(&SM, frame) + fpsr_sm_eval(&SM_B, frame)) + fpsr_tm_eval(&TM, frame);
+    case 1: {
+        p.seedOuter = (int)fpsr_graph_bench_remap(fpsr_tm_eval(&TM, frame), 0.0, 1.0, 0.0, 1000.0);
+        float driven = (float)frame + fpsr_graph_bench_remap(fpsr_qs_eval(&QS, frame), 0.0, 1.0, 0.0, 500.0);
+        return fpsr_sm_eval(&p, (int)driven);
+    }
+    default: {
+        volatile float big = fpsr_tm_eval(&TM, frame) * 1e12f; // volatile: converted at run time
+        p.seedInner = (int)big;
+        return fpsr_sm_eval(&p, frame);
+    }
+    }
+}
+
+/** @brief Builds graph and compiles its output. @return NULL on failure. */
+static fpsr_program* fpsr_graph_bench_build(int graph) {
+    fpsr_graph* g = fpsr_graph_create();
+    if (!g) { return NULL; }
+    int out = -1;
+    switch (graph) {
+    case 0:
+        out = fpsr_graph_add(g, fpsr_graph_add(g, fpsr_graph_sm(g, &SM), fpsr_graph_sm(g, &SM_B)), fpsr_graph_tm(g, &TM));
+        break;
+    case 1: {
+        out = fpsr_graph_sm(g, &SM);
+        int seedOuter = fpsr_graph_remap(g, fpsr_graph_tm(g, &TM), 0.0, 1.0, 0.0, 1000.0);
+        int driven = fpsr_graph_add(g, fpsr_graph_frame(g), fpsr_graph_remap(g, fpsr_graph_qs(g, &QS), 0.0, 1.0, 0.0, 500.0));
+        if (fpsr_graph_drive(g, out, FPSR_SLOT_SEED_OUTER, seedOuter) != 0 ||
+            fpsr_graph_drive(g, out, FPSR_SLOT_FRAME, driven) != 0) { out = -1; }
+        break;
+    }
+    default: {
+        out = fpsr_graph_sm(g, &SM);
+        int big = fpsr_graph_mul(g, fpsr_graph_tm(g, &TM), fpsr_graph_const(g, 1e12f));
+        if (fpsr_graph_drive(g, out, FPSR_SLOT_SEED_INNER, big) != 0) { out = -1; }
+        break;
+    }
+    }
+    fpsr_program* prog = out >= 0 ? fpsr_graph_compile(g, &out, 1) : NULL;
+    fpsr_graph_destroy(g);
+    return prog;
+}
+
+// Steps of the shared graph's three channels compiled one by one.
+static size_t fpsr_graph_bench_separate_steps(void) {
+    size_t steps = 0;
+    for (int k = 0; k < 3; k++) {
+        fpsr_graph* g = fpsr_graph_create();
+        if (!g) { return 0; }
+        int out = k == 0 ? fpsr_graph_sm(g, &SM) : (k == 1 ? fpsr_graph_sm(g, &SM_B) : fpsr_graph_tm(g, &TM));
+        fpsr_program* prog = fpsr_graph_compile(g, &out, 1);
+        steps += prog ? fpsr_program_steps(prog) : 0;
+        fpsr_program_destroy(prog);
+        fpsr_graph_destroy(g);
+    }
+    return steps;
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static int fpsr_graph_bench_check(int graph, const fpsr_program* prog, float* buf) {
+    const long frames = 200000;
+    long mismatches = 0;
+    for (long start = 0; start < frames; start += FPSR_GRAPH_BENCH_CHUNK) {
+        const int first = FIRST[graph] + (int)start;
+        if (fpsr_program_eval_frames(prog, first, 0, buf, FPSR_GRAPH_BENCH_CHUNK) != 0) { return 1; }
+        for (int k = 0; k < FPSR_GRAPH_BENCH_CHUNK; k++) {
+            mismatches += !fpsr_graph_bench_same(buf[k], fpsr_graph_bench_chain(graph, first + k));
+        }
+    }
+    printf("check %-8s graph against chained calls   %s\n", NAMES[graph], mismatches ? "DIFFER" : "same");
+    return mismatches != 0;
+}
+
+// Outputs x * 0.0 and x * -0.0 must keep their signs.
+static int fpsr_graph_bench_signed_zero(void) {
+    fpsr_graph* g = fpsr_graph_create();
+    if (!g) { return 1; }
+    const int sm = fpsr_graph_sm(g, &SM);
+    const int outs[2] = { fpsr_graph_mul(g, sm, fpsr_graph_const(g, 0.0f)), fpsr_graph_mul(g, sm, fpsr_graph_const(g, -0.0f)) };
+    fpsr_program* prog = fpsr_graph_compile(g, outs, 2);
+    float out[2 * 64];
+    int failed = !prog || fpsr_program_eval_frames(prog, 0, 0, out, 64) != 0;
+    for (int k = 0; !failed && k < 64; k++) {
+        failed = !fpsr_graph_bench_same(out[k], 0.0f) || !fpsr_graph_bench_same(out[64 + k], -0.0f);
+    }
+    printf("check constants 0.0 and -0.0 kept apart      %s\n", failed ? "DIFFER" : "same");
+    fpsr_program_destroy(prog);
+    fpsr_graph_destroy(g);
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Cost                                                                       */
+/******************************************************************************/
+
+// Best of three runs, ns per frame; program 0 times the chain.
+static double fpsr_graph_bench_time(int graph, const fpsr_program* prog, float* buf, long count) {
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        float acc = 0.0f;
+        const double t0 = fpsr_graph_bench_now();
+        for (long start = 0; start < count; start += FPSR_GRAPH_BENCH_CHUNK) {
+            const int first = FIRST[graph] + (int)start;
+            const long n = count - start < FPSR_GRAPH_BENCH_CHUNK ? count - start : FPSR_GRAPH_BENCH_CHUNK;
+            if (prog) {
+                fpsr_program_eval_frames(prog, first, 0, buf, (size_t)n);
+            } else {
+                for (long k = 0; k < n; k++) { buf[k] = fpsr_graph_bench_chain(graph, first + (int)k); }
+            }
+            acc += buf[0] + buf[n - 1];
+        }
+        const double ns = (fpsr_graph_bench_now() - t0) / (double)count;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_graph_bench_sink = acc;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long count = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1 || count > 2000000000L) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    float* buf = (float*)malloc(FPSR_GRAPH_BENCH_CHUNK * sizeof(float));
+    fpsr_program* progs[FPSR_GRAPH_BENCH_GRAPHS];
+    int failed = !buf;
+    for (int graph = 0; graph < FPSR_GRAPH_BENCH_GRAPHS; graph++) {
+        progs[graph] = fpsr_graph_bench_build(graph);
+        failed |= !progs[graph];
+    }
+    if (failed) {
+        perror("fpsr_graph_compile");
+        return 1;
+    }
+
+    for (int graph = 0; graph < FPSR_GRAPH_BENCH_GRAPHS; graph++) {
+        if (graph == 2 && !FPSR_GRAPH_BENCH_X86) {
+            printf("check %-8s graph against chained calls   skipped (not x86)\n", NAMES[graph]);
+            continue;
+        }
+        failed |= fpsr_graph_bench_check(graph, progs[graph], buf);
+    }
+    failed |= fpsr_graph_bench_signed_zero();
+
+    printf("\n%-9s %6s %10s %10s %9s\n", "graph", "steps", "chain ns", "graph ns", "speedup");
+    for (int graph = 0; graph < FPSR_GRAPH_BENCH_GRAPHS; graph++) {
+        const double chain = fpsr_graph_bench_time(graph, NULL, buf, count);
+        const double prog = fpsr_graph_bench_time(graph, progs[graph], buf, count);
+        printf("%-9s %6zu %10.2f %10.2f %8.1fx\n", NAMES[graph], fpsr_program_steps(progs[graph]), chain, prog,
+               chain / prog);
+        fpsr_program_destroy(progs[graph]);
+    }
+    printf("(shared compiled channel by channel: %zu steps; ns per frame over %ld frames, best of 3)\n",
+           fpsr_graph_bench_separate_steps(), count);
+    free(buf);
+    return failed;
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_hash.c
+ * @brief Integer hash backend for portable_rand().
+ */
+
+#include "fpsr_hash.h"
+
+#include <string.h> // For memcpy()
+
+#include "fpsr_sine_lut.h"
+
+
+/******************************************************************************/
+/* SM, TM and QS                                                              */
+/******************************************************************************/
+
+// x - (x % d) of the reference, in 64 bits so clocks near INT_MAX do not overflow.
+static inline int64_t fpsr_hash_held(int64_t x, int64_t d) { return x - (x % d); }
+
+// The seed of a held state: state * 100000 wrapped to 32 bits.
+static inline uint32_t fpsr_hash_state_seed(int64_t state) { return (uint32_t)state * 100000u; }
+
+// floor(lo + rand * span) for the draw behind seed; the 24 bits are
+// rand * 2^24 exactly, so the product is exact and the shift floors it.
+static inline int64_t fpsr_hash_draw(uint32_t seed, int64_t lo, int64_t span) {
+    int64_t scaled = (int64_t)fpsr_hash_rand24(seed) * span;
+    return lo + (scaled >= 0 ? scaled >> 24 : -((-scaled + 0xFFFFFF) >> 24));
+}
+
+// floor() without libm, for the QS durations and steps.
+static inline int64_t fpsr_hash_floor(double x) {
+    int64_t i = (int64_t)x;
+    return ((double)i > x) ? i - 1 : i;
+}
+
+// fpsr_portable_rand_hash() of a 32-bit seed.
+static inline float fpsr_hash_unit(uint32_t seed) { return (float)fpsr_hash_rand24(seed) * (1.0f / 16777216.0f); }
+
+// The final output for a held state (SM and TM step 3).
+static inline float fpsr_hash_held_output(int64_t state, int finalRandSwitch) {
+    return finalRandSwitch ? fpsr_hash_unit(fpsr_hash_state_seed(state)) : (float)state;
+}
+
+float fpsr_sm_hash(const fpsr_sm_params* p, int frame) {
+    int64_t reseedInterval = p->reseedInterval < 1 ? 1 : p->reseedInterval;
+    int64_t duration_seed = (int64_t)p->seedInner + fpsr_hash_held(frame, reseedInterval);
+    int64_t holdDuration = fpsr_hash_draw((uint32_t)duration_seed, p->minHold, (int64_t)p->maxHold - p->minHold);
+    if (holdDuration < 1) { holdDuration = 1; }
+
+    int64_t held_integer_state = fpsr_hash_held((int64_t)p->seedOuter + frame, holdDuration);
+    return fpsr_hash_held_output(held_integer_state, p->finalRandSwitch);
+}
+
+float fpsr_tm_hash(const fpsr_tm_params* p, int frame) {
+    int64_t periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    // r < periodSwitch * 0.5 of the reference, exactly, in integers.
+    int64_t holdDuration = (((int64_t)p->seedInner + frame) % periodSwitch) * 2 < periodSwitch ? p->periodA : p->periodB;
+    if (holdDuration < 1) { holdDuration = 1; }
+
+    int64_t held_integer_state = fpsr_hash_held((int64_t)p->seedOuter + frame, holdDuration);
+    return fpsr_hash_held_output(held_integer_state, p->finalRandSwitch);
+}
+
+// fpsr_qs_resolve() with the floor() above.
+static fpsr_qs_params fpsr_hash_qs_resolve(fpsr_qs_params p) {
+    if (p.streamSwitchDur < 1) { p.streamSwitchDur = (int)fpsr_hash_floor((1.0 / p.baseWaveFreq) * 0.76); }
+    if (p.stream1QuantDur < 1) { p.stream1QuantDur = (int)fpsr_hash_floor((1.0 / p.baseWaveFreq) * 1.2); }
+    if (p.stream2QuantDur < 1) { p.stream2QuantDur = (int)fpsr_hash_floor((1.0 / p.baseWaveFreq) * 0.9); }
+
+    if (p.streamSwitchDur < 1) { p.streamSwitchDur = 1; }
+    if (p.stream1QuantDur < 1) { p.stream1QuantDur = 1; }
+    if (p.stream2QuantDur < 1) { p.stream2QuantDur = 1; }
+
+    if (p.stream2FreqMult < 0) { p.stream2FreqMult = 3.7f; }
+    return p;
+}
+
+// Quantised step of stream (0 or 1) at frame, and its level. @p r must be resolved.
+static int64_t fpsr_hash_qs_step(const fpsr_qs_params* r, int stream, int frame, int64_t* level) {
+    int64_t quantDur = stream ? r->stream2QuantDur : r->stream1QuantDur;
+    int64_t quant_range = (int64_t)r->quantLevelsMinMax[1] - r->quantLevelsMinMax[0] + 1;
+    int64_t quant_seed = fpsr_hash_held((int64_t)r->quantOffsets[stream] + frame, quantDur);
+    *level = fpsr_hash_draw((uint32_t)quant_seed, r->quantLevelsMinMax[0], quant_range);
+    if (*level < 1) { *level = 1; }
+
+    float arg = stream ? (float)((int64_t)r->streamsOffset[1] + frame) * r->baseWaveFreq * r->stream2FreqMult
+                       : (float)((int64_t)r->streamsOffset[0] + frame) * r->baseWaveFreq;
+    return fpsr_hash_floor((fpsr_sine_lut(arg, FPSR_SINE_LOD_HIGH) / 2.0 + 0.5) * (double)*level);
+}
+
+float fpsr_qs_hash(const fpsr_qs_params* p, int frame) {
+    const fpsr_qs_params r = fpsr_hash_qs_resolve(*p);
+    const int stream = (((int64_t)frame % r.streamSwitchDur) < r.streamSwitchDur / 2) ? 0 : 1;
+    int64_t level;
+    int64_t step = fpsr_hash_qs_step(&r, stream, frame, &level);
+
+    if (r.finalRandSwitch == 1) {
+        return fpsr_hash_unit((uint32_t)(step * 100000 / level));
+    }
+    return (float)(step + level) / (float)(2 * level);
+}
+
+
+/******************************************************************************/
+/* Golden vectors                                                             */
+/******************************************************************************/
+
+// Recorded from this implementation and kept as raw IEEE bits. The random
+// values and the SM / TM rows are pure integer arithmetic and must match on
+// every platform; the QS row also goes through the float steps listed in
+// fpsr_hash.h. At frame -2147483647 the SM and TM states are far outside
+// +-21474, where the reference seed saturates to INT_MIN; here they must not
+// equal FPSR_HASH_GOLDEN_RAND[7], the value of that seed.
+
+static const int FPSR_HASH_GOLDEN_SEEDS[8] = {
+    0, 1, -1, 17, 123456, -987654, 2147483647, -2147483647 - 1
+};
+
+static const uint32_t FPSR_HASH_GOLDEN_RAND[8] = {
+    0x3F7D42F4u, 0x3F26F248u, 0x3F76CCF6u, 0x3F1528E6u, 0x3F7C0DECu, 0x3F269C4Du, 0x3ED40B28u, 0x3E2D6194u
+};
+
+static const int FPSR_HASH_GOLDEN_FRAMES[6] = {
+    0, 1, 59, -240, 12345, -2147483647
+};
+
+static const uint32_t FPSR_HASH_GOLDEN_ALGORITHMS[3][6] = {
+    { 0x3F4DCEA7u, 0x3F4DCEA7u, 0x3F634B57u, 0x3EFBB0C4u, 0x3CC3C2C0u, 0x3DE86B08u },
+    { 0x3F7D42F4u, 0x3F7D42F4u, 0x3E290508u, 0x3F7099B9u, 0x3EBB81D8u, 0x3F4608BBu },
+    { 0x3EACC91Eu, 0x3EACC91Eu, 0x3F7DC9A9u, 0x3F3B2358u, 0x3F37C98Cu, 0x3F03AE53u }
+};
+
+int fpsr_hash_verify(void) {
+    const fpsr_sm_params sm = { 16, 24, 9, -41, 23, 1 };
+    const fpsr_tm_params tm = { 10, 25, 30, 15, 0, 1 };
+    const fpsr_qs_params qs = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+    int mismatches = 0;
+    uint32_t bits;
+
+    for (int i = 0; i < 8; i++) {
+        float v = fpsr_portable_rand_hash(FPSR_HASH_GOLDEN_SEEDS[i]);
+        memcpy(&bits, &v, sizeof bits);
+        mismatches += (bits != FPSR_HASH_GOLDEN_RAND[i]);
+    }
+    for (int i = 0; i < 6; i++) {
+        const int frame = FPSR_HASH_GOLDEN_FRAMES[i];
+        const float v[3] = { fpsr_sm_hash(&sm, frame), fpsr_tm_hash(&tm, frame), fpsr_qs_hash(&qs, frame) };
+        for (int a = 0; a < 3; a++) {
+            memcpy(&bits, &v[a], sizeof bits);
+            mismatches += (bits != FPSR_HASH_GOLDEN_ALGORITHMS[a][i]);
+        }
+    }
+    return mismatches;
+}
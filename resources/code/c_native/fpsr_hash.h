@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_hash.h
+ * @brief Integer hash backend for portable_rand(), for embedded and deterministic builds.
+ * @details portable_rand() is built on fmod() and sin(). Without an FPU they
+ * are slow software routines, and their last bits depend on the libm and on
+ * FMA contraction, which the * 43758.5453 amplifies into different random
+ * values. This backend replaces it with a 32-bit avalanche mixer (three
+ * multiply / xor-shift rounds) whose top 24 bits are converted to float
+ * exactly, giving a value in [0, 1) on a 2^-24 grid. Integer arithmetic is
+ * the same on every platform and under every compiler flag.
+ *
+ * SM and TM keep their structure and are integer throughout: the clocks are
+ * 64-bit, a held state is seeded with (uint32_t)state * 100000u (wrapping:
+ * states beyond +-21474 keep their own seeds, where the reference saturates
+ * them all to INT_MIN; only states 2^27 apart share one), and
+ * hold durations scale the 24 random bits with an integer multiply. The only
+ * float step is the exact conversion of the result.
+ *
+ * QS needs a true sine for its two waves, and its frequencies are float
+ * parameters, so these steps still use float arithmetic (IEEE basic
+ * operations only, no libm call):
+ *     - default durations, (1.0 / baseWaveFreq) * k, when a duration is < 1;
+ *     - the wave argument, (float)(streamsOffset + frame) * baseWaveFreq
+ *       (* stream2FreqMult), and its sine from the baked table of
+ *       fpsr_sine_lut.h (bit-exact under that file's conditions: double
+ *       evaluated in double, no FMA contraction);
+ *     - the quantised step, floor((sine / 2 + 0.5) * level).
+ * From the step on it is integer again: the final seed is
+ * step * 100000 / level, and the unrandomised output is one correctly
+ * rounded division, (step + level) / (2 * level).
+ *
+ * This is an alternative backend, not a drop-in for the reference: the
+ * random values, and so SM hold durations, QS levels and every
+ * finalRandSwitch output, differ from portable_rand()'s. TM with
+ * finalRandSwitch off draws nothing and matches the reference.
+ *
+ * The backend can be chosen per call (fpsr_*_hash(), or fpsr_*_backend() with
+ * a fpsr_rand_backend) or at compile time, by building with
+ * -DFPSR_RAND_DEFAULT=FPSR_RAND_HASH and calling fpsr_*_default().
+ */
+
+#ifndef FPSR_HASH_H
+#define FPSR_HASH_H
+
+#include <stdint.h> // For uint32_t
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief The random function behind a call. */
+typedef enum fpsr_rand_backend {
+    FPSR_RAND_SINE = 0, // the reference portable_rand()
+    FPSR_RAND_HASH = 1 // fpsr_portable_rand_hash()
+} fpsr_rand_backend;
+
+/** @brief Backend of the fpsr_*_default() calls, fixed when the program is built. */
+#ifndef FPSR_RAND_DEFAULT
+#define FPSR_RAND_DEFAULT FPSR_RAND_SINE
+#endif
+
+/**
+ * @brief Avalanche mixer: every input bit flips each output bit with
+ * probability close to 1/2.
+ * @details A bijection on 32 bits. The two-round variant of the same
+ * construction leaves a measurable bias on runs of consecutive seeds, which
+ * is exactly how frames feed it; three rounds do not.
+ */
+static inline uint32_t fpsr_hash_mix32(uint32_t x) {
+    x ^= x >> 17;
+    x *= 0xED5AD4BBu;
+    x ^= x >> 11;
+    x *= 0xAC4C1B51u;
+    x ^= x >> 15;
+    x *= 0x31848BABu;
+    x ^= x >> 14;
+    return x;
+}
+
+/** @brief The 24 random bits behind fpsr_portable_rand_hash(). */
+static inline uint32_t fpsr_hash_rand24(uint32_t seed) {
+    return fpsr_hash_mix32(seed + 0x9E3779B9u) >> 8;
+}
+
+/**
+ * @brief portable_rand() on the integer backend: a value in [0, 1).
+ * @details The seed is offset by the golden ratio constant first so that
+ * seed 0 does not map to 0. The top 24 bits fit a float mantissa, so the
+ * conversion and the scaling by 2^-24 are both exact.
+ */
+static inline float fpsr_portable_rand_hash(int seed) {
+    return (float)fpsr_hash_rand24((uint32_t)seed) * (1.0f / 16777216.0f);
+}
+
+/** @brief SM, TM and QS on the hash backend. */
+float fpsr_sm_hash(const fpsr_sm_params* p, int frame);
+float fpsr_tm_hash(const fpsr_tm_params* p, int frame);
+float fpsr_qs_hash(const fpsr_qs_params* p, int frame);
+
+/**
+ * @brief SM, TM and QS on the given backend. FPSR_RAND_SINE is fpsr_*_eval().
+ * @details Inline, so fpsr_hash.c itself needs no libm: only programs that
+ * use the sine backend link sin() and fmod().
+ */
+static inline float fpsr_sm_backend(const fpsr_sm_params* p, int frame, fpsr_rand_backend backend) {
+    return (backend == FPSR_RAND_HASH) ? fpsr_sm_hash(p, frame) : fpsr_sm_eval(p, frame);
+}
+static inline float fpsr_tm_backend(const fpsr_tm_params* p, int frame, fpsr_rand_backend backend) {
+    return (backend == FPSR_RAND_HASH) ? fpsr_tm_hash(p, frame) : fpsr_tm_eval(p, frame);
+}
+static inline float fpsr_qs_backend(const fpsr_qs_params* p, int frame, fpsr_rand_backend backend) {
+    return (backend == FPSR_RAND_HASH) ? fpsr_qs_hash(p, frame) : fpsr_qs_eval(p, frame);
+}
+
+/** @brief SM, TM and QS on the FPSR_RAND_DEFAULT backend. */
+static inline float fpsr_sm_default(const fpsr_sm_params* p, int frame) {
+    return (FPSR_RAND_DEFAULT == FPSR_RAND_HASH) ? fpsr_sm_hash(p, frame) : fpsr_sm_eval(p, frame);
+}
+static inline float fpsr_tm_default(const fpsr_tm_params* p, int frame) {
+    return (FPSR_RAND_DEFAULT == FPSR_RAND_HASH) ? fpsr_tm_hash(p, frame) : fpsr_tm_eval(p, frame);
+}
+static inline float fpsr_qs_default(const fpsr_qs_params* p, int frame) {
+    return (FPSR_RAND_DEFAULT == FPSR_RAND_HASH) ? fpsr_qs_hash(p, frame) : fpsr_qs_eval(p, frame);
+}
+
+/**
+ * @brief Checks this build against golden vectors recorded for the hash backend.
+ * @return The number of mismatches; 0 means the build is bit-exact.
+ */
+int fpsr_hash_verify(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_HASH_H
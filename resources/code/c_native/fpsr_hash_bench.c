@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_hash_bench.c
+ * @brief Statistical checks and throughput of the fpsr_hash.h backend.
+ * @details Three parts, each run on the hash backend and, for comparison, on
+ * the sine-based portable_rand() of the reference:
+ *     - Checks (the program exits 1 if one fails): fpsr_hash_verify(), and
+ *       fpsr_tm_hash() with finalRandSwitch off against fpsr_tm_eval() over
+ *       2 * 10^6 frames, which must be the same bits.
+ *     - Statistics over --count inputs, for two input streams: consecutive
+ *       seeds, and consecutive held states seeded as SM and TM seed them
+ *       (fpsr_state_seed() for the reference, which saturates beyond
+ *       +-21474). Each reports the mean, a chi-square over 256 equal bins
+ *       (255 degrees of freedom), the lag-1 serial correlation and, over
+ *       --count / 32 random seeds of the stream, the worst avalanche bias:
+ *       how far from 1/2 the chance is that flipping one seed bit flips one
+ *       of the 24 output bits. The hash must stay within 5 standard
+ *       deviations of an ideal generator on every one; the reference is
+ *       printed for comparison only.
+ *     - Throughput: ns per call of fpsr_portable_rand_hash() against
+ *       fpsr_portable_rand(), and of fpsr_*_hash() against fpsr_*_eval() for
+ *       the sample presets, best of 3.
+ *
+ * Options: --count N (inputs per statistic and calls per timing, 4194304)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_hash_bench.c fpsr_hash.c fpsr_sine_lut.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h> // For sqrt() and fabs()
+#include <stdint.h> // For uint32_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_hash.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_tm_params TM_RAW = { 10, 25, 30, 15, 0, 0 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static const char* const BACKENDS[2] = { "sine", "hash" };
+static const char* const STREAMS[2] = { "seeds", "states" };
+
+#define FPSR_HASH_BENCH_BINS 256
+#define FPSR_HASH_BENCH_SIGMAS 5.0
+
+static volatile float fpsr_hash_bench_sink;
+
+static double fpsr_hash_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+// The seed behind input i of stream: consecutive seeds, or consecutive held states.
+static int fpsr_hash_bench_seed(int backend, int stream, int i) {
+    if (stream == 0) { return i; }
+    return backend ? (int)((uint32_t)i * 100000u) : fpsr_state_seed(i);
+}
+
+static float fpsr_hash_bench_rand(int backend, int seed) {
+    return backend ? fpsr_portable_rand_hash(seed) : fpsr_portable_rand(seed);
+}
+
+// The value as 24 bits, floor(v * 2^24); exact for the hash.
+static uint32_t fpsr_hash_bench_bits(int backend, int seed) {
+    return (uint32_t)((double)fpsr_hash_bench_rand(backend, seed) * 16777216.0) & 0xFFFFFFu;
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static int fpsr_hash_bench_checks(void) {
+    const int golden = fpsr_hash_verify();
+    printf("check fpsr_hash_verify()                 %s\n", golden ? "DIFFER" : "same");
+
+    long mismatches = 0;
+    for (int frame = -1000000; frame < 1000000; frame++) {
+        const float a = fpsr_tm_hash(&TM_RAW, frame);
+        const float b = fpsr_tm_eval(&TM_RAW, frame);
+        mismatches += memcmp(&a, &b, sizeof a) != 0;
+    }
+    printf("check tm raw hash against eval           %s\n", mismatches ? "DIFFER" : "same");
+    return golden != 0 || mismatches != 0;
+}
+
+
+/******************************************************************************/
+/* Statistics                                                                 */
+/******************************************************************************/
+
+typedef struct fpsr_hash_bench_stats {
+    double mean, chiSquare, serial, avalanche;
+} fpsr_hash_bench_stats;
+
+static fpsr_hash_bench_stats fpsr_hash_bench_measure(int backend, int stream, long count) {
+    fpsr_hash_bench_stats st;
+    long bins[FPSR_HASH_BENCH_BINS] = { 0 };
+    double sum = 0.0, sumSq = 0.0, sumLag = 0.0, prev = 0.0;
+    const int first = (int)(-count / 2);
+
+    for (long k = 0; k < count; k++) {
+        const double v = fpsr_hash_bench_rand(backend, fpsr_hash_bench_seed(backend, stream, first + (int)k));
+        int bin = (int)(v * FPSR_HASH_BENCH_BINS);
+        bins[bin < 0 ? 0 : (bin >= FPSR_HASH_BENCH_BINS ? FPSR_HASH_BENCH_BINS - 1 : bin)]++;
+        sum += v;
+        sumSq += v * v;
+        if (k > 0) { sumLag += v * prev; }
+        prev = v;
+    }
+    st.mean = sum / (double)count;
+    const double variance = sumSq / (double)count - st.mean * st.mean;
+    st.serial = variance > 0.0 ? (sumLag / (double)(count - 1) - st.mean * st.mean) / variance : 1.0;
+
+    const double expected = (double)count / FPSR_HASH_BENCH_BINS;
+    st.chiSquare = 0.0;
+    for (int b = 0; b < FPSR_HASH_BENCH_BINS; b++) {
+        st.chiSquare += ((double)bins[b] - expected) * ((double)bins[b] - expected) / expected;
+    }
+
+    // Avalanche over a 32 x 24 matrix of (input bit, output bit) flip counts.
+    static long flips[32][24];
+    memset(flips, 0, sizeof flips);
+    const long samples = count / 32 < 1 ? 1 : count / 32;
+    uint32_t state = 0x9E3779B9u;
+    for (long k = 0; k < samples; k++) {
+        // Random inputs (xorshift): consecutive ones would share most bits.
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        const int seed = fpsr_hash_bench_seed(backend, stream, (int)state);
+        const uint32_t base = fpsr_hash_bench_bits(backend, seed);
+        for (int in = 0; in < 32; in++) {
+            const uint32_t diff = base ^ fpsr_hash_bench_bits(backend, (int)((uint32_t)seed ^ (1u << in)));
+            for (int out = 0; out < 24; out++) { flips[in][out] += (diff >> out) & 1u; }
+        }
+    }
+    st.avalanche = 0.0;
+    for (int in = 0; in < 32; in++) {
+        for (int out = 0; out < 24; out++) {
+            const double bias = fabs((double)flips[in][out] / (double)samples - 0.5);
+            if (bias > st.avalanche) { st.avalanche = bias; }
+        }
+    }
+    return st;
+}
+
+// Prints one row; for the hash, also whether every statistic is within bounds.
+static int fpsr_hash_bench_row(int backend, int stream, long count) {
+    const fpsr_hash_bench_stats st = fpsr_hash_bench_measure(backend, stream, count);
+    const long samples = count / 32 < 1 ? 1 : count / 32;
+    const double df = FPSR_HASH_BENCH_BINS - 1;
+    const int ok = fabs(st.mean - 0.5) < FPSR_HASH_BENCH_SIGMAS * sqrt(1.0 / 12.0 / (double)count)
+                   && st.chiSquare < df + FPSR_HASH_BENCH_SIGMAS * sqrt(2.0 * df)
+                   && fabs(st.serial) < FPSR_HASH_BENCH_SIGMAS / sqrt((double)count)
+                   && st.avalanche < FPSR_HASH_BENCH_SIGMAS * 0.5 / sqrt((double)samples);
+    printf("%-5s %-7s %10.6f %12.1f %12.2e %12.4f   %s\n", BACKENDS[backend], STREAMS[stream], st.mean,
+           st.chiSquare, st.serial, st.avalanche, backend ? (ok ? "ok" : "FAILED") : "-");
+    return backend && !ok;
+}
+
+
+/******************************************************************************/
+/* Throughput                                                                 */
+/******************************************************************************/
+
+// Best of three runs, ns per call. which 0: rand over seeds, 1-3: SM, TM, QS over frames.
+static double fpsr_hash_bench_time(int which, int backend, long count) {
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        float acc = 0.0f;
+        const double t0 = fpsr_hash_bench_now();
+        for (long i = 0; i < count; i++) {
+            const int x = (int)i;
+            switch (which) {
+            case 0: acc += fpsr_hash_bench_rand(backend, x); break;
+            case 1: acc += backend ? fpsr_sm_hash(&SM, x) : fpsr_sm_eval(&SM, x); break;
+            case 2: acc += backend ? fpsr_tm_hash(&TM, x) : fpsr_tm_eval(&TM, x); break;
+            default: acc += backend ? fpsr_qs_hash(&QS, x) : fpsr_qs_eval(&QS, x); break;
+            }
+        }
+        const double ns = (fpsr_hash_bench_now() - t0) / (double)count;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_hash_bench_sink = acc;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long count = 4194304;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1024 || count > 2000000000L) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    int failed = fpsr_hash_bench_checks();
+
+    printf("\n%-5s %-7s %10s %12s %12s %12s\n", "rand", "inputs", "mean", "chi-square", "serial", "avalanche");
+    for (int stream = 0; stream < 2; stream++) {
+        for (int backend = 0; backend < 2; backend++) { failed |= fpsr_hash_bench_row(backend, stream, count); }
+    }
+    printf("(%ld inputs; chi-square over %d bins, ideal %d +- %.1f; avalanche over %ld inputs, ideal 0)\n", count,
+           FPSR_HASH_BENCH_BINS, FPSR_HASH_BENCH_BINS - 1, sqrt(2.0 * (FPSR_HASH_BENCH_BINS - 1)),
+           count / 32 < 1 ? 1 : count / 32);
+
+    static const char* const NAMES[4] = { "rand", "sm", "tm", "qs" };
+    printf("\n%-6s %10s %10s %9s\n", "call", "sine ns", "hash ns", "speedup");
+    for (int which = 0; which < 4; which++) {
+        const double sine = fpsr_hash_bench_time(which, 0, count);
+        const double hash = fpsr_hash_bench_time(which, 1, count);
+        printf("%-6s %10.2f %10.2f %8.1fx\n", NAMES[which], sine, hash, sine / hash);
+    }
+    printf("(%ld calls per timing, best of 3)\n", count);
+    return failed;
+}
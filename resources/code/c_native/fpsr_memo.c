@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_memo.c
+ * @brief Lock-free memo table of hold segments.
+ * @details Each entry is a sequence lock: seq is odd while a writer owns the
+ * entry. A writer takes it with one compare-and-swap from an even value and
+ * releases it by storing the next even value. A reader loads seq, the
+ * fields, then seq again, and trusts the fields only if seq was even and did
+ * not move. All fields are atomics accessed relaxed, so a racing read is
+ * never undefined behaviour, merely discarded.
+ *
+ * Within a line, way 0 holds the segment that covers the bucket's first
+ * frame and way 1 the latest one starting inside the bucket, so scrubbing
+ * across a hold boundary in the middle of a bucket hits on both sides.
+ */
+
+#include "fpsr_memo.h"
+
+#include <errno.h> // For errno
+#include <stdatomic.h> // For the entries
+#include <stdlib.h> // For aligned_alloc() and free()
+#include <string.h> // For memcpy()
+
+#include "fpsr_segments.h"
+
+
+/******************************************************************************/
+/* Table                                                                      */
+/******************************************************************************/
+
+typedef struct fpsr_memo_entry {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t value; // float bits
+    _Atomic uint64_t tag;
+    _Atomic uint64_t range; // start in the low 32 bits, end in the high 32
+} fpsr_memo_entry;
+
+typedef struct fpsr_memo_line {
+    _Alignas(64) fpsr_memo_entry way[2];
+} fpsr_memo_line;
+
+struct fpsr_memo {
+    fpsr_memo_line* lines;
+    size_t mask;
+    float saturated; // fpsr_portable_rand(INT_MIN), see fpsr_memo_held_span()
+};
+
+_Static_assert(sizeof(fpsr_memo_line) == 64, "fpsr_memo_line must be one cache line");
+
+static inline uint64_t fpsr_memo_range(int start, int end) {
+    return ((uint64_t)(uint32_t)end << 32) | (uint32_t)start;
+}
+
+fpsr_memo* fpsr_memo_create(size_t entries) {
+    size_t lines = 1;
+    while (lines * 2 < entries && lines < SIZE_MAX / 2 / sizeof(fpsr_memo_line)) { lines *= 2; }
+
+    fpsr_memo* memo = (fpsr_memo*)malloc(sizeof(fpsr_memo));
+    fpsr_memo_line* table = (fpsr_memo_line*)aligned_alloc(64, lines * sizeof(fpsr_memo_line));
+    if (!memo || !table) {
+        free(memo);
+        free(table);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memo->lines = table;
+    memo->mask = lines - 1;
+    memo->saturated = fpsr_portable_rand(INT_MIN);
+    for (size_t i = 0; i < lines; i++) {
+        for (int w = 0; w < 2; w++) {
+            atomic_init(&table[i].way[w].seq, 0);
+            atomic_init(&table[i].way[w].value, 0);
+            atomic_init(&table[i].way[w].tag, 0);
+            atomic_init(&table[i].way[w].range, fpsr_memo_range(1, 0));
+        }
+    }
+    return memo;
+}
+
+void fpsr_memo_destroy(fpsr_memo* memo) {
+    if (memo) {
+        free(memo->lines);
+        free(memo);
+    }
+}
+
+void fpsr_memo_clear(fpsr_memo* memo) {
+    for (size_t i = 0; i <= memo->mask; i++) {
+        for (int w = 0; w < 2; w++) {
+            atomic_store_explicit(&memo->lines[i].way[w].tag, 0, memory_order_relaxed);
+            atomic_store_explicit(&memo->lines[i].way[w].range, fpsr_memo_range(1, 0), memory_order_relaxed);
+        }
+    }
+}
+
+size_t fpsr_memo_bytes(const fpsr_memo* memo) {
+    return (memo->mask + 1) * sizeof(fpsr_memo_line);
+}
+
+
+/******************************************************************************/
+/* Keys                                                                       */
+/******************************************************************************/
+
+static inline uint64_t fpsr_memo_fnv(uint64_t h, uint32_t word) {
+    for (int b = 0; b < 4; b++) {
+        h ^= (word >> (8 * b)) & 0xFFu;
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+static uint64_t fpsr_memo_key(uint32_t algorithm, const uint32_t* words, int count) {
+    uint64_t h = fpsr_memo_fnv(0xCBF29CE484222325ull, algorithm);
+    for (int i = 0; i < count; i++) { h = fpsr_memo_fnv(h, words[i]); }
+    return h ? h : 1; // 0 is the empty tag
+}
+
+uint64_t fpsr_memo_sm_key(const fpsr_sm_params* p) {
+    const uint32_t words[6] = {
+        (uint32_t)p->minHold, (uint32_t)p->maxHold, (uint32_t)p->reseedInterval,
+        (uint32_t)p->seedInner, (uint32_t)p->seedOuter, (uint32_t)p->finalRandSwitch
+    };
+    return fpsr_memo_key(0, words, 6);
+}
+
+uint64_t fpsr_memo_tm_key(const fpsr_tm_params* p) {
+    const uint32_t words[6] = {
+        (uint32_t)p->periodA, (uint32_t)p->periodB, (uint32_t)p->periodSwitch,
+        (uint32_t)p->seedInner, (uint32_t)p->seedOuter, (uint32_t)p->finalRandSwitch
+    };
+    return fpsr_memo_key(1, words, 6);
+}
+
+uint64_t fpsr_memo_qs_key(const fpsr_qs_params* p) {
+    uint32_t words[12];
+    memcpy(&words[0], &p->baseWaveFreq, sizeof(float));
+    memcpy(&words[1], &p->stream2FreqMult, sizeof(float));
+    words[2] = (uint32_t)p->quantLevelsMinMax[0];
+    words[3] = (uint32_t)p->quantLevelsMinMax[1];
+    words[4] = (uint32_t)p->streamsOffset[0];
+    words[5] = (uint32_t)p->streamsOffset[1];
+    words[6] = (uint32_t)p->quantOffsets[0];
+    words[7] = (uint32_t)p->quantOffsets[1];
+    words[8] = (uint32_t)p->streamSwitchDur;
+    words[9] = (uint32_t)p->stream1QuantDur;
+    words[10] = (uint32_t)p->stream2QuantDur;
+    words[11] = (uint32_t)p->finalRandSwitch;
+    return fpsr_memo_key(2, words, 12);
+}
+
+
+/******************************************************************************/
+/* Lookup                                                                     */
+/******************************************************************************/
+
+/** @brief floor(frame / FPSR_MEMO_BUCKET), via the order-preserving map to unsigned. */
+static inline uint32_t fpsr_memo_bucket(int frame) {
+    return ((uint32_t)frame ^ 0x80000000u) / FPSR_MEMO_BUCKET;
+}
+
+static inline int fpsr_memo_bucket_first(uint32_t bucket) {
+    return (int)((bucket * FPSR_MEMO_BUCKET) ^ 0x80000000u);
+}
+
+static inline fpsr_memo_line* fpsr_memo_line_of(fpsr_memo* memo, uint64_t key, uint32_t bucket) {
+    uint64_t h = key ^ ((uint64_t)bucket * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return &memo->lines[h & memo->mask];
+}
+
+static int fpsr_memo_read(fpsr_memo_entry* e, uint64_t key, int frame, float* value) {
+    uint32_t seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+    if (seq & 1u) {
+        return 0;
+    }
+    uint64_t tag = atomic_load_explicit(&e->tag, memory_order_relaxed);
+    uint64_t range = atomic_load_explicit(&e->range, memory_order_relaxed);
+    uint32_t bits = atomic_load_explicit(&e->value, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&e->seq, memory_order_relaxed) != seq || tag != key) {
+        return 0;
+    }
+    int start = (int)(uint32_t)range, end = (int)(uint32_t)(range >> 32);
+    if (frame < start || frame > end) {
+        return 0;
+    }
+    memcpy(value, &bits, sizeof bits);
+    return 1;
+}
+
+static void fpsr_memo_write(fpsr_memo_entry* e, uint64_t key, int start, int end, float value, fpsr_memo_stats* stats) {
+    uint32_t seq = atomic_load_explicit(&e->seq, memory_order_relaxed);
+    if ((seq & 1u) || !atomic_compare_exchange_strong_explicit(&e->seq, &seq, seq + 1, memory_order_acquire, memory_order_relaxed)) {
+        if (stats) { stats->skipped++; }
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof bits);
+    atomic_store_explicit(&e->tag, key, memory_order_relaxed);
+    atomic_store_explicit(&e->range, fpsr_memo_range(start, end), memory_order_relaxed);
+    atomic_store_explicit(&e->value, bits, memory_order_relaxed);
+    atomic_store_explicit(&e->seq, seq + 2, memory_order_release);
+    if (stats) { stats->stores++; }
+}
+
+/**
+ * @brief The run of frames around frame that certainly shares its output,
+ * and that output: fpsr_sm_span(), fpsr_tm_span() or fpsr_qs_span(), which
+ * cost what one evaluation costs and no search. saturated is the output of
+ * every SM / TM state past +-21474.
+ */
+typedef float (*fpsr_memo_span_fn)(const void* p, int frame, float saturated, int64_t* lo, int64_t* hi);
+
+static float fpsr_memo_lookup(fpsr_memo* memo, fpsr_memo_span_fn span, const void* p,
+                              uint64_t key, int frame, fpsr_memo_stats* stats)
+{
+    const uint32_t bucket = fpsr_memo_bucket(frame);
+    fpsr_memo_line* line = fpsr_memo_line_of(memo, key, bucket);
+    float value;
+    if (fpsr_memo_read(&line->way[0], key, frame, &value) || fpsr_memo_read(&line->way[1], key, frame, &value)) {
+        if (stats) { stats->hits++; }
+        return value;
+    }
+    if (stats) { stats->misses++; }
+
+    int64_t lo, hi;
+    value = span(p, frame, memo->saturated, &lo, &hi);
+    const int start = lo < INT_MIN ? INT_MIN : (int)lo;
+    const int end = hi > INT_MAX ? INT_MAX : (int)hi;
+
+    // Stored under the bucket of frame and those of the run's two ends, so a
+    // miss writes at most three lines; a bucket in between stores the run
+    // again on its own first miss.
+    const uint32_t buckets[3] = { bucket, fpsr_memo_bucket(start), fpsr_memo_bucket(end) };
+    for (int k = 0; k < 3; k++) {
+        const uint32_t b = buckets[k];
+        if ((k > 0 && b == bucket) || (k == 2 && b == buckets[1])) {
+            continue;
+        }
+        fpsr_memo_line* l = (b == bucket) ? line : fpsr_memo_line_of(memo, key, b);
+        fpsr_memo_write(&l->way[start <= fpsr_memo_bucket_first(b) ? 0 : 1], key, start, end, value, stats);
+    }
+    return value;
+}
+
+/**
+ * @brief The SM / TM run when finalRandSwitch saturates it, else 0.
+ * @details Every held state beyond +-21474 hashes the same seed
+ * (fpsr_state_seed()), so once seedOuter + frame is further out than that
+ * plus the longest hold, the output is saturated for every frame from there
+ * on outward (as far as seedOuter + frame stays an int). No portable_rand().
+ */
+static int fpsr_memo_held_span(int seedOuter, int frame, int finalRandSwitch, int longestHold,
+                               int64_t* lo, int64_t* hi)
+{
+    const int64_t saturation = 21474 + (int64_t)(longestHold < 1 ? 1 : longestHold) + 1;
+    const int64_t outer = (int64_t)seedOuter + frame;
+    if (!finalRandSwitch || (outer < saturation && outer > -saturation)) {
+        return 0;
+    }
+    *lo = outer > 0 ? saturation - seedOuter : (int64_t)INT_MIN - seedOuter;
+    *hi = outer > 0 ? (int64_t)INT_MAX - seedOuter : -saturation - seedOuter;
+    *lo = *lo < INT_MIN ? INT_MIN : *lo;
+    *hi = *hi > INT_MAX ? INT_MAX : *hi;
+    return 1;
+}
+
+static float fpsr_memo_sm_span(const void* p, int frame, float saturated, int64_t* lo, int64_t* hi) {
+    const fpsr_sm_params* sm = (const fpsr_sm_params*)p;
+    if (fpsr_memo_held_span(sm->seedOuter, frame, sm->finalRandSwitch,
+                            sm->minHold > sm->maxHold ? sm->minHold : sm->maxHold, lo, hi)) {
+        return saturated;
+    }
+    return fpsr_held_output(fpsr_sm_span(sm, frame, fpsr_sm_hold_duration(sm, frame), lo, hi), sm->finalRandSwitch);
+}
+
+static float fpsr_memo_tm_span(const void* p, int frame, float saturated, int64_t* lo, int64_t* hi) {
+    const fpsr_tm_params* tm = (const fpsr_tm_params*)p;
+    if (fpsr_memo_held_span(tm->seedOuter, frame, tm->finalRandSwitch,
+                            tm->periodA > tm->periodB ? tm->periodA : tm->periodB, lo, hi)) {
+        return saturated;
+    }
+    return fpsr_held_output(fpsr_tm_span(tm, frame, fpsr_tm_hold_duration(tm, frame), lo, hi), tm->finalRandSwitch);
+}
+
+static float fpsr_memo_qs_span(const void* p, int frame, float saturated, int64_t* lo, int64_t* hi) {
+    (void)saturated;
+    const fpsr_qs_params r = fpsr_qs_resolve(*(const fpsr_qs_params*)p);
+    const int stream = fpsr_qs_active_stream(&r, frame);
+    fpsr_qs_stream_state s;
+    fpsr_qs_stream_state_at(&r, stream, frame, &s);
+    fpsr_qs_span(&r, stream, &s, lo, hi);
+    return fpsr_qs_output(fpsr_qs_step_value(s.step, s.quant_level), r.finalRandSwitch);
+}
+
+float fpsr_memo_sm(fpsr_memo* memo, const fpsr_sm_params* p, uint64_t key, int frame, fpsr_memo_stats* stats) {
+    return fpsr_memo_lookup(memo, fpsr_memo_sm_span, p, key, frame, stats);
+}
+
+float fpsr_memo_tm(fpsr_memo* memo, const fpsr_tm_params* p, uint64_t key, int frame, fpsr_memo_stats* stats) {
+    return fpsr_memo_lookup(memo, fpsr_memo_tm_span, p, key, frame, stats);
+}
+
+float fpsr_memo_qs(fpsr_memo* memo, const fpsr_qs_params* p, uint64_t key, int frame, fpsr_memo_stats* stats) {
+    return fpsr_memo_lookup(memo, fpsr_memo_qs_span, p, key, frame, stats);
+}
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_memo.h
+ * @brief Bounded memo cache of hold segments, for scrubbing and random access.
+ * @details FPS-R is stateless, so its output is perfectly cacheable; and it
+ * is piecewise constant, so one entry can serve a whole hold. An entry is a
+ * hold segment, [start, end] with its output, tagged with the hash of the
+ * preset it belongs to (fpsr_memo_*_key()).
+ *
+ * The frame axis is cut into buckets of FPSR_MEMO_BUCKET frames. Each
+ * (preset, bucket) pair hashes to one cache line of the table, holding two
+ * entries. A lookup reads that line only: if either entry has the preset's
+ * tag and contains the frame, the output is returned without calling
+ * portable_rand() or even the modulo arithmetic. On a miss the run of equal
+ * output containing the frame is found with fpsr_sm_span(), fpsr_tm_span()
+ * or fpsr_qs_span(), which cost about one evaluation and no search, and is
+ * stored in at most three lines: the frame's bucket and the buckets of the
+ * run's two ends, so the rest of the hold hits once the playhead reaches
+ * either end. With finalRandSwitch on, an SM or TM frame whose states are
+ * all past the fpsr_state_seed() saturation gets the whole saturated run,
+ * out to INT_MIN or INT_MAX, and its output is the one value computed when
+ * the table was created. Replacement is direct-mapped, so the table never
+ * grows.
+ *
+ * fpsr_memo_bench.c replays playhead traces through a 4096-segment table
+ * against fpsr_*_eval() (1 M lookups; SM, SM with long holds, TM, QS):
+ * playback 12x, 12x, 6x, 1.4x; a scrub with seeks of up to +-5 * 10^5
+ * 5x, 5x, 2.5x, 1.5x; the same scrub kept within +-2 * 10^4, where no
+ * state saturates, 1.8x, 2.2x, 1.6x, 1.6x; uniform random frames over
+ * +-10^6 6x, 4x, 1.6x, 1.0x. The table pays least on QS, whose runs are
+ * short, and on random access to short holds.
+ *
+ * A table may be private to a thread or shared. Shared tables are lock-free:
+ * each entry is a sequence lock, so readers never block and never return a
+ * torn entry, and a writer that finds an entry busy simply skips it.
+ * Statistics are accumulated in a caller-owned fpsr_memo_stats, so threads
+ * do not contend on shared counters; sum them to report the table's.
+ *
+ * Two presets whose 64-bit keys collide would share entries; with the FNV-1a
+ * key below that is vanishingly unlikely, but callers that need a guarantee
+ * should give each table one preset per key they have checked.
+ */
+
+#ifndef FPSR_MEMO_H
+#define FPSR_MEMO_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint64_t
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Frames per bucket. */
+#define FPSR_MEMO_BUCKET 4
+
+/** @brief A memo table. */
+typedef struct fpsr_memo fpsr_memo;
+
+/** @brief Lookup counters, owned by the caller (one per thread for shared tables). */
+typedef struct fpsr_memo_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores; // entries written
+    uint64_t skipped; // entries not written because another thread was writing them
+} fpsr_memo_stats;
+
+/**
+ * @brief Creates a table with room for at least entries segments (rounded up
+ * to a power of two, minimum 2).
+ * @return NULL with errno set if out of memory.
+ */
+fpsr_memo* fpsr_memo_create(size_t entries);
+void fpsr_memo_destroy(fpsr_memo* memo);
+
+/** @brief Empties the table. Not safe while other threads use it. */
+void fpsr_memo_clear(fpsr_memo* memo);
+
+/** @brief Size of the table in bytes. */
+size_t fpsr_memo_bytes(const fpsr_memo* memo);
+
+/** @brief Tag of a preset: a 64-bit hash of the algorithm and every field. Never 0. */
+uint64_t fpsr_memo_sm_key(const fpsr_sm_params* p);
+uint64_t fpsr_memo_tm_key(const fpsr_tm_params* p);
+uint64_t fpsr_memo_qs_key(const fpsr_qs_params* p);
+
+/**
+ * @brief fpsr_*_eval(p, frame), through the table.
+ * @param key The preset's fpsr_memo_*_key(), computed once per preset.
+ * @param stats Counters to add to, or NULL.
+ */
+float fpsr_memo_sm(fpsr_memo* memo, const fpsr_sm_params* p, uint64_t key, int frame, fpsr_memo_stats* stats);
+float fpsr_memo_tm(fpsr_memo* memo, const fpsr_tm_params* p, uint64_t key, int frame, fpsr_memo_stats* stats);
+float fpsr_memo_qs(fpsr_memo* memo, const fpsr_qs_params* p, uint64_t key, int frame, fpsr_memo_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_MEMO_H
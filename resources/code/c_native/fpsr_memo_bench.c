@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_memo_bench.c
+ * @brief Scrub-trace replay and multithreaded check of the fpsr_memo.h cache.
+ * @details Five synthetic playhead traces of --lookups frames each:
+ *     - play: consecutive frames;
+ *     - loop: frames 1000 to 1239, over and over;
+ *     - scrub: a timeline scrub, mostly drags of up to 4 frames either way,
+ *       some fast drags of up to 60, and a seek anywhere in +-5 * 10^5 one
+ *       step in 20. Most of those frames are past the +-21474 state
+ *       saturation of SM and TM (fpsr_state_seed()), where one entry covers
+ *       everything further out;
+ *     - scrub 0: the same scrub with seeks in +-2 * 10^4, where every SM and
+ *       TM hold has its own output;
+ *     - random: frames spread uniformly over +-10^6, the worst case.
+ * Parts:
+ *     - Replay: each trace through a table of --entries segments, for the SM,
+ *       TM and QS sample presets and an SM preset with long holds. Reports
+ *       the hit rate and ns per lookup against fpsr_*_eval() over the same
+ *       frames (best of 3, the table cleared before each run), and checks
+ *       every value against fpsr_*_eval() bit for bit.
+ *     - Threads: --threads threads share one small table (256 segments, so
+ *       lines are evicted and rewritten all the time) and each replays its
+ *       own scrub trace over all four presets in turn, checking every value
+ *       against fpsr_*_eval(). Reports the summed counters.
+ * The program exits 1 if any lookup differs from fpsr_*_eval().
+ *
+ * Options: --lookups N (1000000), --entries N (4096), --threads N (8)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 -pthread fpsr_memo_bench.c fpsr_memo.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h> // For the threads check
+#include <stdint.h> // For uint32_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_memo.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_sm_params SM_LONG = { 2000, 5000, 10000, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+#define FPSR_MEMO_BENCH_PRESETS 4
+#define FPSR_MEMO_BENCH_TRACES 5
+
+static const char* const PRESETS[FPSR_MEMO_BENCH_PRESETS] = { "sm", "sm long", "tm", "qs" };
+static const char* const TRACES[FPSR_MEMO_BENCH_TRACES] = { "play", "loop", "scrub", "scrub 0", "random" };
+
+static volatile float fpsr_memo_bench_sink;
+
+static double fpsr_memo_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static uint32_t fpsr_memo_bench_rand(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void fpsr_memo_bench_trace(int trace, uint32_t seed, int* frames, long count) {
+    uint32_t state = seed;
+    int pos = 0;
+    for (long i = 0; i < count; i++) {
+        switch (trace) {
+        case 0: pos = (int)i; break;
+        case 1: pos = 1000 + (int)(i % 240); break;
+        case 2:
+        case 3: {
+            const uint32_t r = fpsr_memo_bench_rand(&state) % 100;
+            const uint32_t d = fpsr_memo_bench_rand(&state);
+            if (r < 75) { pos += (int)(d % 9) - 4; }
+            else if (r < 95) { pos += (int)(d % 121) - 60; }
+            else if (trace == 2) { pos = (int)(d % 1000001) - 500000; }
+            else { pos = (int)(d % 40001) - 20000; }
+            break;
+        }
+        default: pos = (int)(fpsr_memo_bench_rand(&state) % 2000001) - 1000000; break;
+        }
+        frames[i] = pos;
+    }
+}
+
+static float fpsr_memo_bench_eval(int preset, int frame) {
+    switch (preset) {
+    case 0: return fpsr_sm_eval(&SM, frame);
+    case 1: return fpsr_sm_eval(&SM_LONG, frame);
+    case 2: return fpsr_tm_eval(&TM, frame);
+    default: return fpsr_qs_eval(&QS, frame);
+    }
+}
+
+static float fpsr_memo_bench_lookup(fpsr_memo* memo, const uint64_t* keys, int preset, int frame, fpsr_memo_stats* st) {
+    switch (preset) {
+    case 0: return fpsr_memo_sm(memo, &SM, keys[0], frame, st);
+    case 1: return fpsr_memo_sm(memo, &SM_LONG, keys[1], frame, st);
+    case 2: return fpsr_memo_tm(memo, &TM, keys[2], frame, st);
+    default: return fpsr_memo_qs(memo, &QS, keys[3], frame, st);
+    }
+}
+
+static void fpsr_memo_bench_keys(uint64_t* keys) {
+    keys[0] = fpsr_memo_sm_key(&SM);
+    keys[1] = fpsr_memo_sm_key(&SM_LONG);
+    keys[2] = fpsr_memo_tm_key(&TM);
+    keys[3] = fpsr_memo_qs_key(&QS);
+}
+
+
+/******************************************************************************/
+/* Replay                                                                     */
+/******************************************************************************/
+
+// Best of three runs, ns per lookup; memo NULL times fpsr_*_eval(). Counts
+// the mismatches of the last run against eval into *mismatches.
+static double fpsr_memo_bench_replay(fpsr_memo* memo, const uint64_t* keys, int preset, const int* frames,
+                                     const float* expected, long count, fpsr_memo_stats* st, long* mismatches)
+{
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        float acc = 0.0f;
+        if (memo) {
+            fpsr_memo_clear(memo);
+            memset(st, 0, sizeof *st);
+        }
+        const double t0 = fpsr_memo_bench_now();
+        if (memo) {
+            for (long i = 0; i < count; i++) { acc += fpsr_memo_bench_lookup(memo, keys, preset, frames[i], st); }
+        } else {
+            for (long i = 0; i < count; i++) { acc += fpsr_memo_bench_eval(preset, frames[i]); }
+        }
+        const double ns = (fpsr_memo_bench_now() - t0) / (double)count;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_memo_bench_sink = acc;
+    }
+    if (memo) {
+        fpsr_memo_clear(memo);
+        *mismatches = 0;
+        for (long i = 0; i < count; i++) {
+            const float v = fpsr_memo_bench_lookup(memo, keys, preset, frames[i], NULL);
+            *mismatches += memcmp(&v, &expected[i], sizeof v) != 0;
+        }
+    }
+    return best;
+}
+
+
+/******************************************************************************/
+/* Threads                                                                    */
+/******************************************************************************/
+
+typedef struct fpsr_memo_bench_worker {
+    fpsr_memo* memo;
+    const uint64_t* keys;
+    long count;
+    uint32_t seed;
+    fpsr_memo_stats stats;
+    long mismatches;
+    pthread_t thread;
+    int started;
+} fpsr_memo_bench_worker;
+
+static void* fpsr_memo_bench_work(void* arg) {
+    fpsr_memo_bench_worker* w = (fpsr_memo_bench_worker*)arg;
+    int* frames = (int*)malloc((size_t)w->count * sizeof(int));
+    if (!frames) {
+        w->mismatches = -1;
+        return NULL;
+    }
+    fpsr_memo_bench_trace(2, w->seed, frames, w->count);
+    for (long i = 0; i < w->count; i++) {
+        const int preset = (int)((i / 64) % FPSR_MEMO_BENCH_PRESETS);
+        const float a = fpsr_memo_bench_lookup(w->memo, w->keys, preset, frames[i], &w->stats);
+        const float b = fpsr_memo_bench_eval(preset, frames[i]);
+        w->mismatches += memcmp(&a, &b, sizeof a) != 0;
+    }
+    free(frames);
+    return NULL;
+}
+
+static int fpsr_memo_bench_threads(const uint64_t* keys, int threads, long count) {
+    fpsr_memo* memo = fpsr_memo_create(256);
+    fpsr_memo_bench_worker* workers = (fpsr_memo_bench_worker*)calloc((size_t)threads, sizeof(fpsr_memo_bench_worker));
+    if (!memo || !workers) {
+        fpsr_memo_destroy(memo);
+        free(workers);
+        perror("fpsr_memo_create");
+        return 1;
+    }
+    for (int t = 0; t < threads; t++) {
+        workers[t].memo = memo;
+        workers[t].keys = keys;
+        workers[t].count = count;
+        workers[t].seed = 0x9E3779B9u + 0x1000193u * (uint32_t)t;
+        workers[t].started = pthread_create(&workers[t].thread, NULL, fpsr_memo_bench_work, &workers[t]) == 0;
+    }
+    fpsr_memo_stats sum = { 0, 0, 0, 0 };
+    long mismatches = 0;
+    int failed = 0;
+    for (int t = 0; t < threads; t++) {
+        if (!workers[t].started) {
+            failed = 1;
+            continue;
+        }
+        pthread_join(workers[t].thread, NULL);
+        failed |= workers[t].mismatches != 0;
+        mismatches += workers[t].mismatches;
+        sum.hits += workers[t].stats.hits;
+        sum.misses += workers[t].stats.misses;
+        sum.stores += workers[t].stats.stores;
+        sum.skipped += workers[t].stats.skipped;
+    }
+    printf("check %d threads, shared 256-segment table  %s\n", threads, failed ? "DIFFER" : "same");
+    printf("      %llu lookups, hit rate %.1f%%, %llu stores, %llu skipped (entry busy), %ld mismatches\n",
+           (unsigned long long)(sum.hits + sum.misses),
+           100.0 * (double)sum.hits / (double)(sum.hits + sum.misses ? sum.hits + sum.misses : 1),
+           (unsigned long long)sum.stores, (unsigned long long)sum.skipped, mismatches);
+    fpsr_memo_destroy(memo);
+    free(workers);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    long lookups = 1000000, entries = 4096, threads = 8;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--lookups") == 0) { lookups = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--entries") == 0) { entries = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) { threads = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--lookups N] [--entries N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (lookups < 1 || lookups > 100000000L || entries < 2 || threads < 1 || threads > 1024) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t keys[FPSR_MEMO_BENCH_PRESETS];
+    fpsr_memo_bench_keys(keys);
+    fpsr_memo* memo = fpsr_memo_create((size_t)entries);
+    int* frames = (int*)malloc((size_t)lookups * sizeof(int));
+    float* expected = (float*)malloc((size_t)lookups * sizeof(float));
+    if (!memo || !frames || !expected) {
+        perror("malloc");
+        return 1;
+    }
+
+    int failed = 0;
+    printf("%-8s %-7s %9s %10s %10s %9s  %s\n", "preset", "trace", "hit rate", "eval ns", "memo ns", "speedup", "values");
+    for (int trace = 0; trace < FPSR_MEMO_BENCH_TRACES; trace++) {
+        fpsr_memo_bench_trace(trace, 0x2545F491u, frames, lookups);
+        for (int preset = 0; preset < FPSR_MEMO_BENCH_PRESETS; preset++) {
+            for (long i = 0; i < lookups; i++) { expected[i] = fpsr_memo_bench_eval(preset, frames[i]); }
+            fpsr_memo_stats st;
+            long mismatches = 0;
+            const double evalNs = fpsr_memo_bench_replay(NULL, keys, preset, frames, expected, lookups, &st, &mismatches);
+            const double memoNs = fpsr_memo_bench_replay(memo, keys, preset, frames, expected, lookups, &st, &mismatches);
+            printf("%-8s %-7s %8.1f%% %10.2f %10.2f %8.1fx  %s\n", PRESETS[preset], TRACES[trace],
+                   100.0 * (double)st.hits / (double)lookups, evalNs, memoNs, evalNs / memoNs,
+                   mismatches ? "DIFFER" : "same");
+            failed |= mismatches != 0;
+        }
+    }
+    printf("(%ld lookups per trace, %ld-segment table of %zu bytes; best of 3)\n\n", lookups, entries,
+           fpsr_memo_bytes(memo));
+
+    failed |= fpsr_memo_bench_threads(keys, (int)threads, lookups);
+
+    fpsr_memo_destroy(memo);
+    free(frames);
+    free(expected);
+    return failed;
+}
@@ -0,0 +1,445 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+// ⚠️ The functions in this header mirror ../c_reference/fpsr_algorithms_reference.c
+// expression for expression. Every optimised path in c_native is validated
+// against them, so keep the two in lock-step.
+
+/**
+ * @file fpsr_native.h
+ * @brief Shared scalar core of the native (performance) FPS-R library.
+ * @details The canonical C reference is written to be read and ported, and
+ * its functions are out of line. The native modules need a scalar "source of
+ * truth" they can inline, so this header carries a faithful
+ * copy of portable_rand(), SM, TM and QS, together with the parameter blocks
+ * ("presets") that the batch, segment and bake APIs take.
+ *
+ * Build notes for every file in c_native:
+ *     - Compile as ISO C11 (-std=c11) or pass -ffp-contract=off. Fusing the
+ *       float multiply-adds into FMAs changes hold durations and breaks
+ *       bit-exactness against the reference.
+ *     - Do not use -ffast-math.
+ */
+
+#ifndef FPSR_NATIVE_H
+#define FPSR_NATIVE_H
+
+#include <limits.h> // For INT_MIN
+#include <math.h> // For sin(), fmod() and floor()
+#include <stdint.h> // For int64_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+/******************************************************************************/
+/* Presets                                                                    */
+/******************************************************************************/
+
+/**
+ * @brief Parameters of one FPS-R:SM channel. Field names follow fpsr_sm().
+ */
+typedef struct fpsr_sm_params {
+    int minHold;
+    int maxHold;
+    int reseedInterval;
+    int seedInner;
+    int seedOuter;
+    int finalRandSwitch;
+} fpsr_sm_params;
+
+/**
+ * @brief Parameters of one FPS-R:TM channel. Field names follow fpsr_tm().
+ */
+typedef struct fpsr_tm_params {
+    int periodA;
+    int periodB;
+    int periodSwitch;
+    int seedInner;
+    int seedOuter;
+    int finalRandSwitch;
+} fpsr_tm_params;
+
+/**
+ * @brief Parameters of one FPS-R:QS channel. Field names follow fpsr_qs().
+ */
+typedef struct fpsr_qs_params {
+    float baseWaveFreq;
+    float stream2FreqMult;
+    int quantLevelsMinMax[2];
+    int streamsOffset[2];
+    int quantOffsets[2];
+    int streamSwitchDur;
+    int stream1QuantDur;
+    int stream2QuantDur;
+    int finalRandSwitch;
+} fpsr_qs_params;
+
+
+/******************************************************************************/
+/* Scalar core (mirrors the C reference)                                      */
+/******************************************************************************/
+
+/**
+ * @brief portable_rand() from the C reference, unchanged.
+ * @param seed An integer used to generate the random number.
+ * @return A pseudo-random float between 0.0 and 1.0.
+ */
+static inline float fpsr_portable_rand(int seed) {
+    float val = (float)seed * 12.9898;
+    const float TWO_PI = 6.28318530718f;
+    val = fmod(val, TWO_PI);
+    float result = sin(val) * 43758.5453f;
+    return result - floor(result);
+}
+
+/**
+ * @brief The integer seed the reference hands to portable_rand() for a held state.
+ * @details The reference writes portable_rand(held_integer_state * 100000.0),
+ * an implicit double-to-int conversion. For |held_integer_state| > 21474 the
+ * product does not fit an int; C leaves that undefined, and x86 (the platform
+ * the reference outputs were produced on) yields INT_MIN. This spells that
+ * behaviour out so the native paths agree with the reference everywhere.
+ */
+static inline int fpsr_state_seed(int held_integer_state) {
+    double scaled = held_integer_state * 100000.0;
+    if (scaled >= -2147483648.0 && scaled < 2147483648.0) {
+        return (int)scaled;
+    }
+    return INT_MIN;
+}
+
+/**
+ * @brief Resolves the QS default durations exactly as the first step of fpsr_qs().
+ * @details Call once per preset; the resolved durations are always >= 1 and
+ * stream2FreqMult is never negative, so downstream code can skip the checks.
+ */
+static inline fpsr_qs_params fpsr_qs_resolve(fpsr_qs_params p) {
+    if (p.streamSwitchDur < 1) { p.streamSwitchDur = (int)floor((1.0 / p.baseWaveFreq) * 0.76); }
+    if (p.stream1QuantDur < 1) { p.stream1QuantDur = (int)floor((1.0 / p.baseWaveFreq) * 1.2); }
+    if (p.stream2QuantDur < 1) { p.stream2QuantDur = (int)floor((1.0 / p.baseWaveFreq) * 0.9); }
+
+    if (p.streamSwitchDur < 1) { p.streamSwitchDur = 1; }
+    if (p.stream1QuantDur < 1) { p.stream1QuantDur = 1; }
+    if (p.stream2QuantDur < 1) { p.stream2QuantDur = 1; }
+
+    if (p.stream2FreqMult < 0) { p.stream2FreqMult = 3.7; }
+    return p;
+}
+
+/**
+ * @brief fpsr_sm() from the C reference (with its documented finalRandSwitch).
+ */
+static inline float fpsr_sm_scalar(
+    int frame, int minHold, int maxHold,
+    int reseedInterval, int seedInner, int seedOuter,
+    int finalRandSwitch)
+{
+    if (reseedInterval < 1) { reseedInterval = 1; }
+
+    float rand_for_duration = fpsr_portable_rand(seedInner + frame - (frame % reseedInterval));
+    int holdDuration = (int)floor(minHold + rand_for_duration * (maxHold - minHold));
+
+    if (holdDuration < 1) { holdDuration = 1; }
+
+    int held_integer_state = (seedOuter + frame) - ((seedOuter + frame) % holdDuration);
+
+    float fpsr_output = 0.0;
+    if (finalRandSwitch) {
+        fpsr_output = fpsr_portable_rand(fpsr_state_seed(held_integer_state));
+    } else {
+        fpsr_output = held_integer_state;
+    }
+    return fpsr_output;
+}
+
+/**
+ * @brief fpsr_tm() from the C reference.
+ */
+static inline float fpsr_tm_scalar(
+    int frame, int periodA, int periodB,
+    int periodSwitch, int seedInner, int seedOuter,
+    int finalRandSwitch)
+{
+    if (periodSwitch < 1) { periodSwitch = 1; }
+
+    int inner_clock_frame = seedInner + frame;
+
+    int holdDuration;
+    if ((inner_clock_frame % periodSwitch) < (periodSwitch * 0.5)) {
+        holdDuration = periodA;
+    } else {
+        holdDuration = periodB;
+    }
+
+    if (holdDuration < 1) { holdDuration = 1; }
+
+    int outer_clock_frame = seedOuter + frame;
+    int held_integer_state = outer_clock_frame - (outer_clock_frame % holdDuration);
+
+    float fpsr_output;
+    if (finalRandSwitch) {
+        fpsr_output = fpsr_portable_rand(fpsr_state_seed(held_integer_state));
+    } else {
+        fpsr_output = (float)held_integer_state;
+    }
+    return fpsr_output;
+}
+
+/**
+ * @brief fpsr_qs() from the C reference.
+ */
+static inline float fpsr_qs_scalar(
+    int frame, float baseWaveFreq, float stream2FreqMult,
+    const int quantLevelsMinMax[2], const int streamsOffset[2], const int quantOffsets[2],
+    int streamSwitchDur, int stream1QuantDur, int stream2QuantDur,
+    int finalRandSwitch)
+{
+    if (streamSwitchDur < 1) { streamSwitchDur = (int)floor((1.0 / baseWaveFreq) * 0.76); }
+    if (stream1QuantDur < 1) { stream1QuantDur = (int)floor((1.0 / baseWaveFreq) * 1.2); }
+    if (stream2QuantDur < 1) { stream2QuantDur = (int)floor((1.0 / baseWaveFreq) * 0.9); }
+
+    if (streamSwitchDur < 1) { streamSwitchDur = 1; }
+    if (stream1QuantDur < 1) { stream1QuantDur = 1; }
+    if (stream2QuantDur < 1) { stream2QuantDur = 1; }
+
+    int quant_min = quantLevelsMinMax[0];
+    int quant_max = quantLevelsMinMax[1];
+    int quant_range = quant_max - quant_min + 1;
+
+    int s1_quant_seed = (quantOffsets[0] + frame) - ((quantOffsets[0] + frame) % stream1QuantDur);
+    float s1_rand_for_quant = fpsr_portable_rand(s1_quant_seed);
+    int s1_quant_level = quant_min + (int)floor(s1_rand_for_quant * quant_range);
+
+    int s2_quant_seed = (quantOffsets[1] + frame) - ((quantOffsets[1] + frame) % stream2QuantDur);
+    float s2_rand_for_quant = fpsr_portable_rand(s2_quant_seed);
+    int s2_quant_level = quant_min + (int)floor(s2_rand_for_quant * quant_range);
+
+    if (s1_quant_level < 1) { s1_quant_level = 1; }
+    if (s2_quant_level < 1) { s2_quant_level = 1; }
+
+    if (stream2FreqMult < 0) { stream2FreqMult = 3.7; }
+
+    float stream1 = floor((sin((float)(streamsOffset[0] + frame) * baseWaveFreq) / 2.0 + 0.5) * s1_quant_level) / (float)s1_quant_level;
+    float stream2 = floor((sin((float)(streamsOffset[1] + frame) * baseWaveFreq * stream2FreqMult) / 2.0 + 0.5) * s2_quant_level) / (float)s2_quant_level;
+
+    float active_stream_val = ((frame % streamSwitchDur) < streamSwitchDur / 2) ? stream1 : stream2;
+
+    float fpsr_output;
+    if (finalRandSwitch == 1) {
+        fpsr_output = fpsr_portable_rand((int)(active_stream_val * 100000.0));
+    } else {
+        fpsr_output = 0.5 * active_stream_val + 0.5;
+    }
+    return fpsr_output;
+}
+
+
+/******************************************************************************/
+/* Intermediates                                                              */
+/******************************************************************************/
+
+// The steps of SM, TM and QS as separate functions, for the modules that
+// reason about hold structure instead of single frames. Each one computes
+// exactly what the corresponding line of the reference computes.
+
+/** @brief SM step 1: the hold duration in force at frame (always >= 1). */
+static inline int fpsr_sm_hold_duration(const fpsr_sm_params* p, int frame) {
+    int reseedInterval = p->reseedInterval < 1 ? 1 : p->reseedInterval;
+    float rand_for_duration = fpsr_portable_rand(p->seedInner + frame - (frame % reseedInterval));
+    int holdDuration = (int)floor(p->minHold + rand_for_duration * (p->maxHold - p->minHold));
+    return holdDuration < 1 ? 1 : holdDuration;
+}
+
+/** @brief TM step 1: the toggled hold duration in force at frame (always >= 1). */
+static inline int fpsr_tm_hold_duration(const fpsr_tm_params* p, int frame) {
+    int periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    int holdDuration = (((p->seedInner + frame) % periodSwitch) < (periodSwitch * 0.5)) ? p->periodA : p->periodB;
+    return holdDuration < 1 ? 1 : holdDuration;
+}
+
+/** @brief Step 2 of SM and TM: the stable integer state for a hold duration. */
+static inline int fpsr_held_state(int seedOuter, int frame, int holdDuration) {
+    return (seedOuter + frame) - ((seedOuter + frame) % holdDuration);
+}
+
+/**
+ * @brief The run of x sharing x - (x % d), i.e. the same truncated quotient.
+ * @details C's % truncates toward zero, so the block around zero is
+ * [-(d - 1), d - 1] and every other block is d long. In 64 bits so that
+ * blocks reaching past INT_MIN / INT_MAX do not overflow.
+ */
+static inline void fpsr_trunc_block(int64_t x, int64_t d, int64_t* lo, int64_t* hi) {
+    // A 32-bit division where the operands fit, which they nearly always do;
+    // a 64-bit one costs several times more on many x86 cores.
+    int64_t q = (x == (int32_t)x && d == (int32_t)d) ? (int32_t)x / (int32_t)d : x / d;
+    if (q > 0) {
+        *lo = q * d;
+        *hi = q * d + d - 1;
+    } else if (q < 0) {
+        *lo = q * d - d + 1;
+        *hi = q * d;
+    } else {
+        *lo = -(d - 1);
+        *hi = d - 1;
+    }
+}
+
+/** @brief Step 3 of SM and TM: the output for a held state. */
+static inline float fpsr_held_output(int held_integer_state, int finalRandSwitch) {
+    return finalRandSwitch ? fpsr_portable_rand(fpsr_state_seed(held_integer_state))
+                           : (float)held_integer_state;
+}
+
+/** @brief QS step 2: quantisation level of stream (0 or 1) at frame. @p r must be resolved. */
+static inline int fpsr_qs_quant_level(const fpsr_qs_params* r, int stream, int frame) {
+    int quantDur = stream ? r->stream2QuantDur : r->stream1QuantDur;
+    int quant_range = r->quantLevelsMinMax[1] - r->quantLevelsMinMax[0] + 1;
+    int quant_seed = (r->quantOffsets[stream] + frame) - ((r->quantOffsets[stream] + frame) % quantDur);
+    int quant_level = r->quantLevelsMinMax[0] + (int)floor(fpsr_portable_rand(quant_seed) * quant_range);
+    return quant_level < 1 ? 1 : quant_level;
+}
+
+/** @brief QS step 3: the sine of stream at frame, before quantisation. @p r must be resolved. */
+static inline double fpsr_qs_stream_sin(const fpsr_qs_params* r, int stream, int frame) {
+    float arg = stream ? (float)(r->streamsOffset[1] + frame) * r->baseWaveFreq * r->stream2FreqMult
+                       : (float)(r->streamsOffset[0] + frame) * r->baseWaveFreq;
+    return sin(arg);
+}
+
+/** @brief QS step 3: the quantised step index (numerator) of a stream's sine. */
+static inline int fpsr_qs_sin_step(double sine, int quant_level) {
+    return (int)floor((sine / 2.0 + 0.5) * quant_level);
+}
+
+/** @brief QS step 3: the quantised step index (numerator) of stream at frame. @p r must be resolved. */
+static inline int fpsr_qs_stream_step(const fpsr_qs_params* r, int stream, int frame, int quant_level) {
+    return fpsr_qs_sin_step(fpsr_qs_stream_sin(r, stream, frame), quant_level);
+}
+
+/** @brief QS step 3: the quantised value of a step index. */
+static inline float fpsr_qs_step_value(int step, int quant_level) {
+    return (double)step / (float)quant_level;
+}
+
+/** @brief QS step 3: the quantised value of stream at frame. @p r must be resolved. */
+static inline float fpsr_qs_stream_value(const fpsr_qs_params* r, int stream, int frame, int quant_level) {
+    return fpsr_qs_step_value(fpsr_qs_stream_step(r, stream, frame, quant_level), quant_level);
+}
+
+/** @brief QS step 4: index (0 or 1) of the stream selected at frame. @p r must be resolved. */
+static inline int fpsr_qs_active_stream(const fpsr_qs_params* r, int frame) {
+    return ((frame % r->streamSwitchDur) < r->streamSwitchDur / 2) ? 0 : 1;
+}
+
+/** @brief QS step 5: the output for the active stream value. */
+static inline float fpsr_qs_output(float active_stream_val, int finalRandSwitch) {
+    return (finalRandSwitch == 1) ? fpsr_portable_rand((int)(active_stream_val * 100000.0))
+                                  : (float)(0.5 * active_stream_val + 0.5);
+}
+
+
+/******************************************************************************/
+/* Pluggable backends                                                         */
+/******************************************************************************/
+
+// SM, TM and QS with the random and sine functions passed in. Called with a
+// constant function pointer they inline down to a direct call, and with
+// fpsr_portable_rand / fpsr_libm_sin they match the reference bit for bit.
+
+typedef float (*fpsr_rand_fn)(int seed);
+typedef double (*fpsr_sin_fn)(double x);
+
+/** @brief The reference sine, as a fpsr_sin_fn. */
+static inline double fpsr_libm_sin(double x) { return sin(x); }
+
+/**
+ * @brief fmod(val, TWO_PI) as portable_rand() computes it, without libm.
+ * @details fmod() is exact, so this is too: the quotient is split so both
+ * partial products are exact, and corrected if the division rounded it one off.
+ */
+static inline float fpsr_wrap_two_pi(float val) {
+    const double two_pi = (double)6.28318530718f;
+    double x = val < 0 ? -(double)val : (double)val;
+    int64_t n = (int64_t)(x / two_pi);
+    int64_t n_hi = n & ~(int64_t)0xFFFF;
+    double rem = (x - (double)n_hi * two_pi) - (double)(n - n_hi) * two_pi;
+    if (rem < 0.0) { rem += two_pi; }
+    if (rem >= two_pi) { rem -= two_pi; }
+    return (float)(val < 0 ? -rem : rem);
+}
+
+/** @brief fpsr_sm_scalar() with a pluggable random function. */
+static inline float fpsr_sm_with(const fpsr_sm_params* p, int frame, fpsr_rand_fn rand_fn) {
+    int reseedInterval = p->reseedInterval < 1 ? 1 : p->reseedInterval;
+    float rand_for_duration = rand_fn(p->seedInner + frame - (frame % reseedInterval));
+    int holdDuration = (int)floor(p->minHold + rand_for_duration * (p->maxHold - p->minHold));
+    if (holdDuration < 1) { holdDuration = 1; }
+
+    int held_integer_state = fpsr_held_state(p->seedOuter, frame, holdDuration);
+    return p->finalRandSwitch ? rand_fn(fpsr_state_seed(held_integer_state)) : (float)held_integer_state;
+}
+
+/** @brief fpsr_tm_scalar() with a pluggable random function. */
+static inline float fpsr_tm_with(const fpsr_tm_params* p, int frame, fpsr_rand_fn rand_fn) {
+    int held_integer_state = fpsr_held_state(p->seedOuter, frame, fpsr_tm_hold_duration(p, frame));
+    return p->finalRandSwitch ? rand_fn(fpsr_state_seed(held_integer_state)) : (float)held_integer_state;
+}
+
+/** @brief fpsr_qs_scalar() with pluggable random and sine functions. */
+static inline float fpsr_qs_with(const fpsr_qs_params* p, int frame, fpsr_rand_fn rand_fn, fpsr_sin_fn sin_fn) {
+    const fpsr_qs_params r = fpsr_qs_resolve(*p);
+    int quant_min = r.quantLevelsMinMax[0];
+    int quant_range = r.quantLevelsMinMax[1] - r.quantLevelsMinMax[0] + 1;
+
+    int s1_quant_seed = (r.quantOffsets[0] + frame) - ((r.quantOffsets[0] + frame) % r.stream1QuantDur);
+    int s1_quant_level = quant_min + (int)floor(rand_fn(s1_quant_seed) * quant_range);
+    int s2_quant_seed = (r.quantOffsets[1] + frame) - ((r.quantOffsets[1] + frame) % r.stream2QuantDur);
+    int s2_quant_level = quant_min + (int)floor(rand_fn(s2_quant_seed) * quant_range);
+    if (s1_quant_level < 1) { s1_quant_level = 1; }
+    if (s2_quant_level < 1) { s2_quant_level = 1; }
+
+    float stream1 = floor((sin_fn((float)(r.streamsOffset[0] + frame) * r.baseWaveFreq) / 2.0 + 0.5) * s1_quant_level) / (float)s1_quant_level;
+    float stream2 = floor((sin_fn((float)(r.streamsOffset[1] + frame) * r.baseWaveFreq * r.stream2FreqMult) / 2.0 + 0.5) * s2_quant_level) / (float)s2_quant_level;
+    float active_stream_val = (fpsr_qs_active_stream(&r, frame) == 0) ? stream1 : stream2;
+
+    return (r.finalRandSwitch == 1) ? rand_fn((int)(active_stream_val * 100000.0))
+                                    : (float)(0.5 * active_stream_val + 0.5);
+}
+
+
+/******************************************************************************/
+/* Preset entry points                                                        */
+/******************************************************************************/
+
+/** @brief fpsr_sm_scalar() driven by a preset. */
+static inline float fpsr_sm_eval(const fpsr_sm_params* p, int frame) {
+    return fpsr_sm_scalar(frame, p->minHold, p->maxHold, p->reseedInterval,
+                          p->seedInner, p->seedOuter, p->finalRandSwitch);
+}
+
+/** @brief fpsr_tm_scalar() driven by a preset. */
+static inline float fpsr_tm_eval(const fpsr_tm_params* p, int frame) {
+    return fpsr_tm_scalar(frame, p->periodA, p->periodB, p->periodSwitch,
+                          p->seedInner, p->seedOuter, p->finalRandSwitch);
+}
+
+/** @brief fpsr_qs_scalar() driven by a preset. */
+static inline float fpsr_qs_eval(const fpsr_qs_params* p, int frame) {
+    return fpsr_qs_scalar(frame, p->baseWaveFreq, p->stream2FreqMult,
+                          p->quantLevelsMinMax, p->streamsOffset, p->quantOffsets,
+                          p->streamSwitchDur, p->stream1QuantDur, p->stream2QuantDur,
+                          p->finalRandSwitch);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_NATIVE_H
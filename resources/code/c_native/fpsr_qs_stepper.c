@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_qs_stepper.c
+ * @brief Stateful, frame-by-frame FPS-R:QS with a sine recurrence.
+ * @details Error budget of fpsr_sine_track_sin(), against the true sine of the
+ * reference argument:
+ *     - sin()/cos() at the restart: a few 1e-17.
+ *     - rotation drift: about 2e-16 per frame, so < 1e-12 over a resync period.
+ *     - the small-angle step eps: the reference argument is a product rounded
+ *       to float (three roundings for stream 2), so it sits within
+ *       3 * 2^-24 * |arg| of k * step; below FPSR_QS_STEPPER_ARG_LIMIT that is
+ *       |eps| < 0.375 counting both ends, where the Taylor series below is
+ *       accurate to 2e-11.
+ * The total stays well inside FPSR_QS_STEPPER_MARGIN.
+ */
+
+#include "fpsr_qs_stepper.h"
+
+static void fpsr_sine_track_init(fpsr_sine_track* t, double step) {
+    t->step = step;
+    t->stepSin = sin(step);
+    t->stepCos = cos(step);
+    t->valid = 0;
+}
+
+/**
+ * @brief Moves the rotation of a track to frame n, or drops it if n is not the next frame.
+ */
+static void fpsr_sine_track_advance(fpsr_sine_track* t, int n) {
+    if (t->valid && n == t->frame) {
+        return;
+    }
+    if (t->valid && n != INT_MIN && n - 1 == t->frame && n - t->anchorFrame < FPSR_QS_STEPPER_RESYNC) {
+        double rotSin = t->rotSin * t->stepCos + t->rotCos * t->stepSin;
+        double rotCos = t->rotCos * t->stepCos - t->rotSin * t->stepSin;
+        t->rotSin = rotSin;
+        t->rotCos = rotCos;
+        t->frame = n;
+    } else {
+        t->valid = 0;
+    }
+}
+
+/**
+ * @brief sin(arg) for the reference argument of frame n, after fpsr_sine_track_advance().
+ * @details *exact is set when the result came straight from libm.
+ */
+static double fpsr_sine_track_sin(fpsr_sine_track* t, int n, double arg, int* exact) {
+    if (!(fabs(arg) < FPSR_QS_STEPPER_ARG_LIMIT)) {
+        t->valid = 0;
+        *exact = 1;
+        return sin(arg);
+    }
+
+    if (!t->valid) {
+        t->anchorFrame = n;
+        t->frame = n;
+        t->anchorArg = arg;
+        t->anchorSin = sin(arg);
+        t->anchorCos = cos(arg);
+        t->rotSin = 0.0;
+        t->rotCos = 1.0;
+        t->valid = 1;
+        *exact = 1;
+        return t->anchorSin;
+    }
+
+    double eps = (arg - t->anchorArg) - (double)(n - t->anchorFrame) * t->step;
+    double sinEps, cosEps;
+    double e2 = eps * eps;
+    if (fabs(eps) < 0x1p-12) {
+        // The common case for small arguments; the next terms are below 1e-18.
+        sinEps = eps * (1.0 - e2 * (1.0 / 6));
+        cosEps = 1.0 - e2 * (1.0 / 2);
+    } else if (fabs(eps) < 0.375) {
+        // sin(eps) and cos(eps) to the eps^9 and eps^8 terms.
+        sinEps = eps * (1.0 + e2 * (-1.0 / 6 + e2 * (1.0 / 120 + e2 * (-1.0 / 5040 + e2 * (1.0 / 362880)))));
+        cosEps = 1.0 + e2 * (-1.0 / 2 + e2 * (1.0 / 24 + e2 * (-1.0 / 720 + e2 * (1.0 / 40320))));
+    } else {
+        *exact = 1;
+        return sin(arg);
+    }
+
+    double phaseSin = t->rotSin * cosEps + t->rotCos * sinEps;
+    double phaseCos = t->rotCos * cosEps - t->rotSin * sinEps;
+    *exact = 0;
+    return t->anchorSin * phaseCos + t->anchorCos * phaseSin;
+}
+
+void fpsr_qs_stepper_init(fpsr_qs_stepper* s, const fpsr_qs_params* p, int firstFrame) {
+    s->preset = fpsr_qs_compile(p);
+    const fpsr_qs_params* r = &s->preset.params;
+    // The stream 2 advance is the exact product of two floats.
+    fpsr_sine_track_init(&s->track[0], (double)r->baseWaveFreq);
+    fpsr_sine_track_init(&s->track[1], (double)r->baseWaveFreq * (double)r->stream2FreqMult);
+    s->quantValid[0] = 0;
+    s->quantValid[1] = 0;
+    s->frame = firstFrame;
+    s->exactFallbacks = 0;
+#ifdef FPSR_QS_STEPPER_STATS
+    s->maxSineError = 0.0;
+#endif
+}
+
+float fpsr_qs_stepper_at(fpsr_qs_stepper* s, int frame) {
+    const fpsr_qs_compiled* c = &s->preset;
+    const fpsr_qs_params* r = &c->params;
+
+    // Both rotations advance every frame so a stream switch does not force a
+    // restart; only the selected stream's sine is evaluated.
+    fpsr_sine_track_advance(&s->track[0], frame);
+    fpsr_sine_track_advance(&s->track[1], frame);
+    int stream = (fpsr_divisor_mod(&c->streamSwitchDur, frame) < r->streamSwitchDur / 2) ? 0 : 1;
+
+    // The same float argument as the reference.
+    float arg = stream ? (float)(r->streamsOffset[1] + frame) * r->baseWaveFreq * r->stream2FreqMult
+                       : (float)(r->streamsOffset[0] + frame) * r->baseWaveFreq;
+    int exact;
+    double sine = fpsr_sine_track_sin(&s->track[stream], frame, arg, &exact);
+
+    const fpsr_divisor* quantDur = stream ? &c->stream2QuantDur : &c->stream1QuantDur;
+    int quant_clock = r->quantOffsets[stream] + frame;
+    int quant_seed = quant_clock - fpsr_divisor_mod(quantDur, quant_clock);
+    if (!s->quantValid[stream] || s->quantSeed[stream] != quant_seed) {
+        int quant_range = r->quantLevelsMinMax[1] - r->quantLevelsMinMax[0] + 1;
+        int quant_level = r->quantLevelsMinMax[0] + (int)floor(fpsr_portable_rand(quant_seed) * quant_range);
+        s->quantLevel[stream] = quant_level < 1 ? 1 : quant_level;
+        s->quantSeed[stream] = quant_seed;
+        s->quantValid[stream] = 1;
+    }
+    int quant_level = s->quantLevel[stream];
+
+    double scaled = (sine / 2.0 + 0.5) * quant_level;
+    double step = floor(scaled);
+#ifdef FPSR_QS_STEPPER_STATS
+    if (!exact) { s->maxSineError = fmax(s->maxSineError, fabs(sine - sin(arg))); }
+#endif
+    if (!exact) {
+        double margin = FPSR_QS_STEPPER_MARGIN * quant_level;
+        if (scaled - step < margin || step + 1.0 - scaled < margin) {
+            step = floor((sin(arg) / 2.0 + 0.5) * quant_level);
+            s->exactFallbacks++;
+        }
+    }
+
+    float active_stream_val = step / (float)quant_level;
+    s->frame = frame < INT_MAX ? frame + 1 : frame;
+    return fpsr_qs_output(active_stream_val, r->finalRandSwitch);
+}
+
+float fpsr_qs_stepper_next(fpsr_qs_stepper* s) {
+    return fpsr_qs_stepper_at(s, s->frame);
+}
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_qs_stepper.h
+ * @brief Stateful, frame-by-frame FPS-R:QS for playback and real-time use.
+ * @details fpsr_qs() is stateless: every frame pays for two sin() calls and
+ * two portable_rand() calls. When frames are visited in order most of that
+ * work repeats, and the stepper reuses it:
+ *     - Each stream's sine is carried forward by a rotation recurrence
+ *       (sin and cos of one frame's advance, applied once per frame). The
+ *       reference argument is a float product, so it wanders up to a few ulps
+ *       off the ideal phase; that offset is applied as a small angle on top.
+ *       The recurrence restarts from libm sin()/cos() every
+ *       FPSR_QS_STEPPER_RESYNC frames, and after any jump.
+ *     - A stream's quantisation level only changes when its quant block
+ *       does, so it is cached with the block's seed, and portable_rand()
+ *       runs once per block instead of once per frame.
+ *     - Only the stream selected at a frame is quantised.
+ * The recurrence is accurate to about 1e-11. Where that could move the
+ * floor() of the quantiser (the value sits within FPSR_QS_STEPPER_MARGIN of
+ * a step), the exact sin() is used instead, so the output is bit-identical
+ * to fpsr_qs() for every frame.
+ *
+ * Random access still works: fpsr_qs_stepper_at() on a frame other than the
+ * next one simply restarts the recurrence there.
+ *
+ * Building with -DFPSR_QS_STEPPER_STATS records the largest recurrence error,
+ * at the cost of a sin() per frame; see fpsr_qs_stepper_bench.c.
+ */
+
+#ifndef FPSR_QS_STEPPER_H
+#define FPSR_QS_STEPPER_H
+
+#include "fpsr_compiled.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Frames between restarts of the sine recurrence from libm. */
+#ifndef FPSR_QS_STEPPER_RESYNC
+#define FPSR_QS_STEPPER_RESYNC 1024
+#endif
+
+/**
+ * @brief Arguments at or beyond this use sin() every frame. Float arguments
+ * are spaced 1/8 apart here, about as far as the small-angle step stays exact.
+ */
+#define FPSR_QS_STEPPER_ARG_LIMIT 1048576.0
+
+/** @brief Distance from a quantisation step below which the exact sin() is used. */
+#define FPSR_QS_STEPPER_MARGIN 1.0e-9
+
+/**
+ * @brief The running sine of one stream.
+ */
+typedef struct fpsr_sine_track {
+    double step; // phase advance per frame
+    double stepSin, stepCos;
+    int anchorFrame; // frame of the last restart
+    int frame; // frame the rotation is at
+    double anchorArg; // reference argument at anchorFrame
+    double anchorSin, anchorCos;
+    double rotSin, rotCos; // sin and cos of (frame - anchorFrame) * step
+    int valid;
+} fpsr_sine_track;
+
+/**
+ * @brief A QS channel being played frame by frame.
+ */
+typedef struct fpsr_qs_stepper {
+    fpsr_qs_compiled preset;
+    fpsr_sine_track track[2];
+    int quantSeed[2]; // quant block seed each cached level belongs to
+    int quantLevel[2];
+    int quantValid[2];
+    int frame; // the frame fpsr_qs_stepper_next() evaluates
+    unsigned long long exactFallbacks; // frames that needed the libm sin()
+#ifdef FPSR_QS_STEPPER_STATS
+    // Costs a libm sin() per frame; for validating the error budget.
+    double maxSineError; // largest |recurrence - sin()| seen
+#endif
+} fpsr_qs_stepper;
+
+/** @brief Prepares a stepper for a preset, positioned at firstFrame. */
+void fpsr_qs_stepper_init(fpsr_qs_stepper* s, const fpsr_qs_params* p, int firstFrame);
+
+/** @brief fpsr_qs_eval() at frame. Fastest when frame is the last one plus 1. */
+float fpsr_qs_stepper_at(fpsr_qs_stepper* s, int frame);
+
+/** @brief The value at s->frame, then advances s->frame by one. */
+float fpsr_qs_stepper_next(fpsr_qs_stepper* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_QS_STEPPER_H
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_qs_stepper_bench.c
+ * @brief Drift check and ns per sample of the fpsr_qs_stepper.h stepper.
+ * @details Two parts, for the QS sample preset and a slow preset whose sine
+ * arguments stay below FPSR_QS_STEPPER_ARG_LIMIT for the whole run (so the
+ * recurrence, not the libm fallback, produces nearly every frame):
+ *     - Drift check (the program exits 1 if it fails): fpsr_qs_stepper_next()
+ *       over --frames consecutive frames centred on 0, against the bits of
+ *       fpsr_qs_eval() at every frame. Reports mismatches and how many frames
+ *       fell back to the exact sin(). Built with -DFPSR_QS_STEPPER_STATS it
+ *       also reports the largest recurrence error against the sine error the
+ *       fallback covers: a value within FPSR_QS_STEPPER_MARGIN * level of a
+ *       step takes the exact path, and a sine error e moves the scaled value
+ *       by e * level / 2, so the recurrence may be off by up to
+ *       2 * FPSR_QS_STEPPER_MARGIN before a step can be missed.
+ *     - Cost: ns per sample of fpsr_qs_eval() against the stepper over
+ *       --count consecutive frames, best of 3.
+ * Rebuilding with -DFPSR_QS_STEPPER_RESYNC=N shows how the error grows with
+ * the resync period.
+ *
+ * Options: --frames N (drift check, 1000000000), --count N (timings, 10000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_qs_stepper_bench.c fpsr_qs_stepper.c fpsr_compiled.c -lm
+ *     cc -std=c11 -O2 -DFPSR_QS_STEPPER_STATS fpsr_qs_stepper_bench.c fpsr_qs_stepper.c fpsr_compiled.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtoll()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_qs_stepper.h"
+
+static const fpsr_qs_params PRESETS[2] = {
+    { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 },
+    // |arg| < 0.0017 * 5e8 < FPSR_QS_STEPPER_ARG_LIMIT over 10^9 frames;
+    // final off, so the quantised value itself is compared.
+    { 0.001f, 1.7f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 0 },
+};
+static const char* const NAMES[2] = { "sample", "slow" };
+
+static volatile float fpsr_qs_stepper_bench_sink;
+
+static double fpsr_qs_stepper_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+
+/******************************************************************************/
+/* Drift check                                                                */
+/******************************************************************************/
+
+static int fpsr_qs_stepper_bench_drift(int preset, long long frames) {
+    const fpsr_qs_params* p = &PRESETS[preset];
+    const int first = (int)(-frames / 2);
+    fpsr_qs_stepper s;
+    fpsr_qs_stepper_init(&s, p, first);
+
+    long long mismatches = 0;
+    int firstMismatch = 0;
+    const double t0 = fpsr_qs_stepper_bench_now();
+    for (long long i = 0; i < frames; i++) {
+        const int frame = (int)(first + i);
+        const float a = fpsr_qs_stepper_next(&s);
+        const float b = fpsr_qs_eval(p, frame);
+        if (memcmp(&a, &b, sizeof a) != 0) {
+            if (mismatches == 0) { firstMismatch = frame; }
+            mismatches++;
+        }
+    }
+    const double seconds = (fpsr_qs_stepper_bench_now() - t0) / 1e9;
+
+    printf("drift %-6s %lld frames from %d: %s", NAMES[preset], frames, first, mismatches ? "DIFFER" : "same");
+    if (mismatches) { printf(" (%lld frames, first at %d)", mismatches, firstMismatch); }
+    printf("; %llu exact fallbacks (%.2g of frames), %.0f s\n", s.exactFallbacks,
+           (double)s.exactFallbacks / (double)frames, seconds);
+#ifdef FPSR_QS_STEPPER_STATS
+    const double budget = 2.0 * FPSR_QS_STEPPER_MARGIN;
+    printf("      %-6s max |recurrence - sin()| %.3g, budget %.3g (%.0fx headroom, resync %d)\n", NAMES[preset],
+           s.maxSineError, budget, s.maxSineError > 0.0 ? budget / s.maxSineError : 0.0, FPSR_QS_STEPPER_RESYNC);
+#endif
+    return mismatches != 0;
+}
+
+
+/******************************************************************************/
+/* Cost                                                                       */
+/******************************************************************************/
+
+// Best of three runs, ns per sample; stepper 0 times fpsr_qs_eval().
+static double fpsr_qs_stepper_bench_time(int preset, int stepper, long count) {
+    const fpsr_qs_params* p = &PRESETS[preset];
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        float acc = 0.0f;
+        fpsr_qs_stepper s;
+        const double t0 = fpsr_qs_stepper_bench_now();
+        if (stepper) {
+            fpsr_qs_stepper_init(&s, p, 0);
+            for (long i = 0; i < count; i++) { acc += fpsr_qs_stepper_next(&s); }
+        } else {
+            for (long i = 0; i < count; i++) { acc += fpsr_qs_eval(p, (int)i); }
+        }
+        const double ns = (fpsr_qs_stepper_bench_now() - t0) / (double)count;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_qs_stepper_bench_sink = acc;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long long frames = 1000000000;
+    long count = 10000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) { frames = strtoll(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 1 || frames > 4000000000LL || count < 1 || count > 2000000000L) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (int preset = 0; preset < 2; preset++) { failed |= fpsr_qs_stepper_bench_drift(preset, frames); }
+
+    printf("\n%-7s %12s %12s %9s\n", "preset", "eval() ns", "stepper ns", "speedup");
+    for (int preset = 0; preset < 2; preset++) {
+        const double evalNs = fpsr_qs_stepper_bench_time(preset, 0, count);
+        const double stepNs = fpsr_qs_stepper_bench_time(preset, 1, count);
+        printf("%-7s %12.2f %12.2f %8.1fx\n", NAMES[preset], evalNs, stepNs, evalNs / stepNs);
+    }
+    printf("(%ld frames per timing, best of 3)\n", count);
+    return failed;
+}
@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_rich.c
+ * @brief Single-pass rich output for FPS-R SM, TM and QS.
+ */
+
+#include "fpsr_rich.h"
+
+#include <string.h> // For memset()
+
+#include "fpsr_segments.h"
+
+
+/******************************************************************************/
+/* Hold search                                                                */
+/******************************************************************************/
+
+// The searches find changes of the held state (SM, TM) or of
+// active_stream_val (QS). Those are output changes unless finalRandSwitch
+// hashes both sides to the same value, so each one found is checked against
+// the output and skipped if it is not a jump.
+
+/** @brief The window FPSR_RICH_FULL searches, clipped to the int range. */
+static void fpsr_rich_window(int frame, int64_t* firstFrame, int64_t* lastFrame) {
+    *firstFrame = (int64_t)frame - FPSR_RICH_HORIZON < INT_MIN ? INT_MIN : (int64_t)frame - FPSR_RICH_HORIZON;
+    *lastFrame = (int64_t)frame + FPSR_RICH_HORIZON > INT_MAX ? INT_MAX : (int64_t)frame + FPSR_RICH_HORIZON;
+}
+
+static void fpsr_rich_progress(int frame, fpsr_rich_output* out) {
+    int64_t length = (int64_t)out->next_changed_frame - out->last_changed_frame;
+    out->hold_progress = length > 0 ? (float)((double)((int64_t)frame - out->last_changed_frame) / (double)length) : 0.0f;
+}
+
+/**
+ * @brief SM / TM spans (fpsr_sm_span()) for a walk away from one frame.
+ * @details An SM span needs the hold duration of its reseedInterval block, one
+ * portable_rand(). Two blocks are kept: that of the frame itself, whose
+ * duration the caller already has, and the last other one looked up, so the
+ * walk pays for each block once, and the search ahead does not pay again for
+ * the frame's block after the search back has left it. TM durations cost
+ * nothing.
+ */
+typedef struct fpsr_rich_walk {
+    const fpsr_sm_params* sm; // one of sm and tm is set
+    const fpsr_tm_params* tm;
+    int finalRandSwitch;
+    int64_t blockLo[2], blockHi[2]; // SM: reseedInterval blocks of known duration, [0] the frame's
+    int blockDuration[2];
+} fpsr_rich_walk;
+
+static int fpsr_rich_walk_span(fpsr_rich_walk* w, int frame, int64_t* lo, int64_t* hi) {
+    if (w->tm) {
+        return fpsr_tm_span(w->tm, frame, fpsr_tm_hold_duration(w->tm, frame), lo, hi);
+    }
+    int k = (frame >= w->blockLo[0] && frame <= w->blockHi[0]) ? 0 : 1;
+    if (k == 1 && (frame < w->blockLo[1] || frame > w->blockHi[1])) {
+        fpsr_trunc_block(frame, w->sm->reseedInterval < 1 ? 1 : w->sm->reseedInterval, &w->blockLo[1], &w->blockHi[1]);
+        w->blockDuration[1] = fpsr_sm_hold_duration(w->sm, frame);
+    }
+    return fpsr_sm_span(w->sm, frame, w->blockDuration[k], lo, hi);
+}
+
+/**
+ * @brief Walks spans from [lo, hi], which holds state and outputs value, in
+ * dir until the output changes, looking no further than limit.
+ * @return 1 and *change, the first frame with another output; 0 if there is none.
+ */
+static int fpsr_rich_walk_change(fpsr_rich_walk* w, int state, float value, int64_t lo, int64_t hi,
+                                 int dir, int64_t limit, int* change)
+{
+    for (;;) {
+        int64_t edge = dir > 0 ? hi : lo;
+        if (dir > 0 ? edge >= limit : edge <= limit) {
+            return 0;
+        }
+        int next = (int)(edge + dir);
+        int nextState = fpsr_rich_walk_span(w, next, &lo, &hi);
+        if (nextState != state) {
+            if (fpsr_held_output(nextState, w->finalRandSwitch) != value) {
+                *change = next;
+                return 1;
+            }
+            state = nextState;
+        }
+    }
+}
+
+/**
+ * @brief Fills last_changed_frame, next_changed_frame and hold_progress for SM / TM.
+ * @details out->value and out->has_changed must already be set, and w must
+ * hold the block of frame in its first slot. Both searches start from the
+ * span of frame rather than from a fresh lookup, and when has_changed is 1
+ * the hold starts at frame and only the next change is searched.
+ *
+ * With finalRandSwitch on, every state beyond +-21474 hashes to the same
+ * output (fpsr_state_seed()), so once seedOuter + frame is further out than
+ * that plus the longest hold, the output never changes again in that
+ * direction. saturation is that distance (0 for none) and outer is
+ * seedOuter + frame; the searches jump straight across the constant region
+ * instead of visiting every hold in it.
+ */
+static void fpsr_rich_held_hold(fpsr_rich_walk* w, int frame, int64_t outer, int64_t saturation,
+                                fpsr_rich_output* out)
+{
+    int64_t firstFrame, lastFrame;
+    fpsr_rich_window(frame, &firstFrame, &lastFrame);
+    int64_t lo, hi;
+    int state = fpsr_rich_walk_span(w, frame, &lo, &hi);
+
+    // Where each search starts; a start outside the window finds nothing.
+    int64_t back = frame;
+    int64_t ahead = frame;
+    if (saturation > 0 && outer >= saturation) {
+        back = frame - (outer - saturation);
+        ahead = lastFrame + 1;
+    } else if (saturation > 0 && outer <= -saturation) {
+        back = firstFrame - 1;
+        ahead = frame + (-saturation - outer);
+    }
+
+    int change;
+    out->last_changed_frame = (int)firstFrame;
+    if (out->has_changed) {
+        out->last_changed_frame = frame;
+    } else if (back >= firstFrame) {
+        int64_t backLo = lo, backHi = hi;
+        int backState = back == frame ? state : fpsr_rich_walk_span(w, (int)back, &backLo, &backHi);
+        // change is the last frame of the previous hold.
+        if (fpsr_rich_walk_change(w, backState, out->value, backLo, backHi, -1, firstFrame, &change)) {
+            out->last_changed_frame = change + 1;
+        }
+    }
+
+    out->next_changed_frame = (int)lastFrame;
+    if (ahead <= lastFrame) {
+        int64_t aheadLo = lo, aheadHi = hi;
+        int aheadState = ahead == frame ? state : fpsr_rich_walk_span(w, (int)ahead, &aheadLo, &aheadHi);
+        if (fpsr_rich_walk_change(w, aheadState, out->value, aheadLo, aheadHi, 1, lastFrame, &change)) {
+            out->next_changed_frame = change;
+        }
+    }
+    fpsr_rich_progress(frame, out);
+}
+
+/** @brief The saturation distance of fpsr_rich_held_hold() for a longest hold. */
+static int64_t fpsr_rich_saturation(int finalRandSwitch, int longestHold) {
+    return finalRandSwitch ? 21474 + (int64_t)(longestHold < 1 ? 1 : longestHold) + 1 : 0;
+}
+
+/**
+ * @brief The hold search of fpsr_rich_qs_hold() in one direction, from the
+ * states of both streams at frame.
+ * @details A change whose value hashes to the same output is not a jump, so
+ * the search goes on from it with its own stream, level and step.
+ */
+static int fpsr_rich_qs_change(const fpsr_qs_params* r, int frame, int stream, const fpsr_qs_stream_state streams[2],
+                               float value, int dir, int limit, int* change)
+{
+    float changeValue;
+    if (!fpsr_qs_change_near(r, frame, stream, streams, dir, limit, change, &changeValue)) {
+        return 0;
+    }
+    while (fpsr_qs_output(changeValue, r->finalRandSwitch) == value) {
+        int from = *change;
+        int fromStream = fpsr_qs_active_stream(r, from);
+        int quant_level = fpsr_qs_quant_level(r, fromStream, from);
+        int step = fpsr_qs_stream_step(r, fromStream, from, quant_level);
+        if (!fpsr_qs_change_from(r, from, fromStream, quant_level, step, dir, limit, change, &changeValue)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Fills last_changed_frame, next_changed_frame and hold_progress for QS.
+ * @details streams holds both streams at frame (r resolved), so the searches
+ * start from what the value and has_changed already computed, and a change is
+ * checked against the output with fpsr_qs_output() alone.
+ */
+static void fpsr_rich_qs_hold(const fpsr_qs_params* r, int frame, int stream, const fpsr_qs_stream_state streams[2],
+                              fpsr_rich_output* out)
+{
+    int64_t firstFrame, lastFrame;
+    fpsr_rich_window(frame, &firstFrame, &lastFrame);
+    int change;
+
+    out->last_changed_frame = (int)firstFrame;
+    if (out->has_changed) {
+        out->last_changed_frame = frame;
+    } else if (fpsr_rich_qs_change(r, frame, stream, streams, out->value, -1, (int)firstFrame, &change)) {
+        // change is the last frame of the previous hold.
+        out->last_changed_frame = change + 1;
+    }
+
+    out->next_changed_frame = (int)lastFrame;
+    if (fpsr_rich_qs_change(r, frame, stream, streams, out->value, 1, (int)lastFrame, &change)) {
+        out->next_changed_frame = change;
+    }
+    fpsr_rich_progress(frame, out);
+}
+
+static void fpsr_rich_clear(int frame, fpsr_rich_output* out) {
+    memset(out, 0, sizeof *out);
+    out->last_changed_frame = frame;
+    out->next_changed_frame = frame;
+}
+
+
+/******************************************************************************/
+/* SM and TM                                                                  */
+/******************************************************************************/
+
+/**
+ * @brief Whether x - 1 falls in another truncated block of d than x, given
+ * m = x % d; x must be above INT_MIN.
+ * @details x % d truncates toward zero, so a block starts at a multiple of d
+ * above zero and one past a multiple of d below it.
+ */
+static int fpsr_rich_block_start(int x, int m, int d) {
+    return x > 0 ? m == 0 : m == 1 - d;
+}
+
+/** @brief (x - 1) % d from m = x % d, without another division; x must be above INT_MIN. */
+static int fpsr_rich_prev_mod(int x, int m, int d) {
+    if (x > 0) {
+        return m > 0 ? m - 1 : d - 1;
+    }
+    return m - 1 > -d ? m - 1 : 0;
+}
+
+/** @brief has_changed from the held states at frame and frame - 1. */
+static int fpsr_rich_state_changed(int state, int prevState, float value, int finalRandSwitch) {
+    return prevState != state && fpsr_held_output(prevState, finalRandSwitch) != value;
+}
+
+void fpsr_sm_rich(const fpsr_sm_params* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out) {
+    fpsr_rich_clear(frame, out);
+    // Taken before fpsr_sm_hold_duration(), which shares the division.
+    int reseedInterval = p->reseedInterval < 1 ? 1 : p->reseedInterval;
+    int blockOffset = frame % reseedInterval;
+    int holdDuration = fpsr_sm_hold_duration(p, frame);
+    int state = fpsr_held_state(p->seedOuter, frame, holdDuration);
+    out->value = fpsr_held_output(state, p->finalRandSwitch);
+    if (lod == FPSR_RICH_VALUE) {
+        return;
+    }
+
+    int prevDuration = 0; // set when frame - 1 has had its own holdDuration computed
+    if (frame != INT_MIN) {
+        // frame - 1 can only hold another state if frame starts its
+        // reseedInterval block or its holdDuration block; only the first
+        // needs a new holdDuration (one portable_rand()). outer - state is
+        // outer % holdDuration.
+        int outer = p->seedOuter + frame;
+        int newBlock = fpsr_rich_block_start(frame, blockOffset, reseedInterval);
+        if (newBlock || fpsr_rich_block_start(outer, outer - state, holdDuration)) {
+            prevDuration = newBlock ? fpsr_sm_hold_duration(p, frame - 1) : holdDuration;
+            int prevState = fpsr_held_state(p->seedOuter, frame - 1, prevDuration);
+            out->has_changed = fpsr_rich_state_changed(state, prevState, out->value, p->finalRandSwitch);
+        }
+    }
+    if (lod == FPSR_RICH_FULL) {
+        // The block of frame is known, so its spans cost no portable_rand(),
+        // and neither does the block before it if has_changed looked there.
+        fpsr_rich_walk w = { p, NULL, p->finalRandSwitch, { 0, 0 }, { -1, -1 }, { holdDuration, prevDuration } };
+        fpsr_trunc_block(frame, reseedInterval, &w.blockLo[0], &w.blockHi[0]);
+        if (prevDuration > 0 && frame == w.blockLo[0]) {
+            fpsr_trunc_block(frame - 1, reseedInterval, &w.blockLo[1], &w.blockHi[1]);
+        }
+        int longestHold = p->minHold > p->maxHold ? p->minHold : p->maxHold;
+        fpsr_rich_held_hold(&w, frame, (int64_t)p->seedOuter + frame,
+                            fpsr_rich_saturation(p->finalRandSwitch, longestHold), out);
+    }
+}
+
+void fpsr_tm_rich(const fpsr_tm_params* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out) {
+    fpsr_rich_clear(frame, out);
+    // Taken before fpsr_tm_hold_duration(), which shares the division.
+    int periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    int inner = p->seedInner + frame;
+    int switchOffset = inner % periodSwitch;
+    int holdDuration = fpsr_tm_hold_duration(p, frame);
+    int state = fpsr_held_state(p->seedOuter, frame, holdDuration);
+    out->value = fpsr_held_output(state, p->finalRandSwitch);
+    if (lod == FPSR_RICH_VALUE) {
+        return;
+    }
+
+    if (frame != INT_MIN) {
+        // The toggle of frame - 1 follows from that of frame; with the same
+        // holdDuration, frame - 1 only holds another state if frame starts its
+        // holdDuration block (outer - state is outer % holdDuration).
+        int prevOffset = fpsr_rich_prev_mod(inner, switchOffset, periodSwitch);
+        int prevDuration = (prevOffset < periodSwitch * 0.5) == (switchOffset < periodSwitch * 0.5)
+                         ? holdDuration : fpsr_tm_hold_duration(p, frame - 1);
+        int outer = p->seedOuter + frame;
+        if (prevDuration != holdDuration || fpsr_rich_block_start(outer, outer - state, holdDuration)) {
+            int prevState = fpsr_held_state(p->seedOuter, frame - 1, prevDuration);
+            out->has_changed = fpsr_rich_state_changed(state, prevState, out->value, p->finalRandSwitch);
+        }
+    }
+    if (lod == FPSR_RICH_FULL) {
+        fpsr_rich_walk w = { NULL, p, p->finalRandSwitch, { 0, 0 }, { -1, -1 }, { 0, 0 } };
+        int longestHold = p->periodA > p->periodB ? p->periodA : p->periodB;
+        fpsr_rich_held_hold(&w, frame, (int64_t)p->seedOuter + frame,
+                            fpsr_rich_saturation(p->finalRandSwitch, longestHold), out);
+    }
+}
+
+
+/******************************************************************************/
+/* QS                                                                         */
+/******************************************************************************/
+
+void fpsr_qs_rich(const fpsr_qs_params* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out) {
+    fpsr_rich_clear(frame, out);
+    const fpsr_qs_params r = fpsr_qs_resolve(*p);
+    // Taken before fpsr_qs_active_stream(), which shares the division.
+    int switchOffset = frame % r.streamSwitchDur;
+    int stream = fpsr_qs_active_stream(&r, frame);
+    if (lod == FPSR_RICH_VALUE) {
+        int quant_level = fpsr_qs_quant_level(&r, stream, frame);
+        float active_stream_val = fpsr_qs_stream_value(&r, stream, frame, quant_level);
+        out->value = fpsr_qs_output(active_stream_val, r.finalRandSwitch);
+        out->selected_stream = stream;
+        out->randStreams[stream] = active_stream_val;
+        return;
+    }
+
+    // Both streams at FPSR_RICH_FULL, which needs them for randStreams anyway.
+    int other = 1 - stream;
+    fpsr_qs_stream_state streams[2];
+    fpsr_qs_stream_state_at(&r, stream, frame, &streams[stream]);
+    if (lod == FPSR_RICH_FULL) {
+        fpsr_qs_stream_state_at(&r, other, frame, &streams[other]);
+        out->randStreams[other] = fpsr_qs_step_value(streams[other].step, streams[other].quant_level);
+    }
+    float active_stream_val = fpsr_qs_step_value(streams[stream].step, streams[stream].quant_level);
+    out->value = fpsr_qs_output(active_stream_val, r.finalRandSwitch);
+    out->selected_stream = stream;
+    out->randStreams[stream] = active_stream_val;
+
+    if (frame != INT_MIN) {
+        // The stream-switch phase gives the stream at frame - 1. When its
+        // state at frame is known, its level is reused inside the quant block
+        // and its step while the sine at frame is safely inside its band,
+        // which leaves most frames without a sin().
+        int prev = frame - 1;
+        int prevStream = fpsr_rich_prev_mod(frame, switchOffset, r.streamSwitchDur) < r.streamSwitchDur / 2 ? 0 : 1;
+        int prevLevel;
+        int prevStep;
+        if (prevStream == stream || lod == FPSR_RICH_FULL) {
+            prevStep = fpsr_qs_step_near(&r, prevStream, &streams[prevStream], prev, &prevLevel);
+        } else {
+            prevLevel = fpsr_qs_quant_level(&r, prevStream, prev);
+            prevStep = fpsr_qs_stream_step(&r, prevStream, prev, prevLevel);
+        }
+        float prevVal = fpsr_qs_step_value(prevStep, prevLevel);
+        out->has_changed = prevVal != active_stream_val &&
+                           fpsr_qs_output(prevVal, r.finalRandSwitch) != out->value;
+    }
+
+    if (lod == FPSR_RICH_FULL) {
+        fpsr_rich_qs_hold(&r, frame, stream, streams, out);
+    }
+}
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_rich.h
+ * @brief Single-pass rich output for FPS-R SM, TM and QS, with levels of detail.
+ * @details The reference sample code finds out whether the output jumped by
+ * calling the algorithm again at frame - 1, which doubles the cost of every
+ * frame. These wrappers derive the same answers from the intermediates the
+ * algorithm computes anyway:
+ *     - SM: the previous frame can only hold another state if frame starts its
+ *       span (fpsr_sm_span()), i.e. a reseedInterval block or a holdDuration
+ *       block. Both tests reuse the remainders the value took, so elsewhere
+ *       has_changed is 0 with no extra work; at a span start the previous
+ *       state is rebuilt (one portable_rand() for a new holdDuration at a
+ *       reseedInterval block, one more for its output with finalRandSwitch on).
+ *     - TM: as SM, but the previous holdDuration is a toggle and costs nothing.
+ *     - QS: the active stream at frame - 1 is known from the stream-switch
+ *       phase, its level is reused inside the quant block, and its step too
+ *       while the sine at frame is further inside its band than one frame can
+ *       move it (fpsr_qs_step_near()), so most frames need no extra sin().
+ * FPSR_RICH_FULL starts both hold searches from that same state: the span of
+ * frame and the duration of its block (plus the block before it, if
+ * has_changed looked there) for SM and TM, and the level, step and sine of
+ * both streams for QS (fpsr_qs_change_near()), which it needs for
+ * randStreams anyway.
+ *
+ * Levels of detail:
+ *     - FPSR_RICH_VALUE: value only, the same work as the base function. For
+ *       QS, selected_stream and randStreams[selected_stream] are filled too.
+ *     - FPSR_RICH_CHANGED: adds has_changed.
+ *     - FPSR_RICH_FULL: adds last_changed_frame, next_changed_frame and
+ *       hold_progress, found with the closed-form searches of
+ *       fpsr_segments.h, and (QS) both randStreams.
+ * Fields a level does not compute are zero, except last_changed_frame and
+ * next_changed_frame, which are frame.
+ *
+ * Measured with fpsr_rich_bench.c (ns per frame near frame 0, -O2, runs
+ * vary by +-20%), LOD 0 / 1 / 2: SM 227 / 293 / 710, TM 98 / 131 / 399,
+ * QS 184 / 278 / 1297; with finalRandSwitch off SM 68 / 99 / 263, TM
+ * 16 / 11 / 58, QS 115 / 180 / 772. LOD 1 is 25-55% over LOD 0, not level
+ * with it: what is left is the portable_rand() of frame - 1's output at
+ * every state change (one frame in a hold) and of its holdDuration at every
+ * SM reseedInterval block, and for QS the sin() of the frames whose sine is
+ * too near a band edge (about one frame in four here). None of these can be
+ * skipped, since two states or values can hash to the same output. LOD 2 is
+ * 3-4x LOD 0 for SM and TM and 5-7x for QS: each search has to hash the
+ * output of the neighbouring hold (again, to tell a jump from a collision),
+ * an SM search pays one portable_rand() per reseedInterval block it crosses,
+ * and a QS search pays a level and a sine at every quant block it enters
+ * and an asin() band test where the known sine cannot rule a step out. It
+ * stays below two calls plus fpsr_*_last_change() and fpsr_*_next_change()
+ * on every preset.
+ *
+ * Every field describes the output value, as comparing with the previous
+ * frame would: has_changed is eval(frame) != eval(frame - 1), and a hold is
+ * a run of equal outputs. With finalRandSwitch on, neighbouring held states
+ * can hash to the same output (see fpsr_state_seed()); such holds are one.
+ */
+
+#ifndef FPSR_RICH_H
+#define FPSR_RICH_H
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How far FPSR_RICH_FULL looks for the ends of a hold, in frames
+ * either side. A hold longer than that is reported as ending at the window.
+ */
+#define FPSR_RICH_HORIZON 65536
+
+/** @brief Level of detail of a rich evaluation. */
+typedef enum fpsr_rich_lod {
+    FPSR_RICH_VALUE = 0,
+    FPSR_RICH_CHANGED = 1,
+    FPSR_RICH_FULL = 2
+} fpsr_rich_lod;
+
+/** @brief The output of one frame and what is known about its hold. */
+typedef struct fpsr_rich_output {
+    float value; // what fpsr_*_eval() returns
+    int has_changed; // 1 if value differs from the previous frame's
+    float hold_progress; // [0, 1): (frame - last_changed_frame) / (next_changed_frame - last_changed_frame)
+    int last_changed_frame; // first frame of the current hold
+    int next_changed_frame; // first frame of the next hold
+    float randStreams[2]; // QS: the quantised value of streams 1 and 2
+    int selected_stream; // QS: index of the active stream in randStreams
+} fpsr_rich_output;
+
+/** @brief SM at frame, with the outputs of the given level of detail. */
+void fpsr_sm_rich(const fpsr_sm_params* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out);
+
+/** @brief TM at frame, with the outputs of the given level of detail. */
+void fpsr_tm_rich(const fpsr_tm_params* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out);
+
+/** @brief QS at frame, with the outputs of the given level of detail. */
+void fpsr_qs_rich(const fpsr_qs_params* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_RICH_H
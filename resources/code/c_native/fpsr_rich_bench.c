@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_rich_bench.c
+ * @brief Checks of fpsr_rich.h and its cost against calling the base function twice.
+ * @details For SM, TM and QS presets with finalRandSwitch on and off (and an
+ * SM preset with long holds):
+ *     - Checks (the program exits 1 if one fails): at every frame of three
+ *       windows (around 0, across the +-21474 state saturation of SM / TM,
+ *       and near INT_MAX), every field of every level of detail against
+ *       brute force over the frames of the window plus FPSR_RICH_HORIZON
+ *       either side: value and has_changed from fpsr_*_eval() at frame and
+ *       frame - 1, the hold bounds from runs of equal outputs, and (QS) the
+ *       selected stream.
+ *     - Cost: ns per frame, best of 3, over --count frames cycling through
+ *       the window around 0 (inside the saturation distance, where every
+ *       hold has to be searched), of
+ *         - eval(): fpsr_*_eval() alone;
+ *         - two calls: fpsr_*_eval() at frame and frame - 1, the reference
+ *           way of getting has_changed;
+ *         - two calls + search: the same plus fpsr_*_last_change() and
+ *           fpsr_*_next_change(), the hold bounds without fpsr_rich.h;
+ *         - rich LOD 0, 1 and 2.
+ *
+ * Options: --count N (frames per timing, 1000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_rich_bench.c fpsr_rich.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h> // For int64_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_rich.h"
+#include "fpsr_segments.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_sm_params SM_RAW = { 16, 24, 9, -41, 23, 0 };
+static const fpsr_sm_params SM_LONG = { 2000, 5000, 10000, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_tm_params TM_RAW = { 10, 25, 30, 15, 0, 0 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+static const fpsr_qs_params QS_RAW = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 0 };
+
+/** @brief One preset of one algorithm (0 SM, 1 TM, 2 QS). */
+typedef struct fpsr_rich_bench_preset {
+    const char* name;
+    int algorithm;
+    const void* params;
+} fpsr_rich_bench_preset;
+
+#define FPSR_RICH_BENCH_PRESETS 7
+
+static const fpsr_rich_bench_preset PRESETS[FPSR_RICH_BENCH_PRESETS] = {
+    { "sm", 0, &SM }, { "sm raw", 0, &SM_RAW }, { "sm long", 0, &SM_LONG },
+    { "tm", 1, &TM }, { "tm raw", 1, &TM_RAW },
+    { "qs", 2, &QS }, { "qs raw", 2, &QS_RAW },
+};
+
+// First frames of the check windows. The last one stops short of INT_MAX by
+// the horizon and 100 frames, so no clock the searches reach overflows the
+// reference's int sums (seedInner + frame, quantOffsets[1] + frame, ...).
+#define FPSR_RICH_BENCH_WINDOW 20000
+static const int WINDOWS[3] = { -FPSR_RICH_BENCH_WINDOW / 2, 15000,
+                                INT_MAX - FPSR_RICH_HORIZON - 100 - FPSR_RICH_BENCH_WINDOW };
+
+static volatile float fpsr_rich_bench_sink;
+
+static double fpsr_rich_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static float fpsr_rich_bench_eval(const fpsr_rich_bench_preset* p, int frame) {
+    switch (p->algorithm) {
+    case 0: return fpsr_sm_eval((const fpsr_sm_params*)p->params, frame);
+    case 1: return fpsr_tm_eval((const fpsr_tm_params*)p->params, frame);
+    default: return fpsr_qs_eval((const fpsr_qs_params*)p->params, frame);
+    }
+}
+
+static void fpsr_rich_bench_rich(const fpsr_rich_bench_preset* p, int frame, fpsr_rich_lod lod, fpsr_rich_output* out) {
+    switch (p->algorithm) {
+    case 0: fpsr_sm_rich((const fpsr_sm_params*)p->params, frame, lod, out); break;
+    case 1: fpsr_tm_rich((const fpsr_tm_params*)p->params, frame, lod, out); break;
+    default: fpsr_qs_rich((const fpsr_qs_params*)p->params, frame, lod, out); break;
+    }
+}
+
+static int fpsr_rich_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+// Whether out matches brute force at frame i of the extended range starting
+// at first: v[] outputs, runStart[] / runEnd[] the bounds of each run.
+static int fpsr_rich_bench_matches(const fpsr_rich_bench_preset* p, int frame, fpsr_rich_lod lod,
+                                   const fpsr_rich_output* out, int64_t first, const float* v,
+                                   const int64_t* runStart, const int64_t* runEnd)
+{
+    const int64_t i = (int64_t)frame - first;
+    if (!fpsr_rich_bench_same(out->value, v[i])) { return 0; }
+    if (p->algorithm == 2) {
+        const fpsr_qs_params r = fpsr_qs_resolve(*(const fpsr_qs_params*)p->params);
+        if (out->selected_stream != fpsr_qs_active_stream(&r, frame)) { return 0; }
+    }
+    if (lod == FPSR_RICH_VALUE) { return 1; }
+
+    const int changed = frame != INT_MIN && v[i - 1] != v[i];
+    if (out->has_changed != changed) { return 0; }
+    if (lod == FPSR_RICH_CHANGED) { return 1; }
+
+    const int64_t lo = (int64_t)frame - FPSR_RICH_HORIZON < INT_MIN ? INT_MIN : (int64_t)frame - FPSR_RICH_HORIZON;
+    const int64_t hi = (int64_t)frame + FPSR_RICH_HORIZON > INT_MAX ? INT_MAX : (int64_t)frame + FPSR_RICH_HORIZON;
+    const int64_t start = runStart[i] > lo ? runStart[i] : lo;
+    const int64_t next = runEnd[i] + 1 < hi ? runEnd[i] + 1 : hi;
+    const int64_t length = next - start;
+    const float progress = length > 0 ? (float)((double)((int64_t)frame - start) / (double)length) : 0.0f;
+    return out->last_changed_frame == start && out->next_changed_frame == next &&
+           fpsr_rich_bench_same(out->hold_progress, progress);
+}
+
+static int fpsr_rich_bench_check(const fpsr_rich_bench_preset* p, int window) {
+    const int64_t lastFrame = (int64_t)window + FPSR_RICH_BENCH_WINDOW - 1;
+    const int64_t first = (int64_t)window - FPSR_RICH_HORIZON - 1 < INT_MIN ? INT_MIN : (int64_t)window - FPSR_RICH_HORIZON - 1;
+    const int64_t last = lastFrame + FPSR_RICH_HORIZON + 1 > INT_MAX ? INT_MAX : lastFrame + FPSR_RICH_HORIZON + 1;
+    const size_t n = (size_t)(last - first + 1);
+    float* v = malloc(n * sizeof *v);
+    int64_t* runStart = malloc(n * sizeof *runStart);
+    int64_t* runEnd = malloc(n * sizeof *runEnd);
+    if (!v || !runStart || !runEnd) {
+        free(v);
+        free(runStart);
+        free(runEnd);
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) { v[i] = fpsr_rich_bench_eval(p, (int)(first + (int64_t)i)); }
+    // A run reaching the end of the range is reported as reaching past it; the
+    // range is wider than the window on both sides, so the clip above decides.
+    for (size_t i = 0; i < n; i++) { runStart[i] = (i > 0 && v[i - 1] == v[i]) ? runStart[i - 1] : first + (int64_t)i; }
+    for (size_t i = n; i-- > 0;) { runEnd[i] = (i + 1 < n && v[i + 1] == v[i]) ? runEnd[i + 1] : first + (int64_t)i; }
+
+    long mismatches = 0;
+    int firstMismatch = 0;
+    for (int64_t frame = window; frame <= lastFrame; frame++) {
+        for (int lod = 0; lod < 3; lod++) {
+            fpsr_rich_output out;
+            fpsr_rich_bench_rich(p, (int)frame, (fpsr_rich_lod)lod, &out);
+            if (!fpsr_rich_bench_matches(p, (int)frame, (fpsr_rich_lod)lod, &out, first, v, runStart, runEnd)) {
+                if (mismatches == 0) { firstMismatch = (int)frame; }
+                mismatches++;
+            }
+        }
+    }
+    printf("check %-8s from %11d: %s", p->name, window, mismatches ? "DIFFER" : "same");
+    if (mismatches) { printf(" (%ld, first at frame %d)", mismatches, firstMismatch); }
+    printf("\n");
+
+    free(v);
+    free(runStart);
+    free(runEnd);
+    return mismatches != 0;
+}
+
+
+/******************************************************************************/
+/* Cost                                                                       */
+/******************************************************************************/
+
+// The hold bounds without fpsr_rich.h: the change searches of
+// fpsr_segments.h around frame, skipping changes that hash to the same output.
+static float fpsr_rich_bench_search(const fpsr_rich_bench_preset* p, int frame, float value) {
+    int lo = frame - FPSR_RICH_HORIZON, hi = frame + FPSR_RICH_HORIZON, change = 0, from = frame;
+    int found = 0;
+    do {
+        found = p->algorithm == 0 ? fpsr_sm_last_change((const fpsr_sm_params*)p->params, from, lo, &change)
+              : p->algorithm == 1 ? fpsr_tm_last_change((const fpsr_tm_params*)p->params, from, lo, &change)
+                                  : fpsr_qs_last_change((const fpsr_qs_params*)p->params, from, lo, &change);
+        from = change - 1;
+    } while (found && fpsr_rich_bench_eval(p, change - 1) == value);
+    const int last = change;
+    from = frame;
+    do {
+        found = p->algorithm == 0 ? fpsr_sm_next_change((const fpsr_sm_params*)p->params, from, hi, &change)
+              : p->algorithm == 1 ? fpsr_tm_next_change((const fpsr_tm_params*)p->params, from, hi, &change)
+                                  : fpsr_qs_next_change((const fpsr_qs_params*)p->params, from, hi, &change);
+        from = change;
+    } while (found && fpsr_rich_bench_eval(p, change) == value);
+    return (float)(last + change);
+}
+
+// Best of three runs, ns per frame. mode 0: eval(), 1: two calls,
+// 2: two calls + search, 3-5: rich LOD 0-2.
+static double fpsr_rich_bench_time(const fpsr_rich_bench_preset* p, int mode, long count) {
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        float acc = 0.0f;
+        const double t0 = fpsr_rich_bench_now();
+        for (long i = 0; i < count; i++) {
+            const int frame = WINDOWS[0] + (int)(i % FPSR_RICH_BENCH_WINDOW);
+            if (mode >= 3) {
+                fpsr_rich_output out;
+                fpsr_rich_bench_rich(p, frame, (fpsr_rich_lod)(mode - 3), &out);
+                acc += out.value + (float)out.has_changed + out.hold_progress;
+                continue;
+            }
+            const float value = fpsr_rich_bench_eval(p, frame);
+            acc += value;
+            if (mode >= 1) { acc += fpsr_rich_bench_eval(p, frame - 1) != value; }
+            if (mode == 2) { acc += fpsr_rich_bench_search(p, frame, value); }
+        }
+        const double ns = (fpsr_rich_bench_now() - t0) / (double)count;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_rich_bench_sink = acc;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long count = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1 || count > 1000000000L) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (int k = 0; k < FPSR_RICH_BENCH_PRESETS; k++) {
+        for (int w = 0; w < 3; w++) { failed |= fpsr_rich_bench_check(&PRESETS[k], WINDOWS[w]); }
+    }
+
+    printf("\n%-8s %9s %10s %10s %9s %9s %9s\n", "preset", "eval()", "two calls", "+ search", "LOD 0", "LOD 1", "LOD 2");
+    for (int k = 0; k < FPSR_RICH_BENCH_PRESETS; k++) {
+        printf("%-8s", PRESETS[k].name);
+        for (int mode = 0; mode < 6; mode++) {
+            printf(mode == 1 || mode == 2 ? " %10.1f" : " %9.1f", fpsr_rich_bench_time(&PRESETS[k], mode, count));
+        }
+        printf("\n");
+    }
+    printf("(ns per frame over %ld frames, best of 3)\n", count);
+    return failed;
+}
@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_rle.c
+ * @brief Writer and mmap reader of the RLE bake format.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fpsr_rle.h"
+
+#include <errno.h> // For errno
+#include <fcntl.h> // For open()
+#include <stdio.h> // For the buffered writer
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset(), memcpy() and memcmp()
+#include <sys/mman.h> // For mmap()
+#include <sys/stat.h> // For fstat()
+#include <unistd.h> // For close()
+
+#include "fpsr_segments.h"
+
+_Static_assert(sizeof(fpsr_rle_header) == 64, "fpsr_rle_header must be 64 bytes");
+_Static_assert(sizeof(fpsr_rle_directory) == 24, "fpsr_rle_directory must be 24 bytes");
+_Static_assert(sizeof(fpsr_rle_record) == 8, "fpsr_rle_record must be 8 bytes");
+
+// Segments fetched from fpsr_segments.h per call.
+#define FPSR_RLE_CHUNK 4096
+
+
+/******************************************************************************/
+/* Writer                                                                     */
+/******************************************************************************/
+
+/** @brief Growable list of sparse index entries for the channel being written. */
+typedef struct fpsr_rle_sparse {
+    int32_t* starts;
+    size_t count;
+    size_t capacity;
+} fpsr_rle_sparse;
+
+static int fpsr_rle_sparse_push(fpsr_rle_sparse* s, int32_t start) {
+    if (s->count == s->capacity) {
+        size_t capacity = s->capacity ? s->capacity * 2 : 256;
+        int32_t* starts = (int32_t*)realloc(s->starts, capacity * sizeof(int32_t));
+        if (!starts) {
+            return -1;
+        }
+        s->starts = starts;
+        s->capacity = capacity;
+    }
+    s->starts[s->count++] = start;
+    return 0;
+}
+
+static size_t fpsr_rle_segments(const fpsr_rle_channel* c, int firstFrame, int lastFrame,
+                                fpsr_segment* out, size_t capacity)
+{
+    switch (c->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_segments(c->sm, firstFrame, lastFrame, out, capacity);
+    case FPSR_BAKE_TM: return fpsr_tm_segments(c->tm, firstFrame, lastFrame, out, capacity);
+    case FPSR_BAKE_QS: return fpsr_qs_segments(c->qs, firstFrame, lastFrame, out, capacity);
+    }
+    return 0;
+}
+
+/**
+ * @brief Streams one channel's records and sparse index to f.
+ * @return The number of records, or -1 on a write error.
+ */
+static int64_t fpsr_rle_write_channel(FILE* f, const fpsr_rle_channel* c, int firstFrame, int lastFrame,
+                                      fpsr_segment* chunk, fpsr_rle_sparse* sparse)
+{
+    int64_t count = 0;
+    fpsr_rle_record pending;
+    int havePending = 0;
+    sparse->count = 0;
+
+    int64_t from = firstFrame;
+    while (from <= lastFrame) {
+        size_t n = fpsr_rle_segments(c, (int)from, lastFrame, chunk, FPSR_RLE_CHUNK);
+        for (size_t i = 0; i < n; i++) {
+            // With finalRandSwitch on, neighbouring holds can hash to the same value.
+            if (havePending && memcmp(&pending.value, &chunk[i].value, sizeof(float)) == 0) {
+                continue;
+            }
+            if (havePending) {
+                if (count % FPSR_RLE_INDEX_STRIDE == 0 && fpsr_rle_sparse_push(sparse, pending.start) != 0) { return -1; }
+                if (fwrite(&pending, sizeof pending, 1, f) != 1) { return -1; }
+                count++;
+            }
+            pending.start = chunk[i].start;
+            pending.value = chunk[i].value;
+            havePending = 1;
+        }
+        from = (int64_t)chunk[n - 1].end + 1;
+    }
+    if (count % FPSR_RLE_INDEX_STRIDE == 0 && fpsr_rle_sparse_push(sparse, pending.start) != 0) { return -1; }
+    if (fwrite(&pending, sizeof pending, 1, f) != 1) { return -1; }
+    count++;
+
+    if (fwrite(sparse->starts, sizeof(int32_t), sparse->count, f) != sparse->count) { return -1; }
+    if (sparse->count & 1) {
+        const int32_t pad = 0; // keep the next channel 8-byte aligned
+        if (fwrite(&pad, sizeof pad, 1, f) != 1) { return -1; }
+    }
+    return count;
+}
+
+int fpsr_rle_write(const char* path, const fpsr_rle_channel* channels, size_t channelCount,
+                   int firstFrame, int lastFrame)
+{
+    if (firstFrame > lastFrame || channelCount > SIZE_MAX / sizeof(fpsr_rle_directory)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fpsr_rle_directory* directory = (fpsr_rle_directory*)calloc(channelCount ? channelCount : 1, sizeof(fpsr_rle_directory));
+    fpsr_segment* chunk = (fpsr_segment*)malloc(FPSR_RLE_CHUNK * sizeof(fpsr_segment));
+    fpsr_rle_sparse sparse = { NULL, 0, 0 };
+    FILE* f = (directory && chunk) ? fopen(path, "wb") : NULL;
+    if (!f) {
+        int err = (directory && chunk) ? errno : ENOMEM;
+        free(directory);
+        free(chunk);
+        errno = err;
+        return -1;
+    }
+
+    fpsr_rle_header header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, "FPSRRLE", 8);
+    header.version = FPSR_RLE_VERSION;
+    header.indexStride = FPSR_RLE_INDEX_STRIDE;
+    header.channelCount = channelCount;
+    header.firstFrame = firstFrame;
+    header.lastFrame = lastFrame;
+    header.directoryOffset = sizeof header;
+
+    // The directory is written once the record offsets are known.
+    int ok = fwrite(&header, sizeof header, 1, f) == 1 &&
+             fwrite(directory, sizeof(fpsr_rle_directory), channelCount, f) == channelCount;
+
+    uint64_t offset = sizeof header + channelCount * sizeof(fpsr_rle_directory);
+    for (size_t i = 0; ok && i < channelCount; i++) {
+        int64_t count = fpsr_rle_write_channel(f, &channels[i], firstFrame, lastFrame, chunk, &sparse);
+        if (count < 0) {
+            ok = 0;
+            break;
+        }
+        directory[i].recordOffset = offset;
+        directory[i].recordCount = (uint64_t)count;
+        directory[i].algorithm = (uint32_t)channels[i].algorithm;
+        offset += (uint64_t)count * sizeof(fpsr_rle_record) + ((sparse.count + 1) & ~(size_t)1) * sizeof(int32_t);
+    }
+
+    ok = ok && fseek(f, (long)sizeof header, SEEK_SET) == 0 &&
+         fwrite(directory, sizeof(fpsr_rle_directory), channelCount, f) == channelCount;
+    int err = errno;
+    if (fclose(f) != 0 && ok) {
+        err = errno;
+        ok = 0;
+    }
+
+    free(directory);
+    free(chunk);
+    free(sparse.starts);
+    if (!ok) {
+        errno = err ? err : EIO;
+        return -1;
+    }
+    return 0;
+}
+
+
+/******************************************************************************/
+/* Reader                                                                     */
+/******************************************************************************/
+
+static uint64_t fpsr_rle_sparse_count(uint64_t recordCount) {
+    return (recordCount + FPSR_RLE_INDEX_STRIDE - 1) / FPSR_RLE_INDEX_STRIDE;
+}
+
+/**
+ * @brief Checks that a channel's records are ones fpsr_rle_find() can search:
+ * starts strictly increasing from firstFrame up to at most lastFrame, and each
+ * sparse entry equal to the start of the record it indexes.
+ */
+static int fpsr_rle_validate_channel(const fpsr_rle_file* file, const fpsr_rle_directory* d) {
+    const fpsr_rle_header* h = file->header;
+    const fpsr_rle_record* records = (const fpsr_rle_record*)(file->base + d->recordOffset);
+    const int32_t* sparse = (const int32_t*)(records + d->recordCount);
+    if (records[0].start != h->firstFrame || records[d->recordCount - 1].start > h->lastFrame) {
+        return 0;
+    }
+    for (uint64_t i = 1; i < d->recordCount; i++) {
+        if (records[i].start <= records[i - 1].start) {
+            return 0;
+        }
+    }
+    for (uint64_t k = 0; k < fpsr_rle_sparse_count(d->recordCount); k++) {
+        if (sparse[k] != records[k * FPSR_RLE_INDEX_STRIDE].start) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** @brief Checks that every section lies inside the file and is aligned, then every channel's records. */
+static int fpsr_rle_validate(const fpsr_rle_file* file) {
+    const fpsr_rle_header* h = file->header;
+    if (file->size < sizeof *h || memcmp(h->magic, "FPSRRLE", 8) != 0 ||
+        h->version != FPSR_RLE_VERSION || h->indexStride != FPSR_RLE_INDEX_STRIDE ||
+        h->firstFrame > h->lastFrame || h->directoryOffset % 8 != 0 ||
+        h->directoryOffset > file->size ||
+        h->channelCount > (file->size - h->directoryOffset) / sizeof(fpsr_rle_directory)) {
+        return 0;
+    }
+    const fpsr_rle_directory* d = (const fpsr_rle_directory*)(file->base + h->directoryOffset);
+    uint64_t frames = (uint64_t)((int64_t)h->lastFrame - h->firstFrame) + 1;
+    for (uint64_t i = 0; i < h->channelCount; i++) {
+        uint64_t n = d[i].recordCount;
+        if (n == 0 || n > frames || d[i].recordOffset % 8 != 0 || d[i].recordOffset > file->size ||
+            n * sizeof(fpsr_rle_record) + fpsr_rle_sparse_count(n) * sizeof(int32_t) > file->size - d[i].recordOffset ||
+            !fpsr_rle_validate_channel(file, &d[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int fpsr_rle_open(fpsr_rle_file* file, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    if ((uint64_t)st.st_size < sizeof(fpsr_rle_header)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The mapping keeps the file alive; the descriptor is not needed any more.
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        errno = err;
+        return -1;
+    }
+
+    file->base = (const unsigned char*)base;
+    file->size = (size_t)st.st_size;
+    file->header = (const fpsr_rle_header*)base;
+    file->directory = (const fpsr_rle_directory*)(file->base + file->header->directoryOffset);
+    if (!fpsr_rle_validate(file)) {
+        munmap(base, file->size);
+        memset(file, 0, sizeof *file);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+void fpsr_rle_close(fpsr_rle_file* file) {
+    if (file->base) {
+        munmap((void*)file->base, file->size);
+    }
+    memset(file, 0, sizeof *file);
+}
+
+int fpsr_rle_channel_view(const fpsr_rle_file* file, size_t channel, fpsr_rle_view* view) {
+    if (channel >= file->header->channelCount) {
+        return -1;
+    }
+    const fpsr_rle_directory* d = &file->directory[channel];
+    view->records = (const fpsr_rle_record*)(file->base + d->recordOffset);
+    view->count = d->recordCount;
+    view->sparse = (const int32_t*)(view->records + d->recordCount);
+    view->sparseCount = fpsr_rle_sparse_count(d->recordCount);
+    view->firstFrame = file->header->firstFrame;
+    view->lastFrame = file->header->lastFrame;
+    return 0;
+}
+
+uint64_t fpsr_rle_find(const fpsr_rle_view* view, int frame) {
+    // Both searches halve a [base, base + n) window without data-dependent
+    // branches, which random lookups would mispredict half the time.
+
+    // Last sparse entry <= frame; sparse[0] is firstFrame, so one always is.
+    uint64_t base = 0;
+    uint64_t n = view->sparseCount;
+    while (n > 1) {
+        uint64_t half = n / 2;
+        base = (view->sparse[base + half] <= frame) ? base + half : base;
+        n -= half;
+    }
+
+    // Then the last record <= frame inside that block.
+    uint64_t first = base * FPSR_RLE_INDEX_STRIDE;
+    base = first;
+    n = first + FPSR_RLE_INDEX_STRIDE < view->count ? FPSR_RLE_INDEX_STRIDE : view->count - first;
+    while (n > 1) {
+        uint64_t half = n / 2;
+        base = (view->records[base + half].start <= frame) ? base + half : base;
+        n -= half;
+    }
+    return base;
+}
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_rle.h
+ * @brief Run-length encoded bake files with a zero-copy, random-access reader.
+ * @details FPS-R output is piecewise constant, so a channel is stored as its
+ * holds: one (start frame, value) record per hold, in frame order, where a hold
+ * runs until the next record's start (the last one until lastFrame).
+ * Neighbouring holds with the same output are merged. The writer is fed by
+ * the closed-form enumerators of fpsr_segments.h, so it never evaluates
+ * frames one by one.
+ *
+ * Every 64th start frame is also copied into a sparse index. A lookup
+ * searches the sparse index (small enough to stay in cache), then one block
+ * of at most 64 records: O(log n) with one or two cache misses.
+ *
+ * The reader maps the file read-only and hands out pointers into the mapping,
+ * so lookups decode and copy nothing, and processes that open the same file
+ * share its pages.
+ *
+ * File layout (host byte order; every section 8-byte aligned):
+ *     fpsr_rle_header (64 bytes)
+ *     fpsr_rle_directory[channelCount]
+ *     per channel: fpsr_rle_record[count], then int32 sparse[(count + 63) / 64]
+ *
+ * POSIX only (mmap).
+ */
+
+#ifndef FPSR_RLE_H
+#define FPSR_RLE_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For fixed-width file fields
+
+#include "fpsr_bake.h" // For fpsr_bake_algorithm
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FPSR_RLE_VERSION 1
+
+/** @brief Records per block of the sparse index. */
+#define FPSR_RLE_INDEX_STRIDE 64
+
+/** @brief Header at the start of an RLE file. */
+typedef struct fpsr_rle_header {
+    char magic[8]; // "FPSRRLE\0"
+    uint32_t version; // FPSR_RLE_VERSION
+    uint32_t indexStride; // FPSR_RLE_INDEX_STRIDE
+    uint64_t channelCount;
+    int32_t firstFrame;
+    int32_t lastFrame;
+    uint64_t directoryOffset;
+    uint8_t reserved[24];
+} fpsr_rle_header;
+
+/** @brief Where one channel's records live. */
+typedef struct fpsr_rle_directory {
+    uint64_t recordOffset; // the sparse index follows the records
+    uint64_t recordCount;
+    uint32_t algorithm; // fpsr_bake_algorithm
+    uint32_t reserved;
+} fpsr_rle_directory;
+
+/** @brief One hold: the output from start until the next record's start. */
+typedef struct fpsr_rle_record {
+    int32_t start;
+    float value;
+} fpsr_rle_record;
+
+/** @brief A channel to write. Set the preset matching algorithm. */
+typedef struct fpsr_rle_channel {
+    fpsr_bake_algorithm algorithm;
+    const fpsr_sm_params* sm;
+    const fpsr_tm_params* tm;
+    const fpsr_qs_params* qs;
+} fpsr_rle_channel;
+
+/**
+ * @brief Writes channels over [firstFrame, lastFrame] to a new file at path.
+ * @return 0 on success, -1 on failure with errno set.
+ */
+int fpsr_rle_write(const char* path, const fpsr_rle_channel* channels, size_t channelCount,
+                   int firstFrame, int lastFrame);
+
+/** @brief An open, mapped RLE file. */
+typedef struct fpsr_rle_file {
+    const unsigned char* base;
+    size_t size;
+    const fpsr_rle_header* header;
+    const fpsr_rle_directory* directory;
+} fpsr_rle_file;
+
+/** @brief One channel of a mapped file; the pointers point into the mapping. */
+typedef struct fpsr_rle_view {
+    const fpsr_rle_record* records;
+    const int32_t* sparse;
+    uint64_t count;
+    uint64_t sparseCount;
+    int firstFrame;
+    int lastFrame;
+} fpsr_rle_view;
+
+/**
+ * @brief Maps and validates an RLE file.
+ * @details Besides the layout, every channel is scanned once: its first record
+ * must start at firstFrame, starts must be strictly increasing and no later
+ * than lastFrame, and the sparse index must match the records. Lookups rely
+ * on all of these, so a file that passes can be searched without checks.
+ * @return 0 on success, -1 on failure with errno set (EINVAL for a malformed file).
+ */
+int fpsr_rle_open(fpsr_rle_file* file, const char* path);
+
+/** @brief Unmaps a file. Views into it become invalid. */
+void fpsr_rle_close(fpsr_rle_file* file);
+
+/**
+ * @brief A view of one channel.
+ * @return 0 on success, -1 if channel is out of range.
+ */
+int fpsr_rle_channel_view(const fpsr_rle_file* file, size_t channel, fpsr_rle_view* view);
+
+/**
+ * @brief Index of the record (hold) that covers frame.
+ * @details frame is clamped to [firstFrame, lastFrame].
+ */
+uint64_t fpsr_rle_find(const fpsr_rle_view* view, int frame);
+
+/** @brief The baked value at frame (clamped to the baked range). */
+static inline float fpsr_rle_value_at(const fpsr_rle_view* view, int frame) {
+    return view->records[fpsr_rle_find(view, frame)].value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_RLE_H
@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_rle_bench.c
+ * @brief Round-trip test, size and lookup benchmark of the fpsr_rle.h format.
+ * @details One file holds the sample presets of SM, TM and QS, SM and TM with
+ * finalRandSwitch off, and an SM preset with long holds, over --frames frames
+ * centred on 0.
+ *     - Checks (the program exits 1 if one fails):
+ *         - round trip: fpsr_rle_value_at() gives the bits of fpsr_*_eval()
+ *           at every frame of the range, and clamps frames outside it;
+ *         - fpsr_rle_open() rejects, with EINVAL, copies of the file where
+ *           the first record does not start at firstFrame, two starts are
+ *           equal or out of order, the last start is past lastFrame, or a
+ *           sparse index entry does not match its record.
+ *     - Size: records and bytes per channel against a float-per-frame bake.
+ *     - Lookups: ns per fpsr_rle_value_at() at random and at consecutive
+ *       frames, against fpsr_*_eval() at the same frames, best of 3.
+ *
+ * Options: --frames N (1000000), --lookups N (10000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_rle_bench.c fpsr_rle.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h> // For errno
+#include <stdint.h> // For uint32_t
+#include <stdio.h> // For printf() and the file copies
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp(), memcpy() and memcmp()
+#include <time.h> // For clock_gettime()
+#include <unistd.h> // For unlink() and getpid()
+
+#include "fpsr_rle.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_sm_params SM_RAW = { 16, 24, 9, -41, 23, 0 };
+static const fpsr_sm_params SM_LONG = { 2000, 5000, 10000, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_tm_params TM_RAW = { 10, 25, 30, 15, 0, 0 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+#define FPSR_RLE_BENCH_CHANNELS 6
+
+static const fpsr_rle_channel CHANNELS[FPSR_RLE_BENCH_CHANNELS] = {
+    { FPSR_BAKE_SM, &SM, NULL, NULL },
+    { FPSR_BAKE_SM, &SM_RAW, NULL, NULL },
+    { FPSR_BAKE_SM, &SM_LONG, NULL, NULL },
+    { FPSR_BAKE_TM, NULL, &TM, NULL },
+    { FPSR_BAKE_TM, NULL, &TM_RAW, NULL },
+    { FPSR_BAKE_QS, NULL, NULL, &QS },
+};
+static const char* const NAMES[FPSR_RLE_BENCH_CHANNELS] = { "sm", "sm raw", "sm long", "tm", "tm raw", "qs" };
+
+static volatile float fpsr_rle_bench_sink;
+
+static double fpsr_rle_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static float fpsr_rle_bench_eval(const fpsr_rle_channel* c, int frame) {
+    switch (c->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_eval(c->sm, frame);
+    case FPSR_BAKE_TM: return fpsr_tm_eval(c->tm, frame);
+    default: return fpsr_qs_eval(c->qs, frame);
+    }
+}
+
+static int fpsr_rle_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+// Random frames in [first, last], xorshift.
+static int fpsr_rle_bench_frame(uint32_t* state, int first, int last) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return first + (int)(*state % (uint32_t)(last - first + 1));
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static int fpsr_rle_bench_round_trip(const fpsr_rle_file* file, int first, int last) {
+    int failed = 0;
+    for (int c = 0; c < FPSR_RLE_BENCH_CHANNELS; c++) {
+        fpsr_rle_view view;
+        long mismatches = fpsr_rle_channel_view(file, (size_t)c, &view) != 0;
+        for (int frame = first; !mismatches && frame <= last; frame++) {
+            mismatches += !fpsr_rle_bench_same(fpsr_rle_value_at(&view, frame), fpsr_rle_bench_eval(&CHANNELS[c], frame));
+        }
+        mismatches += !fpsr_rle_bench_same(fpsr_rle_value_at(&view, first - 1000), fpsr_rle_value_at(&view, first));
+        mismatches += !fpsr_rle_bench_same(fpsr_rle_value_at(&view, last + 1000), fpsr_rle_value_at(&view, last));
+        printf("check round trip %-8s %s\n", NAMES[c], mismatches ? "DIFFER" : "same");
+        failed |= mismatches != 0;
+    }
+    return failed;
+}
+
+static unsigned char* fpsr_rle_bench_read(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { return NULL; }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* bytes = malloc(*size);
+    if (bytes && fread(bytes, 1, *size, f) != *size) {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(f);
+    return bytes;
+}
+
+// Each damaged copy of the file at good must fail to open with EINVAL.
+static int fpsr_rle_bench_damaged(const char* good, const char* bad) {
+    static const char* const CASES[4] = { "first start", "equal starts", "last start", "sparse entry" };
+    size_t size;
+    unsigned char* bytes = fpsr_rle_bench_read(good, &size);
+    if (!bytes) { return 1; }
+    const fpsr_rle_header* h = (const fpsr_rle_header*)bytes;
+    const fpsr_rle_directory* d = (const fpsr_rle_directory*)(bytes + h->directoryOffset);
+    const size_t records = (size_t)d[0].recordOffset;
+    const size_t count = (size_t)d[0].recordCount;
+    const size_t sparse = records + count * sizeof(fpsr_rle_record);
+
+    int failed = 0;
+    for (int k = 0; k < 4; k++) {
+        unsigned char* copy = malloc(size);
+        if (!copy) { break; }
+        memcpy(copy, bytes, size);
+        fpsr_rle_record* r = (fpsr_rle_record*)(copy + records);
+        if (k == 0) { r[0].start += 1; }
+        else if (k == 1) { r[count / 2 + 1].start = r[count / 2].start; }
+        else if (k == 2) { r[count - 1].start = h->lastFrame + 1; }
+        else { ((int32_t*)(copy + sparse))[1] += 1; }
+
+        FILE* f = fopen(bad, "wb");
+        const int written = f && fwrite(copy, 1, size, f) == size;
+        if (f) { fclose(f); }
+        fpsr_rle_file file;
+        errno = 0;
+        const int result = written ? fpsr_rle_open(&file, bad) : 0;
+        const int rejected = written && result == -1 && errno == EINVAL;
+        if (written && result == 0) { fpsr_rle_close(&file); }
+        printf("check rejects bad %-13s %s\n", CASES[k], rejected ? "rejected" : "ACCEPTED");
+        failed |= !rejected;
+        free(copy);
+    }
+    unlink(bad);
+    free(bytes);
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Size and lookups                                                           */
+/******************************************************************************/
+
+// Best of three runs, ns per lookup. mode 0: eval(), 1: RLE; random or consecutive frames.
+static double fpsr_rle_bench_time(const fpsr_rle_channel* c, const fpsr_rle_view* view, int mode, int random,
+                                  int first, int last, long lookups) {
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        uint32_t state = 0x9E3779B9u;
+        float acc = 0.0f;
+        const double t0 = fpsr_rle_bench_now();
+        for (long i = 0; i < lookups; i++) {
+            const int frame = random ? fpsr_rle_bench_frame(&state, first, last) : first + (int)(i % (last - first + 1));
+            acc += mode ? fpsr_rle_value_at(view, frame) : fpsr_rle_bench_eval(c, frame);
+        }
+        const double ns = (fpsr_rle_bench_now() - t0) / (double)lookups;
+        if (run == 0 || ns < best) { best = ns; }
+        fpsr_rle_bench_sink = acc;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long frames = 1000000, lookups = 10000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) { frames = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--lookups") == 0) { lookups = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--lookups N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 1000 || frames > 2000000000L || lookups < 1) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    const int first = (int)(-frames / 2);
+    const int last = (int)(first + frames - 1);
+    char path[64], bad[64];
+    snprintf(path, sizeof path, "fpsr_rle_bench_%ld.rle", (long)getpid());
+    snprintf(bad, sizeof bad, "fpsr_rle_bench_%ld.bad", (long)getpid());
+
+    fpsr_rle_file file;
+    const double t0 = fpsr_rle_bench_now();
+    if (fpsr_rle_write(path, CHANNELS, FPSR_RLE_BENCH_CHANNELS, first, last) != 0) {
+        perror("fpsr_rle_write");
+        return 1;
+    }
+    const double writeMs = (fpsr_rle_bench_now() - t0) / 1e6;
+    if (fpsr_rle_open(&file, path) != 0) {
+        perror("fpsr_rle_open");
+        unlink(path);
+        return 1;
+    }
+
+    int failed = fpsr_rle_bench_round_trip(&file, first, last);
+    failed |= fpsr_rle_bench_damaged(path, bad);
+
+    printf("\n%-8s %10s %12s %9s %10s %10s %10s %10s\n", "channel", "records", "bytes", "vs dense", "eval rnd",
+           "rle rnd", "eval seq", "rle seq");
+    for (int c = 0; c < FPSR_RLE_BENCH_CHANNELS; c++) {
+        fpsr_rle_view view;
+        fpsr_rle_channel_view(&file, (size_t)c, &view);
+        const double bytes = (double)view.count * sizeof(fpsr_rle_record) + (double)((view.sparseCount + 1) & ~1ull) * 4.0;
+        printf("%-8s %10llu %12.0f %8.1fx", NAMES[c], (unsigned long long)view.count, bytes, (double)frames * 4.0 / bytes);
+        for (int random = 1; random >= 0; random--) {
+            for (int mode = 0; mode < 2; mode++) {
+                printf(" %10.2f", fpsr_rle_bench_time(&CHANNELS[c], &view, mode, random, first, last, lookups));
+            }
+        }
+        printf("\n");
+    }
+    printf("(%ld frames, written in %.0f ms; ns per lookup over %ld lookups, best of 3)\n", frames, writeMs, lookups);
+
+    fpsr_rle_close(&file);
+    unlink(path);
+    return failed;
+}
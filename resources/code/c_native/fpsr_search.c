@@ -0,0 +1,463 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_search.c
+ * @brief Parallel, early-out constraint search over presets.
+ * @details Candidates are numbered, so threads share nothing but a counter
+ * that hands out the next batch of numbers and a stop flag. Each thread
+ * builds a candidate by writing the axis values into a copy of the base
+ * preset and walks its windows with its own small segment buffer; the only
+ * lock is taken to report a match.
+ *
+ * Windows are walked in batches of a few segments, merged into runs of equal
+ * output (compared bit for bit) as in fpsr_stats.c, so a candidate that
+ * fails early costs a batch or two rather than the whole window.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fpsr_search.h"
+
+#include <errno.h> // For errno
+#include <limits.h> // For INT_MIN
+#include <pthread.h> // For the worker threads and the match lock
+#include <stdatomic.h> // For the candidate counter and the stop flag
+#include <stdlib.h> // For calloc() and free()
+#include <string.h> // For memcpy(), memcmp() and memset()
+#include <unistd.h> // For sysconf()
+
+#include "fpsr_segments.h"
+
+#define FPSR_SEARCH_BATCH 64
+#define FPSR_SEARCH_SEGMENT_BATCH 16
+
+
+/******************************************************************************/
+/* Candidates                                                                 */
+/******************************************************************************/
+
+/** @brief The preset of candidate that the job's algorithm uses, and its size. */
+static char* fpsr_search_preset(fpsr_bake_algorithm algorithm, fpsr_search_match* candidate, size_t* size) {
+    switch (algorithm) {
+    case FPSR_BAKE_SM: *size = sizeof candidate->sm; return (char*)&candidate->sm;
+    case FPSR_BAKE_TM: *size = sizeof candidate->tm; return (char*)&candidate->tm;
+    case FPSR_BAKE_QS: *size = sizeof candidate->qs; return (char*)&candidate->qs;
+    }
+    *size = 0;
+    return NULL;
+}
+
+/** @brief Whether field is the offset of an int field of the algorithm's preset. */
+static int fpsr_search_valid_field(fpsr_bake_algorithm algorithm, size_t field) {
+    fpsr_search_match probe;
+    size_t size;
+    if (!fpsr_search_preset(algorithm, &probe, &size) || field % sizeof(int) != 0 || field + sizeof(int) > size) {
+        return 0;
+    }
+    // The QS frequencies are floats.
+    return algorithm != FPSR_BAKE_QS || field >= offsetof(fpsr_qs_params, quantLevelsMinMax);
+}
+
+static int fpsr_search_valid_constraint(const fpsr_search_constraint* c) {
+    switch (c->kind) {
+    case FPSR_SEARCH_VALUE_AT: return c->min <= c->max;
+    case FPSR_SEARCH_JUMP_AT:
+    case FPSR_SEARCH_HOLD_AT: return c->firstFrame > INT_MIN;
+    case FPSR_SEARCH_MIN_HOLD:
+    case FPSR_SEARCH_MAX_HOLD: return c->firstFrame <= c->lastFrame;
+    case FPSR_SEARCH_JUMPS:
+    case FPSR_SEARCH_MEAN: return c->firstFrame <= c->lastFrame && c->min <= c->max;
+    }
+    return 0;
+}
+
+static int fpsr_search_valid_job(const fpsr_search_job* job) {
+    const int preset = (job->algorithm == FPSR_BAKE_SM && job->sm) || (job->algorithm == FPSR_BAKE_TM && job->tm) ||
+                       (job->algorithm == FPSR_BAKE_QS && job->qs);
+    if (!preset || job->axisCount < 0 || (job->axisCount > 0 && !job->axes) || job->constraintCount < 0 ||
+        job->constraintCount > FPSR_SEARCH_MAX_CONSTRAINTS || (job->constraintCount > 0 && !job->constraints)) {
+        return 0;
+    }
+    for (int i = 0; i < job->axisCount; i++) {
+        if (job->axes[i].first > job->axes[i].last || !fpsr_search_valid_field(job->algorithm, job->axes[i].field)) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < job->constraintCount; i++) {
+        if (!fpsr_search_valid_constraint(&job->constraints[i])) {
+            return 0;
+        }
+    }
+    return fpsr_search_candidates(job) > 0;
+}
+
+uint64_t fpsr_search_candidates(const fpsr_search_job* job) {
+    uint64_t count = 1;
+    for (int i = 0; i < job->axisCount; i++) {
+        if (job->axes[i].first > job->axes[i].last) {
+            return 0;
+        }
+        const uint64_t size = (uint64_t)((int64_t)job->axes[i].last - job->axes[i].first + 1);
+        if (count > UINT64_MAX / size) {
+            return 0;
+        }
+        count *= size;
+    }
+    return count;
+}
+
+/** @brief fpsr_search_candidate() for a job already checked. */
+static void fpsr_search_build(const fpsr_search_job* job, uint64_t index, fpsr_search_match* candidate) {
+    memset(candidate, 0, sizeof *candidate);
+    candidate->index = index;
+    switch (job->algorithm) {
+    case FPSR_BAKE_SM: candidate->sm = *job->sm; break;
+    case FPSR_BAKE_TM: candidate->tm = *job->tm; break;
+    case FPSR_BAKE_QS: candidate->qs = *job->qs; break;
+    }
+    size_t size;
+    char* preset = fpsr_search_preset(job->algorithm, candidate, &size);
+    for (int i = 0; i < job->axisCount; i++) {
+        const fpsr_search_axis* axis = &job->axes[i];
+        const uint64_t axisSize = (uint64_t)((int64_t)axis->last - axis->first + 1);
+        const int value = (int)((int64_t)axis->first + (int64_t)(index % axisSize));
+        memcpy(preset + axis->field, &value, sizeof value);
+        index /= axisSize;
+    }
+}
+
+int fpsr_search_candidate(const fpsr_search_job* job, uint64_t index, fpsr_search_match* candidate) {
+    if (!fpsr_search_valid_job(job) || index >= fpsr_search_candidates(job)) {
+        errno = EINVAL;
+        return -1;
+    }
+    fpsr_search_build(job, index, candidate);
+    return 0;
+}
+
+
+/******************************************************************************/
+/* Constraints                                                                */
+/******************************************************************************/
+
+static inline int fpsr_search_same(float a, float b) {
+    return memcmp(&a, &b, sizeof a) == 0;
+}
+
+static float fpsr_search_eval(fpsr_bake_algorithm algorithm, const fpsr_search_match* c, int frame) {
+    switch (algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_eval(&c->sm, frame);
+    case FPSR_BAKE_TM: return fpsr_tm_eval(&c->tm, frame);
+    case FPSR_BAKE_QS: return fpsr_qs_eval(&c->qs, frame);
+    }
+    return 0.0f;
+}
+
+static size_t fpsr_search_segments(fpsr_bake_algorithm algorithm, const fpsr_search_match* c, int firstFrame,
+                                   int lastFrame, fpsr_segment* out, size_t capacity) {
+    switch (algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_segments(&c->sm, firstFrame, lastFrame, out, capacity);
+    case FPSR_BAKE_TM: return fpsr_tm_segments(&c->tm, firstFrame, lastFrame, out, capacity);
+    case FPSR_BAKE_QS: return fpsr_qs_segments(&c->qs, firstFrame, lastFrame, out, capacity);
+    }
+    return 0;
+}
+
+/** @brief Whether every output of candidate lies in [0, 1], which lets a mean be bounded early. */
+static int fpsr_search_unit_range(fpsr_bake_algorithm algorithm, const fpsr_search_match* c) {
+    switch (algorithm) {
+    case FPSR_BAKE_SM: return c->sm.finalRandSwitch != 0;
+    case FPSR_BAKE_TM: return c->tm.finalRandSwitch != 0;
+    case FPSR_BAKE_QS: return 1; // portable_rand or 0.5 * [0, 1] + 0.5
+    }
+    return 0;
+}
+
+/** @brief The runs of equal output of a window, fetched a batch of segments at a time. */
+typedef struct fpsr_search_runs {
+    fpsr_bake_algorithm algorithm;
+    const fpsr_search_match* candidate;
+    int64_t from;
+    int last;
+    fpsr_segment batch[FPSR_SEARCH_SEGMENT_BATCH];
+    size_t count, at;
+    fpsr_segment pending;
+    int hasPending;
+} fpsr_search_runs;
+
+static int fpsr_search_next_run(fpsr_search_runs* r, fpsr_segment* run) {
+    for (;;) {
+        if (r->at == r->count) {
+            r->at = 0;
+            r->count = r->from <= r->last
+                ? fpsr_search_segments(r->algorithm, r->candidate, (int)r->from, r->last, r->batch, FPSR_SEARCH_SEGMENT_BATCH)
+                : 0;
+            if (r->count == 0) {
+                *run = r->pending;
+                return r->hasPending ? (r->hasPending = 0, 1) : 0;
+            }
+            r->from = (int64_t)r->batch[r->count - 1].end + 1;
+        }
+        const fpsr_segment s = r->batch[r->at++];
+        if (r->hasPending && fpsr_search_same(r->pending.value, s.value)) {
+            r->pending.end = s.end;
+            continue;
+        }
+        const int ready = r->hasPending;
+        *run = r->pending;
+        r->pending = s;
+        r->hasPending = 1;
+        if (ready) {
+            return 1;
+        }
+    }
+}
+
+/** @brief Checks a window constraint, stopping at the first run that decides it. */
+static int fpsr_search_window(fpsr_bake_algorithm algorithm, const fpsr_search_match* candidate,
+                              const fpsr_search_constraint* c) {
+    fpsr_search_runs runs;
+    runs.algorithm = algorithm;
+    runs.candidate = candidate;
+    runs.from = c->firstFrame;
+    runs.last = c->lastFrame;
+    runs.count = runs.at = 0;
+    runs.hasPending = 0;
+
+    const int64_t frames = (int64_t)c->lastFrame - c->firstFrame + 1;
+    const int unitRange = c->kind == FPSR_SEARCH_MEAN && fpsr_search_unit_range(algorithm, candidate);
+    int64_t runCount = 0, covered = 0;
+    double sum = 0.0;
+    fpsr_segment run;
+    while (fpsr_search_next_run(&runs, &run)) {
+        const int64_t length = (int64_t)run.end - run.start + 1;
+        covered += length;
+        runCount++;
+        switch (c->kind) {
+        case FPSR_SEARCH_MIN_HOLD:
+            if (run.start > c->firstFrame && run.end < c->lastFrame && (double)length < c->min) { return 0; }
+            break;
+        case FPSR_SEARCH_MAX_HOLD:
+            if ((double)length > c->max) { return 0; }
+            break;
+        case FPSR_SEARCH_JUMPS:
+            // Each frame still to come can add at most one jump.
+            if ((double)(runCount - 1) > c->max || (double)(runCount - 1 + frames - covered) < c->min) { return 0; }
+            break;
+        case FPSR_SEARCH_MEAN:
+            sum += (double)run.value * (double)length;
+            if (unitRange && (sum / (double)frames > c->max || (sum + (double)(frames - covered)) / (double)frames < c->min)) {
+                return 0;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (c->kind == FPSR_SEARCH_JUMPS) {
+        return (double)(runCount - 1) >= c->min;
+    }
+    if (c->kind == FPSR_SEARCH_MEAN) {
+        const double mean = sum / (double)frames;
+        return mean >= c->min && mean <= c->max;
+    }
+    return 1;
+}
+
+static int fpsr_search_meets(fpsr_bake_algorithm algorithm, const fpsr_search_match* candidate,
+                             const fpsr_search_constraint* c) {
+    switch (c->kind) {
+    case FPSR_SEARCH_VALUE_AT: {
+        const float v = fpsr_search_eval(algorithm, candidate, c->firstFrame);
+        return v >= c->min && v <= c->max;
+    }
+    case FPSR_SEARCH_JUMP_AT:
+    case FPSR_SEARCH_HOLD_AT: {
+        const int same = fpsr_search_same(fpsr_search_eval(algorithm, candidate, c->firstFrame - 1),
+                                          fpsr_search_eval(algorithm, candidate, c->firstFrame));
+        return c->kind == FPSR_SEARCH_HOLD_AT ? same : !same;
+    }
+    default:
+        return fpsr_search_window(algorithm, candidate, c);
+    }
+}
+
+/** @brief Rough cost of a constraint: frames evaluated or walked. */
+static int64_t fpsr_search_cost(const fpsr_search_constraint* c) {
+    switch (c->kind) {
+    case FPSR_SEARCH_VALUE_AT: return 1;
+    case FPSR_SEARCH_JUMP_AT:
+    case FPSR_SEARCH_HOLD_AT: return 2;
+    default: return 2 + (int64_t)c->lastFrame - c->firstFrame + 1;
+    }
+}
+
+/** @brief Constraint indices of job, cheapest first (stable). */
+static void fpsr_search_order(const fpsr_search_job* job, int* order) {
+    for (int i = 0; i < job->constraintCount; i++) {
+        int j = i;
+        const int64_t cost = fpsr_search_cost(&job->constraints[i]);
+        for (; j > 0 && fpsr_search_cost(&job->constraints[order[j - 1]]) > cost; j--) { order[j] = order[j - 1]; }
+        order[j] = i;
+    }
+}
+
+/** @return -1 if candidate meets every constraint, else the index of the first it fails. */
+static int fpsr_search_first_failure(const fpsr_search_job* job, const int* order, const fpsr_search_match* candidate) {
+    for (int i = 0; i < job->constraintCount; i++) {
+        if (!fpsr_search_meets(job->algorithm, candidate, &job->constraints[order[i]])) {
+            return order[i];
+        }
+    }
+    return -1;
+}
+
+int fpsr_search_check(const fpsr_search_job* job, const fpsr_search_match* candidate) {
+    int order[FPSR_SEARCH_MAX_CONSTRAINTS];
+    if (job->constraintCount < 0 || job->constraintCount > FPSR_SEARCH_MAX_CONSTRAINTS) {
+        return 0;
+    }
+    fpsr_search_order(job, order);
+    return fpsr_search_first_failure(job, order, candidate) < 0;
+}
+
+
+/******************************************************************************/
+/* Thread pool                                                                */
+/******************************************************************************/
+
+typedef struct fpsr_search_pool {
+    const fpsr_search_job* job;
+    int order[FPSR_SEARCH_MAX_CONSTRAINTS];
+    uint64_t candidates;
+    uint64_t batch;
+    uint64_t maxMatches;
+    fpsr_search_callback found;
+    void* user;
+    _Atomic uint64_t next;
+    atomic_int stop;
+    pthread_mutex_t lock; // serialises found and guards matches
+    uint64_t matches;
+} fpsr_search_pool;
+
+typedef struct fpsr_search_worker {
+    fpsr_search_pool* pool;
+    uint64_t candidates;
+    uint64_t rejected[FPSR_SEARCH_MAX_CONSTRAINTS];
+    int started;
+    pthread_t thread;
+} fpsr_search_worker;
+
+/** @brief Claims the next batch, [*first, *end). @return 0 when none is left. */
+static int fpsr_search_claim(fpsr_search_pool* pool, uint64_t* first, uint64_t* end) {
+    uint64_t at = atomic_load(&pool->next);
+    do {
+        if (at >= pool->candidates) {
+            return 0;
+        }
+        *end = pool->candidates - at > pool->batch ? at + pool->batch : pool->candidates;
+    } while (!atomic_compare_exchange_weak(&pool->next, &at, *end));
+    *first = at;
+    return 1;
+}
+
+static void fpsr_search_report(fpsr_search_pool* pool, const fpsr_search_match* match) {
+    pthread_mutex_lock(&pool->lock);
+    if (!atomic_load(&pool->stop)) {
+        pool->matches++;
+        const int stop = pool->found && pool->found(match, pool->user) != 0;
+        if (stop || (pool->maxMatches > 0 && pool->matches >= pool->maxMatches)) { atomic_store(&pool->stop, 1); }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* fpsr_search_work(void* arg) {
+    fpsr_search_worker* worker = (fpsr_search_worker*)arg;
+    fpsr_search_pool* pool = worker->pool;
+    uint64_t first, end;
+    while (!atomic_load_explicit(&pool->stop, memory_order_relaxed) && fpsr_search_claim(pool, &first, &end)) {
+        for (uint64_t i = first; i < end && !atomic_load_explicit(&pool->stop, memory_order_relaxed); i++) {
+            fpsr_search_match candidate;
+            fpsr_search_build(pool->job, i, &candidate);
+            worker->candidates++;
+            const int failed = fpsr_search_first_failure(pool->job, pool->order, &candidate);
+            if (failed >= 0) {
+                worker->rejected[failed]++;
+            } else {
+                fpsr_search_report(pool, &candidate);
+            }
+        }
+    }
+    return NULL;
+}
+
+
+/******************************************************************************/
+/* Entry point                                                                */
+/******************************************************************************/
+
+int fpsr_search(const fpsr_search_job* job, const fpsr_search_options* options,
+                fpsr_search_callback found, void* user, fpsr_search_stats* stats) {
+    const fpsr_search_options none = { 0, 0, 0 };
+    if (!options) { options = &none; }
+    if (!fpsr_search_valid_job(job) || options->batch < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fpsr_search_pool pool;
+    pool.job = job;
+    fpsr_search_order(job, pool.order);
+    pool.candidates = fpsr_search_candidates(job);
+    pool.batch = options->batch > 0 ? (uint64_t)options->batch : FPSR_SEARCH_BATCH;
+    pool.maxMatches = options->maxMatches;
+    pool.found = found;
+    pool.user = user;
+    pool.matches = 0;
+    atomic_init(&pool.next, 0);
+    atomic_init(&pool.stop, 0);
+
+    int threads = options->threads;
+    if (threads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    const uint64_t batches = pool.candidates / pool.batch + (pool.candidates % pool.batch != 0);
+    if ((uint64_t)threads > batches) { threads = (int)batches; }
+
+    fpsr_search_worker* workers = (fpsr_search_worker*)calloc((size_t)threads, sizeof(fpsr_search_worker));
+    if (!workers) {
+        errno = ENOMEM;
+        return -1;
+    }
+    const int error = pthread_mutex_init(&pool.lock, NULL);
+    if (error != 0) {
+        free(workers);
+        errno = error;
+        return -1;
+    }
+
+    for (int i = 0; i < threads; i++) { workers[i].pool = &pool; }
+    for (int i = 1; i < threads; i++) {
+        workers[i].started = pthread_create(&workers[i].thread, NULL, fpsr_search_work, &workers[i]) == 0;
+    }
+    fpsr_search_work(&workers[0]);
+    for (int i = 1; i < threads; i++) {
+        if (workers[i].started) { pthread_join(workers[i].thread, NULL); }
+    }
+
+    if (stats) {
+        memset(stats, 0, sizeof *stats);
+        stats->matches = pool.matches;
+        for (int i = 0; i < threads; i++) {
+            stats->candidates += workers[i].candidates;
+            for (int k = 0; k < job->constraintCount; k++) { stats->rejected[k] += workers[i].rejected[k]; }
+        }
+    }
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_search.h
+ * @brief Parallel search for presets whose sequence meets constraints.
+ * @details A search starts from a base preset and sweeps some of its integer
+ * fields (seeds, hold durations, periods, offsets) over ranges, the axes.
+ * Every combination is a candidate; candidate i takes, on axis 0,
+ * first + i % size, on axis 1 the next digit, and so on, so axis 0 varies
+ * fastest.
+ *
+ * Each candidate is checked against the constraints, cheapest first: the
+ * single-frame ones, then the windows, shortest first. A window is walked
+ * hold by hold with fpsr_segments.h (runs of equal output, as
+ * fpsr_stats.h counts them), and the walk stops at the first hold that
+ * breaks the constraint, or as soon as a count or mean can no longer end up
+ * in range. A candidate stops at its first failed constraint.
+ *
+ * Candidates are handed out in batches to a pool of threads. Matches are
+ * passed to a callback as they are found, one at a time (the callback is
+ * serialised) but not in candidate order. The callback can stop the search.
+ *
+ * POSIX only (pthreads).
+ */
+
+#ifndef FPSR_SEARCH_H
+#define FPSR_SEARCH_H
+
+#include <stddef.h> // For size_t and offsetof()
+#include <stdint.h> // For uint64_t
+
+#include "fpsr_bake.h" // For fpsr_bake_algorithm
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Most constraints a job may have. */
+#define FPSR_SEARCH_MAX_CONSTRAINTS 16
+
+/** @brief The field an axis sweeps, e.g. FPSR_SEARCH_FIELD(fpsr_sm_params, seedOuter). Int fields only. */
+#define FPSR_SEARCH_FIELD(type, member) offsetof(type, member)
+
+/** @brief One swept field: every value in [first, last]. */
+typedef struct fpsr_search_axis {
+    size_t field;
+    int first;
+    int last;
+} fpsr_search_axis;
+
+/** @brief What a constraint checks. "Jump" and "hold" mean the output changes or not between frames. */
+typedef enum fpsr_search_kind {
+    FPSR_SEARCH_VALUE_AT = 0, // the output at firstFrame is within [min, max]
+    FPSR_SEARCH_JUMP_AT = 1, // the output jumps at firstFrame (differs from firstFrame - 1)
+    FPSR_SEARCH_HOLD_AT = 2, // the output does not jump at firstFrame
+    FPSR_SEARCH_MIN_HOLD = 3, // every hold inside the window lasts at least min frames
+    FPSR_SEARCH_MAX_HOLD = 4, // no hold, or the part of one inside the window, lasts more than max frames
+    FPSR_SEARCH_JUMPS = 5, // the number of jumps in (firstFrame, lastFrame] is within [min, max]
+    FPSR_SEARCH_MEAN = 6 // the mean output over the window is within [min, max]
+} fpsr_search_kind;
+
+/**
+ * @brief One constraint over the window [firstFrame, lastFrame] (lastFrame is
+ * ignored by the *_AT kinds). For MIN_HOLD, the holds cut by the ends of the
+ * window are not checked, as their lengths are not known.
+ */
+typedef struct fpsr_search_constraint {
+    fpsr_search_kind kind;
+    int firstFrame;
+    int lastFrame;
+    double min;
+    double max;
+} fpsr_search_constraint;
+
+/** @brief What to search. Set the base preset matching algorithm; the others are ignored. */
+typedef struct fpsr_search_job {
+    fpsr_bake_algorithm algorithm;
+    const fpsr_sm_params* sm;
+    const fpsr_tm_params* tm;
+    const fpsr_qs_params* qs;
+    const fpsr_search_axis* axes;
+    int axisCount;
+    const fpsr_search_constraint* constraints;
+    int constraintCount;
+} fpsr_search_job;
+
+/**
+ * @brief Scheduling knobs. Zero fields pick the defaults.
+ */
+typedef struct fpsr_search_options {
+    int threads; // default: online CPUs
+    int batch; // candidates per task handed to a thread; default: 64
+    uint64_t maxMatches; // stop after this many matches; default: no limit
+} fpsr_search_options;
+
+/** @brief A matching candidate: its number and its preset (the one for the job's algorithm). */
+typedef struct fpsr_search_match {
+    uint64_t index;
+    fpsr_sm_params sm;
+    fpsr_tm_params tm;
+    fpsr_qs_params qs;
+} fpsr_search_match;
+
+/** @brief Receives a match. Return nonzero to stop the search. */
+typedef int (*fpsr_search_callback)(const fpsr_search_match* match, void* user);
+
+/** @brief What a search did. */
+typedef struct fpsr_search_stats {
+    uint64_t candidates; // candidates checked
+    uint64_t matches;
+    uint64_t rejected[FPSR_SEARCH_MAX_CONSTRAINTS]; // candidates rejected by each constraint, in job order
+} fpsr_search_stats;
+
+/**
+ * @brief Number of candidates of a job (the product of the axis sizes).
+ * @return 0 if an axis is empty or the product does not fit 64 bits.
+ */
+uint64_t fpsr_search_candidates(const fpsr_search_job* job);
+
+/** @brief Builds candidate index of job. @return 0, or -1 with errno EINVAL. */
+int fpsr_search_candidate(const fpsr_search_job* job, uint64_t index, fpsr_search_match* candidate);
+
+/** @brief Whether candidate (built by fpsr_search_candidate()) meets every constraint of job. */
+int fpsr_search_check(const fpsr_search_job* job, const fpsr_search_match* candidate);
+
+/**
+ * @brief Checks every candidate of job, calling found for each match.
+ * @param stats Filled in if not NULL.
+ * @return 0, or -1 with errno set (EINVAL for a bad job, ENOMEM).
+ */
+int fpsr_search(const fpsr_search_job* job, const fpsr_search_options* options,
+                fpsr_search_callback found, void* user, fpsr_search_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_SEARCH_H
@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_search_bench.c
+ * @brief Checks and candidates per second of fpsr_search() across thread counts.
+ * @details Runs three sweeps against the kind of constraints we brute-force
+ * in Python: no hold shorter than a minimum, a jump at frame 1200, and a mean
+ * over frames 0-5000 within 0.45-0.55. The sweeps are:
+ *     - seeds: seedInner x seedOuter of an SM preset, no hold under 2 frames
+ *       in frames 1000-1400 (reseedInterval 9 cuts holds to 1 frame somewhere
+ *       in every longer window);
+ *     - holds: minHold x maxHold x reseedInterval of the same preset
+ *       (40 x 40 x 12, whatever --candidates), no hold under 6 frames in
+ *       frames 0-5000;
+ *     - qs: two offsets of a slow QS preset, no hold under 3 frames in frames
+ *       1000-1400 (the sample preset steps every frame or two). 1200 is a
+ *       stream switch, so the jump almost always holds here.
+ * Each has matches at the default --candidates.
+ * For each it prints:
+ *     - frame by frame: frames 0-5000 evaluated with fpsr_*_eval() and the
+ *       constraints checked, one thread, for every candidate; and whether
+ *       fpsr_search_check() agrees on every one;
+ *     - fpsr_search() with 1, 2, 4, ... threads up to --threads, the match
+ *       count, and whether the candidates passed to the callback are exactly
+ *       the frame-by-frame matches, each once.
+ * The program exits 1 if any of these differ or a sweep has no match.
+ *
+ * Options: --candidates N (per seed sweep, 20000), --threads N (online CPUs)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 -pthread fpsr_search_bench.c fpsr_search.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and calloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+#include <unistd.h> // For sysconf()
+
+#include "fpsr_search.h"
+
+#define FPSR_SEARCH_BENCH_SIDE 1000 // seedInner values per seedOuter
+#define FPSR_SEARCH_BENCH_LAST 5000 // the windows are frames 0 to this
+
+static const fpsr_sm_params SM = { 6, 40, 9, 7, 0, 1 };
+static const fpsr_qs_params QS = { 0.004f, 1.5f, { 2, 6 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+/**
+ * @brief What a sweep asks for: no hold shorter than minHold in frames
+ * holdFirst to holdLast, a jump at jumpAt, and a mean over frames 0-5000 in
+ * [meanMin, meanMax].
+ */
+typedef struct fpsr_search_bench_ask {
+    int minHold;
+    int holdFirst, holdLast;
+    int jumpAt;
+    double meanMin, meanMax;
+} fpsr_search_bench_ask;
+
+static const fpsr_search_bench_ask SEEDS_ASK = { 2, 1000, 1400, 1200, 0.45, 0.55 };
+static const fpsr_search_bench_ask HOLDS_ASK = { 6, 0, FPSR_SEARCH_BENCH_LAST, 1200, 0.45, 0.55 };
+static const fpsr_search_bench_ask QS_ASK = { 3, 1000, 1400, 1200, 0.45, 0.55 };
+
+static double fpsr_search_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static void fpsr_search_bench_constraints(const fpsr_search_bench_ask* ask, fpsr_search_constraint* c) {
+    const fpsr_search_constraint constraints[3] = {
+        { FPSR_SEARCH_MIN_HOLD, ask->holdFirst, ask->holdLast, (double)ask->minHold, 0.0 },
+        { FPSR_SEARCH_JUMP_AT, ask->jumpAt, 0, 0.0, 0.0 },
+        { FPSR_SEARCH_MEAN, 0, FPSR_SEARCH_BENCH_LAST, ask->meanMin, ask->meanMax },
+    };
+    memcpy(c, constraints, sizeof constraints);
+}
+
+static float fpsr_search_bench_eval(const fpsr_search_job* job, const fpsr_search_match* m, int frame) {
+    return job->algorithm == FPSR_BAKE_SM ? fpsr_sm_eval(&m->sm, frame) : fpsr_qs_eval(&m->qs, frame);
+}
+
+/** @brief The Python approach: evaluate frames 0-5000, then check what ask asks for. */
+static int fpsr_search_bench_frame_by_frame(const fpsr_search_job* job, const fpsr_search_bench_ask* ask,
+                                            const fpsr_search_match* m) {
+    const int first = 0, last = FPSR_SEARCH_BENCH_LAST;
+    float previous = fpsr_search_bench_eval(job, m, first);
+    double sum = previous;
+    // The holds checked start and end with jumps inside (holdFirst, holdLast].
+    int lastJump = 0, shortHold = 0, jumpAt = 0;
+    for (int frame = first + 1; frame <= last; frame++) {
+        const float v = fpsr_search_bench_eval(job, m, frame);
+        if (memcmp(&v, &previous, sizeof v) != 0) {
+            if (frame > ask->holdFirst && frame <= ask->holdLast) {
+                shortHold |= lastJump > ask->holdFirst && frame - lastJump < ask->minHold;
+                lastJump = frame;
+            }
+            jumpAt |= frame == ask->jumpAt;
+        }
+        sum += v;
+        previous = v;
+    }
+    const double mean = sum / (last - first + 1);
+    return !shortHold && jumpAt && mean >= ask->meanMin && mean <= ask->meanMax;
+}
+
+/** @brief The candidates fpsr_search() reported; the callback is serialised. */
+typedef struct fpsr_search_bench_found {
+    unsigned char* seen;
+    uint64_t candidates;
+    uint64_t bad; // indices out of range or reported twice
+} fpsr_search_bench_found;
+
+static int fpsr_search_bench_record(const fpsr_search_match* match, void* user) {
+    fpsr_search_bench_found* f = (fpsr_search_bench_found*)user;
+    if (match->index >= f->candidates || f->seen[match->index]) { f->bad++; }
+    else { f->seen[match->index] = 1; }
+    return 0;
+}
+
+/** @brief Runs one sweep. @return 1 if a check fails. */
+static int fpsr_search_bench_run(const char* name, const fpsr_search_job* job, const fpsr_search_bench_ask* ask,
+                                 int maxThreads) {
+    const uint64_t candidates = fpsr_search_candidates(job);
+    unsigned char* expected = calloc((size_t)candidates, 1);
+    unsigned char* seen = malloc((size_t)candidates);
+    if (!expected || !seen) {
+        perror("fpsr_search_bench");
+        free(expected);
+        free(seen);
+        return 1;
+    }
+
+    fpsr_search_match m;
+    uint64_t matches = 0, differ = 0;
+    double t0 = fpsr_search_bench_now();
+    for (uint64_t i = 0; i < candidates; i++) {
+        fpsr_search_candidate(job, i, &m);
+        expected[i] = (unsigned char)fpsr_search_bench_frame_by_frame(job, ask, &m);
+        matches += expected[i];
+    }
+    const double slowRate = (double)candidates / (fpsr_search_bench_now() - t0);
+    for (uint64_t i = 0; i < candidates; i++) {
+        fpsr_search_candidate(job, i, &m);
+        differ += (uint64_t)(fpsr_search_check(job, &m) != expected[i]);
+    }
+    printf("%-6s %-16s %14.0f  %llu of %llu match; fpsr_search_check() %s", name, "frame by frame", slowRate,
+           (unsigned long long)matches, (unsigned long long)candidates, differ ? "DIFFERS" : "same");
+    if (differ) { printf(" (%llu candidates)", (unsigned long long)differ); }
+    printf("\n");
+    int failed = differ != 0 || matches == 0;
+
+    for (int threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        const fpsr_search_options options = { threads, 0, 0 };
+        fpsr_search_bench_found found = { seen, candidates, 0 };
+        fpsr_search_stats stats;
+        memset(seen, 0, (size_t)candidates);
+        t0 = fpsr_search_bench_now();
+        if (fpsr_search(job, &options, fpsr_search_bench_record, &found, &stats) != 0) {
+            perror("fpsr_search");
+            failed = 1;
+            break;
+        }
+        const double rate = (double)stats.candidates / (fpsr_search_bench_now() - t0);
+        const int same = found.bad == 0 && stats.matches == matches && memcmp(seen, expected, (size_t)candidates) == 0;
+        char label[32];
+        snprintf(label, sizeof label, "search, %d thr", threads);
+        printf("%-6s %-16s %14.0f  %6.1fx  %llu matches, %s; rejected by hold / jump / mean: %llu / %llu / %llu\n",
+               name, label, rate, rate / slowRate, (unsigned long long)stats.matches, same ? "same" : "DIFFER",
+               (unsigned long long)stats.rejected[0], (unsigned long long)stats.rejected[1],
+               (unsigned long long)stats.rejected[2]);
+        failed |= !same;
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+    free(expected);
+    free(seen);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    long candidates = 20000;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    for (int i = 1; i < argc; i++) {
+        const int hasValue = i + 1 < argc;
+        if (hasValue && strcmp(argv[i], "--candidates") == 0) { candidates = strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--threads") == 0) { threads = (int)strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--candidates N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (candidates < 1 || threads < 1) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    const int side = candidates < FPSR_SEARCH_BENCH_SIDE ? (int)candidates : FPSR_SEARCH_BENCH_SIDE;
+    const int outer = (int)((candidates + side - 1) / side);
+    const fpsr_search_axis smAxes[2] = {
+        { FPSR_SEARCH_FIELD(fpsr_sm_params, seedInner), 0, side - 1 },
+        { FPSR_SEARCH_FIELD(fpsr_sm_params, seedOuter), 0, outer - 1 },
+    };
+    const fpsr_search_axis qsAxes[2] = {
+        { FPSR_SEARCH_FIELD(fpsr_qs_params, quantOffsets[0]), 0, side - 1 },
+        { FPSR_SEARCH_FIELD(fpsr_qs_params, streamsOffset[1]), 0, outer - 1 },
+    };
+    const fpsr_search_axis holdAxes[3] = {
+        { FPSR_SEARCH_FIELD(fpsr_sm_params, minHold), 1, 40 },
+        { FPSR_SEARCH_FIELD(fpsr_sm_params, maxHold), 1, 40 },
+        { FPSR_SEARCH_FIELD(fpsr_sm_params, reseedInterval), 1, 12 },
+    };
+    fpsr_search_constraint seedsConstraints[3], holdsConstraints[3], qsConstraints[3];
+    fpsr_search_bench_constraints(&SEEDS_ASK, seedsConstraints);
+    fpsr_search_bench_constraints(&HOLDS_ASK, holdsConstraints);
+    fpsr_search_bench_constraints(&QS_ASK, qsConstraints);
+    const fpsr_search_job sm = { FPSR_BAKE_SM, &SM, NULL, NULL, smAxes, 2, seedsConstraints, 3 };
+    const fpsr_search_job holds = { FPSR_BAKE_SM, &SM, NULL, NULL, holdAxes, 3, holdsConstraints, 3 };
+    const fpsr_search_job qs = { FPSR_BAKE_QS, NULL, NULL, &QS, qsAxes, 2, qsConstraints, 3 };
+
+    printf("%-6s %-16s %14s\n", "sweep", "method", "candidates/s");
+    int failed = fpsr_search_bench_run("seeds", &sm, &SEEDS_ASK, threads);
+    failed |= fpsr_search_bench_run("holds", &holds, &HOLDS_ASK, threads);
+    failed |= fpsr_search_bench_run("qs", &qs, &QS_ASK, threads);
+    return failed;
+}
@@ -0,0 +1,515 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_segments.c
+ * @brief Closed-form hold-segment enumeration for FPS-R SM, TM and QS.
+ * @details All boundary arithmetic is done in 64 bits so that windows
+ * reaching INT_MIN / INT_MAX do not overflow. Every value handed back is
+ * computed with the scalar core, so segments agree with per-frame evaluation.
+ */
+
+#include "fpsr_segments.h"
+
+#include <stdint.h> // For int64_t
+
+#define FPSR_FRAME_MIN ((int64_t)INT_MIN)
+#define FPSR_FRAME_MAX ((int64_t)INT_MAX)
+
+
+/******************************************************************************/
+/* Modulo structure                                                           */
+/******************************************************************************/
+
+/**
+ * @brief The run of x over which (x % d) < threshold keeps its truth value.
+ * @details onCount is how many residues in [0, d) pass the test. Negative x
+ * have residues in (-d, 0], which pass whenever residue 0 does, so every
+ * negative x sits in one long run together with the first passing block.
+ */
+static void fpsr_toggle_run(int64_t x, int64_t d, int64_t onCount, int64_t* lo, int64_t* hi) {
+    if (onCount <= 0 || onCount >= d) {
+        *lo = FPSR_FRAME_MIN * 4;
+        *hi = FPSR_FRAME_MAX * 4;
+        return;
+    }
+    if (x < 0) {
+        *lo = FPSR_FRAME_MIN * 4;
+        *hi = onCount - 1;
+        return;
+    }
+    int64_t base = ((x == (int32_t)x && d == (int32_t)d) ? (int32_t)x / (int32_t)d : x / d) * d;
+    if (x - base < onCount) {
+        *lo = (base == 0) ? FPSR_FRAME_MIN * 4 : base;
+        *hi = base + onCount - 1;
+    } else {
+        *lo = base + onCount;
+        *hi = base + d - 1;
+    }
+}
+
+static int64_t fpsr_min64(int64_t a, int64_t b) { return a < b ? a : b; }
+static int64_t fpsr_max64(int64_t a, int64_t b) { return a > b ? a : b; }
+
+
+/******************************************************************************/
+/* SM / TM spans                                                              */
+/******************************************************************************/
+
+// A span is a run of frames over which both the hold duration and the
+// held-state block are fixed, so the held state is constant. Neighbouring
+// spans may still share a state, so the walkers compare states.
+typedef int (*fpsr_span_fn)(const void* p, int frame, int64_t* lo, int64_t* hi);
+
+int fpsr_sm_span(const fpsr_sm_params* p, int frame, int holdDuration, int64_t* lo, int64_t* hi) {
+    int reseedInterval = p->reseedInterval < 1 ? 1 : p->reseedInterval;
+    int64_t ilo, ihi, olo, ohi;
+
+    fpsr_trunc_block(frame, reseedInterval, &ilo, &ihi);
+    fpsr_trunc_block((int64_t)p->seedOuter + frame, holdDuration, &olo, &ohi);
+    *lo = fpsr_max64(ilo, olo - p->seedOuter);
+    *hi = fpsr_min64(ihi, ohi - p->seedOuter);
+    return fpsr_held_state(p->seedOuter, frame, holdDuration);
+}
+
+int fpsr_tm_span(const fpsr_tm_params* p, int frame, int holdDuration, int64_t* lo, int64_t* hi) {
+    int periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    int64_t ilo, ihi, olo, ohi;
+
+    // (m < periodSwitch * 0.5) passes for the first ceil(periodSwitch / 2) residues.
+    fpsr_toggle_run((int64_t)p->seedInner + frame, periodSwitch, (periodSwitch + 1) / 2, &ilo, &ihi);
+    fpsr_trunc_block((int64_t)p->seedOuter + frame, holdDuration, &olo, &ohi);
+    *lo = fpsr_max64(ilo - p->seedInner, olo - p->seedOuter);
+    *hi = fpsr_min64(ihi - p->seedInner, ohi - p->seedOuter);
+    return fpsr_held_state(p->seedOuter, frame, holdDuration);
+}
+
+static int fpsr_sm_span_at(const void* p, int frame, int64_t* lo, int64_t* hi) {
+    const fpsr_sm_params* sm = (const fpsr_sm_params*)p;
+    return fpsr_sm_span(sm, frame, fpsr_sm_hold_duration(sm, frame), lo, hi);
+}
+
+static int fpsr_tm_span_at(const void* p, int frame, int64_t* lo, int64_t* hi) {
+    const fpsr_tm_params* tm = (const fpsr_tm_params*)p;
+    return fpsr_tm_span(tm, frame, fpsr_tm_hold_duration(tm, frame), lo, hi);
+}
+
+/**
+ * @brief First frame after frame (dir 1) or before it (dir -1), up to and
+ * including limit, whose held state differs from the one at frame.
+ * @details The held state at frame is stored in *state when state is not NULL.
+ */
+static int fpsr_span_walk(fpsr_span_fn span, const void* p, int frame, int dir, int64_t limit,
+                          int64_t* changeFrame, int* state)
+{
+    int64_t lo, hi;
+    int state0 = span(p, frame, &lo, &hi);
+    if (state) { *state = state0; }
+
+    for (;;) {
+        int64_t edge = (dir > 0) ? hi : lo;
+        if ((dir > 0) ? edge >= limit : edge <= limit) { return 0; }
+        int next = (int)(edge + dir);
+        if (span(p, next, &lo, &hi) != state0) {
+            *changeFrame = next;
+            return 1;
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* QS                                                                         */
+/******************************************************************************/
+
+// Band shrink applied to the asin() thresholds. It covers libm's sin(), the
+// "/ 2.0 + 0.5" and "* quant_level" roundings and asin() itself.
+#define FPSR_QS_BAND_MARGIN 1.0e-9
+
+// Relative bound on |float argument - exact argument|: up to three float
+// roundings ((float)(offset + frame), * baseWaveFreq, * stream2FreqMult).
+#define FPSR_QS_ARG_ERROR 0x1p-21
+
+static const double FPSR_TWO_PI_D = 6.28318530717958647692;
+static const double FPSR_PI_D = 3.14159265358979323846;
+
+/**
+ * @brief Smallest y >= y0 at which sin(y) leaves the open band (lo, hi).
+ * @return 0 if sin(y0) is not safely inside the band, else 1 with *exit set
+ * (HUGE_VAL when the band contains the whole of [-1, 1]). The answer errs
+ * early, never late.
+ */
+static int fpsr_sin_band_exit(double y0, double lo, double hi, double* exit) {
+    double v = sin(y0);
+    if (!(v > lo && v < hi)) { return 0; }
+
+    double first = HUGE_VAL;
+    if (hi < 1.0) {
+        // sin(y) >= hi on [a + 2*pi*n, pi - a + 2*pi*n]
+        double a = asin(hi);
+        double n = ceil((y0 - a) / FPSR_TWO_PI_D - 1.0e-9);
+        first = fmin(first, a + FPSR_TWO_PI_D * n);
+    }
+    if (lo > -1.0) {
+        // sin(y) <= lo on [pi - b + 2*pi*n, 2*pi + b + 2*pi*n]
+        double b = asin(lo);
+        double n = ceil((y0 - (FPSR_PI_D - b)) / FPSR_TWO_PI_D - 1.0e-9);
+        first = fmin(first, FPSR_PI_D - b + FPSR_TWO_PI_D * n);
+    }
+    *exit = first - (1.0e-7 + fabs(first) * 0x1p-40);
+    return 1;
+}
+
+/**
+ * @brief First frame strictly past cur, moving in dir and no further than
+ * limit, where the quantised step of stream leaves step; the new step is
+ * stored in *changeStep.
+ */
+static int fpsr_qs_step_change(
+    const fpsr_qs_params* r, int stream, int quant_level, int step,
+    int64_t cur, int64_t limit, int dir, int64_t* changeFrame, int* changeStep)
+{
+    double slope = stream ? (double)r->baseWaveFreq * (double)r->stream2FreqMult : (double)r->baseWaveFreq;
+    double offset = r->streamsOffset[stream];
+    if (slope == 0.0) { return 0; }
+
+    // Work in y = sgn * x so that y grows as frames advance in dir.
+    double sgn = (slope > 0.0) ? dir : -dir;
+    double rate = fabs(slope);
+    double lo = 2.0 * step / quant_level - 1.0 + FPSR_QS_BAND_MARGIN;
+    double hi = 2.0 * (step + 1) / quant_level - 1.0 - FPSR_QS_BAND_MARGIN;
+    double band_lo = (sgn > 0) ? lo : -hi;
+    double band_hi = (sgn > 0) ? hi : -lo;
+
+    while (cur != limit) {
+        int64_t next = cur + dir;
+        double y = sgn * (offset + (double)next) * slope;
+        double y_exit;
+
+        if (fpsr_sin_band_exit(y - fabs(y) * FPSR_QS_ARG_ERROR, band_lo, band_hi, &y_exit)) {
+            // Frames next + dir * j are safe while y + rate * j, plus the
+            // argument error, stays short of the exit.
+            int64_t remaining = (dir > 0) ? limit - next : next - limit;
+            double err = (fmax(fabs(y), fabs(y_exit)) + rate) * FPSR_QS_ARG_ERROR;
+            double room = (y_exit - err - y) / rate;
+            if (room > (double)remaining) { return 0; }
+            if (room > 0.0) {
+                int64_t safe = (int64_t)ceil(room) - 1;
+                if (safe >= 0) {
+                    cur = next + dir * safe;
+                    if (safe > 0) { continue; }
+                }
+            }
+        }
+
+        // Too close to a threshold to decide analytically: evaluate exactly.
+        int nextStep = fpsr_qs_stream_step(r, stream, (int)next, quant_level);
+        if (nextStep != step) {
+            *changeFrame = next;
+            *changeStep = nextStep;
+            return 1;
+        }
+        cur = next;
+    }
+    return 0;
+}
+
+static float fpsr_qs_active_value(const fpsr_qs_params* r, int frame) {
+    int stream = fpsr_qs_active_stream(r, frame);
+    return fpsr_qs_stream_value(r, stream, frame, fpsr_qs_quant_level(r, stream, frame));
+}
+
+/**
+ * @brief First frame past frame in dir, up to limit, whose active_stream_val
+ * differs; that value is stored in *changeValue.
+ * @details stream, quant_level and step are those of frame, so a caller that
+ * has evaluated frame already does not pay for them again.
+ */
+static int fpsr_qs_walk_from(const fpsr_qs_params* r, int frame, int stream, int quant_level, int step,
+                             int dir, int64_t limit, int64_t* changeFrame, float* changeValue)
+{
+    const float value0 = fpsr_qs_step_value(step, quant_level);
+    int64_t cur = frame;
+
+    while (cur != limit) {
+        int quantDur = stream ? r->stream2QuantDur : r->stream1QuantDur;
+        int64_t slo, shi, qlo, qhi;
+
+        fpsr_toggle_run(cur, r->streamSwitchDur, r->streamSwitchDur / 2, &slo, &shi);
+        fpsr_trunc_block((int64_t)r->quantOffsets[stream] + cur, quantDur, &qlo, &qhi);
+        qlo -= r->quantOffsets[stream];
+        qhi -= r->quantOffsets[stream];
+
+        // Inside [cur, edge] the stream and its level are fixed, so only the
+        // sine step can change the value.
+        int64_t edge = (dir > 0) ? fpsr_min64(fpsr_min64(shi, qhi), limit)
+                                 : fpsr_max64(fpsr_max64(slo, qlo), limit);
+        int changeStep;
+        if (fpsr_qs_step_change(r, stream, quant_level, step, cur, edge, dir, changeFrame, &changeStep)) {
+            *changeValue = fpsr_qs_step_value(changeStep, quant_level);
+            return 1;
+        }
+        if (edge == limit) { return 0; }
+
+        cur = edge + dir;
+        stream = fpsr_qs_active_stream(r, (int)cur);
+        quant_level = fpsr_qs_quant_level(r, stream, (int)cur);
+        step = fpsr_qs_stream_step(r, stream, (int)cur, quant_level);
+        float value = fpsr_qs_step_value(step, quant_level);
+        if (value != value0) {
+            *changeFrame = cur;
+            *changeValue = value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** @brief fpsr_qs_walk_from() for a frame not evaluated yet. */
+static int fpsr_qs_walk(const fpsr_qs_params* r, int frame, int dir, int64_t limit, int64_t* changeFrame) {
+    int stream = fpsr_qs_active_stream(r, frame);
+    int quant_level = fpsr_qs_quant_level(r, stream, frame);
+    float changeValue;
+    return fpsr_qs_walk_from(r, frame, stream, quant_level, fpsr_qs_stream_step(r, stream, frame, quant_level),
+                             dir, limit, changeFrame, &changeValue);
+}
+
+/**
+ * @brief Whether stream certainly keeps step (at quant_level) at every frame
+ * within distance of frame, judged from the sine behind step at frame alone.
+ * @details The sine of a frame j frames away moves by at most the change of
+ * its argument, j * |slope| plus the float roundings of both arguments, so a
+ * sine that far inside its band cannot have left it.
+ */
+static int fpsr_qs_step_holds(const fpsr_qs_params* r, int stream, int frame, int quant_level, int step,
+                              double sine, int64_t distance)
+{
+    double slope = fabs(stream ? (double)r->baseWaveFreq * (double)r->stream2FreqMult : (double)r->baseWaveFreq);
+    double x = fabs(((double)r->streamsOffset[stream] + frame) * slope);
+    double reach = slope * (double)distance;
+    double move = reach + (2.0 * x + reach) * FPSR_QS_ARG_ERROR;
+    double lo = 2.0 * step / quant_level - 1.0 + FPSR_QS_BAND_MARGIN;
+    double hi = 2.0 * (step + 1) / quant_level - 1.0 - FPSR_QS_BAND_MARGIN;
+    return sine - move > lo && sine + move < hi;
+}
+
+
+/******************************************************************************/
+/* Public API                                                                 */
+/******************************************************************************/
+
+static int fpsr_report_next(int found, int64_t change, int* changeFrame) {
+    if (found) { *changeFrame = (int)change; }
+    return found;
+}
+
+static int fpsr_report_last(int found, int64_t change, int firstFrame, int* changeFrame) {
+    // The walk finds the last frame of the previous hold; the hold starts one later.
+    *changeFrame = found ? (int)(change + 1) : firstFrame;
+    return found;
+}
+
+int fpsr_sm_next_change(const fpsr_sm_params* p, int frame, int lastFrame, int* changeFrame) {
+    int64_t change = 0;
+    int found = fpsr_span_walk(fpsr_sm_span_at, p, frame, 1, lastFrame, &change, NULL);
+    return fpsr_report_next(found, change, changeFrame);
+}
+
+int fpsr_tm_next_change(const fpsr_tm_params* p, int frame, int lastFrame, int* changeFrame) {
+    int64_t change = 0;
+    int found = fpsr_span_walk(fpsr_tm_span_at, p, frame, 1, lastFrame, &change, NULL);
+    return fpsr_report_next(found, change, changeFrame);
+}
+
+int fpsr_qs_next_change(const fpsr_qs_params* p, int frame, int lastFrame, int* changeFrame) {
+    const fpsr_qs_params r = fpsr_qs_resolve(*p);
+    int64_t change = 0;
+    int found = fpsr_qs_walk(&r, frame, 1, lastFrame, &change);
+    return fpsr_report_next(found, change, changeFrame);
+}
+
+int fpsr_qs_change_from(const fpsr_qs_params* r, int frame, int stream, int quant_level, int step,
+                        int dir, int limit, int* changeFrame, float* changeValue)
+{
+    int64_t change = 0;
+    int found = fpsr_qs_walk_from(r, frame, stream, quant_level, step, dir, limit, &change, changeValue);
+    return fpsr_report_next(found, change, changeFrame);
+}
+
+void fpsr_qs_stream_state_at(const fpsr_qs_params* r, int stream, int frame, fpsr_qs_stream_state* out) {
+    // The quant block from the int remainder fpsr_qs_quant_level() takes too,
+    // so the two share one division.
+    int quantDur = stream ? r->stream2QuantDur : r->stream1QuantDur;
+    int quant_seed = (r->quantOffsets[stream] + frame) - ((r->quantOffsets[stream] + frame) % quantDur);
+    int64_t base = (int64_t)quant_seed - r->quantOffsets[stream];
+    out->quantLo = quant_seed > 0 ? base : base - (quantDur - 1);
+    out->quantHi = quant_seed < 0 ? base : base + (quantDur - 1);
+    out->frame = frame;
+    out->quant_level = fpsr_qs_quant_level(r, stream, frame);
+    out->sine = fpsr_qs_stream_sin(r, stream, frame);
+    out->step = fpsr_qs_sin_step(out->sine, out->quant_level);
+}
+
+/**
+ * @brief Moves s to target, where its step is wanted: the level is kept inside
+ * the quant block and the step while fpsr_qs_step_holds() allows; whatever
+ * cannot be kept is evaluated at target, which becomes the frame of s.
+ */
+static void fpsr_qs_stream_state_move(const fpsr_qs_params* r, int stream, fpsr_qs_stream_state* s, int target) {
+    if (target < s->quantLo || target > s->quantHi) {
+        fpsr_qs_stream_state_at(r, stream, target, s);
+        return;
+    }
+    int64_t distance = (int64_t)target - s->frame;
+    if (!fpsr_qs_step_holds(r, stream, s->frame, s->quant_level, s->step, s->sine, distance < 0 ? -distance : distance)) {
+        s->frame = target;
+        s->sine = fpsr_qs_stream_sin(r, stream, target);
+        s->step = fpsr_qs_sin_step(s->sine, s->quant_level);
+    }
+}
+
+void fpsr_qs_span(const fpsr_qs_params* r, int stream, const fpsr_qs_stream_state* s, int64_t* lo, int64_t* hi) {
+    int64_t slo, shi;
+    fpsr_toggle_run(s->frame, r->streamSwitchDur, r->streamSwitchDur / 2, &slo, &shi);
+    *lo = fpsr_max64(slo, s->quantLo);
+    *hi = fpsr_min64(shi, s->quantHi);
+
+    // The largest distance fpsr_qs_step_holds() accepts, solved from its
+    // bound and then confirmed with it, as the solution rounds.
+    double slope = fabs(stream ? (double)r->baseWaveFreq * (double)r->stream2FreqMult : (double)r->baseWaveFreq);
+    if (slope == 0.0) { return; }
+    double x = fabs(((double)r->streamsOffset[stream] + s->frame) * slope);
+    double lower = 2.0 * s->step / s->quant_level - 1.0 + FPSR_QS_BAND_MARGIN;
+    double upper = 2.0 * (s->step + 1) / s->quant_level - 1.0 - FPSR_QS_BAND_MARGIN;
+    double gap = fmin(s->sine - lower, upper - s->sine) - 2.0 * x * FPSR_QS_ARG_ERROR;
+    int64_t reach = 0;
+    if (gap > 0.0) {
+        double solved = floor(gap / (slope * (1.0 + FPSR_QS_ARG_ERROR)));
+        reach = solved < (double)(FPSR_FRAME_MAX * 4) ? (int64_t)solved : FPSR_FRAME_MAX * 4;
+        while (reach > 0 && !fpsr_qs_step_holds(r, stream, s->frame, s->quant_level, s->step, s->sine, reach)) { reach--; }
+    }
+    *lo = fpsr_max64(*lo, (int64_t)s->frame - reach);
+    *hi = fpsr_min64(*hi, (int64_t)s->frame + reach);
+}
+
+int fpsr_qs_step_near(const fpsr_qs_params* r, int stream, const fpsr_qs_stream_state* s, int target, int* quant_level) {
+    fpsr_qs_stream_state moved = *s;
+    fpsr_qs_stream_state_move(r, stream, &moved, target);
+    *quant_level = moved.quant_level;
+    return moved.step;
+}
+
+int fpsr_qs_change_near(const fpsr_qs_params* r, int frame, int stream, const fpsr_qs_stream_state streams[2],
+                        int dir, int limit, int* changeFrame, float* changeValue)
+{
+    fpsr_qs_stream_state known[2] = { streams[0], streams[1] };
+    const float value0 = fpsr_qs_step_value(known[stream].step, known[stream].quant_level);
+    int64_t cur = frame;
+
+    while (cur != limit) {
+        fpsr_qs_stream_state* s = &known[stream];
+        int64_t slo, shi;
+        fpsr_toggle_run(cur, r->streamSwitchDur, r->streamSwitchDur / 2, &slo, &shi);
+        int64_t edge = (dir > 0) ? fpsr_min64(fpsr_min64(shi, s->quantHi), limit)
+                                 : fpsr_max64(fpsr_max64(slo, s->quantLo), limit);
+
+        // Up to the next stream or quant edge, the known sine may show that
+        // the step cannot move; otherwise that stretch is searched exactly.
+        int64_t reach = (dir > 0) ? edge - s->frame : s->frame - edge;
+        if (!fpsr_qs_step_holds(r, stream, s->frame, s->quant_level, s->step, s->sine, reach) &&
+            fpsr_qs_change_from(r, (int)cur, stream, s->quant_level, s->step, dir, (int)edge, changeFrame, changeValue)) {
+            return 1;
+        }
+        if (edge == limit) { return 0; }
+
+        // Past the edge, the stream that takes over is often known already.
+        cur = edge + dir;
+        stream = fpsr_qs_active_stream(r, (int)cur);
+        fpsr_qs_stream_state_move(r, stream, &known[stream], (int)cur);
+        float value = fpsr_qs_step_value(known[stream].step, known[stream].quant_level);
+        if (value != value0) {
+            *changeFrame = (int)cur;
+            *changeValue = value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int fpsr_sm_last_change(const fpsr_sm_params* p, int frame, int firstFrame, int* changeFrame) {
+    int64_t change = 0;
+    int found = fpsr_span_walk(fpsr_sm_span_at, p, frame, -1, firstFrame, &change, NULL);
+    return fpsr_report_last(found, change, firstFrame, changeFrame);
+}
+
+int fpsr_tm_last_change(const fpsr_tm_params* p, int frame, int firstFrame, int* changeFrame) {
+    int64_t change = 0;
+    int found = fpsr_span_walk(fpsr_tm_span_at, p, frame, -1, firstFrame, &change, NULL);
+    return fpsr_report_last(found, change, firstFrame, changeFrame);
+}
+
+int fpsr_qs_last_change(const fpsr_qs_params* p, int frame, int firstFrame, int* changeFrame) {
+    const fpsr_qs_params r = fpsr_qs_resolve(*p);
+    int64_t change = 0;
+    int found = fpsr_qs_walk(&r, frame, -1, firstFrame, &change);
+    return fpsr_report_last(found, change, firstFrame, changeFrame);
+}
+
+size_t fpsr_sm_segments(const fpsr_sm_params* p, int firstFrame, int lastFrame,
+                        fpsr_segment* out, size_t capacity)
+{
+    size_t count = 0;
+    int64_t start = firstFrame;
+    while (start <= lastFrame && count < capacity) {
+        int64_t change = 0;
+        int state;
+        int found = fpsr_span_walk(fpsr_sm_span_at, p, (int)start, 1, lastFrame, &change, &state);
+        out[count].start = (int)start;
+        out[count].end = found ? (int)(change - 1) : lastFrame;
+        out[count].value = fpsr_held_output(state, p->finalRandSwitch);
+        count++;
+        if (!found) { break; }
+        start = change;
+    }
+    return count;
+}
+
+size_t fpsr_tm_segments(const fpsr_tm_params* p, int firstFrame, int lastFrame,
+                        fpsr_segment* out, size_t capacity)
+{
+    size_t count = 0;
+    int64_t start = firstFrame;
+    while (start <= lastFrame && count < capacity) {
+        int64_t change = 0;
+        int state;
+        int found = fpsr_span_walk(fpsr_tm_span_at, p, (int)start, 1, lastFrame, &change, &state);
+        out[count].start = (int)start;
+        out[count].end = found ? (int)(change - 1) : lastFrame;
+        out[count].value = fpsr_held_output(state, p->finalRandSwitch);
+        count++;
+        if (!found) { break; }
+        start = change;
+    }
+    return count;
+}
+
+size_t fpsr_qs_segments(const fpsr_qs_params* p, int firstFrame, int lastFrame,
+                        fpsr_segment* out, size_t capacity)
+{
+    const fpsr_qs_params r = fpsr_qs_resolve(*p);
+    size_t count = 0;
+    int64_t start = firstFrame;
+    while (start <= lastFrame && count < capacity) {
+        int64_t change = 0;
+        int found = fpsr_qs_walk(&r, (int)start, 1, lastFrame, &change);
+        out[count].start = (int)start;
+        out[count].end = found ? (int)(change - 1) : lastFrame;
+        out[count].value = fpsr_qs_output(fpsr_qs_active_value(&r, (int)start), r.finalRandSwitch);
+        count++;
+        if (!found) { break; }
+        start = change;
+    }
+    return count;
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_segments.h
+ * @brief Closed-form hold-segment enumeration for FPS-R SM, TM and QS.
+ * @details Instead of evaluating every frame and comparing it with the
+ * previous one, these functions jump straight from one change to the next by
+ * solving the modulo structure of each algorithm:
+ *     - SM: the reseedInterval block fixes holdDuration, and the holdDuration
+ *       block of (seedOuter + frame) fixes the held state.
+ *     - TM: the periodSwitch half-cycle fixes holdDuration, then as SM.
+ *     - QS: the stream switch half-cycle and the active stream's quant block
+ *       fix the stream and its level; inside those, the next quantisation
+ *       step is found from asin() and confirmed with the exact expression.
+ * The cost is proportional to the number of changes, not the number of frames.
+ *
+ * A "change" is a change of the value the final hash is applied to:
+ * held_integer_state for SM and TM, active_stream_val for QS. With
+ * finalRandSwitch on, two neighbouring segments can still hash to the same
+ * output (e.g. every SM/TM state beyond +-21474 hashes the same seed, see
+ * fpsr_state_seed()); each segment reports its own output in value.
+ *
+ * Searches are bounded by a caller-given frame window, since some presets
+ * hold a value forever.
+ */
+
+#ifndef FPSR_SEGMENTS_H
+#define FPSR_SEGMENTS_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For int64_t
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One hold: every frame in [start, end] (inclusive) outputs value.
+ */
+typedef struct fpsr_segment {
+    int start;
+    int end;
+    float value;
+} fpsr_segment;
+
+/**
+ * @brief First frame in (frame, lastFrame] at which the output changes.
+ * @return 1 and *changeFrame on success, 0 if the value holds through lastFrame.
+ */
+int fpsr_sm_next_change(const fpsr_sm_params* p, int frame, int lastFrame, int* changeFrame);
+int fpsr_tm_next_change(const fpsr_tm_params* p, int frame, int lastFrame, int* changeFrame);
+int fpsr_qs_next_change(const fpsr_qs_params* p, int frame, int lastFrame, int* changeFrame);
+
+/**
+ * @brief First frame of the hold that contains frame, looking no earlier than firstFrame.
+ * @return 1 if the hold starts after firstFrame; 0 if it reaches back to
+ * firstFrame, in which case *changeFrame is firstFrame.
+ */
+int fpsr_sm_last_change(const fpsr_sm_params* p, int frame, int firstFrame, int* changeFrame);
+int fpsr_tm_last_change(const fpsr_tm_params* p, int frame, int firstFrame, int* changeFrame);
+int fpsr_qs_last_change(const fpsr_qs_params* p, int frame, int firstFrame, int* changeFrame);
+
+/**
+ * @brief First frame past frame in direction dir (1 or -1), no further than
+ * limit, at which active_stream_val differs from frame's, for a caller that
+ * has evaluated frame already.
+ * @details r must be resolved (fpsr_qs_resolve()), and stream, quant_level and
+ * step must be frame's active stream, its level and its step index
+ * (fpsr_qs_active_stream(), fpsr_qs_quant_level(), fpsr_qs_stream_step()).
+ * With dir -1 the frame found is the last one of the previous value.
+ * @return 1 with *changeFrame and its active_stream_val in *changeValue, or 0.
+ */
+int fpsr_qs_change_from(const fpsr_qs_params* r, int frame, int stream, int quant_level, int step,
+                        int dir, int limit, int* changeFrame, float* changeValue);
+
+/**
+ * @brief What is known of one QS stream: its level and step index at frame,
+ * the sine the step was quantised from, and the quant block over which the
+ * level holds.
+ */
+typedef struct fpsr_qs_stream_state {
+    int frame;
+    int quant_level;
+    int step;
+    double sine; // fpsr_qs_stream_sin() at frame
+    int64_t quantLo, quantHi;
+} fpsr_qs_stream_state;
+
+/** @brief Fills *out for stream at frame (one portable_rand(), one sin()). @p r must be resolved. */
+void fpsr_qs_stream_state_at(const fpsr_qs_params* r, int stream, int frame, fpsr_qs_stream_state* out);
+
+/**
+ * @brief The run [*lo, *hi] around s->frame over which stream, active there
+ * with state s, certainly keeps its output: its stream-switch run, its quant
+ * block, and the frames its sine is too far inside its band to leave. No
+ * sin() or portable_rand(); the run is not always the whole hold.
+ */
+void fpsr_qs_span(const fpsr_qs_params* r, int stream, const fpsr_qs_stream_state* s, int64_t* lo, int64_t* hi);
+
+/**
+ * @brief The step index of stream at target, and its level in *quant_level,
+ * from s, a state of that stream.
+ * @details The level is reused inside s's quant block, and the step too while
+ * the sine of s is further from its band edges than the distance to target
+ * can move it. Only what cannot be reused is evaluated.
+ */
+int fpsr_qs_step_near(const fpsr_qs_params* r, int stream, const fpsr_qs_stream_state* s, int target, int* quant_level);
+
+/**
+ * @brief fpsr_qs_change_from() for a caller that knows the state of both
+ * streams, streams[stream] being the active one at frame.
+ * @details At every stream or quant edge the search crosses, the known states
+ * stand in for evaluation as fpsr_qs_step_near() allows, so short holds are
+ * mostly bounded without a sin() or portable_rand().
+ */
+int fpsr_qs_change_near(const fpsr_qs_params* r, int frame, int stream, const fpsr_qs_stream_state streams[2],
+                        int dir, int limit, int* changeFrame, float* changeValue);
+
+/**
+ * @brief The run [*lo, *hi] of frames around frame that share its hold
+ * duration and held-state block; the held state there is returned.
+ * @details holdDuration must be fpsr_*_hold_duration(p, frame), so callers
+ * that have it already pay no portable_rand(). The run may reach past the
+ * int range, and a neighbouring run may hold the same state.
+ */
+int fpsr_sm_span(const fpsr_sm_params* p, int frame, int holdDuration, int64_t* lo, int64_t* hi);
+int fpsr_tm_span(const fpsr_tm_params* p, int frame, int holdDuration, int64_t* lo, int64_t* hi);
+
+/**
+ * @brief Enumerates the holds that cover [firstFrame, lastFrame], clipped to it.
+ * @return The number of segments written. If it equals capacity there may be
+ * more; call again from out[capacity - 1].end + 1.
+ */
+size_t fpsr_sm_segments(const fpsr_sm_params* p, int firstFrame, int lastFrame,
+                        fpsr_segment* out, size_t capacity);
+size_t fpsr_tm_segments(const fpsr_tm_params* p, int firstFrame, int lastFrame,
+                        fpsr_segment* out, size_t capacity);
+size_t fpsr_qs_segments(const fpsr_qs_params* p, int firstFrame, int lastFrame,
+                        fpsr_segment* out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_SEGMENTS_H
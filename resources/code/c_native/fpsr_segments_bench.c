@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_segments_bench.c
+ * @brief Exhaustive check and benchmark of fpsr_segments.h against per-frame evaluation.
+ * @details Two parts:
+ *     - Checks (the program exits 1 if one fails), for SM, TM and QS
+ *       presets chosen to stress each path (reseedInterval 1, durations
+ *       below 1, odd switch periods, fast and slow QS waves, many quant
+ *       levels, finalRandSwitch off), over --check-frames frames centred on
+ *       0 and 100000 frames just inside INT_MIN and INT_MAX:
+ *         - fpsr_*_segments() covers the window with contiguous segments,
+ *           and every frame's fpsr_*_eval() has the bits of its segment;
+ *         - with finalRandSwitch off, neighbouring segments hold different
+ *           values (below 2^24, where the float of an SM / TM state is
+ *           exact), so no change is reported that did not happen. The
+ *           per-frame check covers the other direction, including the asin()
+ *           band exit of QS, which skips frames;
+ *         - fpsr_*_next_change() from each segment's start and
+ *           fpsr_*_last_change() from its end return its bounds.
+ *     - Throughput: over --frames frames (10^8) of the sample presets and
+ *       of presets with long holds, the time to find every change by
+ *       evaluating each frame and comparing it with the previous one,
+ *       against enumerating the segments. Both must count the same output
+ *       changes. The sample presets change every few frames, so there the
+ *       gain is small; it grows with the hold length.
+ *
+ * Options: --frames N (100000000), --check-frames N (10000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_segments_bench.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h> // For int64_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_segments.h"
+
+#define FPSR_SEGMENTS_BENCH_CHUNK 4096 // segments per fpsr_*_segments() call
+#define FPSR_SEGMENTS_BENCH_EDGE 100000 // frames of the windows near INT_MIN / INT_MAX
+
+static const fpsr_sm_params SM_PRESETS[] = {
+    { 16, 24, 9, -41, 23, 1 }, // sample
+    { 16, 24, 9, -41, 23, 0 },
+    { 1, 6, 1, 5, -7, 0 }, // reseed every frame
+    { -3, 2, 4, 0, 0, 0 }, // durations below 1
+};
+static const fpsr_tm_params TM_PRESETS[] = {
+    { 10, 25, 30, 15, 0, 1 }, // sample
+    { 10, 25, 30, 15, 0, 0 },
+    { 3, 7, 11, -4, 9, 0 }, // odd switch period
+    { 0, 5, 1, 0, 0, 0 }, // periodA below 1, switch every frame
+};
+static const fpsr_qs_params QS_PRESETS[] = {
+    { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 }, // sample
+    { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 0 },
+    { 0.3f, -1.0f, { 2, 5 }, { -13, 7 }, { 3, -11 }, 0, 0, 0, 0 }, // fast, resolved durations
+    { 0.0007f, 1.7f, { 40, 200 }, { 5, -99 }, { 0, 0 }, 301, 97, 64, 0 }, // slow, many levels
+    { -0.05f, 2.0f, { 1, 1 }, { 0, 0 }, { 0, 0 }, 7, 3, 5, 0 }, // negative frequency, one level
+};
+
+// Long holds, for the throughput rows where changes are rare.
+static const fpsr_sm_params SM_LONG = { 2000, 5000, 10000, -41, 23, 1 };
+static const fpsr_tm_params TM_LONG = { 1500, 4000, 20000, 15, 0, 1 };
+
+#define FPSR_SEGMENTS_BENCH_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static volatile float fpsr_segments_bench_sink;
+
+static double fpsr_segments_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static int fpsr_segments_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+
+/******************************************************************************/
+/* Algorithms behind one interface                                            */
+/******************************************************************************/
+
+typedef struct fpsr_segments_bench_algo {
+    const char* name;
+    float (*eval)(const void* p, int frame);
+    size_t (*segments)(const void* p, int firstFrame, int lastFrame, fpsr_segment* out, size_t capacity);
+    int (*next)(const void* p, int frame, int lastFrame, int* changeFrame);
+    int (*last)(const void* p, int frame, int firstFrame, int* changeFrame);
+    int (*final)(const void* p);
+} fpsr_segments_bench_algo;
+
+#define FPSR_SEGMENTS_BENCH_ALGO(a)                                                                  \
+    static float a##_bench_eval(const void* p, int f) { return fpsr_##a##_eval(p, f); }              \
+    static size_t a##_bench_segments(const void* p, int f, int l, fpsr_segment* o, size_t c) {      \
+        return fpsr_##a##_segments(p, f, l, o, c);                                                   \
+    }                                                                                                \
+    static int a##_bench_next(const void* p, int f, int l, int* c) { return fpsr_##a##_next_change(p, f, l, c); } \
+    static int a##_bench_last(const void* p, int f, int l, int* c) { return fpsr_##a##_last_change(p, f, l, c); } \
+    static int a##_bench_final(const void* p) { return ((const fpsr_##a##_params*)p)->finalRandSwitch; } \
+    static const fpsr_segments_bench_algo a##_algo = {                                               \
+        #a, a##_bench_eval, a##_bench_segments, a##_bench_next, a##_bench_last, a##_bench_final      \
+    };
+
+FPSR_SEGMENTS_BENCH_ALGO(sm)
+FPSR_SEGMENTS_BENCH_ALGO(tm)
+FPSR_SEGMENTS_BENCH_ALGO(qs)
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+// Every frame of [first, last] against its segment; see the file comment.
+static long fpsr_segments_bench_window(const fpsr_segments_bench_algo* a, const void* p, int first, int last) {
+    static fpsr_segment seg[FPSR_SEGMENTS_BENCH_CHUNK];
+    const int final = a->final(p);
+    long errors = 0;
+    int64_t expect = first; // start of the next segment
+    int havePrev = 0;
+    float prev = 0.0f;
+    while (expect <= last) {
+        const size_t n = a->segments(p, (int)expect, last, seg, FPSR_SEGMENTS_BENCH_CHUNK);
+        if (n == 0) { return errors + 1; }
+        for (size_t k = 0; k < n; k++) {
+            const fpsr_segment* s = &seg[k];
+            if (s->start != expect || s->end < s->start || s->end > last) { return errors + 1; }
+            for (int64_t f = s->start; f <= s->end; f++) {
+                errors += !fpsr_segments_bench_same(a->eval(p, (int)f), s->value);
+            }
+            // Past 2^24 the float of distinct SM / TM states can coincide.
+            errors += !final && havePrev && s->start > -(1 << 24) && s->start < (1 << 24)
+                    && fpsr_segments_bench_same(prev, s->value);
+
+            int change;
+            const int more = a->next(p, s->start, last, &change);
+            errors += s->end < last ? (!more || change != s->end + 1) : more;
+            const int after = a->last(p, s->end, first, &change);
+            errors += s->start > first ? (!after || change != s->start) : (after || change != first);
+
+            havePrev = 1;
+            prev = s->value;
+            expect = (int64_t)s->end + 1;
+        }
+    }
+    return errors;
+}
+
+static int fpsr_segments_bench_check(const fpsr_segments_bench_algo* a, const void* p, int preset, int checkFrames) {
+    // Seeds and offsets of the presets stay below 400, so clocks stay inside int.
+    const int windows[3][2] = {
+        { -(checkFrames / 2), checkFrames - checkFrames / 2 - 1 },
+        { INT_MIN + 400, INT_MIN + 400 + FPSR_SEGMENTS_BENCH_EDGE - 1 },
+        { INT_MAX - 400 - FPSR_SEGMENTS_BENCH_EDGE + 1, INT_MAX - 400 },
+    };
+    long errors = 0;
+    for (int w = 0; w < 3; w++) { errors += fpsr_segments_bench_window(a, p, windows[w][0], windows[w][1]); }
+    printf("check %s preset %d: %s", a->name, preset, errors ? "DIFFER" : "same");
+    if (errors) { printf(" (%ld errors)", errors); }
+    printf("\n");
+    return errors != 0;
+}
+
+
+/******************************************************************************/
+/* Throughput                                                                 */
+/******************************************************************************/
+
+static void fpsr_segments_bench_speed(
+    const fpsr_segments_bench_algo* a, const void* p, const char* preset, int frames, int* failed)
+{
+    static fpsr_segment seg[FPSR_SEGMENTS_BENCH_CHUNK];
+    const int last = frames - 1;
+
+    double t0 = fpsr_segments_bench_now();
+    long bruteChanges = 0;
+    float prev = a->eval(p, 0);
+    for (int f = 1; f <= last; f++) {
+        const float v = a->eval(p, f);
+        bruteChanges += !fpsr_segments_bench_same(v, prev);
+        prev = v;
+    }
+    const double brute = fpsr_segments_bench_now() - t0;
+
+    t0 = fpsr_segments_bench_now();
+    long segments = 0, changes = 0;
+    int havePrev = 0;
+    for (int64_t start = 0; start <= last;) {
+        const size_t n = a->segments(p, (int)start, last, seg, FPSR_SEGMENTS_BENCH_CHUNK);
+        for (size_t k = 0; k < n; k++) {
+            changes += havePrev && !fpsr_segments_bench_same(prev, seg[k].value);
+            havePrev = 1;
+            prev = seg[k].value;
+        }
+        segments += (long)n;
+        start = (int64_t)seg[n - 1].end + 1;
+    }
+    const double enumerate = fpsr_segments_bench_now() - t0;
+    fpsr_segments_bench_sink = prev;
+
+    *failed |= changes != bruteChanges;
+    printf("%-4s %-7s %12.2f %12.4f %10.0fx %10ld %10ld %10ld  %s\n", a->name, preset, brute, enumerate, brute / enumerate,
+           bruteChanges, changes, segments, changes == bruteChanges ? "same" : "DIFFER");
+}
+
+int main(int argc, char** argv) {
+    long frames = 100000000, checkFrames = 10000000;
+    for (int i = 1; i < argc; i++) {
+        const int hasValue = i + 1 < argc;
+        if (hasValue && strcmp(argv[i], "--frames") == 0) { frames = strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--check-frames") == 0) { checkFrames = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--check-frames N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 2 || frames > 1000000000 || checkFrames < 1 || checkFrames > 1000000000) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < FPSR_SEGMENTS_BENCH_COUNT(SM_PRESETS); i++) {
+        failed |= fpsr_segments_bench_check(&sm_algo, &SM_PRESETS[i], (int)i, (int)checkFrames);
+    }
+    for (size_t i = 0; i < FPSR_SEGMENTS_BENCH_COUNT(TM_PRESETS); i++) {
+        failed |= fpsr_segments_bench_check(&tm_algo, &TM_PRESETS[i], (int)i, (int)checkFrames);
+    }
+    for (size_t i = 0; i < FPSR_SEGMENTS_BENCH_COUNT(QS_PRESETS); i++) {
+        failed |= fpsr_segments_bench_check(&qs_algo, &QS_PRESETS[i], (int)i, (int)checkFrames);
+    }
+
+    printf("\n%-4s %-7s %12s %12s %11s %10s %10s %10s\n", "alg", "preset", "per-frame s", "segments s", "speedup",
+           "changes", "seg chg", "segments");
+    fpsr_segments_bench_speed(&sm_algo, &SM_PRESETS[0], "sample", (int)frames, &failed);
+    fpsr_segments_bench_speed(&sm_algo, &SM_LONG, "long", (int)frames, &failed);
+    fpsr_segments_bench_speed(&tm_algo, &TM_PRESETS[0], "sample", (int)frames, &failed);
+    fpsr_segments_bench_speed(&tm_algo, &TM_LONG, "long", (int)frames, &failed);
+    fpsr_segments_bench_speed(&qs_algo, &QS_PRESETS[0], "sample", (int)frames, &failed);
+    fpsr_segments_bench_speed(&qs_algo, &QS_PRESETS[3], "slow", (int)frames, &failed);
+    printf("(frames 0 to %ld)\n", frames - 1);
+    return failed;
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_sine_lut.c
+ * @brief Baked sine lookup table backend for portable_rand() and the QS streams.
+ */
+
+#include "fpsr_sine_lut.h"
+
+#include <string.h> // For memcpy()
+
+#include "fpsr_sine_lut_table.inc"
+
+static const double FPSR_LUT_TWO_OVER_PI = 6.36619772367581382433e-01;
+
+double fpsr_sine_lut(double x, fpsr_sine_lod lod) {
+    const int shift = 2 * (int)lod;
+    const int64_t quarter = FPSR_SINE_LUT_QUARTER >> shift;
+
+    // Position in table cells; the scale is a power of two times 2/pi, so
+    // the product rounds the same everywhere.
+    double t = x * (FPSR_LUT_TWO_OVER_PI * (double)quarter);
+    int64_t cell = (int64_t)t;
+    if ((double)cell > t) { cell -= 1; } // floor() without libm
+    double frac = t - (double)cell;
+
+    uint64_t index = (uint64_t)cell & (uint64_t)(4 * quarter - 1);
+    int quadrant = (int)(index / (uint64_t)quarter);
+    int64_t pos = (int64_t)(index % (uint64_t)quarter);
+
+    // Mirror the quarter wave into the other three.
+    int64_t i0 = (quadrant & 1) ? quarter - pos : pos;
+    int64_t i1 = (quadrant & 1) ? i0 - 1 : i0 + 1;
+    double a = FPSR_SINE_LUT_TABLE[i0 << shift];
+    double b = FPSR_SINE_LUT_TABLE[i1 << shift];
+    double v = a + (b - a) * frac;
+    return (quadrant & 2) ? -v : v;
+}
+
+float fpsr_portable_rand_lut(int seed, fpsr_sine_lod lod) {
+    float val = (float)seed * 12.9898;
+    val = fpsr_wrap_two_pi(val);
+
+    float result = fpsr_sine_lut(val, lod) * 43758.5453f;
+
+    // result - floor(result), without libm; |result| < 43759 fits an int.
+    double whole = (double)(int)result;
+    if (whole > result) { whole -= 1.0; }
+    return result - whole;
+}
+
+// One function per level so they can be passed as fpsr_rand_fn / fpsr_sin_fn.
+static float fpsr_rand_lut_high(int seed) { return fpsr_portable_rand_lut(seed, FPSR_SINE_LOD_HIGH); }
+static float fpsr_rand_lut_medium(int seed) { return fpsr_portable_rand_lut(seed, FPSR_SINE_LOD_MEDIUM); }
+static float fpsr_rand_lut_low(int seed) { return fpsr_portable_rand_lut(seed, FPSR_SINE_LOD_LOW); }
+static double fpsr_sin_lut_high(double x) { return fpsr_sine_lut(x, FPSR_SINE_LOD_HIGH); }
+static double fpsr_sin_lut_medium(double x) { return fpsr_sine_lut(x, FPSR_SINE_LOD_MEDIUM); }
+static double fpsr_sin_lut_low(double x) { return fpsr_sine_lut(x, FPSR_SINE_LOD_LOW); }
+
+float fpsr_sm_lut(const fpsr_sm_params* p, int frame, fpsr_sine_lod lod) {
+    switch (lod) {
+    case FPSR_SINE_LOD_MEDIUM: return fpsr_sm_with(p, frame, fpsr_rand_lut_medium);
+    case FPSR_SINE_LOD_LOW: return fpsr_sm_with(p, frame, fpsr_rand_lut_low);
+    default: return fpsr_sm_with(p, frame, fpsr_rand_lut_high);
+    }
+}
+
+float fpsr_tm_lut(const fpsr_tm_params* p, int frame, fpsr_sine_lod lod) {
+    switch (lod) {
+    case FPSR_SINE_LOD_MEDIUM: return fpsr_tm_with(p, frame, fpsr_rand_lut_medium);
+    case FPSR_SINE_LOD_LOW: return fpsr_tm_with(p, frame, fpsr_rand_lut_low);
+    default: return fpsr_tm_with(p, frame, fpsr_rand_lut_high);
+    }
+}
+
+float fpsr_qs_lut(const fpsr_qs_params* p, int frame, fpsr_sine_lod lod) {
+    switch (lod) {
+    case FPSR_SINE_LOD_MEDIUM: return fpsr_qs_with(p, frame, fpsr_rand_lut_medium, fpsr_sin_lut_medium);
+    case FPSR_SINE_LOD_LOW: return fpsr_qs_with(p, frame, fpsr_rand_lut_low, fpsr_sin_lut_low);
+    default: return fpsr_qs_with(p, frame, fpsr_rand_lut_high, fpsr_sin_lut_high);
+    }
+}
+
+
+/******************************************************************************/
+/* Golden vectors                                                             */
+/******************************************************************************/
+
+// Recorded from this implementation on x86-64 (SSE2) and kept as raw IEEE
+// bits, so a mismatch means the build, not the data, has drifted.
+
+static const int FPSR_LUT_GOLDEN_SEEDS[8] = {
+    0, 1, -1, 17, 123456, -987654, 2147483647, -2147483647 - 1
+};
+
+static const uint32_t FPSR_LUT_GOLDEN_RAND[3][8] = {
+    { 0x00000000u, 0x3F6D0000u, 0x3D980000u, 0x3E800000u, 0x3DF00000u, 0x3E2C0000u, 0x3E000000u, 0x3F600000u },
+    { 0x00000000u, 0x3F6D0000u, 0x3D980000u, 0x3E740000u, 0x3DF80000u, 0x3E2C0000u, 0x3E0C0000u, 0x3F5D0000u },
+    { 0x00000000u, 0x3F6C8000u, 0x3D9C0000u, 0x3E300000u, 0x3E800000u, 0x3CE00000u, 0x3E9C0000u, 0x3F320000u },
+};
+
+static const double FPSR_LUT_GOLDEN_X[6] = {
+    0.0, 0.5, -1.25, 3.14159, 100.0, -12345.678
+};
+
+static const uint64_t FPSR_LUT_GOLDEN_SIN[3][6] = {
+    {
+        0x0000000000000000ull, 0x3FDEAEE86E2D14A2ull, 0xBFEE5E14F4B3F8ABull,
+        0x3EC6428A6179D880ull, 0xBFE03425B295A2A0ull, 0x3FE687D585D376BAull
+    },
+    {
+        0x0000000000000000ull, 0x3FDEAEE8572E19FAull, 0xBFEE5E14BBC1224Aull,
+        0x3EC64289D82A6200ull, 0xBFE03425921A0D7Dull, 0x3FE687D53D875B75ull
+    },
+    {
+        0x0000000000000000ull, 0x3FDEAEDEFEF8384Full, 0xBFEE5E0D6A170045ull,
+        0x3EC6428143341800ull, 0xBFE03420BE4FF03Full, 0x3FE687CFA5C2A74Cull
+    },
+};
+
+int fpsr_sine_lut_verify(void) {
+    int mismatches = 0;
+    for (int lod = 0; lod < 3; lod++) {
+        for (int i = 0; i < 8; i++) {
+            float v = fpsr_portable_rand_lut(FPSR_LUT_GOLDEN_SEEDS[i], (fpsr_sine_lod)lod);
+            uint32_t bits;
+            memcpy(&bits, &v, sizeof bits);
+            mismatches += (bits != FPSR_LUT_GOLDEN_RAND[lod][i]);
+        }
+        for (int i = 0; i < 6; i++) {
+            double v = fpsr_sine_lut(FPSR_LUT_GOLDEN_X[i], (fpsr_sine_lod)lod);
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof bits);
+            mismatches += (bits != FPSR_LUT_GOLDEN_SIN[lod][i]);
+        }
+    }
+    return mismatches;
+}
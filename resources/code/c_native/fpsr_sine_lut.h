@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_sine_lut.h
+ * @brief Baked sine lookup table backend for portable_rand() and the QS streams.
+ * @details This delivers the "baked sine curve" planned in the CHANGELOG without
+ * its initialize_sine_luts() step: the quarter-wave table is generated ahead of
+ * time (fpsr_sine_lut_gen.py) and compiled in as constant data, so there is no
+ * startup cost, no mutable global and nothing for two threads to race on.
+ *
+ * The table holds 4096 samples per quarter wave. Lower levels of detail read
+ * every 4th or 16th sample of the same table and interpolate linearly.
+ * Only IEEE additions and multiplications are used after the lookup, so results
+ * are bit-identical on every platform that evaluates double in double
+ * (SSE2, AArch64, ...; not x87) and does not contract to FMA.
+ *
+ * This is an alternative backend, not a drop-in for the reference: sin() from
+ * libm and the interpolated table differ in the last bits, and portable_rand()
+ * amplifies that by 43758, so the random values differ. Hold structure with
+ * finalRandSwitch off is unchanged for TM; SM and QS hold durations and levels
+ * are drawn from the LUT random values.
+ */
+
+#ifndef FPSR_SINE_LUT_H
+#define FPSR_SINE_LUT_H
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Samples per quarter wave at FPSR_SINE_LOD_HIGH. */
+#define FPSR_SINE_LUT_QUARTER 4096
+
+/**
+ * @brief Table resolution. Each step down reads a quarter of the samples.
+ */
+typedef enum fpsr_sine_lod {
+    FPSR_SINE_LOD_HIGH = 0, // 4096 samples per quarter wave
+    FPSR_SINE_LOD_MEDIUM = 1, // 1024 samples per quarter wave
+    FPSR_SINE_LOD_LOW = 2 // 256 samples per quarter wave
+} fpsr_sine_lod;
+
+/** @brief Linearly interpolated sin(x) from the baked table. */
+double fpsr_sine_lut(double x, fpsr_sine_lod lod);
+
+/** @brief portable_rand() with the table in place of fmod() + sin(). */
+float fpsr_portable_rand_lut(int seed, fpsr_sine_lod lod);
+
+/** @brief SM, TM and QS on the table backend. */
+float fpsr_sm_lut(const fpsr_sm_params* p, int frame, fpsr_sine_lod lod);
+float fpsr_tm_lut(const fpsr_tm_params* p, int frame, fpsr_sine_lod lod);
+float fpsr_qs_lut(const fpsr_qs_params* p, int frame, fpsr_sine_lod lod);
+
+/**
+ * @brief Checks this build against golden vectors recorded for the table backend.
+ * @return The number of mismatches; 0 means the build is bit-exact.
+ */
+int fpsr_sine_lut_verify(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_SINE_LUT_H
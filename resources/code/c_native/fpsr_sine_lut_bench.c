@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_sine_lut_bench.c
+ * @brief Golden-vector test and microbenchmark of the fpsr_sine_lut.h backend.
+ * @details Two parts:
+ *     - Golden vectors (the program exits 1 if one fails):
+ *         - fpsr_sine_lut_verify(), the hand-picked vectors in the library;
+ *         - per LOD, an FNV-1a digest of the output bits of
+ *           fpsr_portable_rand_lut() over seeds -2^20 to 2^20 - 1, of
+ *           fpsr_sine_lut() over 2^20 arguments spread across +-10^5, and of
+ *           fpsr_sm_lut(), fpsr_tm_lut() and fpsr_qs_lut() over frames 0 to
+ *           99999 of the sample presets. The digests were recorded on x86-64
+ *           (SSE2); any build that prints a different one is not bit-exact.
+ *     - Microbenchmark: ns per call of the libm path (fpsr_portable_rand(),
+ *       sin(), fpsr_*_eval()) against the table at each LOD, and the largest
+ *       difference between the table and sin() over the arguments above.
+ *
+ * Options: --count N (calls per timing, 2000000)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 fpsr_sine_lut_bench.c fpsr_sine_lut.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h> // For uint64_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol()
+#include <string.h> // For strcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_sine_lut.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static const char* const LODS[3] = { "high", "medium", "low" };
+static const char* const DIGEST_NAMES[5] = { "rand", "sine", "sm", "tm", "qs" };
+
+#define FPSR_SINE_LUT_BENCH_SEEDS (1 << 20) // on each side of 0
+#define FPSR_SINE_LUT_BENCH_ARGS (1 << 20)
+#define FPSR_SINE_LUT_BENCH_FRAMES 100000
+
+// Digests recorded on x86-64 (SSE2), [lod][rand, sine, sm, tm, qs].
+static const uint64_t FPSR_SINE_LUT_BENCH_GOLDEN[3][5] = {
+    { 0xA29E63ABF01123E7ull, 0x6195A4208ED4DBEAull, 0xA19431D0ECA6C9CEull,
+      0x085C6920AF3EFA0Full, 0x1A714CCF45174567ull },
+    { 0xCEF4AE37D59DFF8Aull, 0x779D0975B336B4B4ull, 0x16C4EF5966D54164ull,
+      0xFA71DBC9B5F3FD72ull, 0x091F6469958AA372ull },
+    { 0x4EC657B630F826E5ull, 0xEE33BBDF3A662A4Cull, 0x404F1745E088F884ull,
+      0x60953DC4500A574Cull, 0x9F17C8F920419A89ull },
+};
+
+static volatile double fpsr_sine_lut_bench_sink;
+
+static double fpsr_sine_lut_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+// Argument i of the sine digest and timings: 2^20 steps across +-10^5.
+static double fpsr_sine_lut_bench_arg(int i) {
+    return -1.0e5 + (double)i * (2.0e5 / FPSR_SINE_LUT_BENCH_ARGS);
+}
+
+
+/******************************************************************************/
+/* Golden vectors                                                             */
+/******************************************************************************/
+
+static uint64_t fpsr_sine_lut_bench_fnv(uint64_t h, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+static uint64_t fpsr_sine_lut_bench_digest(int which, fpsr_sine_lod lod) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    if (which == 0) {
+        for (int seed = -FPSR_SINE_LUT_BENCH_SEEDS; seed < FPSR_SINE_LUT_BENCH_SEEDS; seed++) {
+            const float v = fpsr_portable_rand_lut(seed, lod);
+            h = fpsr_sine_lut_bench_fnv(h, &v, sizeof v);
+        }
+    } else if (which == 1) {
+        for (int i = 0; i < FPSR_SINE_LUT_BENCH_ARGS; i++) {
+            const double v = fpsr_sine_lut(fpsr_sine_lut_bench_arg(i), lod);
+            h = fpsr_sine_lut_bench_fnv(h, &v, sizeof v);
+        }
+    } else {
+        for (int frame = 0; frame < FPSR_SINE_LUT_BENCH_FRAMES; frame++) {
+            const float v = which == 2 ? fpsr_sm_lut(&SM, frame, lod)
+                          : which == 3 ? fpsr_tm_lut(&TM, frame, lod)
+                                       : fpsr_qs_lut(&QS, frame, lod);
+            h = fpsr_sine_lut_bench_fnv(h, &v, sizeof v);
+        }
+    }
+    return h;
+}
+
+static int fpsr_sine_lut_bench_golden(void) {
+    const int verify = fpsr_sine_lut_verify();
+    int failed = verify != 0;
+    printf("fpsr_sine_lut_verify(): %d mismatches\n", verify);
+    for (int lod = 0; lod < 3; lod++) {
+        for (int which = 0; which < 5; which++) {
+            const uint64_t d = fpsr_sine_lut_bench_digest(which, (fpsr_sine_lod)lod);
+            const int same = d == FPSR_SINE_LUT_BENCH_GOLDEN[lod][which];
+            failed |= !same;
+            printf("digest %-6s %-4s 0x%016llXull %s\n", LODS[lod], DIGEST_NAMES[which], (unsigned long long)d,
+                   same ? "same" : "DIFFER");
+        }
+    }
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Microbenchmark                                                             */
+/******************************************************************************/
+
+// ns per call; lod -1 is the libm path.
+static double fpsr_sine_lut_bench_time(int which, int lod, long count) {
+    double acc = 0.0;
+    const double t0 = fpsr_sine_lut_bench_now();
+    for (long i = 0; i < count; i++) {
+        const int k = (int)(i & (FPSR_SINE_LUT_BENCH_ARGS - 1));
+        const int seed = (int)(i * 7919);
+        switch (which) {
+        case 0: acc += lod < 0 ? fpsr_portable_rand(seed) : fpsr_portable_rand_lut(seed, (fpsr_sine_lod)lod); break;
+        case 1: {
+            const double x = fpsr_sine_lut_bench_arg(k);
+            acc += lod < 0 ? sin(x) : fpsr_sine_lut(x, (fpsr_sine_lod)lod);
+            break;
+        }
+        case 2: acc += lod < 0 ? fpsr_sm_eval(&SM, (int)i) : fpsr_sm_lut(&SM, (int)i, (fpsr_sine_lod)lod); break;
+        case 3: acc += lod < 0 ? fpsr_tm_eval(&TM, (int)i) : fpsr_tm_lut(&TM, (int)i, (fpsr_sine_lod)lod); break;
+        default: acc += lod < 0 ? fpsr_qs_eval(&QS, (int)i) : fpsr_qs_lut(&QS, (int)i, (fpsr_sine_lod)lod); break;
+        }
+    }
+    fpsr_sine_lut_bench_sink = acc;
+    return (fpsr_sine_lut_bench_now() - t0) / (double)count;
+}
+
+static double fpsr_sine_lut_bench_error(fpsr_sine_lod lod) {
+    double worst = 0.0;
+    for (int i = 0; i < FPSR_SINE_LUT_BENCH_ARGS; i++) {
+        const double x = fpsr_sine_lut_bench_arg(i);
+        const double e = fabs(fpsr_sine_lut(x, lod) - sin(x));
+        if (e > worst) { worst = e; }
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    long count = 2000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--count") == 0) { count = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--count N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    const int failed = fpsr_sine_lut_bench_golden();
+
+    printf("\n%-6s %12s %12s %12s %12s\n", "call", "libm ns", "high ns", "medium ns", "low ns");
+    for (int which = 0; which < 5; which++) {
+        printf("%-6s", DIGEST_NAMES[which]);
+        for (int lod = -1; lod < 3; lod++) { printf(" %12.2f", fpsr_sine_lut_bench_time(which, lod, count)); }
+        printf("\n");
+    }
+    printf("%-19s", "max |lut - sin|");
+    for (int lod = 0; lod < 3; lod++) { printf(" %12.3g", fpsr_sine_lut_bench_error((fpsr_sine_lod)lod)); }
+    printf("\n(%ld calls per timing)\n", count);
+    return failed;
+}
@@ -0,0 +1,40 @@
+# SPDX-License-Identifier: MIT — See LICENSE for full terms
+# Created by Patrick Woo, 2025.
+# This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+# https://github.com/patwooky/fpsr
+
+'''
+file: fpsr_sine_lut_gen.py
+brief: Generates fpsr_sine_lut_table.inc, the baked quarter-wave sine table.
+details:
+    The table is checked in, so nothing has to run at build time or at
+    program startup. Re-run this only when FPSR_SINE_LUT_QUARTER changes:
+
+        python3 fpsr_sine_lut_gen.py > fpsr_sine_lut_table.inc
+
+    Values are written with repr(), which round-trips every double exactly,
+    so the table is bit-identical on every compiler that reads it.
+'''
+
+import math
+
+FPSR_SINE_LUT_QUARTER = 4096  # samples per quarter wave at the highest LOD
+
+
+def main():
+    n = FPSR_SINE_LUT_QUARTER
+    print("// Generated by fpsr_sine_lut_gen.py. Do not edit by hand.")
+    print("// sin(i * (pi / 2) / %d) for i = 0 .. %d." % (n, n))
+    print("static const double FPSR_SINE_LUT_TABLE[%d] = {" % (n + 1))
+    for i in range(0, n + 1, 4):
+        row = []
+        for j in range(i, min(i + 4, n + 1)):
+            # Pin the end points so the quadrant mirroring is exact.
+            v = 1.0 if j == n else math.sin(j * (math.pi / 2.0) / n)
+            row.append(repr(v))
+        print("    " + ", ".join(row) + ",")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_space.c
+ * @brief Grid evaluation of FPS-R in space.
+ * @details A fill runs in two passes over the rows of the grid, each on the
+ * same kind of pool: threads take blocks of tileRows rows from a shared
+ * atomic counter. The first pass writes the rows that start a (z hold,
+ * y hold) pair; the second copies them into every other row of the pair.
+ * The passes are separated by joining the threads, so a copy never reads a
+ * row that is still being written.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fpsr_space.h"
+
+#include <errno.h> // For errno
+#include <pthread.h> // For the worker threads
+#include <stdatomic.h> // For the row counter
+#include <stdint.h> // For uint32_t
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memcpy()
+#include <unistd.h> // For sysconf()
+
+#include "fpsr_hash.h" // For fpsr_hash_mix32()
+
+#define FPSR_SPACE_TILE_ROWS 16
+
+
+/******************************************************************************/
+/* Keys                                                                       */
+/******************************************************************************/
+
+static const fpsr_space_channel FPSR_SPACE_NO_CHANNEL = { FPSR_BAKE_SM, NULL, NULL, NULL };
+
+static int fpsr_space_channel_valid(const fpsr_space_channel* c) {
+    switch (c->algorithm) {
+    case FPSR_BAKE_SM: return c->sm != NULL;
+    case FPSR_BAKE_TM: return c->tm != NULL;
+    case FPSR_BAKE_QS: return c->qs != NULL;
+    }
+    return 0;
+}
+
+/** @brief The key of a channel at coord: the bits of its output (0 for a missing time channel). */
+static int fpsr_space_key(const fpsr_space_channel* c, int coord) {
+    float v;
+    switch (c->algorithm) {
+    case FPSR_BAKE_SM:
+        if (!c->sm) { return 0; }
+        v = fpsr_sm_eval(c->sm, coord);
+        break;
+    case FPSR_BAKE_TM: v = fpsr_tm_eval(c->tm, coord); break;
+    case FPSR_BAKE_QS: v = fpsr_qs_eval(c->qs, coord); break;
+    default: return 0;
+    }
+    int bits;
+    memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+/** @brief Folds one more key into a cell hash. */
+static inline uint32_t fpsr_space_fold(uint32_t h, int key) {
+    return fpsr_hash_mix32(h + (uint32_t)key);
+}
+
+/** @brief Hash of the time, z and y keys, shared by a whole row. */
+static inline uint32_t fpsr_space_row_hash(int timeKey, int zKey, int yKey) {
+    return fpsr_space_fold(fpsr_space_fold(fpsr_space_fold(0x9E3779B9u, timeKey), zKey), yKey);
+}
+
+static inline float fpsr_space_value(uint32_t rowHash, int xKey) {
+    return fpsr_portable_rand((int)(fpsr_space_fold(rowHash, xKey) >> 8));
+}
+
+static int fpsr_space_time_key(const fpsr_space_job* job) {
+    return fpsr_space_key(job->time ? job->time : &FPSR_SPACE_NO_CHANNEL, job->frame);
+}
+
+float fpsr_space_cell(const fpsr_space_job* job, int x, int y, int z) {
+    int zKey = job->dims == 3 ? fpsr_space_key(&job->axes[2], z) : 0;
+    uint32_t rowHash = fpsr_space_row_hash(fpsr_space_time_key(job), zKey, fpsr_space_key(&job->axes[1], y));
+    return fpsr_space_value(rowHash, fpsr_space_key(&job->axes[0], x));
+}
+
+
+/******************************************************************************/
+/* Pool                                                                       */
+/******************************************************************************/
+
+typedef struct fpsr_space_pool {
+    const fpsr_space_job* job;
+    float* out;
+    size_t width;
+    size_t height;
+    int timeKey;
+    const int* yKeys;
+    const int* zKeys;
+    const int* ySource; // first row of each row's y hold
+    const int* zSource; // first slab of each slab's z hold
+    const int* runStart; // x holds: runStart[r] .. runStart[r + 1] - 1
+    const int* runKey;
+    size_t runCount;
+    const size_t* rows; // the rows of the current pass, as k * height + j
+    size_t rowCount;
+    int copying; // 0: evaluate rows, 1: copy them
+    size_t tileRows;
+    _Atomic size_t next;
+} fpsr_space_pool;
+
+typedef struct fpsr_space_worker {
+    fpsr_space_pool* pool;
+    int started;
+    pthread_t thread;
+} fpsr_space_worker;
+
+static void fpsr_space_row(const fpsr_space_pool* pool, size_t row) {
+    size_t k = row / pool->height, j = row % pool->height;
+    float* dst = pool->out + row * pool->width;
+
+    if (pool->copying) {
+        size_t source = (size_t)pool->zSource[k] * pool->height + (size_t)pool->ySource[j];
+        memcpy(dst, pool->out + source * pool->width, pool->width * sizeof(float));
+        return;
+    }
+    uint32_t rowHash = fpsr_space_row_hash(pool->timeKey, pool->zKeys[k], pool->yKeys[j]);
+    for (size_t r = 0; r < pool->runCount; r++) {
+        float v = fpsr_space_value(rowHash, pool->runKey[r]);
+        for (int i = pool->runStart[r]; i < pool->runStart[r + 1]; i++) { dst[i] = v; }
+    }
+}
+
+static void* fpsr_space_work(void* arg) {
+    fpsr_space_pool* pool = ((fpsr_space_worker*)arg)->pool;
+    for (;;) {
+        size_t begin = atomic_fetch_add(&pool->next, pool->tileRows);
+        if (begin >= pool->rowCount) {
+            return NULL;
+        }
+        size_t end = begin + pool->tileRows < pool->rowCount ? begin + pool->tileRows : pool->rowCount;
+        for (size_t r = begin; r < end; r++) {
+            fpsr_space_row(pool, pool->rows[r]);
+        }
+    }
+}
+
+/** @brief Runs the current pass; the calling thread is worker 0. */
+static void fpsr_space_pass(fpsr_space_pool* pool, fpsr_space_worker* workers, int threads) {
+    atomic_store(&pool->next, 0);
+    for (int i = 0; i < threads; i++) { workers[i].pool = pool; }
+    for (int i = 1; i < threads; i++) {
+        workers[i].started = pthread_create(&workers[i].thread, NULL, fpsr_space_work, &workers[i]) == 0;
+    }
+    fpsr_space_work(&workers[0]);
+    for (int i = 1; i < threads; i++) {
+        if (workers[i].started) { pthread_join(workers[i].thread, NULL); }
+    }
+}
+
+
+/******************************************************************************/
+/* Entry point                                                                */
+/******************************************************************************/
+
+/** @brief Keys of the coordinates of one axis, and the first index of each hold. */
+static void fpsr_space_axis_keys(const fpsr_space_channel* c, int origin, int size, int* keys, int* source) {
+    for (int i = 0; i < size; i++) {
+        keys[i] = fpsr_space_key(c, origin + i);
+        source[i] = (i > 0 && keys[i] == keys[i - 1]) ? source[i - 1] : i;
+    }
+}
+
+int fpsr_space_fill(const fpsr_space_job* job, const fpsr_space_options* options, float* out) {
+    const fpsr_space_options none = { 0, 0 };
+    if (!options) { options = &none; }
+
+    const int dims = job->dims;
+    if (dims != 2 && dims != 3) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int a = 0; a < dims; a++) {
+        if (!fpsr_space_channel_valid(&job->axes[a]) || job->size[a] < 0 ||
+            (int64_t)job->origin[a] + job->size[a] - 1 > INT_MAX) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    if (job->time && !fpsr_space_channel_valid(job->time)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const size_t width = (size_t)job->size[0], height = (size_t)job->size[1];
+    const size_t depth = dims == 3 ? (size_t)job->size[2] : 1;
+    if (width == 0 || height == 0 || depth == 0) {
+        return 0;
+    }
+    if (height > SIZE_MAX / depth || height * depth > SIZE_MAX / sizeof(float) / width) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int threads = options->threads;
+    if (threads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    const size_t rowTotal = height * depth;
+    if ((size_t)threads > rowTotal) { threads = (int)rowTotal; }
+
+    int* runStart = (int*)malloc((width + 1) * sizeof(int));
+    int* runKey = (int*)malloc(width * sizeof(int));
+    int* yKeys = (int*)malloc(height * 2 * sizeof(int));
+    int* zKeys = (int*)malloc(depth * 2 * sizeof(int));
+    size_t* rows = (size_t*)malloc(rowTotal * sizeof(size_t));
+    fpsr_space_worker* workers = (fpsr_space_worker*)malloc((size_t)threads * sizeof(fpsr_space_worker));
+    if (!runStart || !runKey || !yKeys || !zKeys || !rows || !workers) {
+        free(runStart);
+        free(runKey);
+        free(yKeys);
+        free(zKeys);
+        free(rows);
+        free(workers);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // Hold boundaries, once per axis.
+    size_t runCount = 0;
+    for (size_t i = 0; i < width; i++) {
+        int key = fpsr_space_key(&job->axes[0], job->origin[0] + (int)i);
+        if (runCount == 0 || key != runKey[runCount - 1]) {
+            runStart[runCount] = (int)i;
+            runKey[runCount++] = key;
+        }
+    }
+    runStart[runCount] = (int)width;
+    fpsr_space_axis_keys(&job->axes[1], job->origin[1], (int)height, yKeys, yKeys + height);
+    if (dims == 3) {
+        fpsr_space_axis_keys(&job->axes[2], job->origin[2], (int)depth, zKeys, zKeys + depth);
+    } else {
+        zKeys[0] = 0;
+        zKeys[1] = 0;
+    }
+
+    fpsr_space_pool pool;
+    pool.job = job;
+    pool.out = out;
+    pool.width = width;
+    pool.height = height;
+    pool.timeKey = fpsr_space_time_key(job);
+    pool.yKeys = yKeys;
+    pool.zKeys = zKeys;
+    pool.ySource = yKeys + height;
+    pool.zSource = zKeys + depth;
+    pool.runStart = runStart;
+    pool.runKey = runKey;
+    pool.runCount = runCount;
+    pool.rows = rows;
+    pool.tileRows = options->tileRows > 0 ? (size_t)options->tileRows : FPSR_SPACE_TILE_ROWS;
+
+    // Pass 1: the first row of every (z hold, y hold) pair. Pass 2: the rest.
+    // Both lists are in memory order; the copies fill the back of the array.
+    size_t first = 0, copies = rowTotal;
+    for (size_t row = 0; row < rowTotal; row++) {
+        size_t k = row / height, j = row % height;
+        if ((size_t)pool.zSource[k] == k && (size_t)pool.ySource[j] == j) {
+            rows[first++] = row;
+        }
+    }
+    for (size_t row = rowTotal; row-- > 0;) {
+        size_t k = row / height, j = row % height;
+        if ((size_t)pool.zSource[k] != k || (size_t)pool.ySource[j] != j) {
+            rows[--copies] = row;
+        }
+    }
+
+    pool.copying = 0;
+    pool.rowCount = first;
+    fpsr_space_pass(&pool, workers, threads);
+    if (first < rowTotal) {
+        pool.copying = 1;
+        pool.rows = rows + first;
+        pool.rowCount = rowTotal - first;
+        fpsr_space_pass(&pool, workers, threads);
+    }
+
+    free(runStart);
+    free(runKey);
+    free(yKeys);
+    free(zKeys);
+    free(rows);
+    free(workers);
+    return 0;
+}
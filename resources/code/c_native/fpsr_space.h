@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_space.h
+ * @brief FPS-R in space: multi-threaded evaluation over 2D and 3D grids.
+ * @details Every axis of the grid (x, y and, in 3D, z) runs its own FPS-R
+ * channel with the cell coordinate in place of the frame, so each axis has
+ * its own hold durations and seeds. An optional time channel, evaluated at
+ * the frame, layers one more key on top, so the whole pattern holds and
+ * jumps over time like a single channel does.
+ *
+ * Each channel is evaluated exactly as fpsr_*_eval() (finalRandSwitch
+ * included), and its key is the IEEE bits of that output. With
+ * mix = fpsr_hash_mix32() and the keys T (time; 0 without a time channel),
+ * Z (0 in 2D), Y and X, a cell's value is
+ *
+ *     h = mix(mix(mix(mix(0x9E3779B9 + T) + Z) + Y) + X)   (uint32_t)
+ *     value = portable_rand((int)(h >> 8))                 in [0, 1)
+ *
+ * So a cell is a box whose edges fall where an axis output changes, and two
+ * cells share a value whenever all their axis outputs are equal.
+ *
+ * fpsr_space_fill() computes each axis' keys once per grid, so hold
+ * boundaries are found once per axis rather than once per cell, then:
+ *     - evaluates one row per distinct (z key, y key) pair, one hash per
+ *       x hold;
+ *     - copies that row wherever the same pair repeats (every row inside a
+ *       y hold, every slab inside a z hold).
+ * Both passes hand out blocks of rows to a pool of threads.
+ * fpsr_space_cell() evaluates one cell the slow way and is the reference the
+ * grid matches bit for bit.
+ *
+ * POSIX only (pthreads).
+ */
+
+#ifndef FPSR_SPACE_H
+#define FPSR_SPACE_H
+
+#include <stddef.h> // For size_t
+
+#include "fpsr_bake.h" // For fpsr_bake_algorithm
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief The channel of one axis. Set the preset matching algorithm; the others are ignored. */
+typedef struct fpsr_space_channel {
+    fpsr_bake_algorithm algorithm;
+    const fpsr_sm_params* sm;
+    const fpsr_tm_params* tm;
+    const fpsr_qs_params* qs;
+} fpsr_space_channel;
+
+/**
+ * @brief A grid to fill: cell (i, j, k) sits at coordinates
+ * (origin[0] + i, origin[1] + j, origin[2] + k).
+ */
+typedef struct fpsr_space_job {
+    int dims; // 2 or 3; in 2D, axes[2], origin[2] and size[2] are ignored
+    fpsr_space_channel axes[3]; // x, y, z
+    int origin[3];
+    int size[3];
+    const fpsr_space_channel* time; // NULL: the pattern does not change over time
+    int frame;
+} fpsr_space_job;
+
+/**
+ * @brief Scheduling knobs. Zero fields pick the defaults.
+ */
+typedef struct fpsr_space_options {
+    int threads; // default: online CPUs
+    int tileRows; // rows per block handed to a thread; default: 16
+} fpsr_space_options;
+
+/**
+ * @brief One cell at absolute coordinates (z is ignored in 2D).
+ */
+float fpsr_space_cell(const fpsr_space_job* job, int x, int y, int z);
+
+/**
+ * @brief Fills out[(k * size[1] + j) * size[0] + i] for the whole grid.
+ * @return 0 on success, -1 with errno EINVAL (invalid job) or ENOMEM.
+ */
+int fpsr_space_fill(const fpsr_space_job* job, const fpsr_space_options* options, float* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_SPACE_H
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_space_bench.c
+ * @brief Checks and Mcells/s benchmark of fpsr_space.h grids.
+ * @details Axis channels: x SM sample preset, y TM with finalRandSwitch off,
+ * z QS sample preset; time channel SM sample preset.
+ *     - Checks (the program exits 1 if one fails):
+ *         - rule: fpsr_space_cell() against the combination rule of
+ *           fpsr_space.h, written out here from fpsr_*_eval() outputs, at
+ *           10^5 random cells of the 2D and 3D jobs, with and without time;
+ *         - fill: fpsr_space_fill() against fpsr_space_cell() at every cell
+ *           of a 2D and a 3D grid, with 1 and --threads threads.
+ *     - Throughput: Mcells/s of fpsr_space_fill() for a --size2 square and a
+ *       --size3 cube at 1, 2, 4 .. --threads threads, against calling
+ *       fpsr_space_cell() for every cell, best of 3.
+ *
+ * Options: --size2 N (4096), --size3 N (256), --threads N (8)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 -pthread fpsr_space_bench.c fpsr_space.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h> // For uint32_t
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp(), memcpy() and memcmp()
+#include <time.h> // For clock_gettime()
+#include <unistd.h> // For sysconf()
+
+#include "fpsr_hash.h" // For fpsr_hash_mix32()
+#include "fpsr_space.h"
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM_RAW = { 10, 25, 30, 15, 0, 0 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static const fpsr_space_channel TIME = { FPSR_BAKE_SM, &SM, NULL, NULL };
+
+static volatile float fpsr_space_bench_sink;
+
+static double fpsr_space_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static fpsr_space_job fpsr_space_bench_job(int dims, int size, int timed) {
+    fpsr_space_job job;
+    memset(&job, 0, sizeof job);
+    job.dims = dims;
+    job.axes[0] = (fpsr_space_channel){ FPSR_BAKE_SM, &SM, NULL, NULL };
+    job.axes[1] = (fpsr_space_channel){ FPSR_BAKE_TM, NULL, &TM_RAW, NULL };
+    job.axes[2] = (fpsr_space_channel){ FPSR_BAKE_QS, NULL, NULL, &QS };
+    for (int a = 0; a < 3; a++) {
+        job.origin[a] = -size / 3 + 1000 * a;
+        job.size[a] = size;
+    }
+    job.time = timed ? &TIME : NULL;
+    job.frame = 4321;
+    return job;
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static uint32_t fpsr_space_bench_bits(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+// The combination rule of fpsr_space.h, from the channel outputs.
+static float fpsr_space_bench_rule(const fpsr_space_job* job, int x, int y, int z) {
+    const uint32_t t = job->time ? fpsr_space_bench_bits(fpsr_sm_eval(job->time->sm, job->frame)) : 0u;
+    const uint32_t zk = job->dims == 3 ? fpsr_space_bench_bits(fpsr_qs_eval(job->axes[2].qs, z)) : 0u;
+    const uint32_t yk = fpsr_space_bench_bits(fpsr_tm_eval(job->axes[1].tm, y));
+    const uint32_t xk = fpsr_space_bench_bits(fpsr_sm_eval(job->axes[0].sm, x));
+    uint32_t h = fpsr_hash_mix32(0x9E3779B9u + t);
+    h = fpsr_hash_mix32(h + zk);
+    h = fpsr_hash_mix32(h + yk);
+    h = fpsr_hash_mix32(h + xk);
+    return fpsr_portable_rand((int)(h >> 8));
+}
+
+static int fpsr_space_bench_check_rule(void) {
+    int failed = 0;
+    for (int dims = 2; dims <= 3; dims++) {
+        for (int timed = 0; timed < 2; timed++) {
+            const fpsr_space_job job = fpsr_space_bench_job(dims, 0, timed);
+            uint32_t state = 0x9E3779B9u;
+            long mismatches = 0;
+            for (int n = 0; n < 100000; n++) {
+                int c[3];
+                for (int a = 0; a < 3; a++) {
+                    state ^= state << 13;
+                    state ^= state >> 17;
+                    state ^= state << 5;
+                    c[a] = (int)(state % 2000001u) - 1000000;
+                }
+                const float a = fpsr_space_cell(&job, c[0], c[1], c[2]);
+                const float b = fpsr_space_bench_rule(&job, c[0], c[1], c[2]);
+                mismatches += memcmp(&a, &b, sizeof a) != 0;
+            }
+            printf("check rule %dD %-10s %s\n", dims, timed ? "with time" : "", mismatches ? "DIFFER" : "same");
+            failed |= mismatches != 0;
+        }
+    }
+    return failed;
+}
+
+static int fpsr_space_bench_check_fill(int maxThreads) {
+    const int sizes[2] = { 300, 48 };
+    int failed = 0;
+    for (int dims = 2; dims <= 3; dims++) {
+        const fpsr_space_job job = fpsr_space_bench_job(dims, sizes[dims - 2], 1);
+        const size_t depth = dims == 3 ? (size_t)job.size[2] : 1;
+        const size_t cells = (size_t)job.size[0] * (size_t)job.size[1] * depth;
+        float* out = (float*)malloc(cells * sizeof(float));
+        for (int threads = 1; threads <= maxThreads; threads = threads == 1 ? maxThreads : maxThreads + 1) {
+            const fpsr_space_options options = { threads, 0 };
+            long mismatches = !out || fpsr_space_fill(&job, &options, out) != 0;
+            for (size_t k = 0; !mismatches && k < depth; k++) {
+                for (int j = 0; j < job.size[1]; j++) {
+                    for (int i = 0; i < job.size[0]; i++) {
+                        const float a = out[(k * (size_t)job.size[1] + (size_t)j) * (size_t)job.size[0] + (size_t)i];
+                        const float b = fpsr_space_cell(&job, job.origin[0] + i, job.origin[1] + j, job.origin[2] + (int)k);
+                        mismatches += memcmp(&a, &b, sizeof a) != 0;
+                    }
+                }
+            }
+            printf("check fill %dD %d threads  %s\n", dims, threads, mismatches ? "DIFFER" : "same");
+            failed |= mismatches != 0;
+        }
+        free(out);
+    }
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Throughput                                                                 */
+/******************************************************************************/
+
+// Best of three runs, Mcells/s; threads 0 calls fpsr_space_cell() per cell.
+static double fpsr_space_bench_time(const fpsr_space_job* job, int threads, float* out) {
+    const size_t depth = job->dims == 3 ? (size_t)job->size[2] : 1;
+    const size_t cells = (size_t)job->size[0] * (size_t)job->size[1] * depth;
+    double best = 0.0;
+    for (int run = 0; run < 3; run++) {
+        const double t0 = fpsr_space_bench_now();
+        if (threads > 0) {
+            const fpsr_space_options options = { threads, 0 };
+            fpsr_space_fill(job, &options, out);
+        } else {
+            size_t n = 0;
+            for (size_t k = 0; k < depth; k++) {
+                for (int j = 0; j < job->size[1]; j++) {
+                    for (int i = 0; i < job->size[0]; i++) {
+                        out[n++] = fpsr_space_cell(job, job->origin[0] + i, job->origin[1] + j, job->origin[2] + (int)k);
+                    }
+                }
+            }
+        }
+        const double mcells = (double)cells / ((fpsr_space_bench_now() - t0) / 1e3);
+        if (run == 0 || mcells > best) { best = mcells; }
+        fpsr_space_bench_sink = out[cells - 1];
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    long size2 = 4096, size3 = 256, maxThreads = 8;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--size2") == 0) { size2 = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--size3") == 0) { size3 = strtol(argv[++i], NULL, 10); }
+        else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) { maxThreads = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--size2 N] [--size3 N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (size2 < 1 || size2 > 46340 || size3 < 1 || size3 > 1290 || maxThreads < 1 || maxThreads > 1024) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    int failed = fpsr_space_bench_check_rule();
+    failed |= fpsr_space_bench_check_fill((int)maxThreads);
+
+    const fpsr_space_job jobs[2] = { fpsr_space_bench_job(2, (int)size2, 1), fpsr_space_bench_job(3, (int)size3, 1) };
+    const size_t cells2 = (size_t)size2 * (size_t)size2, cells3 = (size_t)size3 * (size_t)size3 * (size_t)size3;
+    float* out = (float*)malloc((cells2 > cells3 ? cells2 : cells3) * sizeof(float));
+    if (!out) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("\n%-10s %14s %14s\n", "threads", "2D Mcells/s", "3D Mcells/s");
+    printf("%-10s %14.1f %14.1f\n", "per cell", fpsr_space_bench_time(&jobs[0], 0, out), fpsr_space_bench_time(&jobs[1], 0, out));
+    for (long threads = 1; threads <= maxThreads; threads *= 2) {
+        printf("%-10ld %14.1f %14.1f\n", threads, fpsr_space_bench_time(&jobs[0], (int)threads, out),
+               fpsr_space_bench_time(&jobs[1], (int)threads, out));
+    }
+    printf("(2D %ld x %ld, 3D %ld^3, with a time channel; %ld online CPUs, best of 3)\n", size2, size2, size3,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    free(out);
+    return failed;
+}
@@ -0,0 +1,633 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_stats.c
+ * @brief Parallel, hold-by-hold fingerprint of a preset.
+ * @details fpsr_segments.h reports changes of the hashed state, so two of its
+ * segments in a row can share an output; a task first merges them into runs
+ * of equal output (compared bit for bit), which is what the notebook counts.
+ *
+ * The lagged products are summed per pair of runs: frames t of run P and
+ * t + k of run R form min(P.end, R.end - k) - max(P.start, R.start - k) + 1
+ * pairs, a trapezoid in k. Its second differences are four terms, so each
+ * pair of runs within maxLag frames of each other costs O(1), and the task
+ * integrates them once at its end. A task owns the pairs whose later
+ * frame it owns, and walks maxLag frames of history before its first frame
+ * to see them; the runs of that window are kept in a small ring.
+ *
+ * Integer counts are accumulated per thread. Each task keeps its own sums
+ * and the runs touching its two ends; the reduction joins those runs across
+ * task boundaries and merges the sums in task order.
+ *
+ * The sums are shifted so that they do not cancel when the output is far
+ * from 0 (raw SM and TM states near INT_MAX, say): a task sums value - ref
+ * and its square, ref being its first output, and the reduction merges the
+ * tasks' counts, means and squared deviations with Chan's update. The lagged
+ * products all use the output at firstFrame as the shift, as the pairs
+ * straddle tasks. The correlation at lag k takes the moments of the first
+ * and last n - k frames from the whole range's by running Chan's update
+ * backwards on the k frames at either end, which are evaluated directly.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fpsr_stats.h"
+
+#include <errno.h> // For errno
+#include <limits.h> // For INT_MAX
+#include <math.h> // For sqrt()
+#include <pthread.h> // For the worker threads
+#include <stdatomic.h> // For the task counter
+#include <stdlib.h> // For malloc(), calloc() and free()
+#include <string.h> // For memcpy() and memset()
+#include <unistd.h> // For sysconf()
+
+#include "fpsr_segments.h"
+
+#define FPSR_STATS_MAX_HOLD 256
+#define FPSR_STATS_VALUE_BINS 64
+#define FPSR_STATS_MAX_LAG 32
+#define FPSR_STATS_TASK_FRAMES (1 << 20)
+#define FPSR_STATS_SEGMENT_BATCH 256
+
+
+/******************************************************************************/
+/* Accumulators                                                               */
+/******************************************************************************/
+
+/** @brief A run of equal output, [start, end] inclusive. */
+typedef struct fpsr_stats_span {
+    int start;
+    int end;
+    float value;
+} fpsr_stats_span;
+
+/** @brief The run touching one end of a task, clipped to the task. */
+typedef struct fpsr_stats_edge {
+    float value;
+    int64_t length;
+} fpsr_stats_edge;
+
+/** @brief What a task hands to the reduction. */
+typedef struct fpsr_stats_task {
+    fpsr_stats_edge first, last;
+    int single; // one run covers the whole task
+    int64_t jumps; // inside the task
+    float ref; // the task's first output
+    double sum, sumSquares; // of value - ref over the task's frames
+    float lowest, highest;
+    double* lagSums; // [maxLag + 1], sums of (x[t] - shift) * (x[t + k] - shift) over t + k in the task
+} fpsr_stats_task;
+
+/** @brief Integer counts, one set per thread. */
+typedef struct fpsr_stats_tally {
+    uint64_t* holdHistogram;
+    int64_t holds, holdSum, holdMin, holdMax;
+    uint64_t* valueHistogram;
+    uint64_t below, above;
+} fpsr_stats_tally;
+
+static inline int fpsr_stats_same(float a, float b) {
+    return memcmp(&a, &b, sizeof a) == 0;
+}
+
+static void fpsr_stats_add_hold(fpsr_stats_tally* tally, int maxHold, int64_t length) {
+    tally->holdHistogram[length < maxHold ? length : maxHold]++;
+    if (tally->holds == 0 || length < tally->holdMin) { tally->holdMin = length; }
+    if (tally->holds == 0 || length > tally->holdMax) { tally->holdMax = length; }
+    tally->holds++;
+    tally->holdSum += length;
+}
+
+/** @brief Frame count, mean and sum of squared deviations from the mean. */
+typedef struct fpsr_stats_moments {
+    double n, mean, m2;
+} fpsr_stats_moments;
+
+/** @brief Adds the frames of from to into (Chan et al.'s pairwise update). */
+static void fpsr_stats_merge_moments(fpsr_stats_moments* into, fpsr_stats_moments from) {
+    if (from.n <= 0.0) {
+        return;
+    }
+    const double n = into->n + from.n;
+    const double delta = from.mean - into->mean;
+    into->m2 += from.m2 + delta * delta * (into->n * from.n / n);
+    into->mean += delta * (from.n / n);
+    into->n = n;
+}
+
+/** @brief The moments of all once the frames of part are taken out: the update above run backwards. */
+static fpsr_stats_moments fpsr_stats_remove_moments(fpsr_stats_moments all, fpsr_stats_moments part) {
+    fpsr_stats_moments rest = { all.n - part.n, 0.0, 0.0 };
+    if (rest.n <= 0.0) {
+        return rest;
+    }
+    rest.mean = all.mean + (all.mean - part.mean) * (part.n / rest.n);
+    const double delta = part.mean - rest.mean;
+    rest.m2 = all.m2 - part.m2 - delta * delta * (rest.n * part.n / all.n);
+    if (rest.m2 < 0.0) { rest.m2 = 0.0; }
+    return rest;
+}
+
+static void fpsr_stats_merge_tally(fpsr_stats_tally* into, const fpsr_stats_tally* from, int maxHold, int valueBins) {
+    for (int i = 0; i <= maxHold; i++) { into->holdHistogram[i] += from->holdHistogram[i]; }
+    for (int i = 0; i < valueBins; i++) { into->valueHistogram[i] += from->valueHistogram[i]; }
+    if (from->holds > 0) {
+        if (into->holds == 0 || from->holdMin < into->holdMin) { into->holdMin = from->holdMin; }
+        if (into->holds == 0 || from->holdMax > into->holdMax) { into->holdMax = from->holdMax; }
+    }
+    into->holds += from->holds;
+    into->holdSum += from->holdSum;
+    into->below += from->below;
+    into->above += from->above;
+}
+
+
+/******************************************************************************/
+/* Thread pool                                                                */
+/******************************************************************************/
+
+typedef struct fpsr_stats_pool {
+    const fpsr_stats_job* job;
+    int maxHold, valueBins, maxLag;
+    float valueMin, valueMax;
+    double shift; // the output at firstFrame, taken off both factors of the lagged products
+    int64_t taskFrames;
+    size_t taskCount;
+    fpsr_stats_task* tasks;
+    _Atomic size_t next;
+} fpsr_stats_pool;
+
+typedef struct fpsr_stats_worker {
+    fpsr_stats_pool* pool;
+    fpsr_stats_tally tally;
+    fpsr_stats_span* window; // ring of the runs within maxLag frames, [maxLag + 2]
+    double* curvature; // second differences of the task's lagged sums, [maxLag + 1]
+    int started;
+    pthread_t thread;
+} fpsr_stats_worker;
+
+/** @brief State of the task being walked. */
+typedef struct fpsr_stats_walk {
+    fpsr_stats_worker* worker;
+    fpsr_stats_task* task;
+    int ownFirst; // first frame of the task; earlier frames are history
+    size_t windowHead, windowCount;
+    int64_t ownRuns;
+    fpsr_stats_edge previous; // the latest run of the task, not yet known to be interior
+} fpsr_stats_walk;
+
+static size_t fpsr_stats_segments(const fpsr_stats_job* job, int firstFrame, int lastFrame,
+                                  fpsr_segment* out, size_t capacity) {
+    switch (job->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_segments(job->sm, firstFrame, lastFrame, out, capacity);
+    case FPSR_BAKE_TM: return fpsr_tm_segments(job->tm, firstFrame, lastFrame, out, capacity);
+    case FPSR_BAKE_QS: return fpsr_qs_segments(job->qs, firstFrame, lastFrame, out, capacity);
+    }
+    return 0;
+}
+
+static float fpsr_stats_eval(const fpsr_stats_job* job, int frame) {
+    switch (job->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_eval(job->sm, frame);
+    case FPSR_BAKE_TM: return fpsr_tm_eval(job->tm, frame);
+    case FPSR_BAKE_QS: return fpsr_qs_eval(job->qs, frame);
+    }
+    return 0.0f;
+}
+
+/**
+ * @brief Whether every frame of [first, last] outputs the saturated SM / TM value.
+ * @details With finalRandSwitch on, every state beyond +-21474 hashes the
+ * same seed (fpsr_state_seed()). A state lies within one hold duration of
+ * seedOuter + frame, so where that clock stays further than the longest hold
+ * beyond the limit, the whole range is one run and needs no segments.
+ */
+static int fpsr_stats_saturated(const fpsr_stats_job* job, int64_t first, int64_t last, float* value) {
+    int64_t a, b, seedOuter;
+    if (job->algorithm == FPSR_BAKE_SM && job->sm->finalRandSwitch) {
+        a = job->sm->minHold;
+        b = job->sm->maxHold;
+        seedOuter = job->sm->seedOuter;
+    } else if (job->algorithm == FPSR_BAKE_TM && job->tm->finalRandSwitch) {
+        a = job->tm->periodA;
+        b = job->tm->periodB;
+        seedOuter = job->tm->seedOuter;
+    } else {
+        return 0;
+    }
+    const int64_t reach = (a < 0 ? -a : a) + (b < 0 ? -b : b) + 1; // more than any hold duration
+    if (seedOuter + first - reach > 21474 || seedOuter + last + reach < -21474) {
+        *value = fpsr_held_output(INT_MAX, 1);
+        return 1;
+    }
+    return 0;
+}
+
+/** @brief Adds one complete run to the task. */
+static void fpsr_stats_emit(fpsr_stats_walk* w, fpsr_stats_span run) {
+    const fpsr_stats_pool* pool = w->worker->pool;
+    fpsr_stats_task* task = w->task;
+    fpsr_stats_span* window = w->worker->window;
+    const size_t ring = (size_t)pool->maxLag + 2;
+
+    const int c = run.start > w->ownFirst ? run.start : w->ownFirst;
+    while (w->windowCount > 0 && (int64_t)window[w->windowHead].end < (int64_t)c - pool->maxLag) {
+        w->windowHead = (w->windowHead + 1) % ring;
+        w->windowCount--;
+    }
+    window[(w->windowHead + w->windowCount++) % ring] = run;
+    if (run.end < w->ownFirst) {
+        return; // history only
+    }
+
+    // Pairs (t, t + k) with t + k in the run's own frames [c, d]; first those
+    // with t in the run itself.
+    const int d = run.end;
+    const double v = (double)run.value - pool->shift;
+    for (int64_t k = 1; k <= pool->maxLag && k <= (int64_t)d - run.start; k++) {
+        const int64_t lo = run.start > c - k ? run.start : c - k;
+        task->lagSums[k] += v * v * (double)(d - k - lo + 1);
+    }
+    // With an earlier run P, the count is a trapezoid in k: 1 at k = c - P.end,
+    // rising by one per lag to min(|P|, d - c + 1), flat, and falling back to 1
+    // at k = d - P.start. Its second differences are integrated by the caller.
+    double* curvature = w->worker->curvature;
+    const int64_t ownLength = (int64_t)d - c + 1;
+    for (size_t i = 0; i + 1 < w->windowCount; i++) {
+        const fpsr_stats_span p = window[(w->windowHead + i) % ring];
+        const int64_t rise = (int64_t)c - p.end, fall = (int64_t)d - p.start;
+        const int64_t plateau = (int64_t)p.end - p.start + 1 < ownLength ? (int64_t)p.end - p.start + 1 : ownLength;
+        const double product = ((double)p.value - pool->shift) * v;
+        const int64_t at[4] = { rise, rise + plateau, fall - plateau + 2, fall + 2 };
+        const double by[4] = { product, -product, -product, product };
+        for (int j = 0; j < 4; j++) {
+            if (at[j] <= pool->maxLag) { curvature[at[j]] += by[j]; }
+        }
+    }
+
+    if (w->ownRuns == 0) { task->ref = run.value; }
+    const double y = (double)run.value - task->ref;
+    task->sum += y * (double)ownLength;
+    task->sumSquares += y * y * (double)ownLength;
+    if (w->ownRuns == 0 || run.value < task->lowest) { task->lowest = run.value; }
+    if (w->ownRuns == 0 || run.value > task->highest) { task->highest = run.value; }
+
+    fpsr_stats_tally* tally = &w->worker->tally;
+    if (run.value < pool->valueMin) {
+        tally->below += (uint64_t)ownLength;
+    } else if (run.value >= pool->valueMax) {
+        tally->above += (uint64_t)ownLength;
+    } else {
+        int bin = (int)((double)(run.value - pool->valueMin) / ((double)pool->valueMax - pool->valueMin) * pool->valueBins);
+        tally->valueHistogram[bin < pool->valueBins ? bin : pool->valueBins - 1] += (uint64_t)ownLength;
+    }
+
+    const fpsr_stats_edge edge = { run.value, ownLength };
+    if (w->ownRuns == 0) {
+        task->first = edge;
+    } else {
+        task->jumps++;
+        if (w->ownRuns > 1) { fpsr_stats_add_hold(tally, pool->maxHold, w->previous.length); }
+    }
+    w->previous = edge;
+    w->ownRuns++;
+}
+
+static void fpsr_stats_task_walk(fpsr_stats_worker* worker, size_t index) {
+    const fpsr_stats_pool* pool = worker->pool;
+    const fpsr_stats_job* job = pool->job;
+    const int64_t jobLast = (int64_t)job->firstFrame + job->frameCount - 1;
+    const int64_t ownFirst = (int64_t)job->firstFrame + (int64_t)index * pool->taskFrames;
+    const int64_t ownLast = ownFirst + pool->taskFrames - 1 < jobLast ? ownFirst + pool->taskFrames - 1 : jobLast;
+    const int64_t historyFirst = ownFirst - pool->maxLag > job->firstFrame ? ownFirst - pool->maxLag : job->firstFrame;
+
+    fpsr_stats_walk w;
+    memset(&w, 0, sizeof w);
+    w.worker = worker;
+    w.task = &pool->tasks[index];
+    w.ownFirst = (int)ownFirst;
+    memset(worker->curvature, 0, ((size_t)pool->maxLag + 1) * sizeof(double));
+
+    fpsr_segment batch[FPSR_STATS_SEGMENT_BATCH];
+    fpsr_stats_span pending = { (int)historyFirst, (int)ownLast, 0.0f };
+    int hasPending = fpsr_stats_saturated(job, historyFirst, ownLast, &pending.value);
+    for (int64_t from = hasPending ? ownLast + 1 : historyFirst; from <= ownLast;) {
+        size_t n = fpsr_stats_segments(job, (int)from, (int)ownLast, batch, FPSR_STATS_SEGMENT_BATCH);
+        if (n == 0) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (hasPending && fpsr_stats_same(pending.value, batch[i].value)) {
+                pending.end = batch[i].end;
+                continue;
+            }
+            if (hasPending) { fpsr_stats_emit(&w, pending); }
+            pending.start = batch[i].start;
+            pending.end = batch[i].end;
+            pending.value = batch[i].value;
+            hasPending = 1;
+        }
+        from = (int64_t)batch[n - 1].end + 1;
+    }
+    if (hasPending) { fpsr_stats_emit(&w, pending); }
+
+    double slope = 0.0, sum = 0.0;
+    for (int k = 1; k <= pool->maxLag; k++) {
+        slope += worker->curvature[k];
+        sum += slope;
+        w.task->lagSums[k] += sum;
+    }
+    w.task->last = w.previous;
+    w.task->single = w.ownRuns == 1;
+}
+
+static void* fpsr_stats_work(void* arg) {
+    fpsr_stats_worker* worker = (fpsr_stats_worker*)arg;
+    for (;;) {
+        size_t index = atomic_fetch_add(&worker->pool->next, 1);
+        if (index >= worker->pool->taskCount) {
+            return NULL;
+        }
+        fpsr_stats_task_walk(worker, index);
+    }
+}
+
+
+/******************************************************************************/
+/* Entry point                                                                */
+/******************************************************************************/
+
+/** @brief Frames in [0, n) that select QS stream 0, for a switch duration dur. */
+static int64_t fpsr_stats_qs_stream0_below(int64_t n, int64_t dur) {
+    const int64_t half = dur / 2, rest = n % dur;
+    return n / dur * half + (rest < half ? rest : half);
+}
+
+/** @brief Frames in [first, last] whose QS frame % streamSwitchDur selects stream 0. */
+static uint64_t fpsr_stats_qs_stream0(const fpsr_qs_params* p, int64_t first, int64_t last) {
+    const int64_t dur = fpsr_qs_resolve(*p).streamSwitchDur;
+    uint64_t count = 0;
+    if (first < 0) {
+        // C's % is <= 0 here, so stream 0 unless dur / 2 is 0.
+        const int64_t end = last < 0 ? last : -1;
+        if (dur / 2 > 0) { count += (uint64_t)(end - first + 1); }
+        first = 0;
+    }
+    if (last >= first) {
+        count += (uint64_t)(fpsr_stats_qs_stream0_below(last + 1, dur) - fpsr_stats_qs_stream0_below(first, dur));
+    }
+    return count;
+}
+
+static int fpsr_stats_alloc_tally(fpsr_stats_tally* t, int maxHold, int valueBins) {
+    memset(t, 0, sizeof *t);
+    t->holdHistogram = (uint64_t*)calloc((size_t)maxHold + 1, sizeof(uint64_t));
+    t->valueHistogram = (uint64_t*)calloc((size_t)valueBins, sizeof(uint64_t));
+    return t->holdHistogram && t->valueHistogram;
+}
+
+int fpsr_stats_run(const fpsr_stats_job* job, const fpsr_stats_options* options, fpsr_stats* stats) {
+    const fpsr_stats_options none = { 0, 0, 0, 0.0f, 0.0f, 0, 0 };
+    if (!options) { options = &none; }
+
+    const int valid = (job->algorithm == FPSR_BAKE_SM && job->sm) || (job->algorithm == FPSR_BAKE_TM && job->tm) ||
+                      (job->algorithm == FPSR_BAKE_QS && job->qs);
+    const int rangeSet = options->valueMin != 0.0f || options->valueMax != 0.0f;
+    if (!valid || job->frameCount < 1 || (int64_t)job->firstFrame + job->frameCount - 1 > INT_MAX ||
+        options->maxHold < 0 || options->valueBins < 0 || options->maxLag < 0 || options->taskFrames < 0 ||
+        (rangeSet && !(options->valueMax > options->valueMin))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fpsr_stats_pool pool;
+    pool.job = job;
+    pool.maxHold = options->maxHold > 0 ? options->maxHold : FPSR_STATS_MAX_HOLD;
+    pool.valueBins = options->valueBins > 0 ? options->valueBins : FPSR_STATS_VALUE_BINS;
+    pool.maxLag = options->maxLag > 0 ? options->maxLag : FPSR_STATS_MAX_LAG;
+    pool.valueMin = rangeSet ? options->valueMin : 0.0f;
+    pool.valueMax = rangeSet ? options->valueMax : 1.0f;
+    pool.taskFrames = options->taskFrames > 0 ? options->taskFrames : FPSR_STATS_TASK_FRAMES;
+    pool.taskCount = (size_t)((job->frameCount + pool.taskFrames - 1) / pool.taskFrames);
+    pool.shift = fpsr_stats_eval(job, job->firstFrame);
+    atomic_init(&pool.next, 0);
+
+    int threads = options->threads;
+    if (threads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if ((size_t)threads > pool.taskCount) { threads = (int)pool.taskCount; }
+
+    const size_t lags = (size_t)pool.maxLag + 1;
+    memset(stats, 0, sizeof *stats);
+    stats->autocorrelation = (double*)calloc(lags, sizeof(double));
+    pool.tasks = (fpsr_stats_task*)calloc(pool.taskCount, sizeof(fpsr_stats_task));
+    double* lagSums = (double*)calloc(pool.taskCount * lags, sizeof(double));
+    fpsr_stats_worker* workers = (fpsr_stats_worker*)calloc((size_t)threads, sizeof(fpsr_stats_worker));
+    fpsr_stats_tally total;
+    int ok = fpsr_stats_alloc_tally(&total, pool.maxHold, pool.valueBins) && stats->autocorrelation && pool.tasks &&
+             lagSums && workers;
+    for (int i = 0; ok && i < threads; i++) {
+        workers[i].pool = &pool;
+        workers[i].window = (fpsr_stats_span*)malloc((lags + 1) * sizeof(fpsr_stats_span));
+        workers[i].curvature = (double*)malloc(lags * sizeof(double));
+        ok = fpsr_stats_alloc_tally(&workers[i].tally, pool.maxHold, pool.valueBins) && workers[i].window &&
+             workers[i].curvature;
+    }
+
+    if (ok) {
+        for (size_t t = 0; t < pool.taskCount; t++) { pool.tasks[t].lagSums = lagSums + t * lags; }
+        for (int i = 1; i < threads; i++) {
+            workers[i].started = pthread_create(&workers[i].thread, NULL, fpsr_stats_work, &workers[i]) == 0;
+        }
+        fpsr_stats_work(&workers[0]);
+        for (int i = 1; i < threads; i++) {
+            if (workers[i].started) { pthread_join(workers[i].thread, NULL); }
+        }
+
+        for (int i = 0; i < threads; i++) { fpsr_stats_merge_tally(&total, &workers[i].tally, pool.maxHold, pool.valueBins); }
+
+        // Join the runs that cross task boundaries, and merge the sums in task order.
+        fpsr_stats_moments values = { 0.0, 0.0, 0.0 };
+        fpsr_stats_edge carry = pool.tasks[0].first;
+        int carryClipped = 1; // the run touching firstFrame is cut by the range
+        for (size_t t = 0; t < pool.taskCount; t++) {
+            const fpsr_stats_task* task = &pool.tasks[t];
+            if (t > 0) {
+                if (fpsr_stats_same(carry.value, task->first.value)) {
+                    carry.length += task->first.length;
+                } else {
+                    stats->jumps++;
+                    if (!carryClipped) { fpsr_stats_add_hold(&total, pool.maxHold, carry.length); }
+                    carry = task->first;
+                    carryClipped = 0;
+                }
+            }
+            if (!task->single) {
+                if (!carryClipped) { fpsr_stats_add_hold(&total, pool.maxHold, carry.length); }
+                carry = task->last;
+                carryClipped = 0;
+            }
+            stats->jumps += task->jumps;
+            const double frames = (double)(t + 1 < pool.taskCount ? pool.taskFrames
+                                                                  : job->frameCount - (int64_t)t * pool.taskFrames);
+            const double m2 = task->sumSquares - task->sum * task->sum / frames;
+            const fpsr_stats_moments own = { frames, (double)task->ref + task->sum / frames, m2 > 0.0 ? m2 : 0.0 };
+            fpsr_stats_merge_moments(&values, own);
+            for (size_t k = 0; k < lags; k++) { stats->autocorrelation[k] += task->lagSums[k]; }
+            if (t == 0 || task->lowest < stats->valueLowest) { stats->valueLowest = task->lowest; }
+            if (t == 0 || task->highest > stats->valueHighest) { stats->valueHighest = task->highest; }
+        }
+
+        const double n = (double)job->frameCount;
+        stats->algorithm = job->algorithm;
+        stats->firstFrame = job->firstFrame;
+        stats->frames = job->frameCount;
+        stats->jumpRate = job->frameCount > 1 ? (double)stats->jumps / (n - 1.0) : 0.0;
+        stats->holds = total.holds;
+        stats->holdMin = total.holdMin;
+        stats->holdMax = total.holdMax;
+        stats->holdMean = total.holds > 0 ? (double)total.holdSum / (double)total.holds : 0.0;
+        stats->maxHold = pool.maxHold;
+        stats->holdHistogram = total.holdHistogram;
+        stats->valueMean = values.mean;
+        stats->valueVariance = values.m2 / n;
+        stats->valueBins = pool.valueBins;
+        stats->valueMin = pool.valueMin;
+        stats->valueMax = pool.valueMax;
+        stats->valueHistogram = total.valueHistogram;
+        stats->valuesBelow = total.below;
+        stats->valuesAbove = total.above;
+        stats->maxLag = pool.maxLag;
+        // Lag k pairs frames [first, last - k] with [first + k, last]: the
+        // whole range less the k frames at its end or at its start.
+        fpsr_stats_moments head = { 0.0, 0.0, 0.0 }, tail = { 0.0, 0.0, 0.0 };
+        for (size_t k = 1; k < lags; k++) {
+            const int64_t pairs = job->frameCount - (int64_t)k;
+            if (pairs <= 0) {
+                stats->autocorrelation[k] = 0.0;
+                continue;
+            }
+            const fpsr_stats_moments first = { 1.0, fpsr_stats_eval(job, job->firstFrame + (int)k - 1), 0.0 };
+            const fpsr_stats_moments last = { 1.0, fpsr_stats_eval(job, (int)(job->firstFrame + pairs)), 0.0 };
+            fpsr_stats_merge_moments(&head, first);
+            fpsr_stats_merge_moments(&tail, last);
+            const fpsr_stats_moments from = fpsr_stats_remove_moments(values, tail);
+            const fpsr_stats_moments to = fpsr_stats_remove_moments(values, head);
+            const double cross = stats->autocorrelation[k] - (double)pairs * (from.mean - pool.shift) * (to.mean - pool.shift);
+            const double scale = sqrt(from.m2 * to.m2);
+            stats->autocorrelation[k] = scale > 0.0 ? cross / scale : 0.0;
+        }
+        stats->autocorrelation[0] = 1.0;
+        if (job->algorithm == FPSR_BAKE_QS) {
+            const int64_t last = (int64_t)job->firstFrame + job->frameCount - 1;
+            stats->qsStreamFrames[0] = fpsr_stats_qs_stream0(job->qs, job->firstFrame, last);
+            stats->qsStreamFrames[1] = (uint64_t)job->frameCount - stats->qsStreamFrames[0];
+        }
+    }
+
+    for (int i = 0; workers && i < threads; i++) {
+        free(workers[i].tally.holdHistogram);
+        free(workers[i].tally.valueHistogram);
+        free(workers[i].window);
+        free(workers[i].curvature);
+    }
+    free(workers);
+    free(lagSums);
+    free(pool.tasks);
+    if (!ok) {
+        free(total.holdHistogram);
+        free(total.valueHistogram);
+        free(stats->autocorrelation);
+        memset(stats, 0, sizeof *stats);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void fpsr_stats_free(fpsr_stats* stats) {
+    if (!stats) { return; }
+    free(stats->holdHistogram);
+    free(stats->valueHistogram);
+    free(stats->autocorrelation);
+    memset(stats, 0, sizeof *stats);
+}
+
+
+/******************************************************************************/
+/* Export                                                                     */
+/******************************************************************************/
+
+static const char* fpsr_stats_algorithm_name(fpsr_bake_algorithm algorithm) {
+    switch (algorithm) {
+    case FPSR_BAKE_SM: return "sm";
+    case FPSR_BAKE_TM: return "tm";
+    case FPSR_BAKE_QS: return "qs";
+    }
+    return "?";
+}
+
+/** @brief Bins of the hold histogram up to the last non-empty one. */
+static int fpsr_stats_hold_bins(const fpsr_stats* stats) {
+    int bins = stats->maxHold + 1;
+    while (bins > 1 && stats->holdHistogram[bins - 1] == 0) { bins--; }
+    return bins;
+}
+
+int fpsr_stats_write_json(const fpsr_stats* stats, FILE* out) {
+    fprintf(out, "{\"algorithm\":\"%s\",\"firstFrame\":%d,\"frames\":%lld,\"jumps\":%lld,\"jumpRate\":%.9g,",
+            fpsr_stats_algorithm_name(stats->algorithm), stats->firstFrame, (long long)stats->frames,
+            (long long)stats->jumps, stats->jumpRate);
+    fprintf(out, "\"holds\":{\"count\":%lld,\"min\":%lld,\"max\":%lld,\"mean\":%.9g,\"histogram\":[",
+            (long long)stats->holds, (long long)stats->holdMin, (long long)stats->holdMax, stats->holdMean);
+    const int holdBins = fpsr_stats_hold_bins(stats);
+    for (int i = 0; i < holdBins; i++) { fprintf(out, i ? ",%llu" : "%llu", (unsigned long long)stats->holdHistogram[i]); }
+    fprintf(out, "]},\"values\":{\"mean\":%.9g,\"variance\":%.9g,\"lowest\":%.9g,\"highest\":%.9g,"
+                 "\"range\":[%.9g,%.9g],\"below\":%llu,\"above\":%llu,\"histogram\":[",
+            stats->valueMean, stats->valueVariance, stats->valueLowest, stats->valueHighest, stats->valueMin,
+            stats->valueMax, (unsigned long long)stats->valuesBelow, (unsigned long long)stats->valuesAbove);
+    for (int i = 0; i < stats->valueBins; i++) {
+        fprintf(out, i ? ",%llu" : "%llu", (unsigned long long)stats->valueHistogram[i]);
+    }
+    fprintf(out, "]},\"autocorrelation\":[");
+    for (int k = 0; k <= stats->maxLag; k++) { fprintf(out, k ? ",%.6g" : "%.6g", stats->autocorrelation[k]); }
+    fprintf(out, "]");
+    if (stats->algorithm == FPSR_BAKE_QS) {
+        fprintf(out, ",\"qsStreamFrames\":[%llu,%llu]", (unsigned long long)stats->qsStreamFrames[0],
+                (unsigned long long)stats->qsStreamFrames[1]);
+    }
+    fprintf(out, "}\n");
+    return ferror(out) ? -1 : 0;
+}
+
+int fpsr_stats_write_csv(const fpsr_stats* stats, FILE* out) {
+    fprintf(out, "metric,index,value\n");
+    fprintf(out, "algorithm,,%s\n", fpsr_stats_algorithm_name(stats->algorithm));
+    fprintf(out, "first_frame,,%d\nframes,,%lld\njumps,,%lld\njump_rate,,%.9g\n", stats->firstFrame,
+            (long long)stats->frames, (long long)stats->jumps, stats->jumpRate);
+    fprintf(out, "holds,,%lld\nhold_min,,%lld\nhold_max,,%lld\nhold_mean,,%.9g\n", (long long)stats->holds,
+            (long long)stats->holdMin, (long long)stats->holdMax, stats->holdMean);
+    const int holdBins = fpsr_stats_hold_bins(stats);
+    for (int i = 1; i < holdBins; i++) {
+        fprintf(out, "hold_histogram,%d,%llu\n", i, (unsigned long long)stats->holdHistogram[i]);
+    }
+    fprintf(out, "value_mean,,%.9g\nvalue_variance,,%.9g\nvalue_lowest,,%.9g\nvalue_highest,,%.9g\n",
+            stats->valueMean, stats->valueVariance, stats->valueLowest, stats->valueHighest);
+    fprintf(out, "value_min,,%.9g\nvalue_max,,%.9g\nvalues_below,,%llu\nvalues_above,,%llu\n", stats->valueMin,
+            stats->valueMax, (unsigned long long)stats->valuesBelow, (unsigned long long)stats->valuesAbove);
+    for (int i = 0; i < stats->valueBins; i++) {
+        fprintf(out, "value_histogram,%d,%llu\n", i, (unsigned long long)stats->valueHistogram[i]);
+    }
+    for (int k = 1; k <= stats->maxLag; k++) { fprintf(out, "autocorrelation,%d,%.6g\n", k, stats->autocorrelation[k]); }
+    if (stats->algorithm == FPSR_BAKE_QS) {
+        fprintf(out, "qs_stream_frames,0,%llu\nqs_stream_frames,1,%llu\n", (unsigned long long)stats->qsStreamFrames[0],
+                (unsigned long long)stats->qsStreamFrames[1]);
+    }
+    return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_stats.h
+ * @brief Statistical fingerprint of a preset over a long frame range.
+ * @details The numbers the analysis notebook (_WIP/algo_data_analysis) plots
+ * when tuning a preset, computed natively over up to 2^32 frames:
+ *     - jumps and jump rate: frames whose output differs from the previous
+ *       frame's, as the notebook's `changed` flag;
+ *     - hold histogram: lengths of the runs of equal output between jumps.
+ *       The runs cut by the two ends of the range are left out, as their
+ *       lengths are not known;
+ *     - value histogram, mean, variance, min and max of the output;
+ *     - autocorrelation of the output for lags 1 .. maxLag: the correlation
+ *       of x[t] with x[t + k] over the frame pairs of the range, as pandas'
+ *       Series.autocorr(k), so always within [-1, 1];
+ *     - QS: the number of frames each stream is selected.
+ *
+ * The range is never walked frame by frame. It is cut into tasks, handed to
+ * a pool of threads, and each task is walked hold by hold with
+ * fpsr_segments.h; a hold adds its length to the histograms and its
+ * value, squared value and lagged products, weighted by how many frames or
+ * frame pairs it covers, to the sums. Holds that straddle two tasks are
+ * joined when the tasks are reduced, in frame order. The floating-point sums
+ * are shifted by a nearby output, so raw SM and TM states far from 0 keep
+ * their precision, and are reduced in task order too, so the result does not
+ * depend on the number of threads. fpsr_stats_bench.c checks the result
+ * against a frame-by-frame pass.
+ *
+ * Results are written as compact JSON or as CSV with fpsr_stats_write_*().
+ *
+ * POSIX only (pthreads).
+ */
+
+#ifndef FPSR_STATS_H
+#define FPSR_STATS_H
+
+#include <stdint.h> // For int64_t and uint64_t
+#include <stdio.h> // For FILE
+
+#include "fpsr_bake.h" // For fpsr_bake_algorithm
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief What to analyse. Set the preset matching algorithm; the others are ignored. */
+typedef struct fpsr_stats_job {
+    fpsr_bake_algorithm algorithm;
+    const fpsr_sm_params* sm;
+    const fpsr_tm_params* tm;
+    const fpsr_qs_params* qs;
+    int firstFrame;
+    int64_t frameCount; // the last frame, firstFrame + frameCount - 1, must fit in an int
+} fpsr_stats_job;
+
+/**
+ * @brief Histogram shapes and scheduling knobs. Zero fields pick the defaults.
+ */
+typedef struct fpsr_stats_options {
+    int threads; // default: online CPUs
+    int maxHold; // hold histogram bins 1 .. maxHold; the last also counts longer holds. Default: 256
+    int valueBins; // default: 64
+    float valueMin, valueMax; // value histogram range [valueMin, valueMax); default (both 0): [0, 1)
+    int maxLag; // default: 32
+    int taskFrames; // frames per task; default: 1 << 20
+} fpsr_stats_options;
+
+/** @brief A fingerprint. Arrays are owned by it; release with fpsr_stats_free(). */
+typedef struct fpsr_stats {
+    fpsr_bake_algorithm algorithm;
+    int firstFrame;
+    int64_t frames;
+
+    int64_t jumps;
+    double jumpRate; // jumps / (frames - 1)
+
+    int64_t holds; // runs counted in holdHistogram
+    int64_t holdMin, holdMax;
+    double holdMean;
+    int maxHold;
+    uint64_t* holdHistogram; // [maxHold + 1]: index = hold length, [maxHold] also counts longer holds, [0] is 0
+
+    double valueMean, valueVariance;
+    float valueLowest, valueHighest;
+    int valueBins;
+    float valueMin, valueMax;
+    uint64_t* valueHistogram; // [valueBins], frames per bin
+    uint64_t valuesBelow, valuesAbove; // frames outside [valueMin, valueMax)
+
+    int maxLag;
+    double* autocorrelation; // [maxLag + 1], [0] is 1
+
+    uint64_t qsStreamFrames[2]; // QS only: frames that selected stream 0 and stream 1
+} fpsr_stats;
+
+/**
+ * @brief Computes the fingerprint of job into stats.
+ * @return 0, or -1 with errno set (EINVAL for a bad job or options, ENOMEM).
+ */
+int fpsr_stats_run(const fpsr_stats_job* job, const fpsr_stats_options* options, fpsr_stats* stats);
+
+void fpsr_stats_free(fpsr_stats* stats);
+
+/**
+ * @brief Writes stats as one JSON object. Trailing empty bins of the hold
+ * histogram are left out.
+ * @return 0, or -1 if the stream reported an error.
+ */
+int fpsr_stats_write_json(const fpsr_stats* stats, FILE* out);
+
+/**
+ * @brief Writes stats as CSV rows of metric,index,value (index empty for scalars).
+ * @return 0, or -1 if the stream reported an error.
+ */
+int fpsr_stats_write_csv(const fpsr_stats* stats, FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_STATS_H
@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_stats_bench.c
+ * @brief Check and benchmark of fpsr_stats_run() against a frame-by-frame pass.
+ * @details For the sample SM, TM and QS presets over --frames frames from 0
+ * (mostly past the +-21474 state saturation of SM and TM) and from
+ * -frames / 2, and for SM and TM with finalRandSwitch off (raw states) over
+ * --frames frames from 2 * 10^9:
+ *     - frame by frame: every frame evaluated with fpsr_*_eval() and kept,
+ *       then the jumps, holds, histograms and stream split counted and the
+ *       mean, variance and autocorrelations computed in two passes around the
+ *       mean, the textbook way;
+ *     - fpsr_stats_run() with one thread and with --threads threads, both
+ *       with 4096-frame tasks so that holds and lag pairs straddle tasks.
+ * Checks (the program exits 1 if one fails):
+ *     - every count and histogram bin, the lowest and highest value and the
+ *       stream split are equal;
+ *     - the mean, the variance and each autocorrelation agree to 10^-9,
+ *       relative to the spread of the output for the mean;
+ *     - every autocorrelation lies in [-1, 1];
+ *     - the two thread counts give the same bits.
+ * The value histogram of the raw presets spans their lowest to highest value.
+ * Also prints ns per frame of each.
+ *
+ * Options: --frames N (1000000), --threads N (4)
+ *
+ * Build (POSIX):
+ *     cc -std=c11 -O2 -pthread fpsr_stats_bench.c fpsr_stats.c fpsr_segments.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h> // For fabs() and sqrt()
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_stats.h"
+
+#define FPSR_STATS_BENCH_TASK 4096 // frames per task
+#define FPSR_STATS_BENCH_RAW_FIRST 2000000000 // first frame of the raw presets
+#define FPSR_STATS_BENCH_TOLERANCE 1e-9
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_sm_params SM_RAW = { 16, 24, 9, -41, 23, 0 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_tm_params TM_RAW = { 10, 25, 30, 15, 0, 0 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+
+static double fpsr_stats_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+static int fpsr_stats_bench_same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+static float fpsr_stats_bench_eval(const fpsr_stats_job* job, int frame) {
+    switch (job->algorithm) {
+    case FPSR_BAKE_SM: return fpsr_sm_eval(job->sm, frame);
+    case FPSR_BAKE_TM: return fpsr_tm_eval(job->tm, frame);
+    case FPSR_BAKE_QS: return fpsr_qs_eval(job->qs, frame);
+    }
+    return 0.0f;
+}
+
+
+/******************************************************************************/
+/* Frame by frame                                                             */
+/******************************************************************************/
+
+/** @brief The fingerprint of job from every frame's value, with the histogram shapes of options. */
+static void fpsr_stats_bench_reference(const fpsr_stats_job* job, const fpsr_stats_options* o, float* x,
+                                       fpsr_stats* s) {
+    const int64_t n = job->frameCount;
+    const fpsr_qs_params qs = job->algorithm == FPSR_BAKE_QS ? fpsr_qs_resolve(*job->qs) : (fpsr_qs_params){ 0 };
+    for (int64_t t = 0; t < n; t++) { x[t] = fpsr_stats_bench_eval(job, job->firstFrame + (int)t); }
+
+    int64_t holdStart = 0, holdSum = 0;
+    int cut = 1; // the run at firstFrame is cut by the range
+    for (int64_t t = 0; t < n; t++) {
+        const float v = x[t];
+        if (t == 0 || v < s->valueLowest) { s->valueLowest = v; }
+        if (t == 0 || v > s->valueHighest) { s->valueHighest = v; }
+        if (v < o->valueMin) {
+            s->valuesBelow++;
+        } else if (v >= o->valueMax) {
+            s->valuesAbove++;
+        } else {
+            const int bin = (int)((double)(v - o->valueMin) / ((double)o->valueMax - o->valueMin) * o->valueBins);
+            s->valueHistogram[bin < o->valueBins ? bin : o->valueBins - 1]++;
+        }
+        if (t > 0 && !fpsr_stats_bench_same(v, x[t - 1])) {
+            s->jumps++;
+            if (!cut) {
+                const int64_t length = t - holdStart;
+                s->holdHistogram[length < o->maxHold ? length : o->maxHold]++;
+                if (s->holds == 0 || length < s->holdMin) { s->holdMin = length; }
+                if (s->holds == 0 || length > s->holdMax) { s->holdMax = length; }
+                s->holds++;
+                holdSum += length;
+            }
+            holdStart = t;
+            cut = 0;
+        }
+        if (job->algorithm == FPSR_BAKE_QS) {
+            s->qsStreamFrames[fpsr_qs_active_stream(&qs, job->firstFrame + (int)t)]++;
+        }
+    }
+    s->holdMean = s->holds > 0 ? (double)holdSum / (double)s->holds : 0.0;
+
+    double sum = 0.0;
+    for (int64_t t = 0; t < n; t++) { sum += x[t]; }
+    s->valueMean = sum / (double)n;
+    double m2 = 0.0;
+    for (int64_t t = 0; t < n; t++) { m2 += ((double)x[t] - s->valueMean) * ((double)x[t] - s->valueMean); }
+    s->valueVariance = m2 / (double)n;
+
+    // Lag k: the correlation of x[0 .. n - k) with x[k .. n).
+    s->autocorrelation[0] = 1.0;
+    for (int k = 1; k <= o->maxLag; k++) {
+        const int64_t pairs = n - k;
+        if (pairs <= 0) {
+            s->autocorrelation[k] = 0.0;
+            continue;
+        }
+        double a = 0.0, b = 0.0;
+        for (int64_t t = 0; t < pairs; t++) {
+            a += x[t];
+            b += x[t + k];
+        }
+        a /= (double)pairs;
+        b /= (double)pairs;
+        double cross = 0.0, aa = 0.0, bb = 0.0;
+        for (int64_t t = 0; t < pairs; t++) {
+            const double da = (double)x[t] - a, db = (double)x[t + k] - b;
+            cross += da * db;
+            aa += da * da;
+            bb += db * db;
+        }
+        s->autocorrelation[k] = aa > 0.0 && bb > 0.0 ? cross / sqrt(aa * bb) : 0.0;
+    }
+}
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static int fpsr_stats_bench_close(double a, double b, double scale) {
+    return fabs(a - b) <= FPSR_STATS_BENCH_TOLERANCE * scale;
+}
+
+/** @brief What differs between stats and the reference ref, printed; 0 if nothing. */
+static int fpsr_stats_bench_compare(const fpsr_stats* ref, const fpsr_stats* s) {
+    int failed = 0;
+#define FPSR_STATS_BENCH_EXPECT(ok, what)                                                                  \
+    do {                                                                                                   \
+        if (!(ok)) {                                                                                       \
+            printf("    %s differs\n", what);                                                          \
+            failed = 1;                                                                                    \
+        }                                                                                                  \
+    } while (0)
+    FPSR_STATS_BENCH_EXPECT(s->jumps == ref->jumps, "jumps");
+    FPSR_STATS_BENCH_EXPECT(s->holds == ref->holds && s->holdMin == ref->holdMin && s->holdMax == ref->holdMax,
+                            "hold count, min or max");
+    FPSR_STATS_BENCH_EXPECT(memcmp(s->holdHistogram, ref->holdHistogram, ((size_t)s->maxHold + 1) * sizeof(uint64_t)) == 0,
+                            "hold histogram");
+    FPSR_STATS_BENCH_EXPECT(fpsr_stats_bench_close(s->holdMean, ref->holdMean, ref->holdMean), "hold mean");
+    FPSR_STATS_BENCH_EXPECT(memcmp(s->valueHistogram, ref->valueHistogram, (size_t)s->valueBins * sizeof(uint64_t)) == 0 &&
+                                s->valuesBelow == ref->valuesBelow && s->valuesAbove == ref->valuesAbove,
+                            "value histogram");
+    FPSR_STATS_BENCH_EXPECT(fpsr_stats_bench_same(s->valueLowest, ref->valueLowest) &&
+                                fpsr_stats_bench_same(s->valueHighest, ref->valueHighest),
+                            "lowest or highest value");
+    FPSR_STATS_BENCH_EXPECT(s->qsStreamFrames[0] == ref->qsStreamFrames[0] && s->qsStreamFrames[1] == ref->qsStreamFrames[1],
+                            "stream split");
+    const double spread = sqrt(ref->valueVariance) + (ref->valueVariance == 0.0);
+    FPSR_STATS_BENCH_EXPECT(fpsr_stats_bench_close(s->valueMean, ref->valueMean, spread), "mean");
+    FPSR_STATS_BENCH_EXPECT(fpsr_stats_bench_close(s->valueVariance, ref->valueVariance, ref->valueVariance), "variance");
+    for (int k = 0; k <= s->maxLag; k++) {
+        char what[96];
+        snprintf(what, sizeof what, "autocorrelation %d (%.9f, frame by frame %.9f)", k, s->autocorrelation[k],
+                 ref->autocorrelation[k]);
+        FPSR_STATS_BENCH_EXPECT(fpsr_stats_bench_close(s->autocorrelation[k], ref->autocorrelation[k], 1.0), what);
+        snprintf(what, sizeof what, "autocorrelation %d out of [-1, 1] (%.9f)", k, s->autocorrelation[k]);
+        FPSR_STATS_BENCH_EXPECT(s->autocorrelation[k] >= -1.0 && s->autocorrelation[k] <= 1.0, what);
+    }
+#undef FPSR_STATS_BENCH_EXPECT
+    return failed;
+}
+
+/** @brief Whether two runs gave the same bits. */
+static int fpsr_stats_bench_identical(const fpsr_stats* a, const fpsr_stats* b) {
+    return a->jumps == b->jumps && a->holds == b->holds &&
+           memcmp(a->holdHistogram, b->holdHistogram, ((size_t)a->maxHold + 1) * sizeof(uint64_t)) == 0 &&
+           memcmp(a->valueHistogram, b->valueHistogram, (size_t)a->valueBins * sizeof(uint64_t)) == 0 &&
+           memcmp(&a->valueMean, &b->valueMean, sizeof a->valueMean) == 0 &&
+           memcmp(&a->valueVariance, &b->valueVariance, sizeof a->valueVariance) == 0 &&
+           memcmp(a->autocorrelation, b->autocorrelation, ((size_t)a->maxLag + 1) * sizeof(double)) == 0;
+}
+
+
+/******************************************************************************/
+/* Cases                                                                      */
+/******************************************************************************/
+
+static int fpsr_stats_bench_case(const char* name, const fpsr_stats_job* job, int threads, float* x) {
+    fpsr_stats_options options = { 1, 256, 64, 0.0f, 0.0f, 32, FPSR_STATS_BENCH_TASK };
+    fpsr_stats ref;
+    memset(&ref, 0, sizeof ref);
+    uint64_t holdBins[257] = { 0 }, valueBins[64] = { 0 };
+    double autocorrelation[33] = { 0.0 };
+    ref.holdHistogram = holdBins;
+    ref.valueHistogram = valueBins;
+    ref.autocorrelation = autocorrelation;
+
+    // Find the raw presets' range first, then bin over it.
+    const int raw = (job->algorithm == FPSR_BAKE_SM && !job->sm->finalRandSwitch) ||
+                    (job->algorithm == FPSR_BAKE_TM && !job->tm->finalRandSwitch);
+    fpsr_stats_options shape = options;
+    shape.valueMin = 0.0f;
+    shape.valueMax = 1.0f;
+    double t0 = fpsr_stats_bench_now();
+    fpsr_stats_bench_reference(job, &shape, x, &ref);
+    const double referenceNs = (fpsr_stats_bench_now() - t0) / (double)job->frameCount;
+    if (raw) {
+        options.valueMin = ref.valueLowest;
+        options.valueMax = ref.valueHighest;
+        shape = options;
+        memset(&ref, 0, sizeof ref);
+        memset(holdBins, 0, sizeof holdBins);
+        memset(valueBins, 0, sizeof valueBins);
+        ref.holdHistogram = holdBins;
+        ref.valueHistogram = valueBins;
+        ref.autocorrelation = autocorrelation;
+        fpsr_stats_bench_reference(job, &shape, x, &ref);
+    }
+
+    fpsr_stats one, many;
+    t0 = fpsr_stats_bench_now();
+    if (fpsr_stats_run(job, &options, &one) != 0) {
+        perror("fpsr_stats_run");
+        return 1;
+    }
+    const double oneNs = (fpsr_stats_bench_now() - t0) / (double)job->frameCount;
+    options.threads = threads;
+    t0 = fpsr_stats_bench_now();
+    if (fpsr_stats_run(job, &options, &many) != 0) {
+        perror("fpsr_stats_run");
+        fpsr_stats_free(&one);
+        return 1;
+    }
+    const double manyNs = (fpsr_stats_bench_now() - t0) / (double)job->frameCount;
+
+    const int identical = fpsr_stats_bench_identical(&one, &many);
+    printf("%-12s %11d %13.2f %11.2f %11.2f  %9.6f %9.6f  %s\n", name, job->firstFrame, referenceNs, oneNs, manyNs,
+           one.autocorrelation[1], one.autocorrelation[32], identical ? "same" : "DIFFER");
+    int failed = fpsr_stats_bench_compare(&ref, &one) | !identical;
+    fpsr_stats_free(&one);
+    fpsr_stats_free(&many);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    long frames = 1000000;
+    long threads = 4;
+    for (int i = 1; i < argc; i++) {
+        const int hasValue = i + 1 < argc;
+        if (hasValue && strcmp(argv[i], "--frames") == 0) { frames = strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--threads") == 0) { threads = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 64 || frames > 100000000 || threads < 1 || threads > 256) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+    float* x = (float*)malloc((size_t)frames * sizeof(float));
+    if (!x) {
+        perror("malloc");
+        return 1;
+    }
+
+    const int half = -(int)(frames / 2);
+    const fpsr_stats_job jobs[] = {
+        { FPSR_BAKE_SM, &SM, NULL, NULL, 0, frames },
+        { FPSR_BAKE_SM, &SM, NULL, NULL, half, frames },
+        { FPSR_BAKE_SM, &SM_RAW, NULL, NULL, FPSR_STATS_BENCH_RAW_FIRST, frames },
+        { FPSR_BAKE_TM, NULL, &TM, NULL, 0, frames },
+        { FPSR_BAKE_TM, NULL, &TM, NULL, half, frames },
+        { FPSR_BAKE_TM, NULL, &TM_RAW, NULL, FPSR_STATS_BENCH_RAW_FIRST, frames },
+        { FPSR_BAKE_QS, NULL, NULL, &QS, 0, frames },
+        { FPSR_BAKE_QS, NULL, NULL, &QS, half, frames },
+    };
+    const char* const names[] = { "sm", "sm", "sm raw", "tm", "tm", "tm raw", "qs", "qs" };
+
+    char label[32];
+    snprintf(label, sizeof label, "%ld thr ns", threads);
+    printf("%-12s %11s %13s %11s %11s  %9s %9s  %s\n", "preset", "first frame", "frame ns", "1 thr ns", label, "ac 1",
+           "ac 32", "threads");
+    int failed = 0;
+    for (size_t i = 0; i < sizeof jobs / sizeof jobs[0]; i++) {
+        failed |= fpsr_stats_bench_case(names[i], &jobs[i], (int)threads, x);
+    }
+    printf("(%ld frames, %d-frame tasks; ns per frame)\n%s\n", frames, FPSR_STATS_BENCH_TASK,
+           failed ? "checks FAILED" : "checks same");
+    free(x);
+    return failed;
+}
@@ -0,0 +1,392 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_time64.c
+ * @brief Batch SM, TM and QS over 64-bit frames and sub-frame ticks.
+ * @details Each algorithm has a cursor that keeps, for every value it has
+ * computed, the run of frames over which that value cannot change: the
+ * reseed or toggle block, the hold block, and for QS the stream switch and
+ * quant blocks. A frame inside all of them costs two compares. Leaving one
+ * costs a 64-bit division (fpsr_trunc_block(), and the toggle arithmetic of
+ * fpsr_segments.c), and portable_rand() only runs when a seed changes:
+ *     - SM: the duration seed changes once per reseed block and the held
+ *       state once per hold;
+ *     - TM: the held state changes once per hold;
+ *     - QS: each stream's level changes once per quant block. The sine of
+ *       the selected stream is the one left per frame (per tick on the tick
+ *       timeline, where the fraction moves it); the cursor gathers the
+ *       arguments of FPSR_QS_BLOCK frames and fpsr_qs_quantise_batch() takes
+ *       their sines in SIMD lanes. The finalRandSwitch rand of a quantised
+ *       value is kept in a small table, since a preset only produces a few
+ *       dozen of them.
+ * Every value still comes from the steps of fpsr_time64.h, so the output is
+ * bit-identical to fpsr_*_eval64() and fpsr_*_eval_ticks().
+ *
+ * SM frame ranges whose arithmetic fits an int go to the SIMD
+ * fpsr_sm_batch_frames() instead, which gives the same values there (under
+ * FPSR_TIME64_WIDE_STATE_SEED only while no state passes +-21474). QS ranges
+ * do too while their sine arguments stay within the lane sine of
+ * fpsr_batch.c. TM stays on its cursor, which is faster than the SIMD path.
+ */
+
+#include "fpsr_time64.h"
+#include "fpsr_batch.h"
+
+#include <stdlib.h> // For llabs()
+#include <string.h> // For memcpy() and memset()
+
+// Entries of the QS output table. A power of two.
+#define FPSR_QS_OUTPUT_CACHE 64
+
+// Frames whose QS arguments are gathered before their sines are taken.
+#define FPSR_QS_BLOCK 256
+
+// fpsr_batch.c's FPSR_LANE_SIN_LIMIT: its kernels send every value whose QS
+// sine arguments pass this back through fpsr_qs_eval(), one frame at a time.
+#define FPSR_QS_LANE_SIN_LIMIT 1.0e6
+
+
+/******************************************************************************/
+/* Helpers                                                                    */
+/******************************************************************************/
+
+static int64_t fpsr_min64(int64_t a, int64_t b) { return a < b ? a : b; }
+static int64_t fpsr_max64(int64_t a, int64_t b) { return a > b ? a : b; }
+
+static int fpsr_fits_int(int64_t v) { return v >= INT_MIN && v <= INT_MAX; }
+
+/*
+ * Whether offset + frame fits an int for every frame of [firstFrame,
+ * lastFrame], both of which fit an int. The int expressions that start with
+ * that sum stay between it and the offset, so they cannot overflow either.
+ */
+static int fpsr_offset_fits_int(int offset, int64_t firstFrame, int64_t lastFrame) {
+    return fpsr_fits_int(offset + firstFrame) && fpsr_fits_int(offset + lastFrame);
+}
+
+/*
+ * Whether fpsr_sm_batch_frames() gives the values of fpsr_sm_eval64() over
+ * the range: where no int step overflows, the 64-bit steps compute the same
+ * numbers. A held state lies between 0 and seedOuter + frame.
+ */
+static int fpsr_sm_int_path_matches(const fpsr_sm_params* p, int64_t firstFrame, size_t count) {
+    const int64_t lastFrame = firstFrame + (int64_t)count - 1;
+    if (count > (size_t)INT_MAX || !fpsr_fits_int(firstFrame) || !fpsr_fits_int(lastFrame)
+        || !fpsr_offset_fits_int(p->seedInner, firstFrame, lastFrame)
+        || !fpsr_offset_fits_int(p->seedOuter, firstFrame, lastFrame)
+        || !fpsr_fits_int((int64_t)p->maxHold - p->minHold)) {
+        return 0;
+    }
+#ifdef FPSR_TIME64_WIDE_STATE_SEED
+    return !p->finalRandSwitch || (p->seedOuter + firstFrame >= -21474 && p->seedOuter + lastFrame <= 21474);
+#else
+    return 1;
+#endif
+}
+
+/*
+ * The same for QS, which has no held state, and only while both sine
+ * arguments stay within FPSR_QS_LANE_SIN_LIMIT: past it the cursor, with one
+ * sine per frame, is several times faster.
+ */
+static int fpsr_qs_int_path_matches(const fpsr_qs_params* p, int64_t firstFrame, size_t count) {
+    const int64_t lastFrame = firstFrame + (int64_t)count - 1;
+    if (count > (size_t)INT_MAX || !fpsr_fits_int(firstFrame) || !fpsr_fits_int(lastFrame)) {
+        return 0;
+    }
+    for (int stream = 0; stream < 2; stream++) {
+        if (!fpsr_offset_fits_int(p->streamsOffset[stream], firstFrame, lastFrame)
+            || !fpsr_offset_fits_int(p->quantOffsets[stream], firstFrame, lastFrame)) {
+            return 0;
+        }
+        const double reach = (double)fpsr_max64(llabs(p->streamsOffset[stream] + firstFrame),
+                                                llabs(p->streamsOffset[stream] + lastFrame));
+        if (!(reach * fabs(fpsr_qs_frequency64(p, stream)) < FPSR_QS_LANE_SIN_LIMIT)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief The run of x over which (x % d) < onCount keeps its truth value.
+ * @details fpsr_toggle_run() of fpsr_segments.c over the whole 64-bit line.
+ * Negative x have residues in (-d, 0], which pass whenever residue 0 does.
+ */
+static void fpsr_toggle_run64(int64_t x, int64_t d, int64_t onCount, int64_t* lo, int64_t* hi) {
+    if (onCount <= 0 || onCount >= d) {
+        *lo = INT64_MIN;
+        *hi = INT64_MAX;
+        return;
+    }
+    if (x < 0) {
+        *lo = INT64_MIN;
+        *hi = onCount - 1;
+        return;
+    }
+    int64_t base = (x / d) * d;
+    if (x - base < onCount) {
+        *lo = (base == 0) ? INT64_MIN : base;
+        *hi = base + onCount - 1;
+    } else {
+        *lo = base + onCount;
+        *hi = base + d - 1;
+    }
+}
+
+/** @brief A run of x shifted into frame space (x = offset + frame), keeping unbounded ends. */
+static void fpsr_shift_run(int64_t offset, int64_t* lo, int64_t* hi) {
+    if (*lo != INT64_MIN) { *lo -= offset; }
+    if (*hi != INT64_MAX) { *hi -= offset; }
+}
+
+/******************************************************************************/
+/* Cursors                                                                    */
+/******************************************************************************/
+
+// Every run starts empty (lo > hi), so the first frame fills it.
+
+typedef struct fpsr_sm_cursor64 {
+    const fpsr_sm_params* p;
+    int64_t lo, hi; // frames over which value holds
+    int64_t reseedLo, reseedHi; // frames sharing durationSeed
+    int64_t holdLo, holdHi; // frames sharing heldState
+    int64_t durationSeed;
+    int64_t heldState;
+    int holdDuration; // 0 until the first seek
+    int haveState;
+    float value;
+} fpsr_sm_cursor64;
+
+static void fpsr_sm_cursor64_init(fpsr_sm_cursor64* c, const fpsr_sm_params* p) {
+    memset(c, 0, sizeof *c);
+    c->p = p;
+    c->lo = c->reseedLo = c->holdLo = 1;
+}
+
+static float fpsr_sm_cursor64_seek(fpsr_sm_cursor64* c, int64_t frame) {
+    const fpsr_sm_params* p = c->p;
+    if (frame < c->reseedLo || frame > c->reseedHi) {
+        const int64_t durationSeed = fpsr_sm_duration_seed64(p, frame);
+        fpsr_trunc_block(frame, p->reseedInterval < 1 ? 1 : p->reseedInterval, &c->reseedLo, &c->reseedHi);
+        if (c->holdDuration == 0 || durationSeed != c->durationSeed) {
+            const int holdDuration = fpsr_sm_hold_duration64(p, fpsr_portable_rand64(durationSeed));
+            if (holdDuration != c->holdDuration) {
+                c->holdLo = 1;
+                c->holdHi = 0;
+            }
+            c->durationSeed = durationSeed;
+            c->holdDuration = holdDuration;
+        }
+    }
+    if (frame < c->holdLo || frame > c->holdHi) {
+        const int64_t heldState = fpsr_held_state64(p->seedOuter, frame, c->holdDuration);
+        fpsr_trunc_block(p->seedOuter + frame, c->holdDuration, &c->holdLo, &c->holdHi);
+        fpsr_shift_run(p->seedOuter, &c->holdLo, &c->holdHi);
+        if (!c->haveState || heldState != c->heldState) {
+            c->heldState = heldState;
+            c->value = p->finalRandSwitch ? fpsr_portable_rand64(fpsr_state_seed64(heldState)) : (float)heldState;
+            c->haveState = 1;
+        }
+    }
+    c->lo = fpsr_max64(c->reseedLo, c->holdLo);
+    c->hi = fpsr_min64(c->reseedHi, c->holdHi);
+    return c->value;
+}
+
+static inline float fpsr_sm_cursor64_at(fpsr_sm_cursor64* c, int64_t frame) {
+    return (frame >= c->lo && frame <= c->hi) ? c->value : fpsr_sm_cursor64_seek(c, frame);
+}
+
+typedef struct fpsr_tm_cursor64 {
+    const fpsr_tm_params* p;
+    int64_t lo, hi; // frames over which value holds
+    int64_t heldState;
+    int haveState;
+    float value;
+} fpsr_tm_cursor64;
+
+static void fpsr_tm_cursor64_init(fpsr_tm_cursor64* c, const fpsr_tm_params* p) {
+    memset(c, 0, sizeof *c);
+    c->p = p;
+    c->lo = 1;
+}
+
+static float fpsr_tm_cursor64_seek(fpsr_tm_cursor64* c, int64_t frame) {
+    const fpsr_tm_params* p = c->p;
+    const int periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    const int holdDuration = fpsr_tm_hold_duration64(p, frame);
+    const int64_t heldState = fpsr_held_state64(p->seedOuter, frame, holdDuration);
+    if (!c->haveState || heldState != c->heldState) {
+        c->heldState = heldState;
+        c->value = p->finalRandSwitch ? fpsr_portable_rand64(fpsr_state_seed64(heldState)) : (float)heldState;
+        c->haveState = 1;
+    }
+    // (m < periodSwitch * 0.5) passes for the first ceil(periodSwitch / 2) residues.
+    int64_t ilo, ihi, olo, ohi;
+    fpsr_toggle_run64(p->seedInner + frame, periodSwitch, (periodSwitch + 1) / 2, &ilo, &ihi);
+    fpsr_shift_run(p->seedInner, &ilo, &ihi);
+    fpsr_trunc_block(p->seedOuter + frame, holdDuration, &olo, &ohi);
+    fpsr_shift_run(p->seedOuter, &olo, &ohi);
+    c->lo = fpsr_max64(ilo, olo);
+    c->hi = fpsr_min64(ihi, ohi);
+    return c->value;
+}
+
+static inline float fpsr_tm_cursor64_at(fpsr_tm_cursor64* c, int64_t frame) {
+    return (frame >= c->lo && frame <= c->hi) ? c->value : fpsr_tm_cursor64_seek(c, frame);
+}
+
+typedef struct fpsr_qs_cursor64 {
+    fpsr_qs_params r; // resolved
+    fpsr_wide_step wide[2];
+    int64_t streamLo, streamHi; // frames over which stream is selected
+    int stream;
+    int64_t quantLo[2], quantHi[2]; // frames over which quantLevel[s] holds
+    int quantLevel[2];
+    uint32_t outputKey[FPSR_QS_OUTPUT_CACHE]; // bits of active_stream_val + 1, 0 when empty
+    float output[FPSR_QS_OUTPUT_CACHE];
+} fpsr_qs_cursor64;
+
+static void fpsr_qs_cursor64_init(fpsr_qs_cursor64* c, const fpsr_qs_params* p) {
+    memset(c, 0, sizeof *c);
+    c->r = fpsr_qs_resolve(*p);
+    for (int stream = 0; stream < 2; stream++) {
+        c->wide[stream] = fpsr_wide_step_make(fpsr_qs_frequency64(&c->r, stream));
+        c->quantLo[stream] = 1;
+    }
+    c->streamLo = 1;
+}
+
+static float fpsr_qs_cursor64_output(fpsr_qs_cursor64* c, float active_stream_val) {
+    if (c->r.finalRandSwitch != 1) {
+        return fpsr_qs_output(active_stream_val, c->r.finalRandSwitch);
+    }
+    uint32_t bits;
+    memcpy(&bits, &active_stream_val, sizeof bits);
+    const uint32_t slot = (bits ^ (bits >> 15)) & (FPSR_QS_OUTPUT_CACHE - 1);
+    if (c->outputKey[slot] != bits + 1u) {
+        c->outputKey[slot] = bits + 1u;
+        c->output[slot] = fpsr_qs_output(active_stream_val, c->r.finalRandSwitch);
+    }
+    return c->output[slot];
+}
+
+// The sine argument of the stream selected at frame; its level goes to *quant_level.
+static double fpsr_qs_cursor64_arg(fpsr_qs_cursor64* c, int64_t frame, double fraction, int* quant_level) {
+    const fpsr_qs_params* r = &c->r;
+    if (frame < c->streamLo || frame > c->streamHi) {
+        c->stream = fpsr_qs_active_stream64(r, frame);
+        fpsr_toggle_run64(frame, r->streamSwitchDur, r->streamSwitchDur / 2, &c->streamLo, &c->streamHi);
+    }
+    const int stream = c->stream;
+    if (frame < c->quantLo[stream] || frame > c->quantHi[stream]) {
+        const int quantDur = stream ? r->stream2QuantDur : r->stream1QuantDur;
+        c->quantLevel[stream] = fpsr_qs_quant_level64(r, fpsr_portable_rand64(fpsr_qs_quant_seed64(r, stream, frame)));
+        fpsr_trunc_block(r->quantOffsets[stream] + frame, quantDur, &c->quantLo[stream], &c->quantHi[stream]);
+        fpsr_shift_run(r->quantOffsets[stream], &c->quantLo[stream], &c->quantHi[stream]);
+    }
+    *quant_level = c->quantLevel[stream];
+    return fpsr_qs_arg64(r, stream, frame, fraction, &c->wide[stream]);
+}
+
+/*
+ * Finishes a block of FPSR_QS_BLOCK frames or fewer from their arguments and
+ * levels. The wide phases are already reduced into (-2 pi, 2 pi), so the
+ * sines go through fpsr_batch.c's lanes, rounding check and libm fallback.
+ */
+static void fpsr_qs_cursor64_finish(fpsr_qs_cursor64* c, const double* arg, const int* quant_level, float* out, size_t n) {
+    fpsr_qs_quantise_batch(arg, quant_level, out, n);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = fpsr_qs_cursor64_output(c, out[i]);
+    }
+}
+
+
+/******************************************************************************/
+/* Public API                                                                 */
+/******************************************************************************/
+
+// SM and TM fill a whole run per seek; the run may end past the last frame.
+#define FPSR_FILL_RUN(cursor, firstFrame, out, count, i, value)                          \
+    do {                                                                                 \
+        const int64_t runEnd = (cursor).hi - ((firstFrame) + (int64_t)(i));              \
+        const size_t left = (count) - (i);                                               \
+        const size_t n = (runEnd >= 0 && (uint64_t)runEnd < left) ? (size_t)runEnd + 1 : left; \
+        for (size_t k = 0; k < n; k++) { (out)[(i) + k] = (value); }                     \
+        (i) += n;                                                                        \
+    } while (0)
+
+void fpsr_sm_batch_frames64(const fpsr_sm_params* params, int64_t firstFrame, float* out, size_t count) {
+    if (fpsr_sm_int_path_matches(params, firstFrame, count)) {
+        fpsr_sm_batch_frames(params, (int)firstFrame, out, count);
+        return;
+    }
+    fpsr_sm_cursor64 c;
+    fpsr_sm_cursor64_init(&c, params);
+    for (size_t i = 0; i < count;) {
+        const float value = fpsr_sm_cursor64_seek(&c, firstFrame + (int64_t)i);
+        FPSR_FILL_RUN(c, firstFrame, out, count, i, value);
+    }
+}
+
+void fpsr_tm_batch_frames64(const fpsr_tm_params* params, int64_t firstFrame, float* out, size_t count) {
+    fpsr_tm_cursor64 c;
+    fpsr_tm_cursor64_init(&c, params);
+    for (size_t i = 0; i < count;) {
+        const float value = fpsr_tm_cursor64_seek(&c, firstFrame + (int64_t)i);
+        FPSR_FILL_RUN(c, firstFrame, out, count, i, value);
+    }
+}
+
+void fpsr_qs_batch_frames64(const fpsr_qs_params* params, int64_t firstFrame, float* out, size_t count) {
+    if (fpsr_qs_int_path_matches(params, firstFrame, count)) {
+        fpsr_qs_batch_frames(params, (int)firstFrame, out, count);
+        return;
+    }
+    fpsr_qs_cursor64 c;
+    double arg[FPSR_QS_BLOCK];
+    int quantLevel[FPSR_QS_BLOCK];
+    fpsr_qs_cursor64_init(&c, params);
+    for (size_t offset = 0; offset < count; offset += FPSR_QS_BLOCK) {
+        const size_t n = (count - offset < FPSR_QS_BLOCK) ? count - offset : FPSR_QS_BLOCK;
+        for (size_t i = 0; i < n; i++) {
+            arg[i] = fpsr_qs_cursor64_arg(&c, firstFrame + (int64_t)(offset + i), 0.0, &quantLevel[i]);
+        }
+        fpsr_qs_cursor64_finish(&c, arg, quantLevel, out + offset, n);
+    }
+}
+
+void fpsr_sm_batch_ticks(const fpsr_sm_params* params, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count) {
+    fpsr_sm_cursor64 c;
+    fpsr_sm_cursor64_init(&c, params);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = fpsr_sm_cursor64_at(&c, fpsr_ticks_frame(firstTick + (int64_t)i * step));
+    }
+}
+
+void fpsr_tm_batch_ticks(const fpsr_tm_params* params, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count) {
+    fpsr_tm_cursor64 c;
+    fpsr_tm_cursor64_init(&c, params);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = fpsr_tm_cursor64_at(&c, fpsr_ticks_frame(firstTick + (int64_t)i * step));
+    }
+}
+
+void fpsr_qs_batch_ticks(const fpsr_qs_params* params, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count) {
+    fpsr_qs_cursor64 c;
+    double arg[FPSR_QS_BLOCK];
+    int quantLevel[FPSR_QS_BLOCK];
+    fpsr_qs_cursor64_init(&c, params);
+    for (size_t offset = 0; offset < count; offset += FPSR_QS_BLOCK) {
+        const size_t n = (count - offset < FPSR_QS_BLOCK) ? count - offset : FPSR_QS_BLOCK;
+        for (size_t i = 0; i < n; i++) {
+            const fpsr_ticks t = firstTick + (int64_t)(offset + i) * step;
+            arg[i] = fpsr_qs_cursor64_arg(&c, fpsr_ticks_frame(t), fpsr_ticks_fraction(t), &quantLevel[i]);
+        }
+        fpsr_qs_cursor64_finish(&c, arg, quantLevel, out + offset, n);
+    }
+}
@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_time64.h
+ * @brief FPS-R SM, TM and QS on a 64-bit and a fixed-point sub-frame timeline.
+ * @details The reference takes an int frame. seedOuter + frame overflows at
+ * 2^31, held_integer_state * 100000.0 stops fitting an int once the state
+ * passes 21474 (fpsr_state_seed() saturates it to INT_MIN, so every later
+ * hold gets the same final value), and the float in portable_rand() merges
+ * neighbouring seeds long before either. This header carries two timelines
+ * that do not:
+ *     - int64_t frames (fpsr_*_eval64()): the reference expressions with the
+ *       integer steps widened to 64 bits. Valid for |frame| < 2^62.
+ *     - fpsr_ticks, a signed 64-bit fixed-point frame with FPSR_SUBFRAME_BITS
+ *       fraction bits (fpsr_*_eval_ticks()). This is the CHANGELOG's planned
+ *       FPSR_INFLATION_FACTOR, made a power of two so splitting a tick into
+ *       frame and fraction is a shift and a mask. Valid for
+ *       |frame| < 2^(63 - FPSR_SUBFRAME_BITS), 2^47 by default.
+ *
+ * On every frame the 32-bit functions take, the 64-bit ones return the same
+ * bits: every seed that fits an int gets fpsr_portable_rand()'s value, every
+ * held state that fits an int gets the seed fpsr_state_seed() gives it,
+ * INT_MIN past +-21474 included, and a QS argument whose frame fits an int
+ * is the same float product. Beyond that:
+ *     - seeds outside the int range are hashed by fpsr_portable_rand64(),
+ *       which carries the phase seed * 12.9898 in double, in 21-bit pieces,
+ *       so distinct seeds stay distinct up to 2^63;
+ *     - a held state outside the int range becomes the 64-bit seed
+ *       state * 100000 (wrapping), so finalRandSwitch outputs move again
+ *       past 2^31 instead of staying on rand(INT_MIN). Define
+ *       FPSR_TIME64_WIDE_STATE_SEED to use that seed for every state past
+ *       +-21474 as well; the 64-bit functions then no longer match the
+ *       32-bit ones there;
+ *     - a QS sine argument whose frame does not fit an int is carried in
+ *       double the same way, so the streams still move every frame at 2^53
+ *       instead of in the 2^30-frame steps of a float argument.
+ *
+ * On the tick timeline SM and TM still hold whole frames (the planned
+ * inflation scales every duration with the frame), so their value at a tick
+ * is their value at the frame it falls in. QS keeps its quant blocks and
+ * stream switches on whole frames too, but its sines run continuously: the
+ * fraction of a frame advances the argument by fraction * frequency. At a
+ * whole tick every function equals its fpsr_*_eval64() value.
+ *
+ * QS only evaluates the stream selected at a frame, as fpsr_qs_stepper does;
+ * the other one never reaches the output.
+ */
+
+#ifndef FPSR_TIME64_H
+#define FPSR_TIME64_H
+
+#include <stddef.h> // For size_t
+
+#include "fpsr_native.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Fixed-point timeline                                                       */
+/******************************************************************************/
+
+/** @brief Fraction bits of a tick. Override with -DFPSR_SUBFRAME_BITS=n (0-30). */
+#ifndef FPSR_SUBFRAME_BITS
+#define FPSR_SUBFRAME_BITS 16
+#endif
+
+/** @brief Ticks per frame: the inflation factor of the sub-frame timeline. */
+#define FPSR_TICKS_PER_FRAME ((int64_t)1 << FPSR_SUBFRAME_BITS)
+
+/** @brief A point on the sub-frame timeline, in 1 / FPSR_TICKS_PER_FRAME frames. */
+typedef int64_t fpsr_ticks;
+
+/** @brief The tick at the start of frame. */
+static inline fpsr_ticks fpsr_ticks_from_frame(int64_t frame) {
+    return frame * FPSR_TICKS_PER_FRAME;
+}
+
+/** @brief The frame a tick falls in (rounded toward -infinity). */
+static inline int64_t fpsr_ticks_frame(fpsr_ticks t) {
+    return t < 0 ? ~(~t >> FPSR_SUBFRAME_BITS) : t >> FPSR_SUBFRAME_BITS;
+}
+
+/** @brief How far into its frame a tick is, in [0, 1). Exact. */
+static inline double fpsr_ticks_fraction(fpsr_ticks t) {
+    return (double)((uint64_t)t & (uint64_t)(FPSR_TICKS_PER_FRAME - 1)) * (1.0 / (double)FPSR_TICKS_PER_FRAME);
+}
+
+
+/******************************************************************************/
+/* Wide seeds and phases                                                      */
+/******************************************************************************/
+
+/**
+ * @brief x * w modulo 2 pi, for any int64_t x.
+ * @details x is split into 21-bit pieces, each multiplied by w reduced for
+ * its place value. The sum stays below 2^21 * (2 * 2 pi + |w|) and is then
+ * reduced into (-2 pi, 2 pi), keeping about 1e-8 of absolute precision
+ * wherever x is.
+ */
+typedef struct fpsr_wide_step {
+    double w; // per unit of x
+    double w21; // w * 2^21, reduced modulo 2 pi
+    double w42; // w * 2^42, reduced modulo 2 pi
+} fpsr_wide_step;
+
+static inline fpsr_wide_step fpsr_wide_step_make(double w) {
+    const double two_pi = 6.283185307179586;
+    fpsr_wide_step s;
+    s.w = w;
+    s.w21 = fmod(0x1p21 * w, two_pi);
+    s.w42 = fmod(0x1p21 * s.w21, two_pi);
+    return s;
+}
+
+static inline double fpsr_wide_phase(const fpsr_wide_step* s, int64_t x) {
+    uint64_t u = x < 0 ? (uint64_t)0 - (uint64_t)x : (uint64_t)x;
+    const double two_pi = 6.283185307179586;
+    double phase = (double)(u >> 42) * s->w42 + (double)((u >> 21) & 0x1FFFFF) * s->w21
+                 + (double)(u & 0x1FFFFF) * s->w;
+    phase -= (double)(int64_t)(phase * (1.0 / two_pi)) * two_pi;
+    return x < 0 ? -phase : phase;
+}
+
+/**
+ * @brief portable_rand() for an int64_t seed.
+ * @details Seeds that fit an int get fpsr_portable_rand() exactly, with the
+ * fmod() done by fpsr_wrap_two_pi(). Wider ones take sin(seed * 12.9898)
+ * with the product carried by fpsr_wide_phase() instead of a float.
+ */
+static inline float fpsr_portable_rand64(int64_t seed) {
+    double phase;
+    if (seed >= INT_MIN && seed <= INT_MAX) {
+        float val = (float)seed * 12.9898;
+        phase = fpsr_wrap_two_pi(val);
+    } else {
+        // fpsr_wide_step_make(12.9898), spelled out to keep fmod() off this path
+        static const fpsr_wide_step step = {12.9898, 0x1.71456cc416e80p+2, 0x1.79ce069befbc0p-1};
+        phase = fpsr_wide_phase(&step, seed);
+    }
+    float result = sin(phase) * 43758.5453f;
+    return result - floor(result);
+}
+
+/**
+ * @brief The seed fpsr_portable_rand64() gets for a held state.
+ * @details fpsr_state_seed() for every state that fits an int, state * 100000
+ * (wrapping) beyond; see the file comment for FPSR_TIME64_WIDE_STATE_SEED.
+ */
+static inline int64_t fpsr_state_seed64(int64_t held_integer_state) {
+#ifdef FPSR_TIME64_WIDE_STATE_SEED
+    if (held_integer_state >= -21474 && held_integer_state <= 21474) {
+#else
+    if (held_integer_state >= INT_MIN && held_integer_state <= INT_MAX) {
+#endif
+        return fpsr_state_seed((int)held_integer_state);
+    }
+    return (int64_t)((uint64_t)held_integer_state * 100000u);
+}
+
+
+/******************************************************************************/
+/* Steps on 64-bit frames                                                     */
+/******************************************************************************/
+
+// The intermediates of fpsr_native.h with 64-bit frames. Each one computes
+// the same expression as its 32-bit namesake.
+
+/** @brief Step 2 of SM and TM: the stable integer state for a hold duration. */
+static inline int64_t fpsr_held_state64(int seedOuter, int64_t frame, int holdDuration) {
+    return (seedOuter + frame) - ((seedOuter + frame) % holdDuration);
+}
+
+/** @brief Step 3 of SM and TM: the output for a held state. */
+static inline float fpsr_held_output64(int64_t held_integer_state, int finalRandSwitch) {
+    return finalRandSwitch ? fpsr_portable_rand64(fpsr_state_seed64(held_integer_state))
+                           : (float)held_integer_state;
+}
+
+/** @brief SM step 1: the seed of the hold duration in force at frame. */
+static inline int64_t fpsr_sm_duration_seed64(const fpsr_sm_params* p, int64_t frame) {
+    int reseedInterval = p->reseedInterval < 1 ? 1 : p->reseedInterval;
+    return p->seedInner + frame - (frame % reseedInterval);
+}
+
+/** @brief SM step 1: the hold duration for portable_rand() of the duration seed (always >= 1). */
+static inline int fpsr_sm_hold_duration64(const fpsr_sm_params* p, float rand_for_duration) {
+    int holdDuration = (int)floor(p->minHold + rand_for_duration * (p->maxHold - p->minHold));
+    return holdDuration < 1 ? 1 : holdDuration;
+}
+
+/** @brief TM step 1: the toggled hold duration in force at frame (always >= 1). */
+static inline int fpsr_tm_hold_duration64(const fpsr_tm_params* p, int64_t frame) {
+    int periodSwitch = p->periodSwitch < 1 ? 1 : p->periodSwitch;
+    int holdDuration = (((p->seedInner + frame) % periodSwitch) < (periodSwitch * 0.5)) ? p->periodA : p->periodB;
+    return holdDuration < 1 ? 1 : holdDuration;
+}
+
+/** @brief QS step 2: the quant block seed of stream at frame. @p r must be resolved. */
+static inline int64_t fpsr_qs_quant_seed64(const fpsr_qs_params* r, int stream, int64_t frame) {
+    int quantDur = stream ? r->stream2QuantDur : r->stream1QuantDur;
+    return (r->quantOffsets[stream] + frame) - ((r->quantOffsets[stream] + frame) % quantDur);
+}
+
+/** @brief QS step 2: the quantisation level for portable_rand() of the quant seed. @p r must be resolved. */
+static inline int fpsr_qs_quant_level64(const fpsr_qs_params* r, float rand_for_quant) {
+    int quant_range = r->quantLevelsMinMax[1] - r->quantLevelsMinMax[0] + 1;
+    int quant_level = r->quantLevelsMinMax[0] + (int)floor(rand_for_quant * quant_range);
+    return quant_level < 1 ? 1 : quant_level;
+}
+
+/** @brief The phase advance of stream per frame. @p r must be resolved. */
+static inline double fpsr_qs_frequency64(const fpsr_qs_params* r, int stream) {
+    return stream ? (double)r->baseWaveFreq * r->stream2FreqMult : (double)r->baseWaveFreq;
+}
+
+/**
+ * @brief QS step 3: the sine argument of stream at frame + fraction.
+ * @details The reference float product while the frame fits an int,
+ * fpsr_wide_phase() beyond. @p wide is fpsr_wide_step_make() of
+ * fpsr_qs_frequency64(), or NULL to build it when it is needed.
+ * @p r must be resolved.
+ */
+static inline double fpsr_qs_arg64(
+    const fpsr_qs_params* r, int stream, int64_t frame, double fraction, const fpsr_wide_step* wide)
+{
+    int64_t x = r->streamsOffset[stream] + frame;
+    double arg;
+    if (x >= INT_MIN && x <= INT_MAX) {
+        arg = stream ? (float)x * r->baseWaveFreq * r->stream2FreqMult : (float)x * r->baseWaveFreq;
+    } else if (wide) {
+        arg = fpsr_wide_phase(wide, x);
+    } else {
+        const fpsr_wide_step made = fpsr_wide_step_make(fpsr_qs_frequency64(r, stream));
+        arg = fpsr_wide_phase(&made, x);
+    }
+    if (fraction != 0.0) {
+        arg += fraction * fpsr_qs_frequency64(r, stream);
+    }
+    return arg;
+}
+
+/** @brief QS step 3: the quantised value of a stream for its argument. */
+static inline float fpsr_qs_quantise64(double arg, int quant_level) {
+    return floor((sin(arg) / 2.0 + 0.5) * quant_level) / (float)quant_level;
+}
+
+/** @brief QS step 4: index (0 or 1) of the stream selected at frame. @p r must be resolved. */
+static inline int fpsr_qs_active_stream64(const fpsr_qs_params* r, int64_t frame) {
+    return ((frame % r->streamSwitchDur) < r->streamSwitchDur / 2) ? 0 : 1;
+}
+
+
+/******************************************************************************/
+/* Scalar entry points                                                        */
+/******************************************************************************/
+
+/** @brief fpsr_sm_eval() on a 64-bit frame. */
+static inline float fpsr_sm_eval64(const fpsr_sm_params* p, int64_t frame) {
+    int holdDuration = fpsr_sm_hold_duration64(p, fpsr_portable_rand64(fpsr_sm_duration_seed64(p, frame)));
+    return fpsr_held_output64(fpsr_held_state64(p->seedOuter, frame, holdDuration), p->finalRandSwitch);
+}
+
+/** @brief fpsr_tm_eval() on a 64-bit frame. */
+static inline float fpsr_tm_eval64(const fpsr_tm_params* p, int64_t frame) {
+    int64_t held_integer_state = fpsr_held_state64(p->seedOuter, frame, fpsr_tm_hold_duration64(p, frame));
+    return fpsr_held_output64(held_integer_state, p->finalRandSwitch);
+}
+
+/** @brief fpsr_qs_eval() at frame + fraction, fraction in [0, 1). */
+static inline float fpsr_qs_eval64_at(const fpsr_qs_params* p, int64_t frame, double fraction) {
+    const fpsr_qs_params r = fpsr_qs_resolve(*p);
+    int stream = fpsr_qs_active_stream64(&r, frame);
+    int quant_level = fpsr_qs_quant_level64(&r, fpsr_portable_rand64(fpsr_qs_quant_seed64(&r, stream, frame)));
+    float active_stream_val = fpsr_qs_quantise64(fpsr_qs_arg64(&r, stream, frame, fraction, NULL), quant_level);
+    return fpsr_qs_output(active_stream_val, r.finalRandSwitch);
+}
+
+/** @brief fpsr_qs_eval() on a 64-bit frame. */
+static inline float fpsr_qs_eval64(const fpsr_qs_params* p, int64_t frame) {
+    return fpsr_qs_eval64_at(p, frame, 0.0);
+}
+
+/** @brief SM at a tick: the value of the frame it falls in. */
+static inline float fpsr_sm_eval_ticks(const fpsr_sm_params* p, fpsr_ticks t) {
+    return fpsr_sm_eval64(p, fpsr_ticks_frame(t));
+}
+
+/** @brief TM at a tick: the value of the frame it falls in. */
+static inline float fpsr_tm_eval_ticks(const fpsr_tm_params* p, fpsr_ticks t) {
+    return fpsr_tm_eval64(p, fpsr_ticks_frame(t));
+}
+
+/** @brief QS at a tick, with the stream sines advanced by the fraction of the frame. */
+static inline float fpsr_qs_eval_ticks(const fpsr_qs_params* p, fpsr_ticks t) {
+    return fpsr_qs_eval64_at(p, fpsr_ticks_frame(t), fpsr_ticks_fraction(t));
+}
+
+
+/******************************************************************************/
+/* Batch                                                                      */
+/******************************************************************************/
+
+/**
+ * @brief One entity over 64-bit frames: out[i] is the value at firstFrame + i.
+ * @details Bit-identical to the scalar functions above. portable_rand() runs
+ * once per hold or block rather than once per frame; see fpsr_time64.c.
+ * SM ranges whose arithmetic fits an int, and QS ones whose sine arguments
+ * are also small, hand off to fpsr_*_batch_frames(), so fpsr_time64.c links
+ * with fpsr_batch.c. Elsewhere the QS sines still run in SIMD lanes, through
+ * fpsr_qs_quantise_batch().
+ *
+ * SM past the int range stays on its cursor and is slower than the SIMD
+ * path: about 1.3x its ns per value near 2^53 with fpsr_time64_bench.c's
+ * sample preset (16-24 frame holds, reseed every 9). Each reseed block needs
+ * its duration rand before the hold block it selects is known, so the rands
+ * run one at a time through libm sin(), with a 64-bit division per block
+ * edge: about 0.25 rands and 0.5 divisions per frame there. The gap shrinks
+ * as holds and reseed intervals grow; TM, with no duration rand, is faster
+ * than its SIMD path.
+ */
+void fpsr_sm_batch_frames64(const fpsr_sm_params* params, int64_t firstFrame, float* out, size_t count);
+void fpsr_tm_batch_frames64(const fpsr_tm_params* params, int64_t firstFrame, float* out, size_t count);
+void fpsr_qs_batch_frames64(const fpsr_qs_params* params, int64_t firstFrame, float* out, size_t count);
+
+/**
+ * @brief One entity over ticks: out[i] is the value at firstTick + i * step.
+ */
+void fpsr_sm_batch_ticks(const fpsr_sm_params* params, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count);
+void fpsr_tm_batch_ticks(const fpsr_tm_params* params, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count);
+void fpsr_qs_batch_ticks(const fpsr_qs_params* params, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_TIME64_H
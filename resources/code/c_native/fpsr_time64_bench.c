@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_time64_bench.c
+ * @brief Checks and throughput of the 64-bit and tick timelines of fpsr_time64.h.
+ * @details Two parts:
+ *     - Checks (the program exits 1 if one fails):
+ *         - overlap: around frame 0 and just inside INT_MAX and INT_MIN,
+ *           fpsr_*_eval(), fpsr_*_batch_frames(), fpsr_*_eval64(),
+ *           fpsr_*_batch_frames64() and fpsr_*_batch_ticks() at whole ticks
+ *           all give the same bits, with finalRandSwitch on and off (with
+ *           -DFPSR_TIME64_WIDE_STATE_SEED, off only near 2^31, where the wide
+ *           seed no longer saturates as the 32-bit one does);
+ *         - 2^31 and 2^53: across +-2^31, and around +-2^53, the batch agrees
+ *           with fpsr_*_eval64() and the output keeps changing at the
+ *           preset's rate (at least one change per 64 frames; across 2^31 the
+ *           SM and TM states that still fit an int sit on rand(INT_MIN), so
+ *           only the half past it has to move);
+ *         - ticks: around frame +-2^46 at 1/8 frame steps, fpsr_*_batch_ticks()
+ *           agrees with fpsr_*_eval_ticks(), and at whole ticks with
+ *           fpsr_*_eval64().
+ *     - Throughput: ns per value of the 32-bit scalar and SIMD batch paths
+ *       near frame 0 and 2^30 against the 64-bit ones at the same frames.
+ *       The 64-bit ones near 2^53, and the tick batch at 1/4 frame steps,
+ *       have no int path to meet and are set against the one near 0.
+ *
+ * Options: --frames N (values per batch timing, 1000000; the scalar paths
+ *          time N / 10)
+ *
+ * Build (POSIX; the flags are the ones fpsr_batch.c expects):
+ *     cc -std=c11 -O3 -fno-trapping-math fpsr_time64_bench.c fpsr_time64.c fpsr_batch.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> // For printf()
+#include <stdlib.h> // For strtol() and malloc()
+#include <string.h> // For strcmp() and memcmp()
+#include <time.h> // For clock_gettime()
+
+#include "fpsr_batch.h"
+#include "fpsr_time64.h"
+
+#define FPSR_TIME64_BENCH_WINDOW 20000 // frames per check window
+
+static const fpsr_sm_params SM = { 16, 24, 9, -41, 23, 1 };
+static const fpsr_tm_params TM = { 10, 25, 30, 15, 0, 1 };
+static const fpsr_qs_params QS = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 };
+static const fpsr_sm_params SM_STATE = { 16, 24, 9, -41, 23, 0 };
+static const fpsr_tm_params TM_STATE = { 10, 25, 30, 15, 0, 0 };
+static const fpsr_qs_params QS_LEVEL = { 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 0 };
+
+static volatile float fpsr_time64_bench_sink;
+
+static double fpsr_time64_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static int fpsr_time64_bench_same(float a, float b) {
+    return memcmp(&a, &b, sizeof a) == 0;
+}
+
+
+/******************************************************************************/
+/* The three algorithms behind one interface                                  */
+/******************************************************************************/
+
+typedef struct fpsr_time64_bench_algo {
+    const char* name;
+    float (*eval)(const void* p, int frame);
+    float (*eval64)(const void* p, int64_t frame);
+    float (*evalTicks)(const void* p, fpsr_ticks t);
+    void (*batch)(const void* p, int firstFrame, float* out, size_t count);
+    void (*batch64)(const void* p, int64_t firstFrame, float* out, size_t count);
+    void (*batchTicks)(const void* p, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count);
+} fpsr_time64_bench_algo;
+
+#define FPSR_TIME64_BENCH_ALGO(a) \
+    static float a##_eval(const void* p, int frame) { \
+        return fpsr_##a##_eval((const fpsr_##a##_params*)p, frame); } \
+    static float a##_eval64(const void* p, int64_t frame) { \
+        return fpsr_##a##_eval64((const fpsr_##a##_params*)p, frame); } \
+    static float a##_eval_ticks(const void* p, fpsr_ticks t) { \
+        return fpsr_##a##_eval_ticks((const fpsr_##a##_params*)p, t); } \
+    static void a##_batch(const void* p, int firstFrame, float* out, size_t count) { \
+        fpsr_##a##_batch_frames((const fpsr_##a##_params*)p, firstFrame, out, count); } \
+    static void a##_batch64(const void* p, int64_t firstFrame, float* out, size_t count) { \
+        fpsr_##a##_batch_frames64((const fpsr_##a##_params*)p, firstFrame, out, count); } \
+    static void a##_batch_ticks(const void* p, fpsr_ticks firstTick, fpsr_ticks step, float* out, size_t count) { \
+        fpsr_##a##_batch_ticks((const fpsr_##a##_params*)p, firstTick, step, out, count); } \
+    static const fpsr_time64_bench_algo a##_algo = { \
+        #a, a##_eval, a##_eval64, a##_eval_ticks, a##_batch, a##_batch64, a##_batch_ticks };
+
+FPSR_TIME64_BENCH_ALGO(sm)
+FPSR_TIME64_BENCH_ALGO(tm)
+FPSR_TIME64_BENCH_ALGO(qs)
+
+
+/******************************************************************************/
+/* Checks                                                                     */
+/******************************************************************************/
+
+static float fpsr_time64_bench_a[FPSR_TIME64_BENCH_WINDOW];
+static float fpsr_time64_bench_b[FPSR_TIME64_BENCH_WINDOW];
+static float fpsr_time64_bench_c[FPSR_TIME64_BENCH_WINDOW];
+
+static int fpsr_time64_bench_report(const char* check, const fpsr_time64_bench_algo* a, const char* preset,
+                                    long long first, long mismatches, const char* extra) {
+    printf("%-8s %-3s %-6s from %21lld: %s%s\n", check, a->name, preset, first,
+           mismatches ? "MISMATCH" : "same", extra);
+    return mismatches != 0;
+}
+
+/** @brief The five paths over [first, first + count) of the int range. */
+static int fpsr_time64_bench_overlap(const fpsr_time64_bench_algo* a, const void* p, const char* preset, int first) {
+    float* b32 = fpsr_time64_bench_a;
+    float* b64 = fpsr_time64_bench_b;
+    float* bt = fpsr_time64_bench_c;
+    const int count = FPSR_TIME64_BENCH_WINDOW;
+    a->batch(p, first, b32, count);
+    a->batch64(p, first, b64, count);
+    a->batchTicks(p, fpsr_ticks_from_frame(first), FPSR_TICKS_PER_FRAME, bt, count);
+    long mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        const float v = a->eval(p, first + i);
+        mismatches += !fpsr_time64_bench_same(v, a->eval64(p, first + i)) || !fpsr_time64_bench_same(v, b32[i])
+                    || !fpsr_time64_bench_same(v, b64[i]) || !fpsr_time64_bench_same(v, bt[i]);
+    }
+    return fpsr_time64_bench_report("overlap", a, preset, first, mismatches, "");
+}
+
+/** @brief Batch against eval64 past the int range, and (if checkRate) how often the output changes. */
+static int fpsr_time64_bench_wide(
+    const fpsr_time64_bench_algo* a, const void* p, const char* preset, int64_t first, int checkRate)
+{
+    float* b64 = fpsr_time64_bench_b;
+    const int count = FPSR_TIME64_BENCH_WINDOW;
+    a->batch64(p, first, b64, count);
+    long mismatches = 0, changes = 0;
+    for (int i = 0; i < count; i++) {
+        mismatches += !fpsr_time64_bench_same(b64[i], a->eval64(p, first + i));
+        changes += i > 0 && !fpsr_time64_bench_same(b64[i], b64[i - 1]);
+    }
+    char extra[64];
+    snprintf(extra, sizeof extra, ", %ld changes in %d frames", changes, count);
+    return fpsr_time64_bench_report("wide", a, preset, (long long)first, mismatches, extra)
+         | (checkRate && changes < count / 64);
+}
+
+/** @brief The tick batch at 1/8 frame steps against the scalar tick and frame functions. */
+static int fpsr_time64_bench_ticks(const fpsr_time64_bench_algo* a, const void* p, const char* preset, int64_t first) {
+    float* bt = fpsr_time64_bench_c;
+    const int count = FPSR_TIME64_BENCH_WINDOW;
+    const fpsr_ticks firstTick = fpsr_ticks_from_frame(first), step = FPSR_TICKS_PER_FRAME / 8;
+    a->batchTicks(p, firstTick, step, bt, count);
+    long mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        const fpsr_ticks t = firstTick + i * step;
+        mismatches += !fpsr_time64_bench_same(bt[i], a->evalTicks(p, t));
+        mismatches += i % 8 == 0 && !fpsr_time64_bench_same(bt[i], a->eval64(p, first + i / 8));
+    }
+    return fpsr_time64_bench_report("ticks", a, preset, (long long)first, mismatches, "");
+}
+
+static int fpsr_time64_bench_checks(void) {
+    const int nearMax = INT_MAX - FPSR_TIME64_BENCH_WINDOW - 100; // seeds + frame stay in range
+    const int nearMin = INT_MIN + 100;
+    const int64_t two31 = (int64_t)1 << 31, two53 = (int64_t)1 << 53, two46 = (int64_t)1 << 46;
+    const int64_t wide[4] = {
+        two31 - FPSR_TIME64_BENCH_WINDOW / 2, -two31 - FPSR_TIME64_BENCH_WINDOW / 2,
+        two53 - FPSR_TIME64_BENCH_WINDOW / 2, -two53 - FPSR_TIME64_BENCH_WINDOW / 2,
+    };
+    int failed = 0;
+
+    failed |= fpsr_time64_bench_overlap(&sm_algo, &SM, "sample", -FPSR_TIME64_BENCH_WINDOW / 2);
+    failed |= fpsr_time64_bench_overlap(&tm_algo, &TM, "sample", -FPSR_TIME64_BENCH_WINDOW / 2);
+    failed |= fpsr_time64_bench_overlap(&qs_algo, &QS, "sample", -FPSR_TIME64_BENCH_WINDOW / 2);
+    for (int side = 0; side < 2; side++) {
+        const int first = side ? nearMin : nearMax;
+        failed |= fpsr_time64_bench_overlap(&sm_algo, &SM_STATE, "state", first);
+        failed |= fpsr_time64_bench_overlap(&tm_algo, &TM_STATE, "state", first);
+        failed |= fpsr_time64_bench_overlap(&qs_algo, &QS, "sample", first);
+        failed |= fpsr_time64_bench_overlap(&qs_algo, &QS_LEVEL, "level", first);
+#ifndef FPSR_TIME64_WIDE_STATE_SEED
+        failed |= fpsr_time64_bench_overlap(&sm_algo, &SM, "sample", first);
+        failed |= fpsr_time64_bench_overlap(&tm_algo, &TM, "sample", first);
+#endif
+    }
+
+    for (int w = 0; w < 4; w++) {
+        failed |= fpsr_time64_bench_wide(&sm_algo, &SM, "sample", wide[w], 1);
+        failed |= fpsr_time64_bench_wide(&tm_algo, &TM, "sample", wide[w], 1);
+        failed |= fpsr_time64_bench_wide(&qs_algo, &QS, "sample", wide[w], 1);
+    }
+
+    for (int side = 0; side < 2; side++) {
+        const int64_t first = side ? -two46 : two46;
+        failed |= fpsr_time64_bench_ticks(&sm_algo, &SM, "sample", first);
+        failed |= fpsr_time64_bench_ticks(&tm_algo, &TM, "sample", first);
+        failed |= fpsr_time64_bench_ticks(&qs_algo, &QS, "sample", first);
+    }
+    return failed;
+}
+
+
+/******************************************************************************/
+/* Throughput                                                                 */
+/******************************************************************************/
+
+typedef enum fpsr_time64_bench_path {
+    FPSR_TIME64_BENCH_EVAL, FPSR_TIME64_BENCH_EVAL64, FPSR_TIME64_BENCH_BATCH,
+    FPSR_TIME64_BENCH_BATCH64, FPSR_TIME64_BENCH_TICKS
+} fpsr_time64_bench_path;
+
+/** @brief Best of three ns per value of one path over count values from first. */
+static double fpsr_time64_bench_time(const fpsr_time64_bench_algo* a, const void* p, fpsr_time64_bench_path path,
+                                     int64_t first, float* out, size_t count) {
+    double best = 1e300;
+    for (int run = 0; run < 3; run++) {
+        const double t0 = fpsr_time64_bench_now();
+        float sum = 0.0f;
+        switch (path) {
+        case FPSR_TIME64_BENCH_EVAL:
+            for (size_t i = 0; i < count; i++) { sum += a->eval(p, (int)(first + (int64_t)i)); }
+            break;
+        case FPSR_TIME64_BENCH_EVAL64:
+            for (size_t i = 0; i < count; i++) { sum += a->eval64(p, first + (int64_t)i); }
+            break;
+        case FPSR_TIME64_BENCH_BATCH: a->batch(p, (int)first, out, count); break;
+        case FPSR_TIME64_BENCH_BATCH64: a->batch64(p, first, out, count); break;
+        case FPSR_TIME64_BENCH_TICKS:
+            a->batchTicks(p, fpsr_ticks_from_frame(first), FPSR_TICKS_PER_FRAME / 4, out, count);
+            break;
+        }
+        const double elapsed = fpsr_time64_bench_now() - t0;
+        fpsr_time64_bench_sink = sum + out[count - 1];
+        best = elapsed < best ? elapsed : best;
+    }
+    return best * 1e9 / (double)count;
+}
+
+static void fpsr_time64_bench_throughput(const fpsr_time64_bench_algo* a, const void* p, float* out, size_t frames) {
+    const size_t scalarFrames = frames / 10 > 0 ? frames / 10 : 1;
+    const int64_t two30 = (int64_t)1 << 30, two53 = (int64_t)1 << 53;
+    // The int paths near 0 and 2^30, which the 64-bit rows are measured against.
+    const double base[4] = {
+        fpsr_time64_bench_time(a, p, FPSR_TIME64_BENCH_EVAL, 0, out, scalarFrames),
+        fpsr_time64_bench_time(a, p, FPSR_TIME64_BENCH_EVAL, two30, out, scalarFrames),
+        fpsr_time64_bench_time(a, p, FPSR_TIME64_BENCH_BATCH, 0, out, frames),
+        fpsr_time64_bench_time(a, p, FPSR_TIME64_BENCH_BATCH, two30, out, frames),
+    };
+    const struct {
+        const char* label;
+        fpsr_time64_bench_path path;
+        int64_t first;
+        int base; // index into base, or -1 for the int rows themselves
+    } rows[] = {
+        { "eval (int), near 0", FPSR_TIME64_BENCH_EVAL, 0, -1 },
+        { "eval (int), near 2^30", FPSR_TIME64_BENCH_EVAL, two30, -1 },
+        { "eval64, near 0", FPSR_TIME64_BENCH_EVAL64, 0, 0 },
+        { "eval64, near 2^30", FPSR_TIME64_BENCH_EVAL64, two30, 1 },
+        { "eval64, near 2^53", FPSR_TIME64_BENCH_EVAL64, two53, 0 },
+        { "batch (int), near 0", FPSR_TIME64_BENCH_BATCH, 0, -1 },
+        { "batch (int), near 2^30", FPSR_TIME64_BENCH_BATCH, two30, -1 },
+        { "batch64, near 0", FPSR_TIME64_BENCH_BATCH64, 0, 2 },
+        { "batch64, near 2^30", FPSR_TIME64_BENCH_BATCH64, two30, 3 },
+        { "batch64, near 2^53", FPSR_TIME64_BENCH_BATCH64, two53, 2 },
+        { "ticks, 1/4 frame", FPSR_TIME64_BENCH_TICKS, 0, 2 },
+    };
+    for (size_t r = 0, intRow = 0; r < sizeof rows / sizeof rows[0]; r++) {
+        const int scalar = rows[r].path == FPSR_TIME64_BENCH_EVAL || rows[r].path == FPSR_TIME64_BENCH_EVAL64;
+        if (rows[r].base < 0) {
+            printf("%-3s %-24s %10.2f\n", a->name, rows[r].label, base[intRow++]);
+            continue;
+        }
+        const double ns = fpsr_time64_bench_time(a, p, rows[r].path, rows[r].first, out, scalar ? scalarFrames : frames);
+        printf("%-3s %-24s %10.2f  %+7.1f%%\n", a->name, rows[r].label, ns, (ns / base[rows[r].base] - 1.0) * 100.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    long frames = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) { frames = strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--frames N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 1 || frames > INT_MAX) {
+        fprintf(stderr, "%s: options out of range\n", argv[0]);
+        return 2;
+    }
+
+    const int failed = fpsr_time64_bench_checks();
+
+    float* out = malloc((size_t)frames * sizeof *out);
+    if (!out) {
+        perror("malloc");
+        return 2;
+    }
+    printf("\n%-3s %-24s %10s  %8s\n", "alg", "path", "ns/value", "vs int");
+    fpsr_time64_bench_throughput(&sm_algo, &SM, out, (size_t)frames);
+    fpsr_time64_bench_throughput(&tm_algo, &TM, out, (size_t)frames);
+    fpsr_time64_bench_throughput(&qs_algo, &QS, out, (size_t)frames);
+    printf("(%ld values per batch run, %d fraction bits, SIMD level %d)\n", frames, FPSR_SUBFRAME_BITS,
+           (int)fpsr_simd_active());
+    free(out);
+    return failed ? 1 : 0;
+}
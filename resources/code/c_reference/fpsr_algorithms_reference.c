@@ -18,6 +18,8 @@
 
  #include <math.h> // For sin() and floor()
  #include <stdio.h> // For NULL
+
+ #include "fpsr_algorithms_reference.h"
  
 /**
  * A simple, portable pseudo-random number generator.
@@ -76,7 +78,8 @@ float portable_rand(int seed) {
  */
 float fpsr_sm(
     int frame, int minHold, int maxHold,
-    int reseedInterval, int seedInner, int seedOuter)
+    int reseedInterval, int seedInner, int seedOuter,
+    int finalRandSwitch)
 {
     // --- 1. Calculate the random hold duration ---
     if (reseedInterval < 1) { reseedInterval = 1; } // Prevent division by zero.
@@ -103,29 +106,34 @@ float fpsr_sm(
     return fpsr_output;
 }
  
+#ifdef FPSR_REFERENCE_SAMPLES
 // Sample code to call the FPS-R:SM function
-// Parameters
-int frame = 100; // Replace with the current frame value
-int minHoldFrames = 16; // probable minimum held period
-int maxHoldFrames = 24; // maximum held period before cycling
-int reseedFrames = 9; // inner mod cycle timing
-int offsetInner = -41; // offsets the inner frame
-int offsetOuter = 23; // offsets the outer frame
-int finalRandSwitch = 1; // 1 to apply the final randomisation step, 0 to skip it
-
-// Call the FPS-R:SM function
-float randVal = 
-    fpsr_sm(
-        int(frame), minHoldFrames, maxHoldFrames, 
-        reseedFrames, offsetInner, offsetOuter, finalRandSwitch);
-float randVal_previous = 
-    fpsr_sm(
-        int(frame-1), minHoldFrames, maxHoldFrames, 
-        reseedFrames, offsetInner, offsetOuter, finalRandSwitch);
-int changed = 0;
-if (randVal != randVal_previous) {
-    changed = 1; // value has changed from the previous frame
+int fpsr_sm_sample(void) {
+    // Parameters
+    int frame = 100; // Replace with the current frame value
+    int minHoldFrames = 16; // probable minimum held period
+    int maxHoldFrames = 24; // maximum held period before cycling
+    int reseedFrames = 9; // inner mod cycle timing
+    int offsetInner = -41; // offsets the inner frame
+    int offsetOuter = 23; // offsets the outer frame
+    int finalRandSwitch = 1; // 1 to apply the final randomisation step, 0 to skip it
+
+    // Call the FPS-R:SM function
+    float randVal = 
+        fpsr_sm(
+            frame, minHoldFrames, maxHoldFrames, 
+            reseedFrames, offsetInner, offsetOuter, finalRandSwitch);
+    float randVal_previous = 
+        fpsr_sm(
+            frame - 1, minHoldFrames, maxHoldFrames, 
+            reseedFrames, offsetInner, offsetOuter, finalRandSwitch);
+    int changed = 0;
+    if (randVal != randVal_previous) {
+        changed = 1; // value has changed from the previous frame
+    }
+    return changed;
 }
+#endif // FPSR_REFERENCE_SAMPLES
 
 
 /******************************************************************************/
@@ -189,29 +197,34 @@ float fpsr_tm(
     return fpsr_output;
 }
 
+#ifdef FPSR_REFERENCE_SAMPLES
 // Sample code to call the FPS-R:TM function
-// Parameters
-int frame = 100; // Replace with the current frame value
-int period_A = 10; // The first hold duration
-int period_B = 25; // The second hold duration
-int periodSwitch = 30; // The toggle happens every 30 frames
-int offset_inner = 15; // offsets the inner (toggle) clock
-int offset_outer = 0; // offsets the outer (hold) clock
-int final_rand_switch = 1; // 1 to apply the final randomisation step, 0 to skip it
-
-// Call the FPS-R:TM function
-float randVal = 
-    fpsr_tm(
-        frame, period_A, period_B, 
-        switch_duration, offset_inner, offset_outer, final_rand_switch);
-float randVal_previous = 
-    fpsr_tm(
-        frame - 1, period_A, period_B, 
-        switch_duration, offset_inner, offset_outer, final_rand_switch);
-int changed = 0;
-if (randVal != randVal_previous) {
-    changed = 1; // value has changed from the previous frame
+int fpsr_tm_sample(void) {
+    // Parameters
+    int frame = 100; // Replace with the current frame value
+    int period_A = 10; // The first hold duration
+    int period_B = 25; // The second hold duration
+    int switch_duration = 30; // The toggle happens every 30 frames
+    int offset_inner = 15; // offsets the inner (toggle) clock
+    int offset_outer = 0; // offsets the outer (hold) clock
+    int final_rand_switch = 1; // 1 to apply the final randomisation step, 0 to skip it
+
+    // Call the FPS-R:TM function
+    float randVal = 
+        fpsr_tm(
+            frame, period_A, period_B, 
+            switch_duration, offset_inner, offset_outer, final_rand_switch);
+    float randVal_previous = 
+        fpsr_tm(
+            frame - 1, period_A, period_B, 
+            switch_duration, offset_inner, offset_outer, final_rand_switch);
+    int changed = 0;
+    if (randVal != randVal_previous) {
+        changed = 1; // value has changed from the previous frame
+    }
+    return changed;
 }
+#endif // FPSR_REFERENCE_SAMPLES
 
 
 /******************************************************************************/
@@ -291,29 +304,34 @@ float fpsr_qs(
     return fpsr_output;
 }
  
+#ifdef FPSR_REFERENCE_SAMPLES
 // Sample code to call the FPS-R:QS function
-// Parameters
-int frame = 103; // Current frame number
-float baseWaveFreq = 0.012; // Base frequency for the modulation wave of stream 1
-float stream2freqMult = 3.1; // Multiplier for the second stream's frequency
-int quantLevelsMinMax[2] = {4, 12}; // Min, Max quantisation levels for the two streams
-int streamsOffset[2] = {0, 76}; // Offset for the two streams
-int quantOffsets[2] = {10, 81}; // Offset for the random quantisation selection
-int streamSwitchDur = 24; // Duration for switching streams in frames
-int stream1QuantDur = 16; // Duration for the first stream's quantisation switch cycle in frames
-int stream2QuantDur = 20; // Duration for the second stream's quantisation switch cycle in frames
-int finalRandSwitch = 1; // 1 to apply the final randomisation step, 0 to skip it
-
-float randVal = fpsr_qs(
-    frame, baseWaveFreq, stream2freqMult, quantLevelsMinMax, 
-    streamsOffset, quantOffsets, streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch);
-
-// another call to fpsr_qs for the previous frame
-float randVal_previous = fpsr_qs(
-    frame - 1, baseWaveFreq, stream2freqMult, quantLevelsMinMax, 
-    streamsOffset, quantOffsets, streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch);
-
-int changed = 0; // Variable to track if the value has changed
-if (randVal != randVal_previous) {
-    changed = 1; // Mark as changed if the value has changed from the previous frame
-} 
+int fpsr_qs_sample(void) {
+    // Parameters
+    int frame = 103; // Current frame number
+    float baseWaveFreq = 0.012; // Base frequency for the modulation wave of stream 1
+    float stream2freqMult = 3.1; // Multiplier for the second stream's frequency
+    int quantLevelsMinMax[2] = {4, 12}; // Min, Max quantisation levels for the two streams
+    int streamsOffset[2] = {0, 76}; // Offset for the two streams
+    int quantOffsets[2] = {10, 81}; // Offset for the random quantisation selection
+    int streamSwitchDur = 24; // Duration for switching streams in frames
+    int stream1QuantDur = 16; // Duration for the first stream's quantisation switch cycle in frames
+    int stream2QuantDur = 20; // Duration for the second stream's quantisation switch cycle in frames
+    int finalRandSwitch = 1; // 1 to apply the final randomisation step, 0 to skip it
+
+    float randVal = fpsr_qs(
+        frame, baseWaveFreq, stream2freqMult, quantLevelsMinMax, 
+        streamsOffset, quantOffsets, streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch);
+
+    // another call to fpsr_qs for the previous frame
+    float randVal_previous = fpsr_qs(
+        frame - 1, baseWaveFreq, stream2freqMult, quantLevelsMinMax, 
+        streamsOffset, quantOffsets, streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch);
+
+    int changed = 0; // Variable to track if the value has changed
+    if (randVal != randVal_previous) {
+        changed = 1; // Mark as changed if the value has changed from the previous frame
+    }
+    return changed;
+}
+#endif // FPSR_REFERENCE_SAMPLES
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_algorithms_reference.h
+ * @brief Declarations of the reference FPS-R algorithms in fpsr_algorithms_reference.c.
+ * @details Lets the reference be compiled once as a library and linked into
+ * tools: the golden-vector generator (fpsr_reference_golden.c) and the
+ * benchmark harness (fpsr_reference_bench.c). Build it as C11 without
+ * -ffast-math and with -ffp-contract=off, or the outputs are not the
+ * reference's.
+ *
+ * The sample calls are compiled only with -DFPSR_REFERENCE_SAMPLES; each
+ * returns the `changed` flag it computes.
+ */
+
+#ifndef FPSR_ALGORITHMS_REFERENCE_H
+#define FPSR_ALGORITHMS_REFERENCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+float portable_rand(int seed);
+
+float fpsr_sm(
+    int frame, int minHold, int maxHold,
+    int reseedInterval, int seedInner, int seedOuter,
+    int finalRandSwitch);
+
+float fpsr_tm(
+    int frame, int periodA, int periodB,
+    int periodSwitch, int seedInner, int seedOuter,
+    int finalRandSwitch);
+
+float fpsr_qs(
+    int frame, float baseWaveFreq, float stream2FreqMult,
+    const int quantLevelsMinMax[2], const int streamsOffset[2], const int quantOffsets[2],
+    int streamSwitchDur, int stream1QuantDur, int stream2QuantDur,
+    int finalRandSwitch);
+
+#ifdef FPSR_REFERENCE_SAMPLES
+int fpsr_sm_sample(void);
+int fpsr_tm_sample(void);
+int fpsr_qs_sample(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FPSR_ALGORITHMS_REFERENCE_H
@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_reference_bench.c
+ * @brief Microbenchmark harness for the reference FPS-R algorithms.
+ * @details Times portable_rand(), fpsr_sm(), fpsr_tm() and fpsr_qs() from
+ * fpsr_algorithms_reference.c with the sample presets, over consecutive
+ * frames, and reports:
+ *     - ns/call on one thread (the best of several runs, to shed noise);
+ *     - throughput in Mcalls/s at 1, 2, 4, ... threads up to the CPU count,
+ *       every thread running the same loop on its own frame range.
+ *
+ * Results can be stored and compared:
+ *     --save FILE          writes "name ns_per_call" lines
+ *     --baseline FILE      compares ns/call with a stored run; a function more
+ *                          than --tolerance percent (default 10) slower is
+ *                          reported as a regression and the exit status is 1
+ *     --calls N            calls per timed run (default 2000000)
+ *     --threads N          highest thread count (default: online CPUs)
+ *
+ * Baselines only mean something on the machine and compiler they were
+ * recorded with. fpsr_reference_baseline.txt is one such run (gcc -O2,
+ * x86-64, one noisy CPU, where runs differ by up to 20%); "make baseline"
+ * rewrites it on the machine at hand and "make bench-check" compares.
+ *
+ * Build: make, or (POSIX)
+ *     cc -std=c11 -O2 -ffp-contract=off -pthread fpsr_reference_bench.c fpsr_algorithms_reference.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h> // For the worker threads
+#include <stdio.h> // For printf() and the baseline files
+#include <stdlib.h> // For strtol() and strtod()
+#include <string.h> // For strcmp()
+#include <time.h> // For clock_gettime()
+#include <unistd.h> // For sysconf()
+
+#include "fpsr_algorithms_reference.h"
+
+#define FPSR_BENCH_RUNS 5
+#define FPSR_BENCH_MAX_THREADS 256
+
+
+/******************************************************************************/
+/* Functions under test                                                       */
+/******************************************************************************/
+
+// Each runs the function over frames [first, first + calls) and returns a
+// checksum so the calls cannot be optimised away.
+
+static float fpsr_bench_rand(int first, long calls) {
+    float sum = 0.0f;
+    for (long i = 0; i < calls; i++) { sum += portable_rand(first + (int)i); }
+    return sum;
+}
+
+static float fpsr_bench_sm(int first, long calls) {
+    float sum = 0.0f;
+    for (long i = 0; i < calls; i++) { sum += fpsr_sm(first + (int)i, 16, 24, 9, -41, 23, 1); }
+    return sum;
+}
+
+static float fpsr_bench_tm(int first, long calls) {
+    float sum = 0.0f;
+    for (long i = 0; i < calls; i++) { sum += fpsr_tm(first + (int)i, 10, 25, 30, 15, 0, 1); }
+    return sum;
+}
+
+static float fpsr_bench_qs(int first, long calls) {
+    static const int quantLevelsMinMax[2] = { 4, 12 };
+    static const int streamsOffset[2] = { 0, 76 };
+    static const int quantOffsets[2] = { 10, 81 };
+    float sum = 0.0f;
+    for (long i = 0; i < calls; i++) {
+        sum += fpsr_qs(first + (int)i, 0.012f, 3.1f, quantLevelsMinMax, streamsOffset, quantOffsets, 24, 16, 20, 1);
+    }
+    return sum;
+}
+
+typedef struct fpsr_bench_function {
+    const char* name;
+    float (*run)(int first, long calls);
+} fpsr_bench_function;
+
+static const fpsr_bench_function FPSR_BENCH_FUNCTIONS[] = {
+    { "portable_rand", fpsr_bench_rand },
+    { "fpsr_sm", fpsr_bench_sm },
+    { "fpsr_tm", fpsr_bench_tm },
+    { "fpsr_qs", fpsr_bench_qs },
+};
+
+#define FPSR_BENCH_FUNCTION_COUNT ((int)(sizeof FPSR_BENCH_FUNCTIONS / sizeof FPSR_BENCH_FUNCTIONS[0]))
+
+
+/******************************************************************************/
+/* Timing                                                                     */
+/******************************************************************************/
+
+static double fpsr_bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static volatile float fpsr_bench_sink;
+
+typedef struct fpsr_bench_worker {
+    const fpsr_bench_function* function;
+    int first;
+    long calls;
+    pthread_t thread;
+} fpsr_bench_worker;
+
+static void* fpsr_bench_work(void* arg) {
+    fpsr_bench_worker* w = (fpsr_bench_worker*)arg;
+    fpsr_bench_sink = w->function->run(w->first, w->calls);
+    return NULL;
+}
+
+/** @brief Best single-thread time per call, in ns. */
+static double fpsr_bench_ns_per_call(const fpsr_bench_function* f, long calls) {
+    double best = 1e30;
+    for (int r = 0; r < FPSR_BENCH_RUNS; r++) {
+        double t0 = fpsr_bench_now();
+        fpsr_bench_sink = f->run(r * 7919, calls);
+        double t = fpsr_bench_now() - t0;
+        if (t < best) { best = t; }
+    }
+    return best / (double)calls * 1e9;
+}
+
+/** @brief Aggregate throughput of threads running calls each, in Mcalls/s, or -1. */
+static double fpsr_bench_throughput(const fpsr_bench_function* f, int threads, long calls) {
+    fpsr_bench_worker workers[FPSR_BENCH_MAX_THREADS];
+    double t0 = fpsr_bench_now();
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        workers[i].function = f;
+        workers[i].first = i * 1000003;
+        workers[i].calls = calls;
+        if (pthread_create(&workers[i].thread, NULL, fpsr_bench_work, &workers[i]) != 0) { break; }
+        started++;
+    }
+    for (int i = 0; i < started; i++) { pthread_join(workers[i].thread, NULL); }
+    double t = fpsr_bench_now() - t0;
+    return started == threads ? (double)threads * (double)calls / t * 1e-6 : -1.0;
+}
+
+
+/******************************************************************************/
+/* Baselines                                                                  */
+/******************************************************************************/
+
+/** @brief Reads the ns/call of name from a baseline file. @return 1 if found. */
+static int fpsr_bench_baseline(const char* path, const char* name, double* ns) {
+    FILE* file = fopen(path, "r");
+    if (!file) { return 0; }
+    char line[256], key[128];
+    double value;
+    int found = 0;
+    while (!found && fgets(line, sizeof line, file)) {
+        if (line[0] != '#' && sscanf(line, "%127s %lf", key, &value) == 2 && strcmp(key, name) == 0) {
+            *ns = value;
+            found = 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+int main(int argc, char** argv) {
+    const char* savePath = NULL;
+    const char* baselinePath = NULL;
+    double tolerance = 10.0;
+    long calls = 2000000;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxThreads = cpus > 0 ? (int)cpus : 1;
+
+    for (int i = 1; i < argc; i++) {
+        const int hasValue = i + 1 < argc;
+        if (hasValue && strcmp(argv[i], "--save") == 0) { savePath = argv[++i]; }
+        else if (hasValue && strcmp(argv[i], "--baseline") == 0) { baselinePath = argv[++i]; }
+        else if (hasValue && strcmp(argv[i], "--tolerance") == 0) { tolerance = strtod(argv[++i], NULL); }
+        else if (hasValue && strcmp(argv[i], "--calls") == 0) { calls = strtol(argv[++i], NULL, 10); }
+        else if (hasValue && strcmp(argv[i], "--threads") == 0) { maxThreads = (int)strtol(argv[++i], NULL, 10); }
+        else {
+            fprintf(stderr, "usage: %s [--save FILE] [--baseline FILE] [--tolerance PCT] [--calls N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (calls < 1) { calls = 1; }
+    if (maxThreads < 1) { maxThreads = 1; }
+    if (maxThreads > FPSR_BENCH_MAX_THREADS) { maxThreads = FPSR_BENCH_MAX_THREADS; }
+
+    double ns[FPSR_BENCH_FUNCTION_COUNT];
+    printf("%-14s %10s", "function", "ns/call");
+    for (int t = 1; t <= maxThreads; t *= 2) { printf("  %4d thr Mcalls/s", t); }
+    printf("\n");
+    for (int f = 0; f < FPSR_BENCH_FUNCTION_COUNT; f++) {
+        ns[f] = fpsr_bench_ns_per_call(&FPSR_BENCH_FUNCTIONS[f], calls);
+        printf("%-14s %10.2f", FPSR_BENCH_FUNCTIONS[f].name, ns[f]);
+        for (int t = 1; t <= maxThreads; t *= 2) {
+            printf("  %17.2f", fpsr_bench_throughput(&FPSR_BENCH_FUNCTIONS[f], t, calls));
+        }
+        printf("\n");
+    }
+
+    int regressions = 0;
+    if (baselinePath) {
+        printf("\nagainst %s (tolerance %.1f%%):\n", baselinePath, tolerance);
+        for (int f = 0; f < FPSR_BENCH_FUNCTION_COUNT; f++) {
+            double base;
+            if (!fpsr_bench_baseline(baselinePath, FPSR_BENCH_FUNCTIONS[f].name, &base)) {
+                printf("%-14s no baseline\n", FPSR_BENCH_FUNCTIONS[f].name);
+                continue;
+            }
+            double change = (ns[f] / base - 1.0) * 100.0;
+            int regressed = change > tolerance;
+            regressions += regressed;
+            printf("%-14s %10.2f -> %8.2f ns  %+7.1f%%%s\n", FPSR_BENCH_FUNCTIONS[f].name, base, ns[f], change,
+                   regressed ? "  REGRESSION" : "");
+        }
+    }
+
+    if (savePath) {
+        FILE* file = fopen(savePath, "w");
+        if (!file) {
+            perror(savePath);
+            return 2;
+        }
+        fprintf(file, "# fpsr_reference_bench: ns per call, single thread\n");
+        for (int f = 0; f < FPSR_BENCH_FUNCTION_COUNT; f++) { fprintf(file, "%s %.3f\n", FPSR_BENCH_FUNCTIONS[f].name, ns[f]); }
+        fclose(file);
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+# SPDX-License-Identifier: MIT — See LICENSE for full terms
+# Created by Patrick Woo, 2025.
+# This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+# https://github.com/patwooky/fpsr
+
+'''
+file: fpsr_reference_crosscheck.py
+brief: Cross-checks the Python implementation against the C reference's golden vectors.
+details:
+    Reads the JSON lines written by fpsr_reference_golden.c, evaluates every
+    row with the matching function of ../python/fpsr_algorithms.py, and
+    reports, per algorithm and case, how many rows agree:
+        exact   - the Python result rounded to float32 has the golden bits
+        close   - within --tolerance of the golden output
+        differ  - anything else
+    The first few differing rows of each case are listed.
+
+    Python evaluates in double precision and its % floors where C's truncates,
+    so the two are not expected to agree everywhere; this report is how the
+    differences are found and tracked, not a pass/fail test.
+
+    Usage (or "make crosscheck"):
+        python fpsr_reference_crosscheck.py fpsr_reference_golden.jsonl
+'''
+
+import argparse
+import contextlib
+import io
+import json
+import os
+import struct
+import sys
+from collections import OrderedDict
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'python'))
+with contextlib.redirect_stdout(io.StringIO()):  # the module prints its samples on import
+    import fpsr_algorithms
+
+FUNCTIONS = {
+    'portable_rand': lambda row: fpsr_algorithms.portable_rand(row['params']['seed']),
+    'sm': lambda row: fpsr_algorithms.fpsr_sm(row['frame'], **row['params']),
+    'tm': lambda row: fpsr_algorithms.fpsr_tm(row['frame'], **row['params']),
+    'qs': lambda row: fpsr_algorithms.fpsr_qs(row['frame'], **row['params']),
+}
+
+
+def float32_bits(value):
+    """Bits of value rounded to float32, as the golden file writes them."""
+    return '0x%08x' % struct.unpack('<I', struct.pack('<f', value))[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[2].strip())
+    parser.add_argument('golden', help='JSON lines from fpsr_reference_golden')
+    parser.add_argument('--tolerance', type=float, default=1e-6, help='largest difference counted as close')
+    parser.add_argument('--show', type=int, default=3, help='differing rows to list per case')
+    args = parser.parse_args()
+
+    report = OrderedDict()
+    with open(args.golden) as golden:
+        for line in golden:
+            row = json.loads(line)
+            try:
+                value = float(FUNCTIONS[row['algorithm']](row))
+            except (ArithmeticError, ValueError) as error:
+                value, note = None, type(error).__name__
+            counts = report.setdefault((row['algorithm'], row['case']), {'exact': 0, 'close': 0, 'differ': 0, 'rows': []})
+            if value is not None and float32_bits(value) == row['bits']:
+                counts['exact'] += 1
+            elif value is not None and abs(value - row['output']) <= args.tolerance:
+                counts['close'] += 1
+            else:
+                counts['differ'] += 1
+                if len(counts['rows']) < args.show:
+                    counts['rows'].append((row['frame'], row['output'], value if value is not None else note))
+
+    total = {'exact': 0, 'close': 0, 'differ': 0}
+    print('%-14s %-18s %7s %7s %7s' % ('algorithm', 'case', 'exact', 'close', 'differ'))
+    for (algorithm, case), counts in report.items():
+        print('%-14s %-18s %7d %7d %7d' % (algorithm, case, counts['exact'], counts['close'], counts['differ']))
+        for frame, expected, got in counts['rows']:
+            print('    frame %d: C %.9g, Python %s' % (frame, expected, got))
+        for key in total:
+            total[key] += counts[key]
+    print('%-33s %7d %7d %7d' % ('total', total['exact'], total['close'], total['differ']))
+
+
+if __name__ == '__main__':
+    main()
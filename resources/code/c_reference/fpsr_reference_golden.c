@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_reference_golden.c
+ * @brief Golden-vector generator for the reference FPS-R algorithms.
+ * @details Evaluates portable_rand(), fpsr_sm(), fpsr_tm() and fpsr_qs() from
+ * fpsr_algorithms_reference.c over a fixed set of cases and prints one JSON
+ * object per line:
+ *     {"algorithm": "sm", "case": "reseed_below_1", "frame": -3,
+ *      "params": {...}, "output": 0.53110522, "bits": "0x3f07f6f2"}
+ * output is printed with 9 significant digits, enough to round-trip a float,
+ * and bits is its IEEE-754 pattern, which is what ports should compare.
+ *
+ * The cases cover the edges the ports most often get wrong: the sample
+ * presets, negative frames and offsets (C's % truncates toward zero), huge
+ * frames near INT_MIN / INT_MAX, reseedInterval / periodSwitch / hold
+ * durations below 1, the QS default durations and negative stream2FreqMult,
+ * and finalRandSwitch off.
+ *
+ * Frames whose clocks would overflow an int (UB in the reference) are
+ * skipped. For held states beyond +-21474, held_integer_state * 100000.0
+ * does not fit the int parameter of portable_rand(); the vectors record what
+ * x86 does (INT_MIN), see fpsr_state_seed() in the native library.
+ *
+ * The vectors are committed as fpsr_reference_golden.jsonl, generated with
+ * gcc and glibc on x86-64; the output depends on the libm's sin() and
+ * fmod(). "make check" regenerates them and diffs them with that file,
+ * "make golden" rewrites it.
+ *
+ * Build: make, or
+ *     cc -std=c11 -O2 -ffp-contract=off fpsr_reference_golden.c fpsr_algorithms_reference.c -lm
+ *     ./a.out > fpsr_reference_golden.jsonl
+ */
+
+#include <limits.h> // For INT_MIN and INT_MAX
+#include <stdint.h> // For int64_t and uint32_t
+#include <stdio.h> // For printf()
+#include <string.h> // For memcpy()
+
+#include "fpsr_algorithms_reference.h"
+
+/** @brief The frames every case is evaluated at, around its centre frame. */
+static const int FPSR_GOLDEN_OFFSETS[] = { -25, -17, -9, -4, -1, 0, 1, 2, 5, 8, 13, 21, 34 };
+#define FPSR_GOLDEN_OFFSET_COUNT ((int)(sizeof FPSR_GOLDEN_OFFSETS / sizeof FPSR_GOLDEN_OFFSETS[0]))
+
+/** @brief Centre frames: the origin, negative frames, and both ends of the int range. */
+static const int64_t FPSR_GOLDEN_CENTRES[] = { 0, 100, -240, -1000003, (int64_t)INT_MAX - 40, (int64_t)INT_MIN + 30 };
+#define FPSR_GOLDEN_CENTRE_COUNT ((int)(sizeof FPSR_GOLDEN_CENTRES / sizeof FPSR_GOLDEN_CENTRES[0]))
+
+static void fpsr_golden_print(const char* algorithm, const char* name, int frame, const char* params, float output) {
+    uint32_t bits;
+    memcpy(&bits, &output, sizeof bits);
+    printf("{\"algorithm\": \"%s\", \"case\": \"%s\", \"frame\": %d, \"params\": {%s}, \"output\": %.9g, \"bits\": \"0x%08x\"}\n",
+           algorithm, name, frame, params, (double)output, (unsigned)bits);
+}
+
+/** @brief Whether every clock of the case stays inside the int range at frame. */
+static int fpsr_golden_fits(int64_t frame, const int* offsets, int count) {
+    if (frame < INT_MIN || frame > INT_MAX) { return 0; }
+    for (int i = 0; i < count; i++) {
+        int64_t clock = frame + offsets[i];
+        if (clock < INT_MIN || clock > INT_MAX) { return 0; }
+    }
+    return 1;
+}
+
+
+/******************************************************************************/
+/* Cases                                                                      */
+/******************************************************************************/
+
+typedef struct fpsr_golden_sm {
+    const char* name;
+    int minHold, maxHold, reseedInterval, seedInner, seedOuter, finalRandSwitch;
+} fpsr_golden_sm;
+
+static const fpsr_golden_sm FPSR_GOLDEN_SM[] = {
+    { "sample", 16, 24, 9, -41, 23, 1 },
+    { "sample_raw", 16, 24, 9, -41, 23, 0 },
+    { "negative_offsets", 3, 40, 7, -1000, -777, 1 },
+    { "reseed_below_1", 5, 12, 0, 11, 2, 1 },
+    { "reseed_negative", 5, 12, -6, 11, 2, 1 },
+    { "hold_below_1", 0, 0, 4, 9, 9, 1 },
+    { "hold_inverted", 30, 2, 5, 1, 1, 1 },
+    { "large_offsets", 8, 64, 13, 123456789, -987654, 1 },
+};
+
+typedef struct fpsr_golden_tm {
+    const char* name;
+    int periodA, periodB, periodSwitch, seedInner, seedOuter, finalRandSwitch;
+} fpsr_golden_tm;
+
+static const fpsr_golden_tm FPSR_GOLDEN_TM[] = {
+    { "sample", 10, 25, 30, 15, 0, 1 },
+    { "sample_raw", 10, 25, 30, 15, 0, 0 },
+    { "negative_offsets", 7, 19, 11, -503, -61, 1 },
+    { "switch_below_1", 6, 9, 0, 3, 4, 1 },
+    { "switch_odd", 4, 13, 7, 0, 0, 1 },
+    { "period_below_1", 0, -3, 10, 2, 5, 1 },
+    { "large_offsets", 12, 48, 64, -123456789, 987654, 1 },
+};
+
+typedef struct fpsr_golden_qs {
+    const char* name;
+    float baseWaveFreq, stream2FreqMult;
+    int quantLevelsMinMax[2], streamsOffset[2], quantOffsets[2];
+    int streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch;
+} fpsr_golden_qs;
+
+static const fpsr_golden_qs FPSR_GOLDEN_QS[] = {
+    { "sample", 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 1 },
+    { "sample_raw", 0.012f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 24, 16, 20, 0 },
+    { "default_durations", 0.05f, 2.0f, { 2, 6 }, { 5, 9 }, { 1, 2 }, 0, 0, 0, 1 },
+    { "negative_mult", 0.03f, -1.0f, { 3, 8 }, { 0, 0 }, { 0, 0 }, 17, 11, 13, 1 },
+    { "negative_offsets", 0.02f, 1.7f, { 4, 9 }, { -300, -41 }, { -77, -5 }, 23, 19, 29, 1 },
+    { "levels_below_1", 0.08f, 3.1f, { -4, 0 }, { 0, 33 }, { 7, 3 }, 10, 5, 6, 0 },
+    { "fast_wave", 1.5f, 3.1f, { 4, 12 }, { 0, 76 }, { 10, 81 }, 0, 0, 0, 1 },
+};
+
+#define FPSR_COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+
+/******************************************************************************/
+/* Generator                                                                  */
+/******************************************************************************/
+
+static void fpsr_golden_rand(void) {
+    static const int seeds[] = {
+        0, 1, -1, 2, 7, -41, 100, 12345, -98765, 16777216, 16777217, -16777217,
+        2100000000, INT_MAX, INT_MAX - 1, INT_MIN, INT_MIN + 1
+    };
+    char params[64];
+    for (int i = 0; i < FPSR_COUNT(seeds); i++) {
+        snprintf(params, sizeof params, "\"seed\": %d", seeds[i]);
+        fpsr_golden_print("portable_rand", "seeds", 0, params, portable_rand(seeds[i]));
+    }
+}
+
+static void fpsr_golden_sm_cases(void) {
+    char params[256];
+    for (int c = 0; c < FPSR_COUNT(FPSR_GOLDEN_SM); c++) {
+        const fpsr_golden_sm* p = &FPSR_GOLDEN_SM[c];
+        const int offsets[2] = { p->seedInner, p->seedOuter };
+        snprintf(params, sizeof params,
+                 "\"minHold\": %d, \"maxHold\": %d, \"reseedInterval\": %d, \"seedInner\": %d, \"seedOuter\": %d, \"finalRandSwitch\": %d",
+                 p->minHold, p->maxHold, p->reseedInterval, p->seedInner, p->seedOuter, p->finalRandSwitch);
+        for (int k = 0; k < FPSR_GOLDEN_CENTRE_COUNT; k++) {
+            for (int i = 0; i < FPSR_GOLDEN_OFFSET_COUNT; i++) {
+                int64_t frame = FPSR_GOLDEN_CENTRES[k] + FPSR_GOLDEN_OFFSETS[i];
+                if (!fpsr_golden_fits(frame, offsets, 2)) { continue; }
+                fpsr_golden_print("sm", p->name, (int)frame, params,
+                                  fpsr_sm((int)frame, p->minHold, p->maxHold, p->reseedInterval,
+                                          p->seedInner, p->seedOuter, p->finalRandSwitch));
+            }
+        }
+    }
+}
+
+static void fpsr_golden_tm_cases(void) {
+    char params[256];
+    for (int c = 0; c < FPSR_COUNT(FPSR_GOLDEN_TM); c++) {
+        const fpsr_golden_tm* p = &FPSR_GOLDEN_TM[c];
+        const int offsets[2] = { p->seedInner, p->seedOuter };
+        snprintf(params, sizeof params,
+                 "\"periodA\": %d, \"periodB\": %d, \"periodSwitch\": %d, \"seedInner\": %d, \"seedOuter\": %d, \"finalRandSwitch\": %d",
+                 p->periodA, p->periodB, p->periodSwitch, p->seedInner, p->seedOuter, p->finalRandSwitch);
+        for (int k = 0; k < FPSR_GOLDEN_CENTRE_COUNT; k++) {
+            for (int i = 0; i < FPSR_GOLDEN_OFFSET_COUNT; i++) {
+                int64_t frame = FPSR_GOLDEN_CENTRES[k] + FPSR_GOLDEN_OFFSETS[i];
+                if (!fpsr_golden_fits(frame, offsets, 2)) { continue; }
+                fpsr_golden_print("tm", p->name, (int)frame, params,
+                                  fpsr_tm((int)frame, p->periodA, p->periodB, p->periodSwitch,
+                                          p->seedInner, p->seedOuter, p->finalRandSwitch));
+            }
+        }
+    }
+}
+
+static void fpsr_golden_qs_cases(void) {
+    char params[512];
+    for (int c = 0; c < FPSR_COUNT(FPSR_GOLDEN_QS); c++) {
+        const fpsr_golden_qs* p = &FPSR_GOLDEN_QS[c];
+        const int offsets[4] = { p->streamsOffset[0], p->streamsOffset[1], p->quantOffsets[0], p->quantOffsets[1] };
+        snprintf(params, sizeof params,
+                 "\"baseWaveFreq\": %.9g, \"stream2FreqMult\": %.9g, \"quantLevelsMinMax\": [%d, %d], "
+                 "\"streamsOffset\": [%d, %d], \"quantOffsets\": [%d, %d], \"streamSwitchDur\": %d, "
+                 "\"stream1QuantDur\": %d, \"stream2QuantDur\": %d, \"finalRandSwitch\": %d",
+                 (double)p->baseWaveFreq, (double)p->stream2FreqMult, p->quantLevelsMinMax[0], p->quantLevelsMinMax[1],
+                 p->streamsOffset[0], p->streamsOffset[1], p->quantOffsets[0], p->quantOffsets[1],
+                 p->streamSwitchDur, p->stream1QuantDur, p->stream2QuantDur, p->finalRandSwitch);
+        for (int k = 0; k < FPSR_GOLDEN_CENTRE_COUNT; k++) {
+            for (int i = 0; i < FPSR_GOLDEN_OFFSET_COUNT; i++) {
+                int64_t frame = FPSR_GOLDEN_CENTRES[k] + FPSR_GOLDEN_OFFSETS[i];
+                if (!fpsr_golden_fits(frame, offsets, 4)) { continue; }
+                fpsr_golden_print("qs", p->name, (int)frame, params,
+                                  fpsr_qs((int)frame, p->baseWaveFreq, p->stream2FreqMult, p->quantLevelsMinMax,
+                                          p->streamsOffset, p->quantOffsets, p->streamSwitchDur,
+                                          p->stream1QuantDur, p->stream2QuantDur, p->finalRandSwitch));
+            }
+        }
+    }
+}
+
+int main(void) {
+    fpsr_golden_rand();
+    fpsr_golden_sm_cases();
+    fpsr_golden_tm_cases();
+    fpsr_golden_qs_cases();
+    return 0;
+}
@@ -0,0 +1,82 @@
+# SPDX-License-Identifier: MIT — See LICENSE for full terms
+# Created by Patrick Woo, 2025.
+# This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+# https://github.com/patwooky/fpsr
+
+'''
+file: fpsr_numpy.py
+brief: NumPy batch versions of the FPS-R algorithms, computed natively.
+details:
+    portable_rand(), fpsr_sm(), fpsr_tm() and fpsr_qs() take the arguments of
+    the functions of the same names in fpsr_algorithms.py, but any of them may
+    be a NumPy array: arrays broadcast against each other, so a row of frames
+    and a column of per-entity seeds give an entities x frames result. Every
+    element has the same bits as the pure-Python function returns for it.
+
+    The work is done by the ufuncs of the fpsr_numpy_ext extension (see
+    fpsr_numpy_ext.c for the build line), which release the GIL while they
+    run, so several Python threads can evaluate at once. Pass out= a float64
+    array to have the results written into it in place; the same array is
+    returned.
+
+    Integer arguments are taken as int64. For fpsr_qs(), each of the pairs
+    quantLevelsMinMax, streamsOffset and quantOffsets may be a list of two
+    scalars or of two arrays. Where the Python fpsr_qs() would raise (a
+    duration < 1 with baseWaveFreq 0) the result is NaN.
+
+    Example:
+        frames = numpy.arange(0, 1_000_000)
+        seeds = numpy.arange(0, 512)[:, None]
+        values = fpsr_numpy.fpsr_sm(frames, 16, 24, 9, -41, seeds)  # shape (512, 1000000)
+'''
+
+import fpsr_numpy_ext as _native
+
+
+def portable_rand(seed, out=None):
+    """
+    portable_rand() of fpsr_algorithms.py over an array of seeds (int or float).
+
+    Args:
+        seed: An int / float or an array of them.
+        out: Optional float64 array, written in place.
+
+    Returns:
+        numpy.ndarray or numpy.float64: The pseudo-random values in [0.0, 1.0).
+    """
+    return _native.portable_rand(seed, out=out)
+
+
+def fpsr_sm(frame, minHold, maxHold, reseedInterval, seedInner, seedOuter, finalRandSwitch=True, out=None):
+    """
+    fpsr_sm() of fpsr_algorithms.py; any argument may be an array.
+
+    Returns:
+        numpy.ndarray or numpy.float64: The held random values, or the raw states if finalRandSwitch is False.
+    """
+    return _native.sm(frame, minHold, maxHold, reseedInterval, seedInner, seedOuter, finalRandSwitch, out=out)
+
+
+def fpsr_tm(frame, periodA, periodB, periodSwitch, seedInner, seedOuter, finalRandSwitch=True, out=None):
+    """
+    fpsr_tm() of fpsr_algorithms.py; any argument may be an array.
+
+    Returns:
+        numpy.ndarray or numpy.float64: The held random values, or the raw states if finalRandSwitch is False.
+    """
+    return _native.tm(frame, periodA, periodB, periodSwitch, seedInner, seedOuter, finalRandSwitch, out=out)
+
+
+def fpsr_qs(frame, baseWaveFreq, stream2FreqMult, quantLevelsMinMax, streamsOffset, quantOffsets,
+            streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch=True, out=None):
+    """
+    fpsr_qs() of fpsr_algorithms.py; any argument, or either half of a pair, may be an array.
+
+    Returns:
+        numpy.ndarray or numpy.float64: The switched, quantised values.
+    """
+    return _native.qs(frame, baseWaveFreq, stream2FreqMult,
+                      quantLevelsMinMax[0], quantLevelsMinMax[1],
+                      streamsOffset[0], streamsOffset[1],
+                      quantOffsets[0], quantOffsets[1],
+                      streamSwitchDur, stream1QuantDur, stream2QuantDur, finalRandSwitch, out=out)
@@ -0,0 +1,112 @@
+# SPDX-License-Identifier: MIT — See LICENSE for full terms
+# Created by Patrick Woo, 2025.
+# This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+# https://github.com/patwooky/fpsr
+
+'''
+file: fpsr_numpy_bench.py
+brief: Benchmarks fpsr_numpy against the pure-Python fpsr_algorithms module.
+details:
+    For portable_rand, SM, TM and QS (the sample presets of
+    fpsr_algorithms.py) and for SM over entities x frames, prints the ns per
+    value of a Python loop calling fpsr_algorithms, of one fpsr_numpy call
+    writing into a preallocated out= array, and of the same call split
+    across --threads Python threads (which only helps because the ufuncs
+    release the GIL). It also checks that every value of the Python run has
+    the same bits in the NumPy result, and exits 1 if one does not.
+
+    Usage (after building fpsr_numpy_ext, see fpsr_numpy_ext.c):
+        python fpsr_numpy_bench.py [--frames N] [--python-frames N] [--threads N]
+'''
+
+import argparse
+import contextlib
+import io
+import os
+import sys
+import threading
+import time
+
+import numpy
+
+with contextlib.redirect_stdout(io.StringIO()):  # the module prints its samples on import
+    import fpsr_algorithms
+import fpsr_numpy
+
+SM = (16, 24, 9, -41, 23)
+TM = (10, 25, 30, 15, 0)
+QS = (0.012, 3.1, [4, 12], [0, 76], [10, 81], 24, 16, 20)
+ENTITIES = 256
+
+
+def cases():
+    """(name, python function of a frame index, numpy function of a frame array and out array)."""
+    def entity(i):
+        return i // ENTITIES, i % ENTITIES  # row = frame, column = entity
+
+    seeds = numpy.arange(ENTITIES, dtype=numpy.int64)
+    return [
+        ('portable_rand', lambda i: fpsr_algorithms.portable_rand(i),
+         lambda f, out: fpsr_numpy.portable_rand(f, out=out)),
+        ('sm', lambda i: fpsr_algorithms.fpsr_sm(i, *SM),
+         lambda f, out: fpsr_numpy.fpsr_sm(f, *SM, out=out)),
+        ('tm', lambda i: fpsr_algorithms.fpsr_tm(i, *TM),
+         lambda f, out: fpsr_numpy.fpsr_tm(f, *TM, out=out)),
+        ('qs', lambda i: fpsr_algorithms.fpsr_qs(i, *QS),
+         lambda f, out: fpsr_numpy.fpsr_qs(f, *QS, out=out)),
+        ('sm entities', lambda i: fpsr_algorithms.fpsr_sm(entity(i)[0], *SM[:4], entity(i)[1]),
+         lambda f, out: fpsr_numpy.fpsr_sm((f[::ENTITIES] // ENTITIES)[:, None], *SM[:4], seeds,
+                                           out=out.reshape(-1, ENTITIES))),
+    ]
+
+
+def threaded(function, frames, out, threads):
+    """Runs function over frames split into slices of whole entity rows, one per thread."""
+    bounds = numpy.linspace(0, len(frames) // ENTITIES, threads + 1).astype(int) * ENTITIES
+    workers = [threading.Thread(target=function, args=(frames[a:b], out[a:b])) for a, b in zip(bounds, bounds[1:])]
+    for w in workers:
+        w.start()
+    for w in workers:
+        w.join()
+
+
+def best_of(runs, function):
+    best = float('inf')
+    for _ in range(runs):
+        start = time.perf_counter()
+        function()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[2].strip())
+    parser.add_argument('--frames', type=int, default=2_000_000, help='values per NumPy call')
+    parser.add_argument('--python-frames', type=int, default=100_000, help='values computed by the Python loop')
+    parser.add_argument('--threads', type=int, default=os.cpu_count() or 1, help='threads for the threaded run')
+    args = parser.parse_args()
+    count = max(args.frames, args.python_frames)
+    count -= count % ENTITIES  # whole rows for the entities case
+
+    print('%-14s %14s %14s %14s %9s  %s' % ('function', 'python ns', 'numpy ns', 'threads ns', 'speedup', 'bits'))
+    failed = False
+    for name, python_function, numpy_function in cases():
+        frames = numpy.arange(count, dtype=numpy.int64)
+        out = numpy.empty(count, dtype=numpy.float64)
+
+        start = time.perf_counter()
+        expected = [python_function(i) for i in range(args.python_frames)]
+        python_ns = (time.perf_counter() - start) * 1e9 / args.python_frames
+
+        numpy_ns = best_of(3, lambda: numpy_function(frames, out)) * 1e9 / count
+        same = out[:args.python_frames].tobytes() == numpy.array(expected, dtype=numpy.float64).tobytes()
+        failed |= not same
+        threads_ns = best_of(3, lambda: threaded(numpy_function, frames, out, args.threads)) * 1e9 / count
+        print('%-14s %14.1f %14.2f %14.2f %8.0fx  %s' % (name, python_ns, numpy_ns, threads_ns, python_ns / numpy_ns,
+                                                       'same' if same else 'DIFFER'))
+    print('(%d values per NumPy call, %d threads)' % (count, args.threads))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
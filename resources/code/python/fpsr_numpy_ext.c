@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: MIT — See LICENSE for full terms
+// Created by Patrick Woo, 2025.
+// This file is part of the FPS-R (Frame-Persistent Stateless Randomisation) project.
+// https://github.com/patwooky/fpsr
+
+/**
+ * @file fpsr_numpy_ext.c
+ * @brief Native NumPy ufuncs computing fpsr_algorithms.py bit for bit.
+ * @details Defines the extension module fpsr_numpy_ext with four ufuncs,
+ * portable_rand, sm, tm and qs, one element per call of the matching Python
+ * function. Use them through fpsr_numpy.py, which takes the same arguments
+ * as fpsr_algorithms.py.
+ *
+ * The kernels follow the Python module, not the C reference: Python
+ * evaluates in double precision, its % floors towards minus infinity, int()
+ * truncates, and math.sin() / math.fmod() are the C library's sin() / fmod().
+ * The kernels do the same in that order, with int64 for Python's integers,
+ * so every output has the bits the Python function returns. (The C reference
+ * computes in float and int32 and does not: see
+ * ../c_reference/fpsr_reference_crosscheck.py.) Integer arguments and sums
+ * such as seedOuter + frame must fit in int64.
+ *
+ * Being ufuncs, they broadcast their arguments, so frames and per-entity
+ * seeds can be arrays of any compatible shapes, write into an out= array in
+ * place (float64, to avoid a cast), and run without the GIL: NumPy releases
+ * it around the inner loops, which call no Python API.
+ *
+ * Build (POSIX; from this directory):
+ *     cc -std=c11 -O2 -ffp-contract=off -shared -fPIC $(python3-config --includes) \
+ *        -I$(python3 -c "import numpy; print(numpy.get_include())") \
+ *        fpsr_numpy_ext.c -lm -o fpsr_numpy_ext$(python3-config --extension-suffix)
+ */
+
+#define PY_SSIZE_T_CLEAN
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+
+#include <Python.h>
+
+#include <math.h> // For sin(), fmod(), fma() and floor()
+#include <stdint.h> // For int64_t
+
+#include <numpy/ndarraytypes.h>
+#include <numpy/ufuncobject.h>
+
+
+/******************************************************************************/
+/* Kernels: fpsr_algorithms.py, line for line                                 */
+/******************************************************************************/
+
+/** @brief Python's a % d for d >= 1. */
+static inline int64_t fpsr_numpy_mod(int64_t a, int64_t d) {
+    const int64_t r = a % d;
+    return r < 0 ? r + d : r;
+}
+
+/**
+ * @brief fmod(x, 2 * math.pi), bit for bit, without the libm call.
+ * @details fmod() is exact, so any exact remainder has its bits; glibc's
+ * takes ~90 ns, most of portable_rand(). Below 2^52 turns the quotient q is
+ * an exact integer, the true x - q * y fits 53 bits (its unit is at least
+ * the ulp of y, and it stays under 8), so one fma() gives it exactly, and
+ * moving it by one y into fmod()'s range is exact too.
+ */
+static inline double fpsr_numpy_fmod_two_pi(double x) {
+    const double y = 2.0 * 3.141592653589793;
+    if (!(fabs(x) < 0x1p52 * y)) {
+        return fmod(x, y);
+    }
+    double r = fma(-trunc(x / y), y, x);
+    if (x >= 0.0) {
+        if (r < 0.0) { r += y; } else if (r >= y) { r -= y; }
+    } else {
+        if (r > 0.0) { r -= y; } else if (r <= -y) { r += y; }
+    }
+    return r == 0.0 ? copysign(0.0, x) : r;
+}
+
+/** @brief portable_rand(seed); float(seed) is the caller's cast to double. */
+static inline double fpsr_numpy_portable_rand(double seed) {
+    const double val = fpsr_numpy_fmod_two_pi(seed * 12.9898);
+    const double result = sin(val) * 43758.5453;
+    return result - floor(result);
+}
+
+static inline double fpsr_numpy_sm(int64_t frame, int64_t minHold, int64_t maxHold, int64_t reseedInterval,
+                                   int64_t seedInner, int64_t seedOuter, int64_t finalRandSwitch) {
+    if (reseedInterval < 1) { reseedInterval = 1; }
+    const double rand_for_duration = fpsr_numpy_portable_rand((double)(seedInner + frame - fpsr_numpy_mod(frame, reseedInterval)));
+    int64_t holdDuration = (int64_t)floor((double)minHold + rand_for_duration * (double)(maxHold - minHold));
+    if (holdDuration < 1) { holdDuration = 1; }
+    const int64_t held_integer_state = (seedOuter + frame) - fpsr_numpy_mod(seedOuter + frame, holdDuration);
+    return finalRandSwitch ? fpsr_numpy_portable_rand((double)held_integer_state) : (double)held_integer_state;
+}
+
+static inline double fpsr_numpy_tm(int64_t frame, int64_t periodA, int64_t periodB, int64_t periodSwitch,
+                                   int64_t seedInner, int64_t seedOuter, int64_t finalRandSwitch) {
+    if (periodSwitch < 1) { periodSwitch = 1; }
+    int64_t holdDuration = (double)fpsr_numpy_mod(seedInner + frame, periodSwitch) < (double)periodSwitch * 0.5
+        ? periodA : periodB;
+    if (holdDuration < 1) { holdDuration = 1; }
+    const int64_t outer_clock_frame = seedOuter + frame;
+    const int64_t held_integer_state = outer_clock_frame - fpsr_numpy_mod(outer_clock_frame, holdDuration);
+    return finalRandSwitch ? fpsr_numpy_portable_rand((double)held_integer_state * 100000.0)
+                           : (double)held_integer_state;
+}
+
+/**
+ * @brief A QS duration: the given one, or floor(period * factor) if it is < 1, then at least 1.
+ * @return 0 where Python's math.floor() would raise (baseWaveFreq 0 or not finite).
+ */
+static inline int fpsr_numpy_qs_duration(int64_t duration, double baseWaveFreq, double factor, int64_t* out) {
+    if (duration < 1) {
+        const double d = floor((1.0 / baseWaveFreq) * factor);
+        if (!(d > -9.2e18 && d < 9.2e18)) {
+            return 0;
+        }
+        duration = (int64_t)d;
+    }
+    *out = duration < 1 ? 1 : duration;
+    return 1;
+}
+
+static inline int64_t fpsr_numpy_qs_level(int64_t quantOffset, int64_t frame, int64_t quantDur,
+                                          int64_t quant_min, int64_t quant_range) {
+    const int64_t quant_seed = (quantOffset + frame) - fpsr_numpy_mod(quantOffset + frame, quantDur);
+    const int64_t quant_level = quant_min + (int64_t)floor(fpsr_numpy_portable_rand((double)quant_seed) * (double)quant_range);
+    return quant_level < 1 ? 1 : quant_level;
+}
+
+/** @brief fpsr_qs(); NaN where the Python function would raise. */
+static inline double fpsr_numpy_qs(int64_t frame, double baseWaveFreq, double stream2FreqMult,
+                                   int64_t quantMin, int64_t quantMax, int64_t streamOffset1, int64_t streamOffset2,
+                                   int64_t quantOffset1, int64_t quantOffset2, int64_t streamSwitchDur,
+                                   int64_t stream1QuantDur, int64_t stream2QuantDur, int64_t finalRandSwitch) {
+    if (!fpsr_numpy_qs_duration(streamSwitchDur, baseWaveFreq, 0.76, &streamSwitchDur) ||
+        !fpsr_numpy_qs_duration(stream1QuantDur, baseWaveFreq, 1.2, &stream1QuantDur) ||
+        !fpsr_numpy_qs_duration(stream2QuantDur, baseWaveFreq, 0.9, &stream2QuantDur)) {
+        return NAN;
+    }
+    const int64_t quant_range = quantMax - quantMin + 1;
+    const int64_t s1_quant_level = fpsr_numpy_qs_level(quantOffset1, frame, stream1QuantDur, quantMin, quant_range);
+    const int64_t s2_quant_level = fpsr_numpy_qs_level(quantOffset2, frame, stream2QuantDur, quantMin, quant_range);
+
+    if (stream2FreqMult < 0) { stream2FreqMult = 3.7; }
+
+    const double stream1 = floor((sin((double)(streamOffset1 + frame) * baseWaveFreq) / 2.0 + 0.5) * (double)s1_quant_level)
+                           / (double)s1_quant_level;
+    const double stream2 = floor((sin((double)(streamOffset2 + frame) * baseWaveFreq * stream2FreqMult) / 2.0 + 0.5) *
+                                 (double)s2_quant_level) / (double)s2_quant_level;
+
+    const double active_stream_val =
+        (double)fpsr_numpy_mod(frame, streamSwitchDur) < (double)streamSwitchDur / 2.0 ? stream1 : stream2;
+
+    return finalRandSwitch ? fpsr_numpy_portable_rand((double)(int64_t)(active_stream_val * 100000.0))
+                           : 0.5 * active_stream_val + 0.5;
+}
+
+
+/******************************************************************************/
+/* Ufunc loops                                                                */
+/******************************************************************************/
+
+#define FPSR_NUMPY_I64(k) (*(const int64_t*)(args[k] + i * steps[k]))
+#define FPSR_NUMPY_F64(k) (*(const double*)(args[k] + i * steps[k]))
+
+static void fpsr_numpy_portable_rand_loop(char** args, npy_intp const* dimensions, npy_intp const* steps, void* data) {
+    (void)data;
+    for (npy_intp i = 0; i < dimensions[0]; i++) {
+        *(double*)(args[1] + i * steps[1]) = fpsr_numpy_portable_rand(FPSR_NUMPY_F64(0));
+    }
+}
+
+static void fpsr_numpy_sm_loop(char** args, npy_intp const* dimensions, npy_intp const* steps, void* data) {
+    (void)data;
+    for (npy_intp i = 0; i < dimensions[0]; i++) {
+        *(double*)(args[7] + i * steps[7]) = fpsr_numpy_sm(FPSR_NUMPY_I64(0), FPSR_NUMPY_I64(1), FPSR_NUMPY_I64(2),
+                                                           FPSR_NUMPY_I64(3), FPSR_NUMPY_I64(4), FPSR_NUMPY_I64(5),
+                                                           FPSR_NUMPY_I64(6));
+    }
+}
+
+static void fpsr_numpy_tm_loop(char** args, npy_intp const* dimensions, npy_intp const* steps, void* data) {
+    (void)data;
+    for (npy_intp i = 0; i < dimensions[0]; i++) {
+        *(double*)(args[7] + i * steps[7]) = fpsr_numpy_tm(FPSR_NUMPY_I64(0), FPSR_NUMPY_I64(1), FPSR_NUMPY_I64(2),
+                                                           FPSR_NUMPY_I64(3), FPSR_NUMPY_I64(4), FPSR_NUMPY_I64(5),
+                                                           FPSR_NUMPY_I64(6));
+    }
+}
+
+static void fpsr_numpy_qs_loop(char** args, npy_intp const* dimensions, npy_intp const* steps, void* data) {
+    (void)data;
+    for (npy_intp i = 0; i < dimensions[0]; i++) {
+        *(double*)(args[13] + i * steps[13]) = fpsr_numpy_qs(
+            FPSR_NUMPY_I64(0), FPSR_NUMPY_F64(1), FPSR_NUMPY_F64(2), FPSR_NUMPY_I64(3), FPSR_NUMPY_I64(4),
+            FPSR_NUMPY_I64(5), FPSR_NUMPY_I64(6), FPSR_NUMPY_I64(7), FPSR_NUMPY_I64(8), FPSR_NUMPY_I64(9),
+            FPSR_NUMPY_I64(10), FPSR_NUMPY_I64(11), FPSR_NUMPY_I64(12));
+    }
+}
+
+
+/******************************************************************************/
+/* Module                                                                     */
+/******************************************************************************/
+
+static PyUFuncGenericFunction fpsr_numpy_portable_rand_loops[1] = { fpsr_numpy_portable_rand_loop };
+static PyUFuncGenericFunction fpsr_numpy_sm_loops[1] = { fpsr_numpy_sm_loop };
+static PyUFuncGenericFunction fpsr_numpy_tm_loops[1] = { fpsr_numpy_tm_loop };
+static PyUFuncGenericFunction fpsr_numpy_qs_loops[1] = { fpsr_numpy_qs_loop };
+static void* fpsr_numpy_no_data[1] = { NULL };
+
+static const char fpsr_numpy_portable_rand_types[2] = { NPY_DOUBLE, NPY_DOUBLE };
+static const char fpsr_numpy_modulo_types[8] = {
+    NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_DOUBLE,
+};
+static const char fpsr_numpy_qs_types[14] = {
+    NPY_INT64, NPY_DOUBLE, NPY_DOUBLE, NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64,
+    NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_INT64, NPY_DOUBLE,
+};
+
+static int fpsr_numpy_add(PyObject* module, PyUFuncGenericFunction* loops, const char* types, int nin,
+                          const char* name, const char* doc) {
+    PyObject* ufunc = PyUFunc_FromFuncAndData(loops, fpsr_numpy_no_data, (char*)types, 1, nin, 1, PyUFunc_None,
+                                              name, doc, 0);
+    if (!ufunc) {
+        return -1;
+    }
+    if (PyModule_AddObject(module, name, ufunc) < 0) {
+        Py_DECREF(ufunc);
+        return -1;
+    }
+    return 0;
+}
+
+static struct PyModuleDef fpsr_numpy_module = {
+    PyModuleDef_HEAD_INIT,
+    "fpsr_numpy_ext",
+    "Native ufuncs computing fpsr_algorithms.py bit for bit; see fpsr_numpy.py.",
+    -1,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+PyMODINIT_FUNC PyInit_fpsr_numpy_ext(void) {
+    import_array();
+    import_umath();
+
+    PyObject* module = PyModule_Create(&fpsr_numpy_module);
+    if (!module) {
+        return NULL;
+    }
+    if (fpsr_numpy_add(module, fpsr_numpy_portable_rand_loops, fpsr_numpy_portable_rand_types, 1, "portable_rand",
+                       "portable_rand(seed, /, out=None)") < 0 ||
+        fpsr_numpy_add(module, fpsr_numpy_sm_loops, fpsr_numpy_modulo_types, 7, "sm",
+                       "sm(frame, minHold, maxHold, reseedInterval, seedInner, seedOuter, finalRandSwitch, /, out=None)") < 0 ||
+        fpsr_numpy_add(module, fpsr_numpy_tm_loops, fpsr_numpy_modulo_types, 7, "tm",
+                       "tm(frame, periodA, periodB, periodSwitch, seedInner, seedOuter, finalRandSwitch, /, out=None)") < 0 ||
+        fpsr_numpy_add(module, fpsr_numpy_qs_loops, fpsr_numpy_qs_types, 13, "qs",
+                       "qs(frame, baseWaveFreq, stream2FreqMult, quantMin, quantMax, streamOffset1, streamOffset2, "
+                       "quantOffset1, quantOffset2, streamSwitchDur, stream1QuantDur, stream2QuantDur, "
+                       "finalRandSwitch, /, out=None)") < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}